@@ -25,6 +25,7 @@ implementation {
   components GPSmonitorC;
   TagnetC.InfoSensGpsXyz        -> GPSmonitorC;
   TagnetC.InfoSensGpsCmd        -> GPSmonitorC;
+  TagnetC.GpsFilter             -> GPSmonitorC;
 
   GPSmonitorC.GPSControl        -> GpsPort;
   GPSmonitorC.GPSTransmit       -> GpsPort;
@@ -53,6 +54,34 @@ implementation {
   TagnetC.DblkLastRecOffset     -> CollectC.DblkLastRecOffset;
   TagnetC.DblkLastSyncOffset    -> CollectC.DblkLastSyncOffset;
   TagnetC.DblkCommittedOffset   -> CollectC.DblkCommittedOffset;
+  TagnetC.DblkDropNorm          -> CollectC.DblkDropNorm;
+  TagnetC.DblkDropBulk          -> CollectC.DblkDropBulk;
+  TagnetC.DblkDropDtype         -> CollectC.DblkDropDtype;
+
+  components FileSystemC;
+  TagnetC.DblkCacheHits         -> FileSystemC.DblkCacheHits;
+  TagnetC.DblkCacheMisses       -> FileSystemC.DblkCacheMisses;
+  TagnetC.DblkCacheFillMax      -> FileSystemC.DblkCacheFillMax;
+
+  components DblkManagerC;
+  TagnetC.DblkOldestOffset      -> DblkManagerC.DblkOldestOffset;
+  TagnetC.DblkOldestRecnum      -> DblkManagerC.DblkOldestRecnum;
+  TagnetC.DblkEraseWin          -> DblkManagerC.DblkEraseWin;
+
+  components DblkIndexC;
+  TagnetC.DblkFindRec           -> DblkIndexC.DblkFindRec;
+  TagnetC.DblkFindAgo           -> DblkIndexC.DblkFindAgo;
+  TagnetC.DblkUsecs             -> CollectC.DblkUsecs;
+
+  components SSWriteC;
+  TagnetC.SswGroup              -> SSWriteC.SswGroup;
+  TagnetC.SswBufs               -> SSWriteC.SswBufs;
+  TagnetC.SswMaxFull            -> SSWriteC.SswMaxFull;
+  TagnetC.SswLatP50             -> SSWriteC.SswLatP50;
+  TagnetC.SswLatP95             -> SSWriteC.SswLatP95;
+
+  components SD0_ArbP;
+  TagnetC.SDHold                -> SD0_ArbP.SDHold;
 
   components new TimerMilliC()  as Timer0;
   TagnetMonitorP.rcTimer        -> Timer0;
@@ -352,12 +352,21 @@ implementation {
   }
 
   event void Timer.fired() {
-    dt_header_t t;
+    dc_resv_t *rp;
+    uint8_t   *src;
+    uint8_t    i;
 
     nop();
-    t.len   = sizeof(dt_header_t) + 256;
-    t.dtype = DT_TEST;
-    t.pad   = 0;
-    call Collect.collect((void *) &t, sizeof(t), dxx, 256);
+    rp = call Collect.reserve(DT_TEST, sizeof(dt_header_t), 256);
+    if (!rp)
+      return;
+    rp->hdr->len   = sizeof(dt_header_t) + 256;
+    rp->hdr->dtype = DT_TEST;
+    src = dxx;
+    for (i = 0; i < rp->nfrags; i++) {
+      memcpy(rp->data[i], src, rp->dlen[i]);
+      src += rp->dlen[i];
+    }
+    call Collect.commit();
   }
 }
@@ -100,6 +100,12 @@ typedef struct {
  * a start and end address.
  *
  * ie.  PANIC has fsc.loc[FS_AREA_PANIC].loc_start and loc_end.
+ *
+ * A FAT file tops out at 4 GiB, so on bigger SDs the data stream spans
+ * more than one DBLK file (DBLK0001, DBLK0002, ...).  DBLK file n
+ * (file_idx n, see dblk_dir.h) lives at FS_LOC_DBLK + n - 1, the rest
+ * of the locators.  FS_LOC_MAX areas must be there.  Extra DBLK
+ * locators not being used are 0.
  */
 
 enum fs_loc_indicies {
@@ -110,6 +116,8 @@ enum fs_loc_indicies {
   FS_LOC_MAX         = 4,
 };
 
+#define FS_DBLK_FILES_MAX (MAX_FS_LOCATORS - FS_LOC_DBLK)
+
 #define FS_LOC_SIZE_SHORTS  (sizeof(fs_loc_t)/2)
 
 #define FUBAR_REALLY_REALLY_FUBARD UINT32_C(0x08313108)
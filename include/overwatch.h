@@ -219,6 +219,14 @@ typedef struct {
   uint32_t           vec_chk_fail;
   uint32_t           image_chk_fail;
 
+  /*
+   * dblk_nxt hint.  DblkManager keeps the last committed dblk_nxt here
+   * so a warm reboot doesn't have to search for it.  dblk_hint_chk ties
+   * the hint to the Dblk Area it came from.
+   */
+  uint32_t           dblk_nxt_hint;
+  uint32_t           dblk_hint_chk;
+
   uint32_t           ow_sig_c;
 } PACKED ow_control_block_t;
 
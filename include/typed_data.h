@@ -42,7 +42,7 @@
 /*
  * identify what revision of typed_data.h we are using for this build
  */
-#define DT_H_REVISION 16
+#define DT_H_REVISION 24
 
 /*
  * Sync records are used to make sure we can always find the data stream if
@@ -74,6 +74,7 @@ typedef enum {
   DT_SYNC		= 3,
   DT_EVENT              = 4,
   DT_DEBUG		= 5,
+  DT_INDEX		= 6,		/* sparse recnum/time index */
 
   DT_GPS_VERSION        = 16,
   DT_GPS_TIME		= 17,
@@ -84,6 +85,9 @@ typedef enum {
   DT_TEST		= 22,
   DT_NOTE		= 23,
   DT_CONFIG		= 24,
+  DT_GPS_FILTER		= 25,		/* raw gps logging policy */
+  DT_GPS_FIX		= 26,		/* nav solution, MID 41 (+ MID 2) */
+  DT_GPS_TRACK		= 27,		/* delta encoded fixes */
 
   /*
    * GPS_RAW is used to encapsulate data as received from the GPS.
@@ -136,6 +140,33 @@ typedef struct {                /* size 20 */
 } PACKED dt_header_t;
 
 
+/*
+ * High resolution time stamps (usecs)
+ *
+ * systime is binary ms (1/1024 sec).  When Collect's usecs option is on
+ * (Tagnet <node>/tag/sd/0/dblk/.usecs), records also carry the value of
+ * Platform.usecsRaw (free running 32 bit, 1us) as a 4 byte trailer, the
+ * last 4 bytes of the record.  len includes the trailer and DT_F_USECS
+ * is set in dtype.
+ *
+ * For records stamped by Collect (collect and commit) usecs is read
+ * together with systime.  For the _nots variants systime came from the
+ * producer (say GPS arrival) and usecs is when the record went into the
+ * stream, the difference is our own pipeline latency.
+ *
+ * usecs wraps every ~71 minutes, systime says which lap.  The ms and us
+ * clocks aren't locked together so only usecs deltas are meaningful at
+ * us resolution.  REBOOT, VERSION, SYNC, and INDEX (the CRIT records
+ * that framing depends on) never carry a trailer.
+ */
+#define DT_F_USECS  0x8000
+#define DT_TYPE(d)  ((d) & ~DT_F_USECS)
+
+typedef struct {
+  uint32_t usecs;               /* Platform.usecsRaw */
+} PACKED dt_usecs_t;
+
+
 /*
  * SYNCing:
  *
@@ -174,7 +205,7 @@ typedef struct {                /* size 20 */
  */
 
 typedef struct {
-  uint16_t len;                 /* size 44 +    84      */
+  uint16_t len;                 /* size 48 +    92      */
   dtype_t  dtype;               /* reboot  + ow_control */
   uint32_t recnum;
   uint64_t systime;             /* 2quad alignment */
@@ -188,6 +219,7 @@ typedef struct {
   uint32_t dt_h_revision;       /* version identifier of typed_data */
                                 /* and associated structures        */
   uint32_t base;                /* base address of running image    */
+  uint32_t prev_sync_hi;        /* same place as in sync */
 } PACKED dt_reboot_t;
 
 typedef struct {
@@ -218,8 +250,23 @@ typedef struct {
 } dt_dump_version_t;
 
 
+/*
+ * drop_norm/drop_bulk: records shed by Collect since the previous SYNC
+ * (see collect.h).  Follow sync_majik so the majik stays at the same
+ * offset as in the REBOOT record.
+ *
+ * prev_index: file offset of the last DT_INDEX record laid down before
+ * this SYNC, 0 if none yet this boot.
+ *
+ * File offsets are logical offsets into the whole data stream (see
+ * DblkManagerP) and are 64 bits.  Offsets kept in records are the low
+ * 32 bits.  They always point back at something less than 4 GiB before
+ * the record holding them, DT_OFF64 recovers the rest.  prev_sync_hi
+ * (SYNC and REBOOT) is the high word of prev_sync, so a SYNC found
+ * cold knows where it is in the stream.
+ */
 typedef struct {
-  uint16_t   len;               /* size 36 */
+  uint16_t   len;               /* size 48 */
   dtype_t    dtype;
   uint32_t   recnum;
   uint64_t   systime;
@@ -227,8 +274,59 @@ typedef struct {
   datetime_t datetime;          /* 10 bytes */
   uint32_t   prev_sync;         /* file offset */
   uint32_t   sync_majik;
+  uint16_t   drop_norm;         /* NORM records dropped */
+  uint16_t   drop_bulk;         /* BULK records dropped */
+  uint32_t   prev_index;        /* file offset */
+  uint32_t   prev_sync_hi;      /* high word of prev_sync */
 } PACKED dt_sync_t;             /* quad granular */
 
+/* full offset of 32 bit file offset lo, at or before (64 bit) ref */
+#define DT_OFF64(ref, lo) ((ref) - (uint32_t) ((uint32_t) (ref) - (lo)))
+
+
+/*
+ * index record
+ *
+ * A sparse index over the data stream so a record can be found by
+ * recnum or systime without walking the stream.  It is a tree laid down
+ * bottom up as the data goes by.
+ *
+ * Each entry holds the recnum, systime, and file offset of a record.  A
+ * level 0 DT_INDEX indexes DT_INDEX_FAN consecutive SYNC/REBOOT records.
+ * A level n DT_INDEX indexes DT_INDEX_FAN consecutive level n-1 DT_INDEX
+ * records, each entry is the first entry of that record with its offset
+ * replaced by the offset of the DT_INDEX record itself.
+ *
+ * prev_index links each DT_INDEX to the previous one at the same level
+ * (0, first at this level since boot).  Together with prev_index in the
+ * SYNC record this turns the prev_sync chain into a skip list.
+ *
+ * systime restarts on every reboot.  Index entries (and prev_index
+ * chains) only cover the boot they were laid down in.
+ *
+ * entries follow the dt_index_t header, count of them.
+ */
+
+#define DT_INDEX_FAN    16
+#define DT_INDEX_LEVELS 4
+
+typedef struct {
+  uint64_t systime;             /* 2quad alignment */
+  uint32_t recnum;
+  uint32_t offset;              /* file offset */
+} PACKED dt_index_ent_t;
+
+typedef struct {
+  uint16_t len;                 /* size 24 + count * 16 */
+  dtype_t  dtype;
+  uint32_t recnum;
+  uint64_t systime;
+  uint16_t recsum;              /* part of header */
+  uint8_t  level;
+  uint8_t  count;               /* number of entries */
+  uint32_t prev_index;          /* file offset, same level */
+} PACKED dt_index_t;            /* entries 2quad aligned */
+
 
 typedef enum {
   DT_EVENT_SURFACED         = 1,
@@ -332,6 +430,162 @@ typedef struct {
 #define GPS_DIR_TX 1
 
 
+/*
+ * GPS raw filter, DT_GPS_FILTER
+ *
+ * GPSmonitor decides per MID which received SiRF packets get logged as
+ * DT_GPS_RAW_SIRFBIN.  The policy table is written to the data stream
+ * as a DT_GPS_FILTER at boot and whenever it changes, along with how
+ * many packets each entry passed and dropped since the last one.
+ *
+ * Entry 0 is the default, it covers any MID without its own entry
+ * (its mid is 0, not a SiRF MID).
+ *
+ *   ALWAYS     log every one
+ *   NEVER      log none
+ *   NTH        log the first and then 1 of every n
+ *   CHANGE     log if the payload (by its SiRF checksum) differs from
+ *              the last one logged for that entry
+ *   ACQ        log only while we don't have a fix
+ *
+ * entries follow the dt_gps_filter_t header, count of them.
+ */
+typedef enum {
+  GPS_FILT_ALWAYS       = 0,
+  GPS_FILT_NEVER        = 1,
+  GPS_FILT_NTH          = 2,
+  GPS_FILT_CHANGE       = 3,
+  GPS_FILT_ACQ          = 4,
+  GPS_FILT_MAX,
+  GPS_FILT_CLEAR        = 0xff,         /* tagnet only, drop an entry */
+} gps_filt_policy_t;
+
+#define GPS_FILT_ENTRIES 16
+
+typedef struct {
+  uint8_t  mid;
+  uint8_t  policy;
+  uint8_t  n;                   /* NTH, 1 of n */
+  uint8_t  pad;
+  uint16_t passed;              /* since last DT_GPS_FILTER */
+  uint16_t dropped;
+} PACKED dt_gps_filt_ent_t;
+
+typedef struct {
+  uint16_t len;                 /* size 24 + count * 8 */
+  dtype_t  dtype;
+  uint32_t recnum;
+  uint64_t systime;
+  uint16_t recsum;              /* part of header */
+  uint16_t gen;                 /* policy generation */
+  uint8_t  count;               /* number of entries */
+  uint8_t  fix;                 /* have a fix (ACQ) */
+  uint16_t pad;
+} PACKED dt_gps_filter_t;
+
+
+/*
+ * GPS fix and time, DT_GPS_FIX and DT_GPS_TIME
+ *
+ * GPSmonitor writes one DT_GPS_FIX per geodetic message (MID 41),
+ * stamped with when the message arrived.  It carries the status of the
+ * navigation solution, the geodetic position and the ECEF position from
+ * the last NAV_DATA (MID 2).  Without a fix (nav_valid != 0) the
+ * position doesn't mean anything and the record stops after awake
+ * (DT_GPS_FIX_STATUS_SIZE).
+ *
+ * DT_GPS_TIME is written when a fix is acquired, it ties systime to
+ * UTC.  After that tow/week_x in each DT_GPS_FIX keeps the time.
+ *
+ * All fields are native (little endian), converted from the SiRF big
+ * endian.  Units are as SiRF reports them.
+ */
+typedef struct {
+  uint16_t len;                 /* size 80, 36 without a fix */
+  dtype_t  dtype;
+  uint32_t recnum;
+  uint64_t systime;
+  uint16_t recsum;              /* part of header */
+  uint16_t nav_valid;           /* 0 says fix */
+  uint16_t nav_type;
+  uint32_t tow;                 /* time of week, s * 1000 */
+  uint16_t week_x;              /* extended week */
+  uint8_t  nsats;               /* sats in solution */
+  uint8_t  mode1;               /* last MID 2 mode1 */
+  uint8_t  hdop;                /* * 5 */
+  uint8_t  additional_mode;
+  uint32_t awake;               /* gps awake, ms */
+
+  /* position, only with a fix */
+  int32_t  lat;                 /* +N * 10^7 */
+  int32_t  lon;                 /* +E * 10^7 */
+  int32_t  alt_ell;             /* altitude ellipsoid m * 100 */
+  int32_t  alt_msl;             /* altitude msl m * 100 */
+  uint32_t ehpe;                /* m * 100 */
+  uint32_t evpe;                /* m * 100 */
+  uint16_t sog;                 /* m/s * 100 */
+  uint16_t cog;                 /* deg cw from N_t * 100 */
+  uint32_t sat_mask;            /* which sats used in solution */
+  int32_t  x;                   /* ECEF, m, from MID 2 */
+  int32_t  y;
+  int32_t  z;
+} PACKED dt_gps_fix_t;
+
+#define DT_GPS_FIX_STATUS_SIZE (offsetof(dt_gps_fix_t, lat))
+
+typedef struct {
+  uint16_t len;                 /* size 36 */
+  dtype_t  dtype;
+  uint32_t recnum;
+  uint64_t systime;
+  uint16_t recsum;              /* part of header */
+  uint32_t tow;                 /* time of week, s * 1000 */
+  uint16_t week_x;              /* extended week */
+  uint16_t utc_year;
+  uint16_t utc_ms;              /* ms into the minute */
+  uint8_t  utc_month;
+  uint8_t  utc_day;
+  uint8_t  utc_hour;
+  uint8_t  utc_min;
+  uint8_t  nsats;
+  uint8_t  pad[3];              /* quad alignment */
+} PACKED dt_gps_time_t;
+
+
+/*
+ * GPS track, DT_GPS_TRACK
+ *
+ * While we have a fix, positions are collected into a track record
+ * rather than each going out as a full DT_GPS_FIX.  The record header
+ * holds the first fix (the keyframe) at full width, systime is when it
+ * arrived.  Each following fix is 4 deltas from the one before it:
+ *
+ *   systime (ms), lat, lon, alt_msl
+ *
+ * each zig-zag encoded ((d << 1) ^ (d >> 31)) and written as a varint,
+ * 7 bits at a time, low bits first, 0x80 set on all but the last byte.
+ *
+ * Every track record starts with its own keyframe so any one of them
+ * decodes without the others.  A track record is written when the
+ * buffer fills or the fix is lost.  The keyframe fix is also logged as
+ * a full DT_GPS_FIX.
+ */
+typedef struct {
+  uint16_t len;                 /* size 40 + var */
+  dtype_t  dtype;
+  uint32_t recnum;
+  uint64_t systime;             /* keyframe arrival */
+  uint16_t recsum;              /* part of header */
+  uint16_t count;               /* fixes, including the keyframe */
+  uint32_t tow;                 /* keyframe time of week, s * 1000 */
+  int32_t  lat;                 /* +N * 10^7 */
+  int32_t  lon;                 /* +E * 10^7 */
+  int32_t  alt_msl;             /* m * 100 */
+  uint16_t week_x;
+  uint16_t pad;
+} PACKED dt_gps_track_t;
+
+
 typedef struct {
   uint16_t len;                 /* size 24 + var */
   dtype_t  dtype;
@@ -380,8 +634,13 @@ enum {
   DT_HDR_SIZE_VERSION       = sizeof(dt_version_t),
   DT_HDR_SIZE_SYNC          = sizeof(dt_sync_t),
   DT_HDR_SIZE_EVENT         = sizeof(dt_event_t),
+  DT_HDR_SIZE_INDEX         = sizeof(dt_index_t),
 
   DT_HDR_SIZE_GPS           = sizeof(dt_gps_t),
+  DT_HDR_SIZE_GPS_FILTER    = sizeof(dt_gps_filter_t),
+  DT_HDR_SIZE_GPS_FIX       = sizeof(dt_gps_fix_t),
+  DT_HDR_SIZE_GPS_TIME      = sizeof(dt_gps_time_t),
+  DT_HDR_SIZE_GPS_TRACK     = sizeof(dt_gps_track_t),
   DT_HDR_SIZE_SENSOR_DATA   = sizeof(dt_sensor_data_t),
   DT_HDR_SIZE_SENSOR_SET    = sizeof(dt_sensor_set_t),
   DT_HDR_SIZE_NOTE          = sizeof(dt_note_t),
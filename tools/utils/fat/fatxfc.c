@@ -690,13 +690,18 @@ fx_cap_dblk(char *name, char *ext, char *n_name, char *n_ext, u32_t size,
  * s and e are used to return the sector numbers of the start and end of the
  * contiguous file
  *
+ * size 0 asks for the largest group.  Either way the file is limited to
+ * what a FAT32 directory entry can hold (just under 4GiB), bigger areas
+ * have to be split across more than one file (see DBLK000n).  All the
+ * counting is done in clusters so a big card doesn't overflow a u32.
+ *
  * Both FATs are written with the new values.
  */
 
 fx_rtn
 fx_create_contig(char *name, char *ext, u32_t size, u32_t *s, u32_t *e) {
     u32_t *fat;
-    u32_t max, max_count, start, count;
+    u32_t max, max_count, start, count, need, clu_bytes;
     u32_t fat_sector, i, limit;
     fat_dir_entry_t *de;
     info_sector_t *info;
@@ -710,6 +715,11 @@ fx_create_contig(char *name, char *ext, u32_t size, u32_t *s, u32_t *e) {
     if (fx_find_file(name, ext, &start, &count) != FX_NOT_FOUND)
 	return(FX_EXIST);
 
+    clu_bytes = FX_CLUSTER_SIZE * SECTOR_SIZE;
+    need = 0xffffffffU / clu_bytes;           /* most a dir entry can say */
+    if (size && (size - 1) / clu_bytes + 1 < need)
+	need = (size - 1) / clu_bytes + 1;
+
     fat = fx_buf;
     start = count = max = max_count = done = 0;
     for (fat_sector = fx_fat_start; fat_sector <= fx_fat_end; fat_sector++) {
@@ -727,10 +737,10 @@ fx_create_contig(char *name, char *ext, u32_t size, u32_t *s, u32_t *e) {
 		      break;
 		  default:
 		      count++;
-		      if (size && count * FX_CLUSTER_SIZE * SECTOR_SIZE >= size)
-			  done = 1;
 		      break;
 		}
+		if (count >= need)
+		    done = 1;
 		if (done)
 		    break;
 	    } else
@@ -0,0 +1,672 @@
+/*
+ * Copyright 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * Mam-Mark Project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ *
+ *
+ * gpsreplay - run the GPS receive stack on the host against a dblk file
+ *
+ * The real SirfBinP, GPSMsgBufP, and GPSmonitorP are run through nc2c
+ * and built natively (see Makefile, wiring.h).  The raw rx SiRF packets
+ * (DT_GPS_RAW_SIRFBIN, dir rx) are pulled out of a dblk file (a DBLK
+ * file off a tag or a chunk of one) and turned back into a byte stream
+ * at the line rate, timed off each record's systime.  That stream is
+ * fed to SirfBinP the way Gsd4eUP does it, either a block at a time
+ * out of a GPS_RX_RING_SIZE ring (drained every DT_GPS_RX_DRAIN and on
+ * wrap) or a byte at a time (-b).
+ *
+ * typical usage:
+ *
+ * sizing:          gpsreplay -l 40000 -e 0.0001 DBLK0001
+ *                  make clean all EXTRA_CFLAGS="-DGPS_BUF_SIZE=512"
+ * benchmarking:    gpsreplay -n 100 DBLK0001
+ * watch it go:     gpsreplay -s 10 -v DBLK0001
+ *
+ * Time is simulated, -s only throttles it against the wall clock (0, as
+ * fast as we can, is the default).  Tasks (gps_receive_task, the drain)
+ * run in post order after a random latency of up to -l us which stands
+ * in for everything else the tag is doing.  That is what makes the
+ * message queue back up, see gmc.max_full and gmc.max_allocated.
+ *
+ * What the monitor tries to do to the chip (GPSControl, GPSTransmit) is
+ * counted and dropped.  MonTimer never fires, the monitor only sees the
+ * messages.  Collect and CollectEvent are counted by dtype.
+ *
+ * Throughput is time spent inside the stack (SirfBinP through the
+ * monitor) against bytes handed to it, wall clock, so run it on a quiet
+ * machine when comparing parser changes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * nesC is whole program and the headers (sirf_driver.h) lay down data,
+ * so the stack comes in as one translation unit, same as app.c.
+ */
+#include "app.c"
+
+
+#define VERSION "gpsreplay: v0.1.0  2018/06/20\n"
+
+int debug       = 0,
+    verbose     = 0;
+
+/* module state we report on */
+#define gmc           GPSMsgBufP__gmc
+#define sirfbin_stats SirfBinP__sirfbin_stats
+
+
+static struct option longopts[] = {
+  { "version",  no_argument, NULL, 'V' },
+  { "help",     no_argument, NULL, 'h' },
+  { NULL,       0,           NULL, 0 }
+};
+
+
+static void display_gpl() {
+    fprintf(stderr, "This program comes with ABSOLUTELY NO WARRANTY; for details see\n");
+    fprintf(stderr, "warranty sections in COPYING in the top level of this source tree\n\n");
+    fprintf(stderr, "This is free software, and you are welcome to redistribute it under\n");
+    fprintf(stderr, "certain conditions; see COPYING for details\n");
+}
+
+
+static void usage(char *name) {
+    fprintf(stderr, VERSION);
+    fprintf(stderr, "\n");
+    display_gpl();
+    fprintf(stderr, "\nusage: %s [-B <baud>] [-d <prob>] [-e <prob>] [-j <ms>] [-l <us>]\n", name);
+    fprintf(stderr, "          [-n <passes>] [-r <seed>] [-s <speed>] [-bDvV] dblk_file\n");
+    fprintf(stderr, "  -b           byte at a time (interrupt per byte), default block/ring\n");
+    fprintf(stderr, "  -B <baud>    line rate, default %d\n", GPS_TARGET_SPEED);
+    fprintf(stderr, "  -d <prob>    probability a byte gets dropped\n");
+    fprintf(stderr, "  -e <prob>    probability a byte takes a bit error\n");
+    fprintf(stderr, "  -h           this usage\n");
+    fprintf(stderr, "  --help\n");
+    fprintf(stderr, "  -j <ms>      arrival jitter, +/- ms (decimal) per packet\n");
+    fprintf(stderr, "  -l <us>      max task latency, us, default 0\n");
+    fprintf(stderr, "  -n <passes>  replay the file n times back to back\n");
+    fprintf(stderr, "  -r <seed>    random seed, default 1\n");
+    fprintf(stderr, "  -s <speed>   x real time, 0 (default) as fast as possible\n\n");
+    fprintf(stderr, "  -D           increment debugging level\n");
+    fprintf(stderr, "  -v           verbose mode (increment)\n");
+    fprintf(stderr, "  -V           display version\n");
+    fprintf(stderr, "  --version\n");
+    exit(2);
+}
+
+
+/*
+ * the line.  every rx byte that goes out on the wire, after error
+ * injection, and when (sim us) its stop bit is done.
+ */
+typedef struct {
+  uint8_t  *byte;
+  uint64_t *when;
+  uint32_t  count;
+  uint32_t  max;
+} line_t;
+
+static line_t line;
+
+uint32_t baud       = GPS_TARGET_SPEED;
+double   p_drop     = 0,
+         p_err      = 0,
+         jitter_ms  = 0,
+         speed      = 0;
+uint32_t latency_us = 0,
+         passes     = 1;
+int      byte_mode  = 0;
+
+/* what went by */
+uint32_t rx_recs, tx_recs, other_recs, bad_recs;
+uint32_t line_bytes, dropped, flipped, overrun_bytes, overruns;
+
+static uint64_t sim_us;                 /* current simulated time */
+
+
+static void line_add(uint8_t b, uint64_t when) {
+  if (line.count >= line.max) {
+    line.max  = line.max ? line.max * 2 : 64 * 1024;
+    line.byte = realloc(line.byte, line.max);
+    line.when = realloc(line.when, line.max * sizeof(uint64_t));
+    if (!line.byte || !line.when) {
+      fprintf(stderr, "*** out of memory\n");
+      exit(1);
+    }
+  }
+  line.byte[line.count] = b;
+  line.when[line.count] = when;
+  line.count++;
+}
+
+
+static double rnd() {
+  return drand48();
+}
+
+
+/*
+ * load: pull the rx sirfbin packets out of a dblk file and lay them
+ * out on the line.
+ *
+ * Records are quad aligned.  Anything that doesn't look like a record
+ * (len out of range, bad dtype, recsum) we step over a quad at a time,
+ * same as tagdump's resync without needing a SYNC.  Time base is the
+ * first rx packet, t0_us is where this pass starts on the line.
+ */
+static uint64_t load(uint8_t *buf, uint32_t size, uint64_t t0_us) {
+  dt_header_t *hdr;
+  dt_gps_t    *gps;
+  uint32_t     off, rlen, i, n;
+  uint16_t     dtype, sum;
+  uint64_t     st0, t, free_at, byte_us;
+  int          have_t0;
+
+  byte_us = 10 * 1000000ULL / baud;     /* 8N1, 10 bits a byte */
+  have_t0 = 0;
+  st0     = 0;
+  free_at = t0_us;
+  off     = 0;
+  while (off + sizeof(dt_header_t) <= size) {
+    hdr   = (void *) &buf[off];
+    rlen  = hdr->len;
+    dtype = hdr->dtype;
+    if (rlen < sizeof(dt_header_t) || rlen > DT_MAX_RLEN ||
+        off + rlen > size || DT_TYPE(dtype) > DT_MAX || hdr->recnum == 0) {
+      off += 4;
+      continue;
+    }
+    sum = 0;
+    for (i = 0; i < rlen; i++)
+      sum += buf[off + i];
+    sum -= (hdr->recsum & 0xff) + (hdr->recsum >> 8);
+    if (sum != hdr->recsum) {
+      bad_recs++;
+      off += 4;
+      continue;
+    }
+    if (dtype & DT_F_USECS)
+      rlen -= 4;
+    dtype = DT_TYPE(dtype);
+    if (dtype != DT_GPS_RAW_SIRFBIN || rlen <= sizeof(dt_gps_t)) {
+      other_recs++;
+      off = (off + hdr->len + 3) & ~3;
+      continue;
+    }
+    gps = (void *) hdr;
+    if (gps->dir != GPS_DIR_RX) {
+      tx_recs++;
+      off = (off + hdr->len + 3) & ~3;
+      continue;
+    }
+    rx_recs++;
+    if (!have_t0) {
+      st0 = hdr->systime;
+      have_t0 = 1;
+    }
+
+    /* systime is binary ms, arrival of the packet */
+    t = t0_us + ((hdr->systime - st0) * 1000000ULL) / 1024;
+    if (jitter_ms) {
+      int64_t j = (int64_t) ((rnd() * 2 - 1) * jitter_ms * 1000);
+      t = (j < 0 && (uint64_t) -j > t) ? 0 : t + j;
+    }
+    if (t < free_at)                    /* line is still busy */
+      t = free_at;
+    n = rlen - sizeof(dt_gps_t);
+    for (i = 0; i < n; i++) {
+      uint8_t b = buf[off + sizeof(dt_gps_t) + i];
+
+      t += byte_us;
+      line_bytes++;
+      if (p_drop && rnd() < p_drop) {
+        dropped++;
+        continue;
+      }
+      if (p_err && rnd() < p_err) {
+        b ^= 1 << (int) (rnd() * 8);
+        flipped++;
+      }
+      line_add(b, t);
+    }
+    free_at = t;
+    off = (off + hdr->len + 3) & ~3;
+  }
+  return free_at;
+}
+
+
+/*
+ * tasks.  TinyOS semantics, FIFO and a task can only be posted once
+ * until it runs.  Each post picks up a random latency but never gets
+ * ahead of what is already queued.
+ */
+#define MAX_TASKS 8
+
+typedef struct {
+  host_task_t task;
+  uint64_t    run_at;
+} task_ent_t;
+
+static task_ent_t tq[MAX_TASKS];
+static uint32_t   tq_head, tq_n;
+
+void post_task(host_task_t t) {
+  uint64_t at;
+  uint32_t i;
+
+  for (i = 0; i < tq_n; i++)
+    if (tq[(tq_head + i) % MAX_TASKS].task == t)
+      return;
+  if (tq_n >= MAX_TASKS) {
+    fprintf(stderr, "*** task queue full\n");
+    exit(1);
+  }
+  at = sim_us + (latency_us ? (uint64_t) (rnd() * latency_us) : 0);
+  if (tq_n && tq[(tq_head + tq_n - 1) % MAX_TASKS].run_at > at)
+    at = tq[(tq_head + tq_n - 1) % MAX_TASKS].run_at;
+  tq[(tq_head + tq_n) % MAX_TASKS].task   = t;
+  tq[(tq_head + tq_n) % MAX_TASKS].run_at = at;
+  tq_n++;
+}
+
+
+/*
+ * stack timing.  Everything that calls into the stack goes through
+ * stack_enter/stack_exit.
+ */
+static struct timespec st_start;
+static double stack_ns, stack_max_ns;
+static uint32_t stack_calls;
+
+static void stack_enter() {
+  clock_gettime(CLOCK_MONOTONIC, &st_start);
+}
+
+static void stack_exit() {
+  struct timespec now;
+  double ns;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  ns = (now.tv_sec - st_start.tv_sec) * 1e9 + (now.tv_nsec - st_start.tv_nsec);
+  stack_ns += ns;
+  if (ns > stack_max_ns)
+    stack_max_ns = ns;
+  stack_calls++;
+}
+
+
+/*
+ * the rx side of the driver.  rd is how far into the line we have
+ * handed to SirfBinP, the ring is the GPS_RX_RING_SIZE dma buffer.
+ * If the line gets more than a ring ahead of rd the dma has lapped the
+ * drain, those bytes are gone.
+ */
+static uint8_t  rx_ring[GPS_RX_RING_SIZE];
+static uint32_t rd, wr_posted;
+static uint32_t fed;
+
+static uint32_t line_wr() {                     /* bytes in by sim_us */
+  static uint32_t wr;
+
+  while (wr < line.count && line.when[wr] <= sim_us)
+    wr++;
+  return wr;
+}
+
+static void rx_drain() {
+  uint32_t wr, idx, n;
+
+  wr = line_wr();
+  if (wr - rd > GPS_RX_RING_SIZE) {
+    overruns++;
+    overrun_bytes += wr - rd - GPS_RX_RING_SIZE;
+    rd = wr - GPS_RX_RING_SIZE;
+  }
+  while (rd < wr) {
+    idx = rd % GPS_RX_RING_SIZE;
+    n   = wr - rd;
+    if (n > GPS_RX_RING_SIZE - idx)             /* up to the wrap */
+      n = GPS_RX_RING_SIZE - idx;
+    memcpy(&rx_ring[idx], &line.byte[rd], n);
+    stack_enter();
+    SirfBinP__GPSProto__blockAvail(&rx_ring[idx], n);
+    stack_exit();
+    rd  += n;
+    fed += n;
+  }
+}
+
+static void drain_task(void) {
+  rx_drain();
+}
+
+
+/* run the next thing, return 0 when there is nothing left to do */
+static int step(uint64_t *next_tick) {
+  uint64_t t_task, t_rx, t;
+  host_task_t task;
+  uint32_t wr;
+
+  t_task = tq_n ? tq[tq_head].run_at : UINT64_MAX;
+  t_rx   = UINT64_MAX;
+  if (byte_mode) {
+    if (rd < line.count)
+      t_rx = line.when[rd];
+  } else {
+    if (rd < line.count)
+      t_rx = *next_tick;
+  }
+  if (t_task == UINT64_MAX && t_rx == UINT64_MAX)
+    return 0;
+
+  if (t_task <= t_rx) {
+    t = t_task;
+    if (t > sim_us)
+      sim_us = t;
+    task = tq[tq_head].task;
+    tq_head = (tq_head + 1) % MAX_TASKS;
+    tq_n--;
+    if (task == drain_task)
+      task();                           /* times itself */
+    else {
+      stack_enter();
+      task();
+      stack_exit();
+    }
+    return 1;
+  }
+
+  if (t_rx > sim_us)
+    sim_us = t_rx;
+  if (byte_mode) {
+    stack_enter();
+    SirfBinP__GPSProto__byteAvail(line.byte[rd]);
+    stack_exit();
+    rd++;
+    fed++;
+    return 1;
+  }
+
+  /*
+   * block mode.  the dma wraps at a ring boundary and the driver posts
+   * the drain, otherwise the drain timer gets it.
+   */
+  *next_tick += (DT_GPS_RX_DRAIN * 1000000ULL) / 1024;
+  wr = line_wr();
+  while (wr_posted + GPS_RX_RING_SIZE <= wr) {
+    wr_posted += GPS_RX_RING_SIZE;
+    post_task(drain_task);
+  }
+  rx_drain();
+  return 1;
+}
+
+
+/* the wall clock, for -s */
+static struct timespec wall0;
+
+static void pace() {
+  struct timespec now, ts;
+  double want, have;
+
+  if (speed <= 0)
+    return;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  want = sim_us / speed / 1e6;
+  have = (now.tv_sec - wall0.tv_sec) + (now.tv_nsec - wall0.tv_nsec) / 1e9;
+  if (want <= have)
+    return;
+  want -= have;
+  ts.tv_sec  = (time_t) want;
+  ts.tv_nsec = (long) ((want - ts.tv_sec) * 1e9);
+  nanosleep(&ts, NULL);
+}
+
+
+/*
+ * Stubs.  Whatever the stack uses that isn't part of the receive path.
+ */
+static uint32_t recs[DT_MAX + 1], rec_bytes[DT_MAX + 1];
+static uint32_t events, warns, panics, sends, proto_aborts, msg_starts, msg_ends;
+static uint32_t resv_dtype;
+static uint8_t  resv_buf[DT_MAX_HEADER + DT_MAX_RLEN];
+static dc_resv_t resv;
+
+static void count_rec(uint16_t dtype, uint32_t len) {
+  dtype = DT_TYPE(dtype);
+  if (dtype > DT_MAX)
+    dtype = 0;
+  recs[dtype]++;
+  rec_bytes[dtype] += len;
+}
+
+void Host__GPSProto__protoAbort(uint16_t reason) { proto_aborts++; }
+void Host__GPSProto__msgStart(uint16_t len)      { msg_starts++; }
+void Host__GPSProto__msgEnd()                    { msg_ends++; }
+
+uint32_t Host__LocalTime__get() {
+  return (uint32_t) ((sim_us * 1024) / 1000000);
+}
+
+void Host__Panic__warn(uint8_t pcode, uint8_t where, parg_t arg0,
+                       parg_t arg1, parg_t arg2, parg_t arg3) {
+  warns++;
+  if (verbose)
+    fprintf(stderr, "*** warn: %02x/%02x: %x %x %x %x @%llu us\n",
+            pcode, where, arg0, arg1, arg2, arg3,
+            (unsigned long long) sim_us);
+}
+
+static void report();
+
+void Host__Panic__panic(uint8_t pcode, uint8_t where, parg_t arg0,
+                        parg_t arg1, parg_t arg2, parg_t arg3) {
+  panics++;
+  fprintf(stderr, "*** panic: %02x/%02x: %x %x %x %x @%llu us\n",
+          pcode, where, arg0, arg1, arg2, arg3,
+          (unsigned long long) sim_us);
+  report();
+  exit(1);
+}
+
+void Host__Collect__collect(dt_header_t *header, uint16_t hlen,
+                            uint8_t *data, uint16_t dlen) {
+  count_rec(header->dtype, hlen + dlen);
+}
+
+void Host__Collect__collect_nots(dt_header_t *header, uint16_t hlen,
+                                 uint8_t *data, uint16_t dlen) {
+  count_rec(header->dtype, hlen + dlen);
+}
+
+dc_resv_t *Host__Collect__reserve(dtype_t dtype, uint16_t hlen, uint16_t dlen) {
+  if (hlen > DT_MAX_HEADER || dlen > DT_MAX_RLEN)
+    return NULL;
+  resv_dtype    = dtype;
+  resv.hdr      = (void *) resv_buf;
+  resv.data[0]  = &resv_buf[hlen];
+  resv.dlen[0]  = dlen;
+  resv.nfrags   = 1;
+  resv.hdr->len = hlen + dlen;
+  return &resv;
+}
+
+void Host__Collect__commit_nots() {
+  count_rec(resv_dtype, resv.hdr->len);
+}
+
+bool Host__CollectFlush__shutdown_collect(dt_header_t *header, uint16_t hlen,
+                                          uint8_t *data, uint16_t dlen) {
+  count_rec(header->dtype, hlen + dlen);
+  return TRUE;
+}
+
+void Host__CollectEvent__logEvent(uint16_t ev, uint32_t arg0,
+                        uint32_t arg1, uint32_t arg2, uint32_t arg3) {
+  events++;
+}
+
+bool     Host__GPSControl__awake()        { return TRUE; }
+error_t  Host__GPSControl__turnOn()       { return SUCCESS; }
+error_t  Host__GPSControl__turnOff()      { return SUCCESS; }
+error_t  Host__GPSControl__standby()      { return SUCCESS; }
+void     Host__GPSControl__void()         { }
+void     Host__MonTimer__startOneShot(uint32_t dt) { }
+void     Host__MonTimer__stop()           { }
+
+error_t  Host__GPSTransmit__send(uint8_t *ptr, uint16_t len) {
+  sends++;
+  return SUCCESS;
+}
+
+void Host__OverWatch__flush_boot(ow_boot_mode_t boot_mode,
+                                 ow_reboot_reason_t reason) { }
+ow_boot_mode_t Host__OverWatch__getBootMode() { return OW_BOOT_OWT; }
+void Host__OverWatch__halt_and_CF() { }
+
+
+static void report() {
+  double secs = sim_us / 1e6;
+  uint32_t i;
+
+  printf("\nline:    %u rx pkts (%u tx, %u other, %u bad recs), %u bytes, %.1f s\n",
+         rx_recs, tx_recs, other_recs, bad_recs, line_bytes, secs);
+  printf("         %u baud, %.1f%% busy, %u dropped, %u bit errors\n",
+         baud, secs ? 100.0 * line_bytes * 10 / baud / secs : 0,
+         dropped, flipped);
+  printf("rx:      %s, %u bytes fed, %u overruns (%u bytes lost)\n",
+         byte_mode ? "byte" : "block", fed, overruns, overrun_bytes);
+  printf("stack:   %.3f ms in %u calls, max %.1f us",
+         stack_ns / 1e6, stack_calls, stack_max_ns / 1e3);
+  if (stack_ns)
+    printf(", %.2f MB/s, %.0f msgs/s",
+           fed / (stack_ns / 1e9) / 1e6,
+           sirfbin_stats.complete / (stack_ns / 1e9));
+  printf("\n");
+  printf("gmc:     max_full %u/%u, max_allocated %u/%u, full %u allocated %u\n",
+         gmc.max_full, GPS_MAX_MSGS, gmc.max_allocated, GPS_BUF_SIZE,
+         gmc.full, gmc.allocated);
+  printf("sirfbin: starts %u  complete %u  too_big %u  no_buffer %u  max_seen %u\n",
+         sirfbin_stats.starts, sirfbin_stats.complete, sirfbin_stats.too_big,
+         sirfbin_stats.no_buffer, sirfbin_stats.max_seen);
+  printf("         chksum_fail %u  proto_fail %u  rx_errors %u  rx_timeouts %u  resets %u\n",
+         sirfbin_stats.chksum_fail, sirfbin_stats.proto_fail,
+         sirfbin_stats.rx_errors, sirfbin_stats.rx_timeouts,
+         sirfbin_stats.resets);
+  printf("         %u proto aborts\n", proto_aborts);
+  printf("monitor: %u events, %u sends, %u warns, %u panics\n",
+         events, sends, warns, panics);
+  for (i = 0; i <= DT_MAX; i++)
+    if (recs[i])
+      printf("         dtype %2u: %6u recs %8u bytes\n", i, recs[i], rec_bytes[i]);
+}
+
+
+int main(int argc, char **argv) {
+  uint8_t  *buf;
+  uint32_t  size, p;
+  uint64_t  next_tick, t;
+  long      seed;
+  FILE     *fp;
+  int       c;
+
+  seed = 1;
+  while ((c = getopt_long(argc, argv, "bB:d:De:hj:l:n:r:s:vV", longopts, NULL)) != EOF)
+    switch (c) {
+      case 'b': byte_mode  = 1;                         break;
+      case 'B': baud       = strtoul(optarg, NULL, 0);  break;
+      case 'd': p_drop     = atof(optarg);              break;
+      case 'D': debug++;                                break;
+      case 'e': p_err      = atof(optarg);              break;
+      case 'j': jitter_ms  = atof(optarg);              break;
+      case 'l': latency_us = strtoul(optarg, NULL, 0);  break;
+      case 'n': passes     = strtoul(optarg, NULL, 0);  break;
+      case 'r': seed       = strtol(optarg, NULL, 0);   break;
+      case 's': speed      = atof(optarg);              break;
+      case 'v': verbose++;                              break;
+      case 'V':
+        fprintf(stderr, VERSION);
+        exit(0);
+        break;
+      case 'h':
+      default:
+        usage(argv[0]);
+        break;
+    }
+  argc -= optind;
+  argv += optind;
+  if (argc != 1 || baud == 0 || passes == 0)
+    usage(argv[-optind]);
+
+  fp = fopen(argv[0], "rb");
+  if (!fp) {
+    perror(argv[0]);
+    exit(1);
+  }
+  fseek(fp, 0, SEEK_END);
+  size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  buf = malloc(size + 4);
+  if (!buf || fread(buf, 1, size, fp) != size) {
+    fprintf(stderr, "*** can't read %s\n", argv[0]);
+    exit(1);
+  }
+  fclose(fp);
+  srand48(seed);
+
+  t = 0;
+  for (p = 0; p < passes; p++)
+    t = load(buf, size, t);
+  free(buf);
+  if (!line.count) {
+    fprintf(stderr, "*** no rx sirfbin packets in %s\n", argv[0]);
+    exit(1);
+  }
+  printf("%s: %u passes, seed %ld, latency %u us, jitter %.1f ms\n",
+         argv[0], passes, seed, latency_us, jitter_ms);
+  printf("         GPS_BUF_SIZE %u, GPS_MAX_MSGS %u, GPS_RX_RING_SIZE %u\n",
+         GPS_BUF_SIZE, GPS_MAX_MSGS, GPS_RX_RING_SIZE);
+
+  /* boot, same order the tag does it */
+  GPSMsgBufP__Init__init();
+  GPSmonitorP__Boot__booted();
+  GPSmonitorP__GPSControl__gps_booted();
+  events = sends = 0;
+  memset(recs, 0, sizeof(recs));
+  memset(rec_bytes, 0, sizeof(rec_bytes));
+
+  clock_gettime(CLOCK_MONOTONIC, &wall0);
+  sim_us    = line.when[0] > 1000 ? line.when[0] - 1000 : 0;
+  next_tick = sim_us + (DT_GPS_RX_DRAIN * 1000000ULL) / 1024;
+  while (step(&next_tick)) {
+    pace();
+    if (debug && rd && (rd % (64 * 1024)) == 0)
+      fprintf(stderr, "  %u/%u bytes, %llu us\n", rd, line.count,
+              (unsigned long long) sim_us);
+  }
+  report();
+  return 0;
+}
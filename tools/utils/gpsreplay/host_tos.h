@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * host_tos.h: the bits of TinyOS the GPS receive stack (and the modules
+ * under ../hosttest) need to build natively.  Everything here is what
+ * nesC and the tinyos tree would normally give the modules.
+ */
+
+#ifndef __HOST_TOS_H__
+#define __HOST_TOS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* normally pulled in via the platform, hardware.h */
+#include <platform_clk_defs.h>
+
+typedef uint8_t bool;
+
+enum {
+  FALSE = 0,
+  TRUE  = 1,
+};
+
+/* TinyError.h */
+typedef enum {
+  SUCCESS  = 0,
+  FAIL     = 1,
+  ESIZE    = 2,
+  ECANCEL  = 3,
+  EOFF     = 4,
+  EBUSY    = 5,
+  EINVAL   = 6,
+  ERETRY   = 7,
+  ERESERVE = 8,
+  EALREADY = 9,
+  ENOMEM   = 10,
+  ENOACK   = 11,
+  EODATA   = 12,
+  ELAST    = 12,
+} error_t;
+
+typedef struct { int notUsed; } TMilli;
+
+#define PACKED          __attribute__((__packed__))
+#define unique(s)       0
+#define uniqueCount(s)  1
+#define nop()           do { } while (0)
+
+/* tasks run from the harness's task queue, see gpsreplay.c */
+typedef void (*host_task_t)(void);
+void post_task(host_task_t t);
+
+#endif  /* __HOST_TOS_H__ */
@@ -0,0 +1,365 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2018 Eric B. Decker
+# All rights reserved.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+# See COPYING in the top level directory of this source tree.
+#
+# Contact: Eric B. Decker <cire831@gmail.com>
+
+'''
+nc2c: turn nesC modules into C that builds on the host.
+
+    nc2c.py [-w <wiring.h>] <module>.nc ... > app.c
+
+Just enough nesC for the modules gpsreplay pulls in, not a compiler.
+Like nesC the output is whole program, one translation unit.
+
+  o the specification (provides/uses) is dropped, the implementation
+    body is kept along with everything in front of the module.
+  o commands and events, defined, called or signalled, become plain
+    functions named <module>__<interface>__<function>.  Wiring is done
+    with #defines (see wiring.h, -w names another one).
+  o parameterized interfaces (X.f[id](...)) put the interface
+    parameters in front of the function's, the way nesC does.
+  o a default handler is only compiled if its name isn't wired.
+  o a generic module is a single instance, its parameter list must be
+    empty.
+  o tasks are plain functions, post goes through post_task().
+  o async, norace and atomic are dropped (single threaded on the host).
+  o everything else the module defines at the top of its implementation
+    is <module>__<name>, functions are static.  Prototypes for all the
+    module's functions go in front of the first one, nesC doesn't care
+    about order.
+'''
+
+from __future__ import print_function
+
+import re
+import sys
+
+
+def match_brace(src, i):
+    '''src[i] is {, return index of the matching }'''
+    depth = 0
+    n = len(src)
+    while i < n:
+        c = src[i]
+        if src.startswith('/*', i):
+            i = src.index('*/', i + 2) + 2
+            continue
+        if src.startswith('//', i):
+            i = src.index('\n', i)
+            continue
+        if c == '"' or c == "'":
+            i = skip_quoted(src, i)
+            continue
+        if c == '{':
+            depth += 1
+        elif c == '}':
+            depth -= 1
+            if depth == 0:
+                return i
+        i += 1
+    raise ValueError('unbalanced braces')
+
+
+def skip_quoted(src, i):
+    q = src[i]
+    i += 1
+    while src[i] != q:
+        if src[i] == '\\':
+            i += 1
+        i += 1
+    return i + 1
+
+
+def decl_start(hdr):
+    '''index in hdr of the first char past whitespace, comments and cpp lines'''
+    i = 0
+    n = len(hdr)
+    while i < n:
+        if hdr[i].isspace():
+            i += 1
+        elif hdr.startswith('/*', i):
+            i = hdr.index('*/', i + 2) + 2
+        elif hdr.startswith('//', i):
+            i = hdr.find('\n', i)
+            if i < 0:
+                return n
+        elif hdr[i] == '#':
+            while True:                 # cpp line, with continuations
+                j = hdr.find('\n', i)
+                if j < 0:
+                    return n
+                if hdr[j - 1] != '\\':
+                    break
+                i = j + 1
+            i = j + 1
+        else:
+            break
+    return i
+
+
+def strip_comments(s):
+    s = re.sub(r'/\*.*?\*/', ' ', s, flags=re.S)
+    return re.sub(r'//[^\n]*', ' ', s)
+
+
+def strip_attrs(s):
+    '''drop __attribute__ ((...)), the parens nest'''
+    while True:
+        m = re.search(r'__attribute__\s*\(', s)
+        if not m:
+            return s
+        i, depth = m.end() - 1, 0
+        while i < len(s):
+            if s[i] == '(':
+                depth += 1
+            elif s[i] == ')':
+                depth -= 1
+                if depth == 0:
+                    break
+            i += 1
+        s = s[:m.start()] + ' ' + s[i + 1:]
+
+
+FUNC_NAME = re.compile(r'(\w+)\s*\($')
+
+def func_name(decl):
+    '''name of the function decl declares/defines, None if not a function'''
+    d = strip_comments(decl)
+    d = strip_attrs(d).strip()
+    if not d or '(' not in d:
+        return None
+    if re.match(r'(typedef|struct|enum|union)\b', d):
+        return None
+    head = d[:d.index('(') + 1]
+    if '=' in head:
+        return None
+    m = FUNC_NAME.search(head)
+    return m.group(1) if m else None
+
+
+C_WORDS = set('''auto char const double extern float int long register short
+    signed static unsigned void volatile inline'''.split())
+
+def strip_braces(s):
+    out, depth = [], 0
+    for c in s:
+        if c == '{':
+            depth += 1
+        elif c == '}':
+            depth -= 1
+        elif depth == 0:
+            out.append(c)
+    return ''.join(out)
+
+
+def split_top(s, sep):
+    '''split s on sep outside of () and []'''
+    out, depth, cur = [], 0, []
+    for c in s:
+        if c in '([':
+            depth += 1
+        elif c in ')]':
+            depth -= 1
+        if c == sep and depth == 0:
+            out.append(''.join(cur))
+            cur = []
+        else:
+            cur.append(c)
+    out.append(''.join(cur))
+    return out
+
+
+def var_names(decl):
+    '''names of the variables a top level declaration declares'''
+    d = strip_attrs(strip_comments(decl)).strip()
+    if re.match(r'typedef\b', d):
+        return []
+    d = strip_braces(d)
+    names = []
+    for dcl in split_top(d, ','):
+        dcl = dcl.split('=')[0]
+        dcl = re.sub(r'\[[^\]]*\]', '', dcl).strip()
+        m = re.search(r'(\w+)$', dcl)
+        if m and m.group(1) not in C_WORDS and \
+           not re.match(r'(struct|enum|union)\s+\w+$', dcl):
+            names.append(m.group(1))
+    return names
+
+
+DEFAULT = '__nc2c_default__ '
+
+def toplevel(body, module):
+    '''
+    static the module's own functions, collect prototypes for all of
+    them and the names of everything the module defines at the top
+    level.  Returns (new body, names).
+    '''
+    out    = []
+    protos = []
+    names  = []
+    first  = None                       # out index of first function def
+    last   = 0                          # start of current item
+    i      = 0
+    n      = len(body)
+
+    def wrap(name, s):
+        '''default handlers only exist if nothing is wired in'''
+        return '\n#ifndef {0}__{1}\n{2}\n#endif\n'.format(module, name, s)
+
+    while i < n:
+        c = body[i]
+        if body.startswith('/*', i):
+            i = body.index('*/', i + 2) + 2
+            continue
+        if body.startswith('//', i):
+            i = body.index('\n', i)
+            continue
+        if c == '#' and body[:i].rstrip(' \t').endswith('\n'):
+            i = body.index('\n', i)
+            continue
+        if c == '"' or c == "'":
+            i = skip_quoted(body, i)
+            continue
+        if c == ';':
+            hdr   = body[last:i]
+            start = decl_start(hdr)
+            decl  = hdr[start:]
+            name  = func_name(decl)
+            if name is None:
+                names.extend(var_names(decl))
+            elif not name.startswith(module + '__') and \
+                 not re.match(r'\s*static\b', decl):
+                decl = 'static ' + decl
+            out.append(hdr[:start] + decl + ';')
+            i += 1
+            last = i
+            continue
+        if c == '{':
+            j     = match_brace(body, i)
+            hdr   = body[last:i]
+            start = decl_start(hdr)
+            decl  = hdr[start:]
+            name  = func_name(decl)
+            if name is None:            # struct/enum/initializer, runs to ;
+                i = j + 1
+                continue
+            dflt = decl.startswith(DEFAULT)
+            if dflt:
+                decl = decl[len(DEFAULT):]
+            if not name.startswith(module + '__'):
+                names.append(name)
+                if not re.match(r'\s*static\b', decl):
+                    decl = 'static ' + decl
+            proto = ' '.join(strip_comments(decl).split()) + ';'
+            fn    = decl + body[i:j + 1]
+            if dflt:
+                proto = wrap(name[len(module) + 2:], proto)
+                fn    = wrap(name[len(module) + 2:], fn)
+            if first is None:
+                first = len(out) + 1    # in front of the decl
+            protos.append(proto)
+            out.append(hdr[:start])
+            out.append(fn)
+            i = j + 1
+            last = i
+            continue
+        i += 1
+    out.append(body[last:])
+
+    if first is not None:
+        out.insert(first, '/* nc2c: prototypes */\n  ' +
+                   '\n  '.join(protos) + '\n\n  ')
+    return ''.join(out), names
+
+
+def params(iparms, tail):
+    '''interface parameters go in front of the function's own'''
+    if not iparms:
+        return '(' + (tail or '')
+    if tail:                            # f[..]() or f[..](void)
+        return '(' + iparms + ')'
+    return '(' + iparms + ', '
+
+
+def nc2c(src):
+    m = re.search(r'\b(?:generic\s+)?module\s+(\w+)\s*(?:\(\s*\))?\s*\{',
+                  src)
+    if not m:
+        raise ValueError('no module')
+    module = m.group(1)
+    spec_end = match_brace(src, m.end() - 1)
+    im = re.compile(r'\bimplementation\s*\{').search(src, spec_end)
+    if not im:
+        raise ValueError('no implementation')
+    impl_end = match_brace(src, im.end() - 1)
+    pre  = re.sub(r'\bnorace\b\s*', '', src[:m.start()])
+    body = src[im.end():impl_end]
+
+    body = re.sub(r'\b(?:norace|async|atomic)\b\s*', '', body)
+    body = re.sub(r'\btask\s+void\s+(\w+)\s*\(\s*\)', r'void \1(void)', body)
+    body = re.sub(r'\bpost\s+(\w+)\s*\(\s*\)', r'post_task(\1)', body)
+
+    def defn(m):
+        dflt = DEFAULT if m.group(1) else ''
+        return '{}{}{}__{}__{}{}'.format(dflt, m.group(2), module,
+                                         m.group(3), m.group(4),
+                                         params(m.group(5), m.group(6)))
+    body = re.sub(r'\b(default\s+)?(?:command|event)\s+([^;{(]*?)'
+                  r'\b(\w+)\.(\w+)\s*(?:\[([^\]]*)\])?\s*\('
+                  r'(\s*(?:void\s*)?\))?', defn, body)
+    body = re.sub(r'\b(?:call|signal)\s+(\w+)\.(\w+)\s*\[([^\]]*)\]\s*\('
+                  r'(\s*\))?',
+                  lambda m: '{}__{}__{}{}'.format(module, m.group(1),
+                                                  m.group(2),
+                                                  params(m.group(3),
+                                                         m.group(4))), body)
+    body = re.sub(r'\b(?:call|signal)\s+(\w+)\.(\w+)\b',
+                  lambda m: '{}__{}__{}'.format(module, m.group(1),
+                                                m.group(2)), body)
+    body, names = toplevel(body, module)
+
+    # module scope, everything the module defines becomes <module>__<name>
+    if names:
+        body = re.sub(r'(?<![.\w])(?<!->)\b({})\b'.format('|'.join(names)),
+                      r'{}__\1'.format(module), body)
+
+    return '/* {0} */\n{1}\n/* implementation {0} */\n{2}\n'.format(
+        module, pre, body)
+
+
+def main(files, wiring='wiring.h'):
+    out = ['/* generated by nc2c, do not edit */\n\n'
+           '#include "host_tos.h"\n#include "{}"\n\n'.format(wiring)]
+    for fn in files:
+        with open(fn) as f:
+            out.append(nc2c(f.read()))
+    sys.stdout.write(''.join(out))
+
+
+if __name__ == '__main__':
+    args = sys.argv[1:]
+    wiring = 'wiring.h'
+    if len(args) >= 2 and args[0] == '-w':
+        wiring = args[1]
+        args = args[2:]
+    if not args:
+        print('usage: nc2c.py [-w <wiring.h>] <module>.nc ... > app.c',
+              file=sys.stderr)
+        sys.exit(1)
+    main(args, wiring)
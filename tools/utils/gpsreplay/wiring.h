@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * wiring.h: the configuration for the host build of the GPS receive
+ * stack.
+ *
+ *   gpsreplay -> SirfBinP -> GPSMsgBufP -> GPSmonitorP
+ *
+ * Same as GPS0C/GPSmonitorC, SirfBinP's GPSBuffer goes to GPSMsgBufP,
+ * GPSMsgBufP's GPSReceive to GPSmonitorP.  Everything else the modules
+ * use lands on Host__ stubs in gpsreplay.c.
+ */
+
+#ifndef __WIRING_H__
+#define __WIRING_H__
+
+#include <typed_data.h>
+#include <collect.h>
+#include <overwatch.h>
+
+/* SirfBinP */
+#define SirfBinP__GPSBuffer__msg_start          GPSMsgBufP__GPSBuffer__msg_start
+#define SirfBinP__GPSBuffer__msg_abort          GPSMsgBufP__GPSBuffer__msg_abort
+#define SirfBinP__GPSBuffer__msg_complete       GPSMsgBufP__GPSBuffer__msg_complete
+#define SirfBinP__GPSProto__protoAbort          Host__GPSProto__protoAbort
+#define SirfBinP__GPSProto__msgStart            Host__GPSProto__msgStart
+#define SirfBinP__GPSProto__msgEnd              Host__GPSProto__msgEnd
+#define SirfBinP__Panic__warn                   Host__Panic__warn
+#define SirfBinP__Panic__panic                  Host__Panic__panic
+
+/* GPSMsgBufP */
+#define GPSMsgBufP__GPSReceive__msg_available   GPSmonitorP__GPSReceive__msg_available
+#define GPSMsgBufP__LocalTime__get              Host__LocalTime__get
+#define GPSMsgBufP__Panic__warn                 Host__Panic__warn
+#define GPSMsgBufP__Panic__panic                Host__Panic__panic
+
+/* GPSmonitorP */
+#define GPSmonitorP__Collect__collect           Host__Collect__collect
+#define GPSmonitorP__Collect__collect_nots      Host__Collect__collect_nots
+#define GPSmonitorP__Collect__reserve           Host__Collect__reserve
+#define GPSmonitorP__Collect__commit_nots       Host__Collect__commit_nots
+#define GPSmonitorP__CollectEvent__logEvent     Host__CollectEvent__logEvent
+#define GPSmonitorP__CollectFlush__shutdown_collect \
+                                        Host__CollectFlush__shutdown_collect
+#define GPSmonitorP__GPSControl__awake          Host__GPSControl__awake
+#define GPSmonitorP__GPSControl__turnOn         Host__GPSControl__turnOn
+#define GPSmonitorP__GPSControl__turnOff        Host__GPSControl__turnOff
+#define GPSmonitorP__GPSControl__standby        Host__GPSControl__standby
+#define GPSmonitorP__GPSControl__hibernate      Host__GPSControl__void
+#define GPSmonitorP__GPSControl__wake           Host__GPSControl__void
+#define GPSmonitorP__GPSControl__pulseOnOff     Host__GPSControl__void
+#define GPSmonitorP__GPSControl__reset          Host__GPSControl__void
+#define GPSmonitorP__GPSControl__powerOn        Host__GPSControl__void
+#define GPSmonitorP__GPSControl__powerOff       Host__GPSControl__void
+#define GPSmonitorP__GPSTransmit__send          Host__GPSTransmit__send
+#define GPSmonitorP__MonTimer__startOneShot     Host__MonTimer__startOneShot
+#define GPSmonitorP__MonTimer__stop             Host__MonTimer__stop
+#define GPSmonitorP__OverWatch__flush_boot      Host__OverWatch__flush_boot
+#define GPSmonitorP__OverWatch__getBootMode     Host__OverWatch__getBootMode
+#define GPSmonitorP__OverWatch__halt_and_CF     Host__OverWatch__halt_and_CF
+#define GPSmonitorP__Panic__warn                Host__Panic__warn
+#define GPSmonitorP__Panic__panic               Host__Panic__panic
+
+
+/* what the stack drives into the harness */
+void     Host__GPSProto__protoAbort(uint16_t reason);
+void     Host__GPSProto__msgStart(uint16_t len);
+void     Host__GPSProto__msgEnd();
+uint32_t Host__LocalTime__get();
+
+void     Host__Panic__warn(uint8_t pcode, uint8_t where, parg_t arg0,
+                           parg_t arg1, parg_t arg2, parg_t arg3);
+void     Host__Panic__panic(uint8_t pcode, uint8_t where, parg_t arg0,
+                            parg_t arg1, parg_t arg2, parg_t arg3);
+
+void       Host__Collect__collect(dt_header_t *header, uint16_t hlen,
+                                  uint8_t *data, uint16_t dlen);
+void       Host__Collect__collect_nots(dt_header_t *header, uint16_t hlen,
+                                       uint8_t *data, uint16_t dlen);
+dc_resv_t *Host__Collect__reserve(dtype_t dtype, uint16_t hlen, uint16_t dlen);
+void       Host__Collect__commit_nots();
+void       Host__CollectEvent__logEvent(uint16_t ev, uint32_t arg0,
+                        uint32_t arg1, uint32_t arg2, uint32_t arg3);
+bool       Host__CollectFlush__shutdown_collect(dt_header_t *header,
+                        uint16_t hlen, uint8_t *data, uint16_t dlen);
+
+bool     Host__GPSControl__awake();
+error_t  Host__GPSControl__turnOn();
+error_t  Host__GPSControl__turnOff();
+error_t  Host__GPSControl__standby();
+void     Host__GPSControl__void();
+error_t  Host__GPSTransmit__send(uint8_t *ptr, uint16_t len);
+void     Host__MonTimer__startOneShot(uint32_t dt);
+void     Host__MonTimer__stop();
+
+void           Host__OverWatch__flush_boot(ow_boot_mode_t boot_mode,
+                                           ow_reboot_reason_t reason);
+ow_boot_mode_t Host__OverWatch__getBootMode();
+void           Host__OverWatch__halt_and_CF();
+
+/* between the modules */
+uint8_t *GPSMsgBufP__GPSBuffer__msg_start(uint16_t len);
+void     GPSMsgBufP__GPSBuffer__msg_abort();
+void     GPSMsgBufP__GPSBuffer__msg_complete();
+void     GPSmonitorP__GPSReceive__msg_available(uint8_t *msg, uint16_t len,
+                        uint32_t arrival_ms, uint32_t mark_j);
+
+/* the modules' own entry points the harness drives */
+error_t  GPSMsgBufP__Init__init();
+void     SirfBinP__GPSProto__byteAvail(uint8_t byte);
+void     SirfBinP__GPSProto__blockAvail(uint8_t *ptr, uint16_t len);
+void     SirfBinP__GPSProto__rx_timeout();
+void     SirfBinP__GPSProto__rx_error();
+void     GPSmonitorP__Boot__booted();
+void     GPSmonitorP__GPSControl__gps_booted();
+
+#endif  /* __WIRING_H__ */
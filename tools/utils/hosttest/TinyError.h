@@ -0,0 +1,11 @@
+/*
+ * TinyError.h: host.  error_t and friends come from host_tos.h (see
+ * ../gpsreplay), the tos modules include this by name.
+ */
+
+#ifndef __TINY_ERROR_H__
+#define __TINY_ERROR_H__
+
+#include "host_tos.h"
+
+#endif  /* __TINY_ERROR_H__ */
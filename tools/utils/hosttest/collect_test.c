@@ -0,0 +1,766 @@
+/*
+ * Copyright 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * Mam-Mark Project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ *
+ *
+ * collect_test - run CollectP on the host
+ *
+ * The real CollectP is run through nc2c (see Makefile, collect_wiring.h).
+ * SSW is a pool of sector buffers, full ones are written to an in memory
+ * disk from task level like the real SSW does.
+ *
+ * kernels:     the fused copy/sum kernels (copy_sum_aligned/unaligned)
+ *              and sum_block (commit) against a byte by byte copy and
+ *              sum, every length up to a sector and every source
+ *              alignment.
+ *
+ * drops:       records shed when SSW runs low, per dtype counts (.drop_dtype).
+ *              CRIT records (SYNC) shed when SSW is empty and leave the
+ *              prev_sync chain and SYNC drop counts alone.
+ *
+ * stream:      random records (sizes, source alignment, usecs on/off)
+ *              through collect, collect_nots, and reserve/commit.  The disk is then
+ *              walked like tagdump does it, every recsum is checked by
+ *              byte sum and every record's contents against what was
+ *              handed in.
+ *
+ * -b           benchmark the copy/sum kernels against the byte loop, and
+ *              collect against reserve/commit for a sensor sized record
+ *              (see bench_records).
+ *
+ * Exits 0 if everything checks out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+
+#include APP_C
+#include "host_test.h"
+
+
+#define VERSION "collect_test: v0.1.0  2018/06/24\n"
+
+int verbose = 0;
+
+#define dcc CollectP__dcc
+
+#define NBUFS 8
+
+typedef enum {
+  HB_FREE = 0,
+  HB_ALLOC,
+  HB_FULL,
+} hb_state_t;
+
+static ss_wr_buf_t host_bufs[NBUFS];
+static hb_state_t  host_state[NBUFS];
+static uint32_t    host_seq[NBUFS];         /* order handed to buffer_full */
+static uint32_t    full_seq, wr_seq;
+static uint32_t    sectors_full;            /* handed to buffer_full */
+
+static uint8_t    *disk;
+static uint32_t    disk_len, disk_max;
+static int         keep_disk = 1;
+
+static uint8_t     host_free_max = NBUFS;   /* squeeze SSW, force sheds */
+static uint32_t    host_ms, host_us;
+static uint32_t    host_syncs;              /* note_sync calls */
+
+
+static void disk_write(uint8_t *buf) {
+  if (!keep_disk)
+    return;
+  if (disk_len + SD_BLOCKSIZE > disk_max) {
+    disk_max = disk_max ? disk_max * 2 : 1024 * SD_BLOCKSIZE;
+    disk = realloc(disk, disk_max);
+    if (!disk) {
+      fprintf(stderr, "*** out of memory\n");
+      exit(1);
+    }
+  }
+  memcpy(&disk[disk_len], buf, SD_BLOCKSIZE);
+  disk_len += SD_BLOCKSIZE;
+}
+
+
+/* write out full buffers, oldest first */
+static void ssw_write_full() {
+  int i;
+
+  for (;;) {
+    for (i = 0; i < NBUFS; i++)
+      if (host_state[i] == HB_FULL && host_seq[i] == wr_seq)
+        break;
+    if (i >= NBUFS)
+      return;
+    disk_write(host_bufs[i].buf);
+    host_state[i] = HB_FREE;
+    wr_seq++;
+  }
+}
+
+
+static void ssw_task(void) {
+  ssw_write_full();
+}
+
+
+ss_wr_buf_t *Host__SSW__get_free_buf_handle() {
+  int i;
+
+  for (i = 0; i < NBUFS; i++)
+    if (host_state[i] == HB_FREE) {
+      host_state[i] = HB_ALLOC;
+      memset(host_bufs[i].buf, 0, SD_BLOCKSIZE);
+      return &host_bufs[i];
+    }
+  return NULL;                          /* like SSW, empty ring */
+}
+
+
+uint8_t *Host__SSW__buf_handle_to_buf(ss_wr_buf_t *buf_handle) {
+  return buf_handle->buf;
+}
+
+
+uint8_t Host__SSW__free_bufs() {
+  uint8_t i, n;
+
+  for (i = n = 0; i < NBUFS; i++)
+    if (host_state[i] == HB_FREE)
+      n++;
+  return (n < host_free_max) ? n : host_free_max;
+}
+
+
+/* like SSW, the buffer only goes out to the disk from task level */
+void Host__SSW__buffer_full(ss_wr_buf_t *buf_handle) {
+  int i;
+
+  i = buf_handle - host_bufs;
+  if (i < 0 || i >= NBUFS || host_state[i] != HB_ALLOC) {
+    fprintf(stderr, "*** buffer_full: bad handle %p\n", buf_handle);
+    exit(1);
+  }
+  host_state[i] = HB_FULL;
+  host_seq[i]   = full_seq++;
+  sectors_full++;
+  post_task(ssw_task);
+}
+
+
+/* full buffers, then whatever Collect has allocated */
+void Host__SSW__flush_all() {
+  int i;
+
+  ssw_write_full();
+  for (i = 0; i < NBUFS; i++)
+    if (host_state[i] == HB_ALLOC) {
+      disk_write(host_bufs[i].buf);
+      host_state[i] = HB_FREE;
+    }
+}
+
+
+uint64_t Host__SS__eof_offset() {
+  return (uint64_t) sectors_full * SD_BLOCKSIZE +
+    (dcc.cur_buf ? SD_BLOCKSIZE - dcc.remaining : 0);
+}
+
+
+uint64_t Host__SS__committed_offset() {
+  return disk_len;
+}
+
+
+void     Host__Boot__booted()                       { }
+void     Host__Timer__startOneShot(uint32_t dt)     { }
+void     Host__Timer__stop()                        { }
+uint32_t Host__OverWatch__getImageBase()            { return 0x20000; }
+void     Host__OverWatch__clearReset()              { }
+void     Host__OverWatch__clrFault(uint32_t fault_mask) { }
+uint32_t Host__DblkManager__get_cur_recnum()        { return 0; }
+uint64_t Host__DblkManager__get_last_rec_offset()   { return 0; }
+uint64_t Host__DblkManager__get_last_sync_offset()  { return 0; }
+void     Host__DblkManager__note_sync(uint64_t offset, uint32_t recnum) { host_syncs++; }
+uint32_t Host__LocalTime__get()                     { return host_ms++; }
+uint32_t Host__Platform__usecsRaw()                 { return host_us += 977; }
+
+
+image_info_t       image_info;
+ow_control_block_t ow_control_block;
+
+
+static uint32_t rnd(uint32_t n) {
+  return (uint32_t) random() % n;
+}
+
+
+/* reference, byte at a time */
+static uint16_t __attribute__((noinline))
+copy_sum_bytes(uint8_t *dst, uint8_t *src, uint16_t len) {
+  uint16_t sum;
+
+  sum = 0;
+  while (len--) {
+    sum += *src;
+    *dst++ = *src++;
+  }
+  return sum;
+}
+
+
+/*
+ * kernels: every word count up to a sector, every source alignment.
+ * Random bytes and all 0xff (the worst case for the lanes).
+ */
+static void test_kernels() {
+  uint32_t src_w[SD_BLOCKSIZE / 4 + 2];
+  uint32_t dst_w[SD_BLOCKSIZE / 4 + 1];
+  uint8_t  ref[SD_BLOCKSIZE];
+  uint8_t *src;
+  uint16_t nw, len, want, got;
+  int      fill, align, i;
+
+  for (fill = 0; fill < 2; fill++) {
+    for (i = 0; i < (int) sizeof(src_w); i++)
+      ((uint8_t *) src_w)[i] = fill ? 0xff : rnd(256);
+    for (align = 0; align < 4; align++) {
+      src = (uint8_t *) src_w + align;
+      for (nw = 0; nw <= SD_BLOCKSIZE / 4; nw++) {
+        memset(dst_w, 0x5a, sizeof(dst_w));
+        want = copy_sum_bytes(ref, src, nw * 4);
+        if (align)
+          got = CollectP__copy_sum_unaligned(dst_w, src, nw);
+        else
+          got = CollectP__copy_sum_aligned(dst_w, (void *) src, nw);
+        if (got != want)
+          fail("kernel sum", align, nw, got);
+        if (memcmp(dst_w, ref, nw * 4))
+          fail("kernel copy", align, nw, 0);
+        if (((uint8_t *) dst_w)[nw * 4] != 0x5a)
+          fail("kernel overrun", align, nw, 0);
+      }
+      for (len = 0; len <= SD_BLOCKSIZE; len++) {
+        want = copy_sum_bytes(ref, src, len);
+        got  = CollectP__sum_block(src, len);
+        if (got != want)
+          fail("sum_block", align, len, got);
+      }
+    }
+  }
+  if (verbose)
+    printf("kernels: %d lengths x 4 alignments x 2 fills\n",
+           SD_BLOCKSIZE / 4 + 1);
+}
+
+
+/*
+ * what each test record should look like on disk, by recnum.  Header
+ * past dt_header_t and the data, back to back.
+ */
+typedef struct {
+  bool     used;                        /* FALSE, SYNC/INDEX etc */
+  uint16_t len;                         /* hlen + dlen, no trailer */
+  uint16_t hlen;
+  dtype_t  dtype;
+  bool     usecs;
+  uint8_t  body[DT_MAX_RLEN];
+} expect_t;
+
+static expect_t *expect;
+static uint32_t  expect_max;
+
+static dtype_t test_dtypes[] = {
+  DT_EVENT, DT_SENSOR_DATA, DT_TEST, DT_NOTE, DT_GPS_RAW_SIRFBIN,
+};
+
+
+static void expect_rec(uint32_t recnum, uint16_t hlen, uint16_t dlen,
+                       dtype_t dtype, uint8_t *hdr, uint8_t *data) {
+  expect_t *ep;
+
+  if (recnum >= expect_max) {
+    fail("recnum out of range", recnum, expect_max, 0);
+    return;
+  }
+  ep = &expect[recnum];
+  ep->used  = TRUE;
+  ep->len   = hlen + dlen;
+  ep->hlen  = hlen;
+  ep->dtype = dtype;
+  ep->usecs = dcc.usecs && hlen + dlen + sizeof(dt_usecs_t) <= DT_MAX_RLEN;
+  memcpy(ep->body, hdr + sizeof(dt_header_t), hlen - sizeof(dt_header_t));
+  memcpy(ep->body + hlen - sizeof(dt_header_t), data, dlen);
+}
+
+
+/* copy into a reservation the way the producers do it */
+static void resv_fill(dc_resv_t *rp, uint8_t *hdr, uint16_t hlen,
+                      uint8_t *data) {
+  int i;
+
+  memcpy(rp->hdr, hdr, hlen);
+  for (i = 0; i < rp->nfrags; i++) {
+    memcpy(rp->data[i], data, rp->dlen[i]);
+    data += rp->dlen[i];
+  }
+}
+
+
+/*
+ * CollectFlush, we are a producer holding a record back.  On the way
+ * down it goes into what is left of the current buffer, if it fits
+ * with room for the last SYNC.  Odd length, the SYNC has to be aligned.
+ */
+static uint32_t host_flushes;           /* flush, before each SYNC task */
+static uint32_t host_held;              /* recnum laid down on shutdown */
+
+void Host__CollectFlush__flush() {
+  host_flushes++;
+}
+
+void Host__CollectFlush__shutdown() {
+  uint8_t      hdr[sizeof(dt_header_t)] __attribute__((aligned(4)));
+  uint8_t      data[13];
+  dt_header_t *hp;
+  bool         fits;
+  int          i;
+
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = rnd(256);
+  hp = (void *) hdr;
+  hp->len     = sizeof(hdr) + sizeof(data);
+  hp->dtype   = DT_TEST;
+  hp->systime = host_ms;
+  fits = dcc.cur_buf && hp->len + 3 + sizeof(dt_sync_t) <= dcc.remaining;
+  if (CollectP__CollectFlush__shutdown_collect(hp, sizeof(hdr), data,
+                                               sizeof(data)) != fits) {
+    fail("shutdown_collect", fits, dcc.remaining, 0);
+    return;
+  }
+  if (!fits)
+    return;
+  expect_rec(hp->recnum, sizeof(hdr), sizeof(data), DT_TEST, hdr, data);
+  expect[hp->recnum].usecs = FALSE;     /* no trailer on the way down */
+  host_held = hp->recnum;
+}
+
+
+/* one random record through collect, collect_nots, or reserve/commit */
+static void stream_one(uint8_t *hdr, uint8_t *src_base) {
+  dt_header_t *hp;
+  dc_resv_t   *rp;
+  uint16_t     hlen, dlen;
+  uint8_t     *data;
+  dtype_t      dtype;
+  int          i;
+
+  hlen  = sizeof(dt_header_t) + rnd(DT_MAX_HEADER - sizeof(dt_header_t) + 1);
+  dlen  = rnd(DT_MAX_RLEN - hlen + 1);
+  if (rnd(4) == 0)
+    dlen = rnd(16);                     /* lots of small ones too */
+  dtype = test_dtypes[rnd(sizeof(test_dtypes) / sizeof(test_dtypes[0]))];
+  data  = src_base + rnd(4);
+  for (i = 0; i < hlen; i++)
+    hdr[i] = rnd(256);
+  for (i = 0; i < dlen; i++)
+    data[i] = rnd(256);
+
+  hp = (void *) hdr;
+  hp->len   = hlen + dlen;
+  hp->dtype = dtype;
+  switch (rnd(4)) {
+    case 0:
+      CollectP__Collect__collect(hp, hlen, data, dlen);
+      break;
+    case 1:
+      hp->systime = host_ms;
+      CollectP__Collect__collect_nots(hp, hlen, data, dlen);
+      break;
+    case 2:
+    case 3:
+      rp = CollectP__Collect__reserve(dtype, hlen, dlen);
+      if (!rp) {
+        fail("shed", hlen, dlen, dtype);
+        return;
+      }
+      resv_fill(rp, hdr, hlen, data);
+      if (rnd(2))
+        CollectP__Collect__commit();
+      else
+        CollectP__Collect__commit_nots();
+      expect_rec(dcc.cur_recnum, hlen, dlen, dtype, hdr, data);
+      return;
+  }
+  if (hp->len != hlen + dlen || hp->dtype != dtype)
+    fail("header not handed back", hp->len, hp->dtype, 0);
+  expect_rec(hp->recnum, hlen, dlen, dtype, hdr, data);
+}
+
+
+/*
+ * walk the disk like tagdump.  Records are quad aligned and back to
+ * back, a zero len is where the stream stops.
+ */
+static uint32_t check_disk(uint32_t first, uint32_t last) {
+  dt_header_t hdr;
+  expect_t   *ep;
+  uint32_t    off, i, len, recnum, nxt, checked;
+  uint16_t    sum, recsum, dtype;
+  uint8_t    *rec;
+
+  nxt = 1;
+  checked = 0;
+  off = 0;
+  while (off + sizeof(hdr) <= disk_len) {
+    memcpy(&hdr, &disk[off], sizeof(hdr));
+    len = hdr.len;
+    if (len == 0)
+      break;
+    if (len < sizeof(hdr) || off + len > disk_len) {
+      fail("bad len", off, len, 0);
+      break;
+    }
+    rec = &disk[off];
+    recsum = hdr.recsum;
+    sum = 0;
+    for (i = 0; i < len; i++)
+      sum += rec[i];
+    sum -= (recsum & 0xff) + (recsum >> 8);
+    recnum = hdr.recnum;
+    dtype  = hdr.dtype;
+    if (sum != recsum)
+      fail("recsum", recnum, sum, recsum);
+    if (recnum != nxt)
+      fail("recnum", off, recnum, nxt);
+    nxt = recnum + 1;
+
+    if (recnum >= first && recnum <= last && expect[recnum].used) {
+      ep = &expect[recnum];
+      if (DT_TYPE(dtype) != ep->dtype ||
+          ((dtype & DT_F_USECS) != 0) != ep->usecs ||
+          len != ep->len + (ep->usecs ? sizeof(dt_usecs_t) : 0))
+        fail("header", recnum, dtype, len);
+      else if (memcmp(rec + sizeof(hdr), ep->body,
+                      ep->len - sizeof(hdr)))
+        fail("contents", recnum, off, ep->len);
+      checked++;
+    }
+    off = (off + len + 3) & ~3;
+  }
+  if (verbose)
+    printf("disk: %u bytes, %u records, %u checked\n",
+           disk_len, nxt - 1, checked);
+  return checked;
+}
+
+
+/*
+ * drops: squeeze SSW so records shed, check the per dtype counts via
+ * .drop_dtype and that a bad dtype select is refused.
+ */
+static void test_drops() {
+  uint8_t      hdr[DT_MAX_HEADER] __attribute__((aligned(4)));
+  uint8_t      data[DT_MAX_RLEN];
+  dt_header_t *hp;
+  uint64_t     sync_off;
+  uint32_t     t, l, recnum, syncs;
+  bool         usecs;
+  int          i;
+
+  memset(hdr, 0, sizeof(hdr));
+  memset(data, 0, sizeof(data));
+  hp = (void *) hdr;
+  recnum = dcc.cur_recnum;
+  host_free_max = 0;
+  for (i = 0; i < 3; i++) {
+    hp->len   = sizeof(dt_header_t) + SD_BLOCKSIZE;
+    hp->dtype = DT_GPS_RAW_SIRFBIN;
+    CollectP__Collect__collect(hp, sizeof(dt_header_t), data, SD_BLOCKSIZE);
+  }
+  hp->len   = sizeof(dt_header_t) + SD_BLOCKSIZE;
+  hp->dtype = DT_TEST;
+  if (CollectP__Collect__reserve(DT_TEST, sizeof(dt_header_t), SD_BLOCKSIZE))
+    fail("reserve not shed", 0, 0, 0);
+
+  /*
+   * SSW empty and no room left in the current sector, the SYNC sheds.
+   * Fill the sector out first, a record that fits never sheds.
+   */
+  usecs = dcc.usecs;
+  dcc.usecs = FALSE;
+  if (dcc.cur_buf && dcc.remaining >= sizeof(dt_header_t)) {
+    hp->len   = dcc.remaining;
+    hp->dtype = DT_TEST;
+    CollectP__Collect__collect(hp, sizeof(dt_header_t), data,
+                               dcc.remaining - sizeof(dt_header_t));
+  }
+  dcc.usecs = usecs;
+  recnum = dcc.cur_recnum;
+  sync_off = dcc.last_sync_offset;
+  syncs = host_syncs;
+  CollectP__write_sync_record();
+  if (dcc.last_sync_offset != sync_off || host_syncs != syncs ||
+      CollectP__dc_drops[DT_SYNC] != 1 || dcc.drops[DC_PRI_CRIT] != 1)
+    fail("sync not shed", host_syncs - syncs, CollectP__dc_drops[DT_SYNC],
+         dcc.drops[DC_PRI_CRIT]);
+  if (dcc.sync_drops[DC_PRI_BULK] != 3 || dcc.sync_drops[DC_PRI_NORM] != 1)
+    fail("shed sync cleared drops", dcc.sync_drops[DC_PRI_NORM],
+         dcc.sync_drops[DC_PRI_BULK], 0);
+  host_free_max = NBUFS;
+  if (dcc.cur_recnum != recnum)
+    fail("shed records laid down", recnum, dcc.cur_recnum, 0);
+
+  CollectP__write_sync_record();
+  run_tasks();
+  if (dcc.cur_recnum != recnum + 1 || host_syncs != syncs + 1 ||
+      dcc.sync_drops[DC_PRI_BULK] || dcc.sync_drops[DC_PRI_NORM])
+    fail("sync after shed", dcc.cur_recnum, host_syncs - syncs,
+         dcc.sync_drops[DC_PRI_BULK]);
+
+  t = DT_GPS_RAW_SIRFBIN; l = 4;
+  if (!CollectP__DblkDropDtype__set_value(&t, &l))
+    fail("drop_dtype select", t, 0, 0);
+  CollectP__DblkDropDtype__get_value(&t, &l);
+  if (t != 3)
+    fail("drop_dtype gps raw", t, 3, 0);
+  t = DT_TEST; l = 4;
+  CollectP__DblkDropDtype__set_value(&t, &l);
+  CollectP__DblkDropDtype__get_value(&t, &l);
+  if (t != 1)
+    fail("drop_dtype test", t, 1, 0);
+  t = DT_MAX + 1; l = 4;
+  if (CollectP__DblkDropDtype__set_value(&t, &l))
+    fail("drop_dtype bad dtype taken", t, 0, 0);
+  t = DT_TEST; l = 2;
+  if (CollectP__DblkDropDtype__set_value(&t, &l))
+    fail("drop_dtype bad len taken", l, 0, 0);
+  if (verbose)
+    printf("drops: crit %u norm %u bulk %u\n", dcc.drops[DC_PRI_CRIT],
+           dcc.drops[DC_PRI_NORM], dcc.drops[DC_PRI_BULK]);
+}
+
+
+static void test_stream(uint32_t nrecs) {
+  uint8_t  hdr[DT_MAX_HEADER] __attribute__((aligned(4)));
+  uint8_t *src;
+  uint32_t first, last, n;
+
+  expect_max = nrecs * 2 + 64;          /* room for SYNCs and INDEXs */
+  expect = calloc(expect_max, sizeof(expect_t));
+  src    = malloc(DT_MAX_RLEN + 8);
+  if (!expect || !src) {
+    fprintf(stderr, "*** out of memory\n");
+    exit(1);
+  }
+
+  first = dcc.cur_recnum + 1;
+  for (n = 0; n < nrecs; n++) {
+    if (rnd(64) == 0) {
+      uint32_t t, l;
+
+      t = !dcc.usecs;
+      l = 4;
+      CollectP__DblkUsecs__set_value(&t, &l);
+    }
+    stream_one(hdr, src);
+    run_tasks();
+  }
+  last = dcc.cur_recnum;
+  if (!host_flushes)
+    fail("no CollectFlush.flush", 0, 0, 0);
+
+  CollectP__SysReboot__shutdown_flush();
+  run_tasks();
+  if (host_held) {
+    if (host_held != last + 1)
+      fail("shutdown record", host_held, last + 1, 0);
+    last = host_held;
+    nrecs++;
+  }
+  if (verbose)
+    printf("shutdown: %s\n", host_held ? "held record laid down" : "no room");
+
+  if (check_disk(first, last) < nrecs)
+    fail("records missing", nrecs, 0, 0);
+  free(src);
+  free(expect);
+}
+
+
+static double now() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/*
+ * copy/sum throughput, a sector at a time, fused kernels against the
+ * byte loop.  Host numbers, good for relative comparison only.
+ */
+static void bench_kernels(uint32_t iters) {
+  uint32_t src_w[SD_BLOCKSIZE / 4 + 2];
+  uint32_t dst_w[SD_BLOCKSIZE / 4 + 1];
+  volatile uint16_t sink;
+  double   t0, mb;
+  uint32_t i;
+  int      align;
+
+  for (i = 0; i < sizeof(src_w); i++)
+    ((uint8_t *) src_w)[i] = rnd(256);
+  mb = (double) iters * SD_BLOCKSIZE / 1e6;
+
+  for (align = 0; align < 2; align++) {
+    t0 = now();
+    for (i = 0; i < iters; i++)
+      sink = copy_sum_bytes((void *) dst_w, (uint8_t *) src_w + align,
+                            SD_BLOCKSIZE);
+    printf("bytes   %-9s %8.1f MB/s\n", align ? "unaligned" : "aligned",
+           mb / (now() - t0));
+
+    t0 = now();
+    for (i = 0; i < iters; i++) {
+      if (align)
+        sink = CollectP__copy_sum_unaligned(dst_w, (uint8_t *) src_w + 1,
+                                            SD_BLOCKSIZE / 4);
+      else
+        sink = CollectP__copy_sum_aligned(dst_w, src_w, SD_BLOCKSIZE / 4);
+    }
+    printf("fused   %-9s %8.1f MB/s\n", align ? "unaligned" : "aligned",
+           mb / (now() - t0));
+  }
+  (void) sink;
+}
+
+
+/*
+ * records/s, a sensor style record (dt_sensor_data_t + nsamples 16 bit
+ * samples) built by the producer.  collect: the samples are built in a
+ * local buffer and copied out.  reserve: built directly in the stream
+ * buffers then committed.
+ */
+static void bench_records(uint32_t nrecs, uint16_t nsamples) {
+  dt_sensor_data_t  sd;
+  uint16_t          samples[DT_MAX_RLEN / 2];
+  dc_resv_t        *rp;
+  dt_sensor_data_t *sdp;
+  uint16_t         *dp;
+  uint16_t          dlen, v;
+  double            t0, dt;
+  uint32_t          n;
+  int               i, j, k;
+
+  dlen = nsamples * 2;
+  v = 0;
+  for (k = 0; k < 2; k++) {
+    t0 = now();
+    for (n = 0; n < nrecs; n++) {
+      if (k == 0) {
+        sd.len         = sizeof(sd) + dlen;
+        sd.dtype       = DT_SENSOR_DATA;
+        sd.sns_id      = 1;
+        sd.sched_delta = n;
+        for (i = 0; i < nsamples; i++)
+          samples[i] = v++;
+        CollectP__Collect__collect((void *) &sd, sizeof(sd),
+                                   (void *) samples, dlen);
+      } else {
+        rp = CollectP__Collect__reserve(DT_SENSOR_DATA, sizeof(sd), dlen);
+        sdp = (void *) rp->hdr;
+        sdp->len         = sizeof(sd) + dlen;
+        sdp->dtype       = DT_SENSOR_DATA;
+        sdp->sns_id      = 1;
+        sdp->sched_delta = n;
+        /* record starts quad aligned, even header, frags are even */
+        for (j = 0; j < rp->nfrags; j++) {
+          dp = (void *) rp->data[j];
+          for (i = 0; i < rp->dlen[j] / 2; i++)
+            dp[i] = v++;
+        }
+        CollectP__Collect__commit();
+      }
+      run_tasks();
+    }
+    dt = now() - t0;
+    printf("%-8s %4u bytes  %9.0f recs/s %8.1f MB/s\n",
+           k ? "reserve" : "collect", (unsigned) (sizeof(sd) + dlen),
+           nrecs / dt, nrecs * (sizeof(sd) + dlen) / dt / 1e6);
+  }
+}
+
+
+static void usage(char *name) {
+  fprintf(stderr, VERSION);
+  fprintf(stderr, "usage: %s [-b] [-n <recs>] [-s <seed>] [-v]\n", name);
+  fprintf(stderr, "  -b           benchmark\n");
+  fprintf(stderr, "  -n <recs>    records for the stream test (20000)\n");
+  fprintf(stderr, "  -s <seed>    random seed (1)\n");
+  fprintf(stderr, "  -v           verbose\n");
+  exit(2);
+}
+
+
+int main(int argc, char **argv) {
+  uint32_t nrecs;
+  int      bench, c;
+
+  bench = 0;
+  nrecs = 20000;
+  srandom(1);
+  while ((c = getopt(argc, argv, "bn:s:v")) != -1) {
+    switch (c) {
+      case 'b': bench = 1;                          break;
+      case 'n': nrecs = strtoul(optarg, NULL, 0);   break;
+      case 's': srandom(strtoul(optarg, NULL, 0));  break;
+      case 'v': verbose++;                          break;
+      default:  usage(argv[0]);
+    }
+  }
+
+  CollectP__Init__init();
+  CollectP__Boot__booted();
+  run_tasks();
+
+  if (bench) {
+    keep_disk = 0;
+    bench_kernels(200000);
+    bench_records(500000, 4);
+    bench_records(500000, 64);
+    bench_records(200000, 400);
+    return 0;
+  }
+
+  test_kernels();
+  test_drops();
+  test_stream(nrecs);
+  if (failures) {
+    printf("collect_test: %d failures\n", failures);
+    return 1;
+  }
+  printf("collect_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * collect_wiring.h: host configuration for CollectP.
+ *
+ * Everything Collect uses lands on Host__ stubs in collect_test.c.  SSW
+ * hands out sector buffers and appends full ones to an in memory disk.
+ */
+
+#ifndef __COLLECT_WIRING_H__
+#define __COLLECT_WIRING_H__
+
+#include <typed_data.h>
+#include <image_info.h>
+#include <overwatch.h>
+#include <stream_storage.h>
+#include <collect.h>
+#include <panic.h>
+#include <platform_panic.h>     /* normally via the platform */
+
+#define CollectP__Booted__booted                Host__Boot__booted
+#define CollectP__SyncTimer__startOneShot       Host__Timer__startOneShot
+#define CollectP__SyncTimer__stop               Host__Timer__stop
+#define CollectP__OverWatch__getImageBase       Host__OverWatch__getImageBase
+#define CollectP__OverWatch__clearReset         Host__OverWatch__clearReset
+#define CollectP__OverWatch__clrFault           Host__OverWatch__clrFault
+#define CollectP__SSW__get_free_buf_handle      Host__SSW__get_free_buf_handle
+#define CollectP__SSW__buf_handle_to_buf        Host__SSW__buf_handle_to_buf
+#define CollectP__SSW__free_bufs                Host__SSW__free_bufs
+#define CollectP__SSW__buffer_full              Host__SSW__buffer_full
+#define CollectP__SSW__flush_all                Host__SSW__flush_all
+#define CollectP__SS__eof_offset                Host__SS__eof_offset
+#define CollectP__SS__committed_offset          Host__SS__committed_offset
+#define CollectP__Panic__panic                  Host__Panic__panic
+#define CollectP__DblkManager__get_cur_recnum       Host__DblkManager__get_cur_recnum
+#define CollectP__DblkManager__get_last_rec_offset  Host__DblkManager__get_last_rec_offset
+#define CollectP__DblkManager__get_last_sync_offset Host__DblkManager__get_last_sync_offset
+#define CollectP__DblkManager__note_sync        Host__DblkManager__note_sync
+#define CollectP__LocalTime__get                Host__LocalTime__get
+#define CollectP__Platform__usecsRaw            Host__Platform__usecsRaw
+#define CollectP__CollectFlush__flush           Host__CollectFlush__flush
+#define CollectP__CollectFlush__shutdown        Host__CollectFlush__shutdown
+
+void         Host__Boot__booted();
+void         Host__Timer__startOneShot(uint32_t dt);
+void         Host__Timer__stop();
+uint32_t     Host__OverWatch__getImageBase();
+void         Host__OverWatch__clearReset();
+void         Host__OverWatch__clrFault(uint32_t fault_mask);
+ss_wr_buf_t *Host__SSW__get_free_buf_handle();
+uint8_t     *Host__SSW__buf_handle_to_buf(ss_wr_buf_t *buf_handle);
+uint8_t      Host__SSW__free_bufs();
+void         Host__SSW__buffer_full(ss_wr_buf_t *buf_handle);
+void         Host__SSW__flush_all();
+uint64_t     Host__SS__eof_offset();
+uint64_t     Host__SS__committed_offset();
+void         Host__Panic__panic(uint8_t pcode, uint8_t where, parg_t arg0,
+                                parg_t arg1, parg_t arg2, parg_t arg3);
+uint32_t     Host__DblkManager__get_cur_recnum();
+uint64_t     Host__DblkManager__get_last_rec_offset();
+uint64_t     Host__DblkManager__get_last_sync_offset();
+void         Host__DblkManager__note_sync(uint64_t offset, uint32_t recnum);
+uint32_t     Host__LocalTime__get();
+uint32_t     Host__Platform__usecsRaw();
+void         Host__CollectFlush__flush();
+void         Host__CollectFlush__shutdown();
+
+#endif  /* __COLLECT_WIRING_H__ */
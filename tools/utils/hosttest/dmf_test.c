@@ -0,0 +1,397 @@
+/*
+ * Copyright 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * Mam-Mark Project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ *
+ *
+ * dmf_test - run DblkMapFileP (the DBLK byte cache) on the host
+ *
+ * The real DblkMapFileP is run through nc2c (see Makefile, dmf_wiring.h).
+ * StreamStorage is a stream of STREAM_SECTORS sectors starting at
+ * BLK_BASE, committed up to host_committed, the rest (up to host_eof)
+ * still sitting in SSW buffers.  Every byte of the stream is
+ * DATA(offset) so whatever map() hands back can be checked.
+ *
+ * SDResource.granted and SDread.readDone are delivered by run_events(),
+ * which the map() loop calls whenever the cache says EBUSY (a fill is
+ * in flight).  Between those a test can make more map() calls, the
+ * tag's other Tagnet contexts doing their thing.
+ *
+ * Each scenario starts with an empty cache and checks hits, misses,
+ * the SD reads issued (and how many sectors each), and the bytes.
+ *
+ * Exits 0 if everything checks out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include APP_C
+
+#define HOST_TASKS_INLINE
+#include "host_test.h"
+
+
+#define BLK_BASE        0x1000
+#define STREAM_SECTORS  64
+
+#define DATA(fo)  ((uint8_t) ((fo) ^ ((fo) >> SD_BLOCKSIZE_NBITS) * 31))
+
+#define dmf_cb    DblkMapFileP__dmf_cb
+#define dmf_slots DblkMapFileP__dmf_slots
+
+int verbose = 0;
+
+static uint64_t host_eof, host_committed;
+static uint8_t  host_tail[STREAM_SECTORS][SD_BLOCKSIZE];
+static uint32_t host_ms;
+
+/* what's in flight, run_events delivers it */
+static bool     grant_pending;
+static bool     read_pending;
+static uint32_t read_blk;
+static uint8_t *read_buf;
+
+static uint32_t sd_reads, sd_sectors, sd_last_n, data_avails;
+
+
+/*
+ * where: like SSW.  Committed sectors are on disk (no buffer), the
+ * rest are in SSW buffers, the last one partial.
+ */
+uint32_t Host__SS__where(uint32_t context, uint64_t offset, uint32_t *lenp,
+                         uint64_t *blk_offsetp, uint8_t **bufp) {
+  uint64_t blk_offset;
+  uint32_t i, sector;
+
+  *lenp = 0;
+  *blk_offsetp = 0;
+  *bufp = NULL;
+  if (offset >= host_eof)
+    return 0;
+  blk_offset = offset & ~(SD_BLOCKSIZE - 1);
+  sector = blk_offset >> SD_BLOCKSIZE_NBITS;
+  *blk_offsetp = blk_offset;
+  *lenp = SD_BLOCKSIZE;
+  if (offset < host_committed)
+    return BLK_BASE + sector;
+
+  for (i = 0; i < SD_BLOCKSIZE; i++)
+    host_tail[sector][i] = DATA(blk_offset + i);
+  *bufp = host_tail[sector];
+  if (host_eof - blk_offset < SD_BLOCKSIZE)
+    *lenp = host_eof - blk_offset;
+  return BLK_BASE + sector;
+}
+
+
+uint64_t Host__SS__eof_offset()                { return host_eof; }
+uint64_t Host__SS__committed_offset()          { return host_committed; }
+uint32_t Host__SS__get_dblk_high(uint32_t blk) { return BLK_BASE + STREAM_SECTORS - 1; }
+uint32_t Host__LocalTime__get()                { return host_ms += 3; }
+
+
+error_t Host__SDResource__request() {
+  if (grant_pending || read_pending)
+    fail("sd request while busy", grant_pending, read_pending, 0);
+  grant_pending = TRUE;
+  return SUCCESS;
+}
+
+
+error_t Host__SDResource__release() {
+  return SUCCESS;
+}
+
+
+error_t Host__SDread__read_multi(uint32_t blk_id, uint8_t **bufs, uint8_t n) {
+  uint64_t fo;
+  uint32_t i, j;
+
+  if (blk_id < BLK_BASE ||
+      ((uint64_t) (blk_id - BLK_BASE + n) << SD_BLOCKSIZE_NBITS) > host_committed)
+    fail("read past committed", blk_id, n, host_committed);
+  for (i = 0; i < n; i++) {
+    fo = (uint64_t) (blk_id - BLK_BASE + i) << SD_BLOCKSIZE_NBITS;
+    for (j = 0; j < SD_BLOCKSIZE; j++)
+      bufs[i][j] = DATA(fo + j);
+  }
+  sd_reads++;
+  sd_sectors += n;
+  sd_last_n = n;
+  read_pending = TRUE;
+  read_blk = blk_id;
+  read_buf = bufs[0];
+  return SUCCESS;
+}
+
+
+void Host__DMF__data_avail(error_t err) {
+  if (err)
+    fail("data_avail", err, 0, 0);
+  data_avails++;
+}
+
+
+static void run_events() {
+  if (grant_pending) {
+    grant_pending = FALSE;
+    DblkMapFileP__SDResource__granted();
+  }
+  if (read_pending) {
+    read_pending = FALSE;
+    DblkMapFileP__SDread__readDone(read_blk, read_buf, SUCCESS);
+  }
+}
+
+
+/* check what map handed back against the stream */
+static void check_bytes(uint64_t fo, uint8_t *buf, uint32_t len) {
+  uint32_t i;
+
+  for (i = 0; i < len; i++)
+    if (buf[i] != DATA(fo + i)) {
+      fail("data", fo, i, buf[i]);
+      return;
+    }
+}
+
+
+/*
+ * one map at fo for want bytes, run the SD until it's satisfied.
+ * returns how much was mapped, 0 for EODATA.
+ */
+static uint32_t map(uint64_t fo, uint32_t want) {
+  uint8_t *buf;
+  uint32_t len;
+  error_t  rc;
+  int      tries;
+
+  for (tries = 0; tries < 4; tries++) {
+    len = want;
+    rc = DblkMapFileP__DMF__map(fo >> 32, &buf, fo, &len);
+    if (rc == EBUSY) {
+      run_events();
+      continue;
+    }
+    if (rc == EODATA)
+      return 0;
+    if (rc != SUCCESS) {
+      fail("map", fo, rc, 0);
+      return 0;
+    }
+    if (len == 0 || len > want)
+      fail("map len", fo, len, want);
+    check_bytes(fo, buf, len);
+    return len;
+  }
+  fail("map never completed", fo, want, 0);
+  return 0;
+}
+
+
+/* start over, empty cache, stream eof/committed in sectors */
+static void reset(uint32_t committed, uint32_t eof) {
+  memset(&dmf_cb, 0, sizeof(dmf_cb));
+  memset(dmf_slots, 0, sizeof(dmf_slots));
+  host_committed = (uint64_t) committed << SD_BLOCKSIZE_NBITS;
+  host_eof       = (uint64_t) eof << SD_BLOCKSIZE_NBITS;
+  grant_pending = read_pending = FALSE;
+  sd_reads = sd_sectors = sd_last_n = data_avails = 0;
+}
+
+
+static void expect(const char *what, uint32_t hits, uint32_t misses,
+                   uint32_t reads, uint32_t sectors) {
+  if (verbose)
+    printf("%-12s hits %3u misses %3u reads %3u sectors %3u\n", what,
+           dmf_cb.hits, dmf_cb.misses, sd_reads, sd_sectors);
+  if (dmf_cb.hits != hits || dmf_cb.misses != misses)
+    fail(what, dmf_cb.hits, dmf_cb.misses, hits * 1000 + misses);
+  if (sd_reads != reads || sd_sectors != sectors)
+    fail(what, sd_reads, sd_sectors, reads * 1000 + sectors);
+}
+
+
+/*
+ * sequential: read n sectors front to back in 128 byte pieces.  The
+ * first sector is a lone miss (nothing in front of it cached), after
+ * that each miss reads ahead DMF_READ_AHEAD sectors.  Every map is
+ * a hit once the fill is in (the retry).
+ */
+static void test_sequential() {
+  uint32_t n, fo, got, misses;
+
+  n = 33;
+  reset(STREAM_SECTORS, STREAM_SECTORS);
+  for (fo = 0; fo < n * SD_BLOCKSIZE; fo += got)
+    if (!(got = map(fo, 128)))
+      break;
+  misses = 1 + (n - 1 + DMF_READ_AHEAD - 1) / DMF_READ_AHEAD;
+  expect("sequential", n * SD_BLOCKSIZE / 128, misses, misses,
+         1 + (misses - 1) * DMF_READ_AHEAD);
+  if (data_avails != misses)
+    fail("data_avail count", data_avails, misses, 0);
+  if (dmf_cb.fill_max_ms == 0)
+    fail("fill latency not recorded", 0, 0, 0);
+}
+
+
+/*
+ * read ahead stops at committed (only what is on disk can be read) and
+ * at the end of the DBLK file, and at sectors already cached.
+ */
+static void test_read_ahead_limits() {
+  /* committed 0..5, sector 1 misses, read ahead 1..4, 5 is the only one left */
+  reset(6, 6);
+  map(0 * SD_BLOCKSIZE, 1);
+  map(1 * SD_BLOCKSIZE, 1);
+  map(5 * SD_BLOCKSIZE, 1);
+  if (sd_last_n != 1)
+    fail("read ahead past committed", sd_last_n, 1, 0);
+  expect("ra committed", 3, 3, 3, 1 + DMF_READ_AHEAD + 1);
+
+  /* sector 3 cached, sector 1 read ahead stops in front of it */
+  reset(STREAM_SECTORS, STREAM_SECTORS);
+  map(3 * SD_BLOCKSIZE, 1);
+  map(0 * SD_BLOCKSIZE, 1);
+  map(1 * SD_BLOCKSIZE, 1);
+  if (sd_last_n != 2)
+    fail("read ahead over cached", sd_last_n, 2, 0);
+  map(2 * SD_BLOCKSIZE, 1);
+  map(3 * SD_BLOCKSIZE, 1);
+  expect("ra cached", 5, 3, 3, 4);
+}
+
+
+/*
+ * lru: random access, one sector per miss.  Fill the cache, touch the
+ * oldest, bring in one more.  The second oldest is the one to go.
+ */
+static void test_lru() {
+  uint32_t i, hits, misses;
+
+  reset(STREAM_SECTORS, STREAM_SECTORS);
+  for (i = 0; i < DMF_CACHE_SECTORS; i++)       /* 0, 2, 4, ... */
+    map(i * 2 * SD_BLOCKSIZE, 16);
+  hits = misses = DMF_CACHE_SECTORS;
+
+  map(0, 16);                                   /* refresh 0 */
+  hits++;
+  map(DMF_CACHE_SECTORS * 2 * SD_BLOCKSIZE, 16);/* evicts 2 */
+  hits++; misses++;
+  map(0, 16);                                   /* still there */
+  hits++;
+  map(2 * SD_BLOCKSIZE, 16);                    /* gone, evicts 4 */
+  hits++; misses++;
+  map(6 * SD_BLOCKSIZE, 16);                    /* still there */
+  hits++;
+  map(4 * SD_BLOCKSIZE, 16);                    /* gone */
+  hits++; misses++;
+  expect("lru", hits, misses, misses, misses);
+}
+
+
+/*
+ * while a fill is in flight hits still go, other misses get EBUSY and
+ * aren't counted.
+ */
+static void test_hit_during_fill() {
+  uint8_t *buf;
+  uint32_t len;
+  error_t  rc;
+
+  reset(STREAM_SECTORS, STREAM_SECTORS);
+  map(10 * SD_BLOCKSIZE, 8);                    /* miss + hit */
+
+  len = 8;
+  rc = DblkMapFileP__DMF__map(0, &buf, 20 * SD_BLOCKSIZE, &len);
+  if (rc != EBUSY)
+    fail("miss not busy", rc, 0, 0);
+  len = 8;
+  rc = DblkMapFileP__DMF__map(0, &buf, 10 * SD_BLOCKSIZE + 100, &len);
+  if (rc != SUCCESS)
+    fail("hit during fill", rc, 0, 0);
+  else
+    check_bytes(10 * SD_BLOCKSIZE + 100, buf, len);
+  len = 8;
+  rc = DblkMapFileP__DMF__map(0, &buf, 30 * SD_BLOCKSIZE, &len);
+  if (rc != EBUSY)
+    fail("second miss not busy", rc, 0, 0);
+  run_events();
+  map(20 * SD_BLOCKSIZE, 8);
+  expect("during fill", 3, 2, 2, 2);
+}
+
+
+/*
+ * the tail, sectors still in SSW.  Copied in, no SD.  A partial last
+ * sector is limited to what's there and is refetched once it grows.
+ */
+static void test_tail() {
+  uint64_t last;
+  uint32_t got;
+
+  reset(4, 6);
+  host_eof -= 200;                              /* last sector partial */
+  last = 5 * SD_BLOCKSIZE;
+  got = map(4 * SD_BLOCKSIZE, SD_BLOCKSIZE);
+  if (got != SD_BLOCKSIZE)
+    fail("tail full sector", got, 0, 0);
+  got = map(last + 100, SD_BLOCKSIZE);
+  if (got != SD_BLOCKSIZE - 200 - 100)
+    fail("tail partial", got, SD_BLOCKSIZE - 300, 0);
+  if (map(host_eof, 1) != 0)
+    fail("past eof", 0, 0, 0);
+
+  host_eof += 100;                              /* Collect added some */
+  got = map(last + SD_BLOCKSIZE - 200, SD_BLOCKSIZE);
+  if (got != 100)
+    fail("tail grown", got, 100, 0);
+  got = map(last, SD_BLOCKSIZE);                /* fresh copy, a hit */
+  if (got != SD_BLOCKSIZE - 100)
+    fail("tail refetch", got, SD_BLOCKSIZE - 100, 0);
+  expect("tail", 1, 4, 0, 0);
+
+  if (DblkMapFileP__DMF__filesize(0) != host_eof ||
+      DblkMapFileP__DMF__commitsize(0) != host_committed ||
+      DblkMapFileP__DMF__filesize(1) != 0)
+    fail("window", DblkMapFileP__DMF__filesize(0),
+         DblkMapFileP__DMF__commitsize(0), DblkMapFileP__DMF__filesize(1));
+}
+
+
+int main(int argc, char **argv) {
+  if (argc > 1 && !strcmp(argv[1], "-v"))
+    verbose++;
+
+  test_sequential();
+  test_read_ahead_limits();
+  test_lru();
+  test_hit_during_fill();
+  test_tail();
+  if (failures) {
+    printf("dmf_test: %d failures\n", failures);
+    return 1;
+  }
+  printf("dmf_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * dmf_wiring.h: host configuration for DblkMapFileP.
+ *
+ * StreamStorage, the SD (SDread and its Resource), LocalTime and Panic
+ * land on Host__ stubs in dmf_test.c.
+ */
+
+#ifndef __DMF_WIRING_H__
+#define __DMF_WIRING_H__
+
+#include <panic.h>
+
+#define DblkMapFileP__SS__where                 Host__SS__where
+#define DblkMapFileP__SS__eof_offset            Host__SS__eof_offset
+#define DblkMapFileP__SS__committed_offset      Host__SS__committed_offset
+#define DblkMapFileP__SS__get_dblk_high         Host__SS__get_dblk_high
+#define DblkMapFileP__SDread__read_multi        Host__SDread__read_multi
+#define DblkMapFileP__SDResource__request       Host__SDResource__request
+#define DblkMapFileP__SDResource__release       Host__SDResource__release
+#define DblkMapFileP__LocalTime__get            Host__LocalTime__get
+#define DblkMapFileP__Panic__panic              Host__Panic__panic
+#define DblkMapFileP__DMF__data_avail           Host__DMF__data_avail
+
+uint32_t Host__SS__where(uint32_t context, uint64_t offset, uint32_t *lenp,
+                         uint64_t *blk_offsetp, uint8_t **bufp);
+uint64_t Host__SS__eof_offset();
+uint64_t Host__SS__committed_offset();
+uint32_t Host__SS__get_dblk_high(uint32_t blk_id);
+error_t  Host__SDread__read_multi(uint32_t blk_id, uint8_t **bufs, uint8_t n);
+error_t  Host__SDResource__request();
+error_t  Host__SDResource__release();
+uint32_t Host__LocalTime__get();
+void     Host__Panic__panic(uint8_t pcode, uint8_t where, parg_t arg0,
+                            parg_t arg1, parg_t arg2, parg_t arg3);
+void     Host__DMF__data_avail(error_t err);
+
+#endif  /* __DMF_WIRING_H__ */
@@ -0,0 +1,98 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2018 Eric B. Decker
+# All rights reserved.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+# See COPYING in the top level directory of this source tree.
+#
+# Contact: Eric B. Decker <cire831@gmail.com>
+
+'''
+gt_check: decode gt_test's track records with tagdump.
+
+    gt_check.py <records> <fixes>
+
+<records> is the GPS_TRACK records gt_test got out of GPSmonitorP, back
+to back.  <fixes> is what went in, "systime lat lon alt_msl" per line.
+Every record is expanded with tagdump's gps_track_fixes, the same code
+that decodes them off the tag, and has to give back exactly the fixes
+that went in.  Needs python 2, same as tagdump.
+'''
+
+from __future__ import print_function
+
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                '..', 'tagdump', 'tagdump'))
+
+from core_headers  import dt_gps_track_obj
+from core_emitters import gps_track_fixes
+
+
+def records(buf):
+    idx = 0
+    while idx + 2 <= len(buf):
+        rlen = buf[idx] | (buf[idx + 1] << 8)
+        if rlen == 0 or idx + rlen > len(buf):
+            raise ValueError('bad record len {} at {}'.format(rlen, idx))
+        yield buf[idx:idx + rlen]
+        idx += rlen
+
+
+def main(rec_file, fix_file):
+    with open(rec_file, 'rb') as f:
+        buf = bytearray(f.read())
+    with open(fix_file) as f:
+        want = [ tuple(int(x) for x in l.split()) for l in f if l.strip() ]
+
+    obj   = dt_gps_track_obj
+    got   = []
+    nrecs = 0
+    bad   = 0
+    for rec in records(buf):
+        obj.set(rec)
+        fixes = gps_track_fixes(obj, rec)
+        if len(fixes) != obj['count'].val:
+            print('rec {}: count {}, decoded {}'.format(
+                nrecs, obj['count'].val, len(fixes)))
+            bad += 1
+        got.extend(fixes)
+        nrecs += 1
+
+    if len(got) != len(want):
+        print('fixes: {} in, {} decoded'.format(len(want), len(got)))
+        bad += 1
+
+    # the tag's systime is 32 bits and wraps, the decoder's doesn't
+    for i, (g, w) in enumerate(zip(got, want)):
+        if (g[0] & 0xffffffff, g[1], g[2], g[3]) != w:
+            if bad < 10:
+                print('fix {}: in {}, decoded {}'.format(i, w, g))
+            bad += 1
+
+    if bad:
+        print('gt_check: {} failures'.format(bad))
+        return 1
+    print('gt_check: ok, {} records, {} fixes'.format(nrecs, len(got)))
+    return 0
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        print('usage: gt_check.py <records> <fixes>', file=sys.stderr)
+        sys.exit(1)
+    sys.exit(main(sys.argv[1], sys.argv[2]))
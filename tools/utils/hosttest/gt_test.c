@@ -0,0 +1,334 @@
+/*
+ * Copyright 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * Mam-Mark Project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ *
+ *
+ * gt_test - round trip the GPS track (DT_GPS_TRACK) encoder
+ *
+ * GPSmonitorP is run through nc2c (see Makefile, gt_wiring.h), only its
+ * track encoder is driven: fixes go straight into GPSmonitorP__gt_add
+ * and the records it hands Collect are captured.  gt_test checks how
+ * the records are framed (keyframes, counts) and writes them out,
+ * back to back (gt_test.trk), along with the fixes that went in
+ * (gt_test.fix, one "systime lat lon alt_msl" per line).  gt_check.py
+ * expands the records with tagdump's gps_track_fixes and every fix has
+ * to come back exactly.  make test runs both.
+ *
+ * The fixes are a 1 Hz walk with jitter that crosses the date line,
+ * runs systime (ms) through its 32 bit wrap, and has time gaps, big
+ * alt jumps, and a few worst case (5 byte) deltas thrown in.  A third
+ * of the way in Collect lays down a SYNC (CollectFlush.flush) and two
+ * thirds in the fix is lost (gt_flush), so short records show up too.
+ * What is left at the end goes out via CollectFlush.shutdown.
+ *
+ *   gt_test [-n <fixes>] [-s <seed>] [-v]
+ *
+ * Exits 0 if everything checks out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+
+#include APP_C
+
+#define HOST_TASKS_INLINE
+#include "host_test.h"
+
+
+#define gt_hdr  GPSmonitorP__gt_hdr
+
+#define LON_WRAP 3600000000LL           /* 360 deg, 10^-7 */
+#define LON_MAX  1800000000LL
+
+typedef struct {
+  uint32_t ms;
+  uint32_t tow;
+  int32_t  lat, lon, alt;
+  bool     key;                         /* gt_add said keyframe */
+} fix_t;
+
+#define MAX_RECS 256
+
+typedef struct {
+  dt_gps_track_t hdr;
+  uint8_t        data[GPS_TRACK_BYTES];
+  uint16_t       dlen;
+} rec_t;
+
+int verbose = 0;
+
+static rec_t    *recs;
+static uint32_t  nrecs;
+
+
+/* what GPSmonitorP drives into the harness, only Collect matters */
+void Host__Panic__warn(uint8_t pcode, uint8_t where, parg_t arg0,
+                       parg_t arg1, parg_t arg2, parg_t arg3) { }
+
+void Host__Collect__collect(dt_header_t *header, uint16_t hlen,
+                            uint8_t *data, uint16_t dlen) {
+  fail("collect", header->dtype, hlen, dlen);
+}
+
+/* the track records, gt_flush */
+void Host__Collect__collect_nots(dt_header_t *header, uint16_t hlen,
+                                 uint8_t *data, uint16_t dlen) {
+  rec_t *rp;
+
+  if (header->dtype != DT_GPS_TRACK || hlen != sizeof(dt_gps_track_t) ||
+      dlen > GPS_TRACK_BYTES || header->len != hlen + dlen) {
+    fail("track record", header->dtype, hlen, dlen);
+    return;
+  }
+  if (nrecs >= MAX_RECS) {
+    fail("too many records", nrecs, 0, 0);
+    return;
+  }
+  rp = &recs[nrecs++];
+  memcpy(&rp->hdr, header, hlen);
+  memcpy(rp->data, data, dlen);
+  rp->dlen = dlen;
+}
+
+dc_resv_t *Host__Collect__reserve(dtype_t dtype, uint16_t hlen, uint16_t dlen) {
+  fail("reserve", dtype, hlen, dlen);
+  return NULL;
+}
+
+void Host__Collect__commit_nots() { }
+
+/* the track on the way down, CollectFlush.shutdown */
+uint32_t shutdown_recs;
+
+bool Host__CollectFlush__shutdown_collect(dt_header_t *header, uint16_t hlen,
+                                          uint8_t *data, uint16_t dlen) {
+  shutdown_recs++;
+  Host__Collect__collect_nots(header, hlen, data, dlen);
+  return TRUE;
+}
+
+void Host__CollectEvent__logEvent(uint16_t ev, uint32_t arg0,
+                        uint32_t arg1, uint32_t arg2, uint32_t arg3) { }
+
+bool     Host__GPSControl__awake()        { return TRUE; }
+error_t  Host__GPSControl__turnOn()       { return SUCCESS; }
+error_t  Host__GPSControl__turnOff()      { return SUCCESS; }
+error_t  Host__GPSControl__standby()      { return SUCCESS; }
+void     Host__GPSControl__void()         { }
+void     Host__MonTimer__startOneShot(uint32_t dt) { }
+void     Host__MonTimer__stop()           { }
+error_t  Host__GPSTransmit__send(uint8_t *ptr, uint16_t len) { return SUCCESS; }
+
+void Host__OverWatch__flush_boot(ow_boot_mode_t boot_mode,
+                                 ow_reboot_reason_t reason) { }
+ow_boot_mode_t Host__OverWatch__getBootMode() { return OW_BOOT_OWT; }
+void Host__OverWatch__halt_and_CF() { }
+
+
+static int32_t rnd(int32_t lo, int32_t hi) {
+  return lo + (int32_t) (random() % (uint32_t) (hi - lo + 1));
+}
+
+
+/*
+ * the track.  Starts just west of the date line headed east and 65 s
+ * short of the ms wrap.
+ */
+static void make_fixes(fix_t *fp, uint32_t n) {
+  uint32_t i, ms, tow;
+  int64_t  lon;
+  int32_t  lat, alt;
+
+  ms  = 0xffffffff - 65000;
+  tow = 345600000;
+  lat = 370000000;
+  lon = 1799000000;
+  alt = 1500;
+  for (i = 0; i < n; i++) {
+    if (i) {
+      if (i % 97 == 0) {
+        ms  += 600000;                  /* lost it for 10 min */
+        tow += 600000;
+      } else {
+        ms  += rnd(990, 1010);
+        tow += 1000;
+      }
+      lat += rnd(-2000, 2000);
+      lon += rnd(1000, 5000);
+      if (lon >= LON_MAX)
+        lon -= LON_WRAP;                /* across the date line */
+      alt += rnd(-50, 50);
+      if (i % 53 == 0)
+        alt += rnd(-2000000, 2000000);
+    }
+    fp[i].ms  = ms;
+    fp[i].tow = tow;
+    fp[i].lat = lat;
+    fp[i].lon = lon;
+    fp[i].alt = alt;
+    if (i % 150 == 75) {                /* worst case deltas, pole to pole */
+      fp[i].lat = (i & 1) ? 900000000 : -900000000;
+      fp[i].alt = (i & 1) ? INT32_MIN : INT32_MAX;
+    }
+  }
+}
+
+
+/* the records as tagdump would see them, back to back */
+static void write_recs(const char *name) {
+  FILE    *fp;
+  uint32_t i;
+
+  if (!(fp = fopen(name, "w"))) {
+    perror(name);
+    exit(1);
+  }
+  for (i = 0; i < nrecs; i++) {
+    fwrite(&recs[i].hdr, sizeof(dt_gps_track_t), 1, fp);
+    fwrite(recs[i].data, recs[i].dlen, 1, fp);
+  }
+  fclose(fp);
+}
+
+
+static void write_fixes(const char *name, fix_t *fp, uint32_t n) {
+  FILE    *f;
+  uint32_t i;
+
+  if (!(f = fopen(name, "w"))) {
+    perror(name);
+    exit(1);
+  }
+  for (i = 0; i < n; i++)
+    fprintf(f, "%u %d %d %d\n", fp[i].ms, fp[i].lat, fp[i].lon, fp[i].alt);
+  fclose(f);
+}
+
+
+static void usage(char *name) {
+  fprintf(stderr, "usage: %s [-n <fixes>] [-s <seed>] [-v]\n", name);
+  fprintf(stderr, "  -n <fixes>   fixes in the track (600)\n");
+  fprintf(stderr, "  -s <seed>    random seed (1)\n");
+  fprintf(stderr, "  -v           verbose\n");
+  exit(2);
+}
+
+
+int main(int argc, char **argv) {
+  fix_t   *in;
+  uint32_t n, i, j, k, cnt, sync, lost, bytes;
+  int      c;
+
+  n = 600;
+  srandom(1);
+  while ((c = getopt(argc, argv, "n:s:v")) != -1) {
+    switch (c) {
+      case 'n': n = strtoul(optarg, NULL, 0);       break;
+      case 's': srandom(strtoul(optarg, NULL, 0));  break;
+      case 'v': verbose++;                          break;
+      default:  usage(argv[0]);
+    }
+  }
+
+  in   = calloc(n, sizeof(fix_t));
+  recs = calloc(MAX_RECS, sizeof(rec_t));
+  if (!in || !recs) {
+    fprintf(stderr, "*** out of memory\n");
+    return 1;
+  }
+  make_fixes(in, n);
+
+  sync = n / 3;
+  lost = n * 2 / 3;
+  for (i = 0; i < n; i++) {
+    gps_geo_t geo;
+
+    memset(&geo, 0, sizeof(geo));
+    geo.tow     = in[i].tow;
+    geo.week_x  = 2010;
+    geo.lat     = in[i].lat;
+    geo.lon     = in[i].lon;
+    geo.alt_msl = in[i].alt;
+    if (i == sync)
+      GPSmonitorP__CollectFlush__flush();       /* SYNC going down */
+    if (i == lost)
+      GPSmonitorP__gt_flush();          /* fix lost, track ends */
+    in[i].key = GPSmonitorP__gt_add(in[i].ms, &geo);
+    if (i == sync && !in[i].key)
+      fail("SYNC didn't end the track", i, 0, 0);
+  }
+  GPSmonitorP__CollectFlush__shutdown();
+  if (gt_hdr.count)
+    fail("shutdown left a track", gt_hdr.count, 0, 0);
+  if (shutdown_recs != 1)
+    fail("shutdown records", shutdown_recs, 1, 0);
+
+  /* every record starts with its keyframe and runs to the next one */
+  for (i = j = bytes = 0; i < nrecs; i++) {
+    if (j >= n || !in[j].key)
+      fail("record not on a keyframe", i, j, 0);
+    else if (recs[i].hdr.tow != in[j].tow || recs[i].hdr.week_x != 2010)
+      fail("keyframe tow", i, recs[i].hdr.tow, in[j].tow);
+    if (j + recs[i].hdr.count > n) {
+      fail("too many fixes", i, j, recs[i].hdr.count);
+      break;
+    }
+    cnt = recs[i].hdr.count;
+    for (k = 1; k < cnt; k++)
+      if (in[j + k].key)
+        fail("keyframe inside a record", i, j + k, 0);
+    if (recs[i].hdr.systime != in[j].ms)
+      fail("keyframe systime", i, recs[i].hdr.systime, in[j].ms);
+    if (verbose)
+      printf("rec %3u: %3u fixes  %3u bytes  %4.1f bytes/fix\n", i,
+             cnt, recs[i].dlen,
+             cnt > 1 ? (double) recs[i].dlen / (cnt - 1) : 0.0);
+    j += cnt;
+    bytes += sizeof(dt_gps_track_t) + recs[i].dlen;
+  }
+  if (j != n)
+    fail("fixes out", j, n, 0);
+  if (nrecs < 3)
+    fail("records", nrecs, 3, 0);
+
+  /* make sure the track did what it is here for */
+  for (i = 1, k = 0; i < n; i++) {
+    if (in[i - 1].lon > 0 && in[i].lon < 0)
+      k |= 1;                           /* date line */
+    if (in[i].ms < in[i - 1].ms)
+      k |= 2;                           /* ms wrap */
+  }
+  if (n >= 600 && k != 3)
+    fail("track coverage", k, 3, 0);
+
+  write_recs("gt_test.trk");
+  write_fixes("gt_test.fix", in, n);
+
+  if (failures) {
+    printf("gt_test: %d failures\n", failures);
+    return 1;
+  }
+  printf("gt_test: ok, %u fixes, %u records, %.1f bytes/fix (fix %u)\n",
+         n, nrecs, (double) bytes / n, (uint32_t) sizeof(dt_gps_fix_t));
+  return 0;
+}
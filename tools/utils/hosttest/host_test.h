@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * host_test.h: the harness bits every host test needs.
+ *
+ * fail() and the failure count, the task queue behind post_task, and
+ * the Panic.panic stub (a panic ends the test).  Include it after
+ * APP_C, which brings in host_tos.h and the test's wiring.
+ *
+ * Tasks are posted like TinyOS does it, a task already in the queue
+ * isn't posted again.  run_tasks() runs them in order until the queue
+ * is empty.  A test that doesn't care when tasks run defines
+ * HOST_TASKS_INLINE, post_task then runs the task right away.
+ *
+ * HOST_FAIL_FMT is how fail() prints its three args, "%u %u %u" unless
+ * the test says otherwise.
+ */
+
+#ifndef __HOST_TEST_H__
+#define __HOST_TEST_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_tos.h"
+#include <panic.h>
+
+#ifndef HOST_FAIL_FMT
+#define HOST_FAIL_FMT "%u %u %u"
+#endif
+
+static int failures;
+
+
+static void fail(const char *what, uint32_t a, uint32_t b, uint32_t c) {
+  fprintf(stderr, "*** %s: " HOST_FAIL_FMT "\n", what, a, b, c);
+  failures++;
+}
+
+
+#ifdef HOST_TASKS_INLINE
+
+void post_task(host_task_t t) { t(); }
+
+#else
+
+#define HOST_MAX_TASKS 16
+
+static host_task_t host_tasks[HOST_MAX_TASKS];
+static int         host_task_head, host_task_tail;
+
+void post_task(host_task_t t) {
+  int i;
+
+  for (i = host_task_head; i != host_task_tail; i = (i + 1) % HOST_MAX_TASKS)
+    if (host_tasks[i] == t)
+      return;                           /* already posted */
+  host_tasks[host_task_tail] = t;
+  host_task_tail = (host_task_tail + 1) % HOST_MAX_TASKS;
+  if (host_task_tail == host_task_head) {
+    fprintf(stderr, "*** task queue overflow\n");
+    exit(1);
+  }
+}
+
+
+static bool tasks_pending() {
+  return host_task_head != host_task_tail;
+}
+
+
+static void run_tasks() {
+  host_task_t t;
+
+  while (host_task_head != host_task_tail) {
+    t = host_tasks[host_task_head];
+    host_task_head = (host_task_head + 1) % HOST_MAX_TASKS;
+    t();
+  }
+}
+
+#endif  /* HOST_TASKS_INLINE */
+
+
+void Host__Panic__panic(uint8_t pcode, uint8_t where, parg_t arg0,
+                        parg_t arg1, parg_t arg2, parg_t arg3) {
+  fprintf(stderr, "*** panic: pcode %02x where %d  %x %x %x %x\n",
+          pcode, where, arg0, arg1, arg2, arg3);
+  exit(1);
+}
+
+#endif  /* __HOST_TEST_H__ */
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * Mam-Mark Project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ *
+ *
+ * sd_crc_test - cross check the SD CRCs in tos/chips/sd/sd_crc.h
+ *
+ * sd_crc.h is included as is.  The CRC16 slice-by-4 kernel (what SDspP
+ * uses by default) is checked against the bit at a time reference on
+ * known values, a 512 byte sector of 0xff, and random data at every
+ * length 0..SD_BLOCKSIZE + 7 and every start alignment.  The tables
+ * themselves are regenerated from the polynomials and compared, CRC16
+ * and the CRC7 command table.  Command CRCs are checked against the
+ * values the SD spec lists for CMD0, CMD8 and friends.
+ *
+ * -b   sectors/s, reference against slice-by-4.  Host numbers, good
+ *      for relative comparison only.
+ *
+ * Exits 0 if everything checks out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "host_tos.h"
+#include <sd.h>
+#include <sd_crc.h>
+
+#define HOST_FAIL_FMT "%x %x %x"
+#include "host_test.h"
+
+
+/* CRC7 one bit at a time, x^7 + x^3 + 1 */
+static uint8_t crc7_bits(const uint8_t *data, uint16_t len) {
+  uint8_t crc, b, i;
+
+  crc = 0;
+  while (len--) {
+    b = *data++;
+    for (i = 0; i < 8; i++) {
+      crc <<= 1;
+      if ((b ^ crc) & 0x80)
+        crc ^= 0x09;
+      b <<= 1;
+    }
+  }
+  return crc & 0x7f;
+}
+
+
+/*
+ * the tables from scratch.  crc7: (crc7 << 1) ^ byte in, crc7 << 1 out.
+ * crc16: tab[0] is the byte table, tab[k] is tab[k-1] pushed through
+ * one more zero byte.
+ */
+static void test_tables() {
+  uint16_t tab[4][256];
+  uint8_t  b;
+  int      i, k;
+
+  for (i = 0; i < 256; i++) {
+    b = i;
+    if ((uint8_t) (crc7_bits(&b, 1) << 1) != sd_crc7_tab[i])
+      fail("crc7 table", i, crc7_bits(&b, 1) << 1, sd_crc7_tab[i]);
+  }
+
+  for (i = 0; i < 256; i++) {
+    b = i;
+    tab[0][i] = sd_crc16_ref(&b, 1);
+  }
+  for (k = 1; k < 4; k++)
+    for (i = 0; i < 256; i++)
+      tab[k][i] = (tab[k - 1][i] << 8) ^ tab[0][tab[k - 1][i] >> 8];
+  for (k = 0; k < 4; k++)
+    for (i = 0; i < 256; i++)
+      if (tab[k][i] != sd_crc16_tab[k][i])
+        fail("crc16 table", k, i, sd_crc16_tab[k][i]);
+}
+
+
+static void test_known() {
+  static const uint8_t check[] = "123456789";
+  static const struct {
+    uint8_t  cmd;
+    uint32_t arg;
+    uint8_t  crc;
+  } cmds[] = {
+    { 0x40 |  0, 0,          0x95 },    /* CMD0,  GO_IDLE */
+    { 0x40 |  8, 0x1aa,      0x87 },    /* CMD8,  SEND_IF_COND, 2.7-3.6V, aa */
+    { 0x40 | 12, 0,          0x61 },    /* CMD12, STOP_TRANSMISSION */
+    { 0x40 | 17, 0,          0x55 },    /* CMD17, READ_SINGLE_BLOCK 0 */
+    { 0x40 | 55, 0,          0x65 },    /* CMD55, APP_CMD */
+    { 0x40 | 41, 0x40000000, 0x77 },    /* ACMD41, HCS */
+  };
+  uint8_t  sector[SD_BLOCKSIZE];
+  uint32_t i;
+
+  if (sd_crc16_ref(check, 9) != 0x31c3 ||
+      sd_crc16_slice4(check, 9) != 0x31c3)
+    fail("crc16 check", sd_crc16_ref(check, 9),
+         sd_crc16_slice4(check, 9), 0x31c3);
+
+  memset(sector, 0xff, sizeof(sector));
+  if (sd_crc16_ref(sector, SD_BLOCKSIZE) != 0x7fa1 ||
+      sd_crc16_slice4(sector, SD_BLOCKSIZE) != 0x7fa1)
+    fail("crc16 0xff sector", sd_crc16_ref(sector, SD_BLOCKSIZE),
+         sd_crc16_slice4(sector, SD_BLOCKSIZE), 0x7fa1);
+
+  for (i = 0; i < sizeof(cmds) / sizeof(cmds[0]); i++)
+    if (sd_cmd_crc7(cmds[i].cmd, cmds[i].arg) != cmds[i].crc)
+      fail("cmd crc7", cmds[i].cmd & 0x3f,
+           sd_cmd_crc7(cmds[i].cmd, cmds[i].arg), cmds[i].crc);
+}
+
+
+/* random data, every length up to a sector and a bit, every alignment */
+static void test_random() {
+  uint8_t  buf[SD_BLOCKSIZE + 16];
+  uint16_t len;
+  uint32_t i, pass;
+  int      off;
+
+  for (pass = 0; pass < 4; pass++) {
+    for (i = 0; i < sizeof(buf); i++)
+      buf[i] = random();
+    for (off = 0; off < 4; off++)
+      for (len = 0; len <= SD_BLOCKSIZE + 7; len++)
+        if (sd_crc16_slice4(buf + off, len) != sd_crc16_ref(buf + off, len)) {
+          fail("slice4 != ref", pass, off, len);
+          return;
+        }
+    if (sd_crc7(buf, 5) != crc7_bits(buf, 5))
+      fail("crc7 != bits", pass, sd_crc7(buf, 5), crc7_bits(buf, 5));
+  }
+}
+
+
+static double now() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static void bench(uint32_t iters) {
+  uint8_t  sector[SD_BLOCKSIZE];
+  volatile uint16_t sink;
+  double   t0;
+  uint32_t i;
+
+  for (i = 0; i < SD_BLOCKSIZE; i++)
+    sector[i] = random();
+
+  t0 = now();
+  for (i = 0; i < iters; i++)
+    sink = sd_crc16_ref(sector, SD_BLOCKSIZE);
+  printf("ref     %10.0f sectors/s\n", iters / (now() - t0));
+
+  t0 = now();
+  for (i = 0; i < iters; i++)
+    sink = sd_crc16_slice4(sector, SD_BLOCKSIZE);
+  printf("slice4  %10.0f sectors/s\n", iters / (now() - t0));
+  (void) sink;
+}
+
+
+int main(int argc, char **argv) {
+  srandom(1);
+  if (argc > 1 && !strcmp(argv[1], "-b")) {
+    bench(200000);
+    return 0;
+  }
+
+  test_tables();
+  test_known();
+  test_random();
+  if (failures) {
+    printf("sd_crc_test: %d failures\n", failures);
+    return 1;
+  }
+  printf("sd_crc_test: ok\n");
+  return 0;
+}
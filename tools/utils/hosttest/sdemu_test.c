@@ -0,0 +1,351 @@
+/*
+ * Copyright 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * Mam-Mark Project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ *
+ *
+ * sdemu_test - run SDemuP (the SD emulator) on the host
+ *
+ * The real SDemuP is run through nc2c (see Makefile, sdemu_wiring.h)
+ * and built with SD_EMU_FILE, an image file mmap'd shared, which is
+ * how it is meant to be used off the tag.  Every 8th write is a slow
+ * one (SD_EMU_SLOW_EVERY, Makefile).
+ *
+ * The timer is virtual.  run() hands out posted tasks and fires the
+ * timer (moving host time to its deadline) until nothing is left, so
+ * the busy times the emulator models show up exactly in host time.
+ *
+ * Checks power up, single and multi block writes and reads, erase,
+ * argument and busy checks, standalone access, that the data really
+ * lands in the image file, and the stats.
+ *
+ * Exits 0 if everything checks out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include APP_C
+#include "host_test.h"
+
+
+#define IMG_BLOCKS      64
+#define TEST_CID        3
+
+#define DATA(blk, i)  ((uint8_t) ((i) ^ ((blk) * 37 + 5)))
+
+int verbose = 0;
+
+static uint32_t host_ms;
+static bool     timer_armed;
+static uint32_t timer_deadline;
+
+static uint32_t releases, warns, dones;
+static uint8_t  done_cid;
+static uint32_t done_blk, done_blk_end;
+static uint8_t *done_buf;
+static uint32_t done_ms;
+
+static uint8_t  blks[4][SD_BLOCKSIZE];
+static uint8_t *bufs[4] = { blks[0], blks[1], blks[2], blks[3] };
+
+
+void Host__Timer__startOneShot(uint32_t dt) {
+  if (timer_armed)
+    fail("timer already running", timer_deadline, dt, 0);
+  timer_armed    = TRUE;
+  timer_deadline = host_ms + dt;
+}
+
+
+uint32_t Host__LocalTime__get() { return host_ms; }
+
+
+void Host__Panic__warn(uint8_t pcode, uint8_t where, parg_t arg0,
+                       parg_t arg1, parg_t arg2, parg_t arg3) {
+  if (verbose)
+    printf("warn: pcode %02x where %d  %x %x\n", pcode, where, arg0, arg1);
+  warns++;
+}
+
+
+error_t Host__RDO__release() {
+  releases++;
+  return SUCCESS;
+}
+
+
+static void done(uint8_t cid, uint32_t blk, uint32_t blk_end, uint8_t *buf,
+                 error_t err) {
+  if (err)
+    fail("completion error", blk, err, 0);
+  dones++;
+  done_cid     = cid;
+  done_blk     = blk;
+  done_blk_end = blk_end;
+  done_buf     = buf;
+  done_ms      = host_ms;
+}
+
+
+void Host__SDread__readDone(uint8_t cid, uint32_t blk_id, uint8_t *buf,
+                            error_t error) {
+  done(cid, blk_id, 0, buf, error);
+}
+
+
+void Host__SDwrite__writeDone(uint8_t cid, uint32_t blk_id, uint8_t *buf,
+                              error_t error) {
+  done(cid, blk_id, 0, buf, error);
+}
+
+
+void Host__SDerase__eraseDone(uint8_t cid, uint32_t blk_start,
+                              uint32_t blk_end, error_t error) {
+  done(cid, blk_start, blk_end, NULL, error);
+}
+
+
+/* tasks first, then the timer, until there is nothing left to do */
+static void run() {
+  for (;;) {
+    run_tasks();
+    if (!timer_armed)
+      return;
+    timer_armed = FALSE;
+    host_ms = timer_deadline;
+    SDemuP__SDtimer__fired();
+  }
+}
+
+
+static void fill(uint8_t *buf, uint32_t blk) {
+  uint32_t i;
+
+  for (i = 0; i < SD_BLOCKSIZE; i++)
+    buf[i] = DATA(blk, i);
+}
+
+
+static void check(const char *what, uint8_t *buf, uint32_t blk) {
+  uint32_t i;
+
+  for (i = 0; i < SD_BLOCKSIZE; i++)
+    if (buf[i] != DATA(blk, i)) {
+      fail(what, blk, i, buf[i]);
+      return;
+    }
+}
+
+
+/*
+ * issue an op (rc from the command), expect it to complete once for
+ * blk after busy ms.  The emulator is busy until then.
+ */
+static void expect_done(const char *what, error_t rc, uint32_t blk,
+                        uint32_t busy) {
+  uint32_t t0, n;
+
+  t0 = host_ms;
+  n  = dones;
+  if (rc != SUCCESS) {
+    fail(what, blk, rc, 0);
+    return;
+  }
+  if (SDemuP__SDread__read(TEST_CID, 0, blks[3]) != EBUSY)
+    fail("not busy", blk, 0, 0);
+  run();
+  if (dones != n + 1 || done_cid != TEST_CID || done_blk != blk)
+    fail(what, dones - n, done_cid, done_blk);
+  if (busy && done_ms - t0 != busy)
+    fail("busy time", blk, done_ms - t0, busy);
+}
+
+
+/* fresh image, all erased */
+static int make_image(const char *name, uint32_t nblks) {
+  int fd;
+
+  fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate(fd, (off_t) nblks * SD_BLOCKSIZE)) {
+    perror(name);
+    exit(1);
+  }
+  return fd;
+}
+
+
+static void test_power_up() {
+  SDemuP__ResourceDefaultOwner__requested();
+  run();
+  if (releases != 1 || sd_emu_stats.pwr_ups != 1 ||
+      host_ms != SD_EMU_PWR_UP_MS)
+    fail("power up", releases, sd_emu_stats.pwr_ups, host_ms);
+}
+
+
+/*
+ * single block writes, every SD_EMU_SLOW_EVERY'th one stays busy for
+ * SD_EMU_SLOW_MS, over SD_WRITE_WARN_THRESHOLD, and warns.
+ */
+static void test_single(int fd) {
+  uint8_t  sector[SD_BLOCKSIZE];
+  uint32_t blk, busy;
+
+  for (blk = 0; blk < 16; blk++) {
+    fill(blks[0], blk);
+    busy = SD_EMU_CMD_MS + SD_EMU_WRITE_MS;
+    if ((blk + 1) % SD_EMU_SLOW_EVERY == 0)
+      busy = SD_EMU_SLOW_MS;
+    expect_done("write", SDemuP__SDwrite__write(TEST_CID, blk, blks[0]),
+                blk, busy);
+    if (done_buf != blks[0])
+      fail("write buf", blk, 0, 0);
+  }
+  if (sd_emu_stats.slow_writes != 16 / SD_EMU_SLOW_EVERY ||
+      warns != 16 / SD_EMU_SLOW_EVERY)
+    fail("slow writes", sd_emu_stats.slow_writes, warns, 0);
+  if (sd_emu_stats.max_write_ms != SD_EMU_SLOW_MS)
+    fail("max write", sd_emu_stats.max_write_ms, SD_EMU_SLOW_MS, 0);
+
+  for (blk = 0; blk < 16; blk++) {
+    memset(blks[1], 0, SD_BLOCKSIZE);
+    expect_done("read", SDemuP__SDread__read(TEST_CID, blk, blks[1]),
+                blk, SD_EMU_CMD_MS + SD_EMU_READ_MS);
+    if (done_buf != blks[1])
+      fail("read buf", blk, 0, 0);
+    check("read", blks[1], blk);
+  }
+
+  /* it's in the file, not just the mapping we're looking at */
+  if (pread(fd, sector, SD_BLOCKSIZE, 5 * SD_BLOCKSIZE) != SD_BLOCKSIZE)
+    fail("pread", 5, 0, 0);
+  check("image file", sector, 5);
+}
+
+
+static void test_multi() {
+  uint32_t i;
+
+  for (i = 0; i < 4; i++)
+    fill(bufs[i], 20 + i);
+  expect_done("write_multi", SDemuP__SDwrite__write_multi(TEST_CID, 20, bufs, 4),
+              20, 0);
+  if (done_buf != blks[0])
+    fail("write_multi buf", 0, 0, 0);
+  memset(blks, 0, sizeof(blks));
+  expect_done("read_multi", SDemuP__SDread__read_multi(TEST_CID, 20, bufs, 4),
+              20, SD_EMU_CMD_MS + SD_EMU_READ_MS * 4);
+  for (i = 0; i < 4; i++)
+    check("read_multi", bufs[i], 20 + i);
+}
+
+
+static void test_erase() {
+  memset(blks, 0xa5, sizeof(blks));
+  expect_done("erase", SDemuP__SDerase__erase(TEST_CID, 21, 22), 21,
+              SD_EMU_CMD_MS + SD_EMU_ERASE_MS);
+  if (done_blk_end != 22)
+    fail("erase end", done_blk_end, 22, 0);
+  expect_done("read erased", SDemuP__SDread__read_multi(TEST_CID, 20, bufs, 4),
+              20, 0);
+  check("erase, before", bufs[0], 20);
+  if (!SDemuP__SDraw__chk_erased(bufs[1]) || !SDemuP__SDraw__chk_erased(bufs[2]))
+    fail("not erased", 21, 22, 0);
+  check("erase, after", bufs[3], 23);
+}
+
+
+static void test_args() {
+  if (SDemuP__SDraw__blocks() != IMG_BLOCKS)
+    fail("blocks", SDemuP__SDraw__blocks(), IMG_BLOCKS, 0);
+  if (SDemuP__SDread__read(TEST_CID, IMG_BLOCKS, blks[0]) != EINVAL ||
+      SDemuP__SDread__read(TEST_CID, 0, NULL) != EINVAL ||
+      SDemuP__SDwrite__write(TEST_CID, IMG_BLOCKS, blks[0]) != EINVAL ||
+      SDemuP__SDwrite__write_multi(TEST_CID, IMG_BLOCKS - 2, bufs, 4) != EINVAL ||
+      SDemuP__SDread__read_multi(TEST_CID, 0, bufs, 0) != EINVAL ||
+      SDemuP__SDerase__erase(TEST_CID, 10, IMG_BLOCKS) != EINVAL ||
+      SDemuP__SDerase__erase(TEST_CID, 10, 9) != EINVAL)
+    fail("bad args accepted", 0, 0, 0);
+  if (timer_armed || tasks_pending())
+    fail("bad args started something", timer_armed, tasks_pending(), 0);
+}
+
+
+/* standalone, what Panic uses.  Synchronous, no timer. */
+static void test_sa() {
+  SDemuP__SDsa__reset();
+  if (!SDemuP__SDsa__inSA())
+    fail("not in SA", 0, 0, 0);
+  fill(blks[0], 40);
+  SDemuP__SDsa__write(40, blks[0]);
+  memset(blks[1], 0, SD_BLOCKSIZE);
+  SDemuP__SDsa__read(40, blks[1]);
+  check("sa", blks[1], 40);
+  SDemuP__SDsa__off();
+  if (SDemuP__SDsa__inSA() || timer_armed)
+    fail("sa off", 0, timer_armed, 0);
+}
+
+
+static void test_stats() {
+  sd_emu_stats_t *s = &sd_emu_stats;
+
+  if (verbose)
+    printf("reads %u writes %u erases %u blks r/w %u/%u slow %u busy %u ms\n",
+           s->reads, s->writes, s->erases, s->blks_read, s->blks_written,
+           s->slow_writes, s->busy_ms);
+  if (s->reads != 18 || s->blks_read != 24 || s->writes != 17 ||
+      s->blks_written != 20 || s->erases != 1)
+    fail("op counts", s->reads, s->writes, s->erases);
+  if (s->busy_ms != host_ms - SD_EMU_PWR_UP_MS)
+    fail("busy ms", s->busy_ms, host_ms - SD_EMU_PWR_UP_MS, 0);
+}
+
+
+int main(int argc, char **argv) {
+  int fd;
+
+  if (argc > 1 && !strcmp(argv[1], "-v"))
+    verbose++;
+
+  fd = make_image(SD_EMU_FILE, IMG_BLOCKS);
+  SDemuP__SoftwareInit__init();
+
+  test_power_up();
+  test_args();
+  test_single(fd);
+  test_multi();
+  test_erase();
+  test_sa();
+  test_stats();
+
+  close(fd);
+  unlink(SD_EMU_FILE);
+  if (failures) {
+    printf("sdemu_test: %d failures\n", failures);
+    return 1;
+  }
+  printf("sdemu_test: ok\n");
+  return 0;
+}
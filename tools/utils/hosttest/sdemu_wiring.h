@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * sdemu_wiring.h: host configuration for SDemuP (SD0C under sdemu).
+ *
+ * The timer, LocalTime, Panic, ResourceDefaultOwner and the SDread,
+ * SDwrite, SDerase completions land on Host__ stubs in sdemu_test.c.
+ */
+
+#ifndef __SDEMU_WIRING_H__
+#define __SDEMU_WIRING_H__
+
+#include <panic.h>
+#include <platform_panic.h>     /* normally via the platform */
+
+#define SDemuP__SDtimer__startOneShot           Host__Timer__startOneShot
+#define SDemuP__lt__get                         Host__LocalTime__get
+#define SDemuP__Panic__panic                    Host__Panic__panic
+#define SDemuP__Panic__warn                     Host__Panic__warn
+#define SDemuP__ResourceDefaultOwner__release   Host__RDO__release
+#define SDemuP__SDread__readDone                Host__SDread__readDone
+#define SDemuP__SDwrite__writeDone              Host__SDwrite__writeDone
+#define SDemuP__SDerase__eraseDone              Host__SDerase__eraseDone
+
+void     Host__Timer__startOneShot(uint32_t dt);
+uint32_t Host__LocalTime__get();
+void     Host__Panic__panic(uint8_t pcode, uint8_t where, parg_t arg0,
+                            parg_t arg1, parg_t arg2, parg_t arg3);
+void     Host__Panic__warn(uint8_t pcode, uint8_t where, parg_t arg0,
+                           parg_t arg1, parg_t arg2, parg_t arg3);
+error_t  Host__RDO__release();
+void     Host__SDread__readDone(uint8_t cid, uint32_t blk_id, uint8_t *buf,
+                                error_t error);
+void     Host__SDwrite__writeDone(uint8_t cid, uint32_t blk_id, uint8_t *buf,
+                                  error_t error);
+void     Host__SDerase__eraseDone(uint8_t cid, uint32_t blk_start,
+                                  uint32_t blk_end, error_t error);
+
+#endif  /* __SDEMU_WIRING_H__ */
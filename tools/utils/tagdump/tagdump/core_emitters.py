@@ -31,6 +31,10 @@ from   dt_defs      import print_record
 
 from   core_headers import owcb_obj
 from   core_headers import image_info_obj
+from   core_headers import dt_index_ent_obj
+from   core_headers import dt_gps_filt_ent_obj
+from   core_headers import gps_filt_names
+from   core_headers import dt_gps_fix_pos_obj
 from   core_headers import event_names
 from   core_headers import PANIC_WARN
 from   core_headers import GPS_CMD
@@ -109,6 +113,12 @@ def reboot_reason_name(reason):
 
 rbt0  = '  {:s} -> {:s}  [{:s}]  ({:d}/{:d})'
 
+# on-disk offsets are the low 32 bits of a 64 bit stream offset, see
+# DT_OFF64 in typed_data.h.  ref is the offset of the record they were
+# found in, they always point back less than 4GiB.
+def dt_off64(ref, lo):
+    return ref - ((ref - lo) & 0xffffffff)
+
 rbt1a = '    REBOOT: {:7s}  f: {:5s}  c: {:5s}  m: {:5s}  reboots: {}/{}   chk_fails: {}'
 rbt1b = '    dt: 2017/12/26-(mon)-01:52:40 GMT  prev_sync: {} (0x{:04x})  rev: {:7d}'
 
@@ -120,6 +130,7 @@ rbt2e = '    reboots: {:4}  fails: {:4}  strg: {:8}  loc: {:4}'
 rbt2f = '    uptime: {:8}  elapsed: {:8}'
 rbt2g = '    rbt_reason:   {:2}  ow_req: {:2}  mode: {:2}  act:  {:2}'
 rbt2h = '    vec_chk_fail: {:2}  image_chk_fail:   {:2}'
+rbt2i = '    dblk_hint: {:08x}  chk: {:08x}'
 
 def emit_reboot(level, offset, buf, obj):
     len      = obj['hdr']['len'].val
@@ -128,7 +139,7 @@ def emit_reboot(level, offset, buf, obj):
     st       = obj['hdr']['st'].val
 
     majik    = obj['majik'].val
-    prev     = obj['prev'].val
+    prev     = (obj['prev_hi'].val << 32) | obj['prev'].val
     dt_rev   = obj['dt_rev'].val
     base     = obj['base'].val
     if dt_rev != DT_H_REVISION:
@@ -162,7 +173,7 @@ def emit_reboot(level, offset, buf, obj):
             base_name(from_base), base_name(base),
             ow_boot_mode_name(owcb_obj['ow_boot_mode'].val),
             reboot_count, fail_count, chk_fails))
-        print(rbt1b.format(obj['prev'].val, obj['prev'].val, dt_rev))
+        print(rbt1b.format(prev, prev, dt_rev))
 
     if (level >= 2):                    # detailed display (level 2)
         print
@@ -183,6 +194,8 @@ def emit_reboot(level, offset, buf, obj):
                            owcb_obj['owt_action'].val))
         print(rbt2h.format(owcb_obj['vec_chk_fail'].val,
                            owcb_obj['image_chk_fail'].val))
+        print(rbt2i.format(owcb_obj['dblk_nxt_hint'].val,
+                           owcb_obj['dblk_hint_chk'].val))
 
 
 ################################################################
@@ -261,9 +274,11 @@ def emit_version(level, offset, buf, obj):
 #
 
 sync0  = '  prev: @{:d} (0x{:x})'
+sync0a = '  index: @{:d} (0x{:x})'
 
 sync1a = '    SYNC: majik:  0x{:x}   prev: {} (0x{:x})'
 sync1b = '          dt: 2017/12/26-01:52:40 (1) GMT'
+sync2  = '    *** dropped: norm: {}  bulk: {}'
 
 def emit_sync(level, offset, buf, obj):
     len      = obj['hdr']['len'].val
@@ -272,10 +287,19 @@ def emit_sync(level, offset, buf, obj):
     st       = obj['hdr']['st'].val
 
     majik    = obj['majik'].val
-    prev     = obj['prev_sync'].val
+    prev     = (obj['prev_sync_hi'].val << 32) | obj['prev_sync'].val
+    d_norm   = obj['drop_norm'].val
+    d_bulk   = obj['drop_bulk'].val
+    p_index  = obj['prev_index'].val
+    if p_index:
+        p_index = dt_off64(offset, p_index)
 
     print(rec0.format(offset, recnum, st, len, type, dt_name(type))),
-    print(sync0.format(prev, prev))
+    print(sync0.format(prev, prev)),
+    print(sync0a.format(p_index, p_index))
+
+    if (d_norm or d_bulk):
+        print(sync2.format(d_norm, d_bulk))
 
     if (level >= 1):
         print(sync1a.format(majik, prev, prev))
@@ -349,6 +373,81 @@ def emit_debug(level, offset, buf, obj):
     print(debug0.format())
 
 
+################################################################
+#
+# INDEX emitter
+# uses decode_default with dt_index_obj to decode
+# entries follow, decoded with dt_index_ent_obj
+#
+
+index0 = '  L{}  n: {}  prev: @{:d} (0x{:x})'
+index1 = '    {:2d}: {:6d} {:8d}  @{:d} (0x{:x})'
+
+def emit_index(level, offset, buf, obj):
+    len      = obj['hdr']['len'].val
+    type     = obj['hdr']['type'].val
+    recnum   = obj['hdr']['recnum'].val
+    st       = obj['hdr']['st'].val
+
+    i_level  = obj['level'].val
+    count    = obj['count'].val
+    prev     = obj['prev_index'].val
+    if prev:
+        prev = dt_off64(offset, prev)
+
+    print(rec0.format(offset, recnum, st, len, type, dt_name(type))),
+    print(index0.format(i_level, count, prev, prev))
+
+    if (level >= 1):
+        ent_off = obj.__len__()
+        for i in range(count):
+            dt_index_ent_obj.set(buf[ent_off:])
+            e_st  = dt_index_ent_obj['st'].val
+            e_rec = dt_index_ent_obj['recnum'].val
+            e_off = dt_off64(offset, dt_index_ent_obj['offset'].val)
+            print(index1.format(i, e_rec, e_st, e_off, e_off))
+            ent_off += dt_index_ent_obj.__len__()
+
+
+################################################################
+#
+# GPS_FILTER emitter
+# uses decode_default with dt_gps_filter_obj to decode
+# entries follow, decoded with dt_gps_filt_ent_obj, counts since
+# the last GPS_FILTER record.
+#
+
+gps_filter0 = '  gen: {}  n: {}  fix: {}'
+gps_filter1 = '    {:>7s}  {:6s} {:3d}  passed: {:5d}  dropped: {:5d}'
+
+def emit_gps_filter(level, offset, buf, obj):
+    len      = obj['hdr']['len'].val
+    type     = obj['hdr']['type'].val
+    recnum   = obj['hdr']['recnum'].val
+    st       = obj['hdr']['st'].val
+
+    gen      = obj['gen'].val
+    count    = obj['count'].val
+    fix      = obj['fix'].val
+
+    print(rec0.format(offset, recnum, st, len, type, dt_name(type))),
+    print(gps_filter0.format(gen, count, fix))
+
+    if (level >= 1):
+        ent_off = obj.__len__()
+        for i in range(count):
+            dt_gps_filt_ent_obj.set(buf[ent_off:])
+            mid    = dt_gps_filt_ent_obj['mid'].val
+            policy = dt_gps_filt_ent_obj['policy'].val
+            mid_s  = 'default' if i == 0 else 'mid {}'.format(mid)
+            print(gps_filter1.format(mid_s,
+                gps_filt_names.get(policy, 'pol/' + str(policy)),
+                dt_gps_filt_ent_obj['n'].val,
+                dt_gps_filt_ent_obj['passed'].val,
+                dt_gps_filt_ent_obj['dropped'].val))
+            ent_off += dt_gps_filt_ent_obj.__len__()
+
+
 ################################################################
 #
 # GPS_VERSION emitter
@@ -365,12 +464,150 @@ def emit_gps_version(level, offset, buf, obj):
         print('    {}'.format(obj['sirf_swver']))
 
 
+gps_time0 = '  utc: {}/{:02}/{:02}-{:02}:{:02}:{:02}.{:03}  ({} sats)'
+gps_time1 = '    xweek: {:4}  tow: {:10}s'
+
 def emit_gps_time(level, offset, buf, obj):
-    print_record(offset, buf)
+    len      = obj['hdr']['len'].val
+    type     = obj['hdr']['type'].val
+    recnum   = obj['hdr']['recnum'].val
+    st       = obj['hdr']['st'].val
+
+    utc_ms   = obj['utc_ms'].val
+    print(rec0.format(offset, recnum, st, len, type, dt_name(type))),
+    print(gps_time0.format(obj['utc_year'].val, obj['utc_month'].val,
+                           obj['utc_day'].val,  obj['utc_hour'].val,
+                           obj['utc_min'].val,  utc_ms / 1000, utc_ms % 1000,
+                           obj['nsats'].val))
     if (level >= 1):
-        print(obj)
-        print_hdr(obj)
-        print
+        print(gps_time1.format(obj['week_x'].val,
+                               obj['tow'].val/float(1000)))
+
+
+################################################################
+#
+# GPS_FIX emitter
+# uses decode_default with dt_gps_fix_obj to decode
+# position (dt_gps_fix_pos_obj) follows if we have a fix
+#
+
+gps_fix0  = '  {:>2s} ({})  {}'
+gps_fix1a = '    nav_valid: 0x{:04x}  nav_type: 0x{:04x}  xweek: {:4}  tow: {:10}s'
+gps_fix1b = '    mode1: 0x{:02x}  hdop: {}  additional_mode: 0x{:02x}  awake: {}'
+gps_fix1c = '    alt(e): {:7.2f} m  alt(msl): {:7.2f} m  ehpe: {:.2f}  evpe: {:.2f}'
+gps_fix1d = '    sog: {:.2f} m/s  cog: {:.2f}  sat_mask: 0x{:08x}'
+gps_fix1e = '    xyz: {} {} {}'
+
+def emit_gps_fix(level, offset, buf, obj):
+    len      = obj['hdr']['len'].val
+    type     = obj['hdr']['type'].val
+    recnum   = obj['hdr']['recnum'].val
+    st       = obj['hdr']['st'].val
+
+    nav_valid = obj['nav_valid'].val
+    pos       = None
+    if (len >= obj.__len__() + dt_gps_fix_pos_obj.__len__()):
+        dt_gps_fix_pos_obj.set(buf[obj.__len__():])
+        pos = dt_gps_fix_pos_obj
+
+    latlon = ''
+    if pos:
+        lat = pos['lat'].val
+        lon = pos['lon'].val
+        latlon = '{}({})  {}({})'.format(
+            abs(lat)/float(10000000), 'S' if lat < 0 else 'N',
+            abs(lon)/float(10000000), 'W' if lon < 0 else 'E')
+    print(rec0.format(offset, recnum, st, len, type, dt_name(type))),
+    print(gps_fix0.format('nl' if nav_valid else 'L', obj['nsats'].val,
+                          latlon).rstrip())
+    if (level >= 1):
+        print(gps_fix1a.format(nav_valid, obj['nav_type'].val,
+                               obj['week_x'].val, obj['tow'].val/float(1000)))
+        print(gps_fix1b.format(obj['mode1'].val, obj['hdop'].val,
+                               obj['additional_mode'].val, obj['awake'].val))
+        if pos:
+            print(gps_fix1c.format(pos['alt_ell'].val/float(100),
+                                   pos['alt_msl'].val/float(100),
+                                   pos['ehpe'].val/float(100),
+                                   pos['evpe'].val/float(100)))
+            print(gps_fix1d.format(pos['sog'].val/float(100),
+                                   pos['cog'].val/float(100),
+                                   pos['sat_mask'].val))
+            print(gps_fix1e.format(pos['x'].val, pos['y'].val, pos['z'].val))
+
+
+################################################################
+#
+# GPS_TRACK emitter
+# uses decode_default with dt_gps_track_obj to decode the keyframe
+# the rest of the fixes are varint deltas, see typed_data.h
+#
+
+def s32(v):
+    v &= 0xffffffff
+    return v - 0x100000000 if v & 0x80000000 else v
+
+def gps_track_fixes(obj, buf):
+    '''
+    expand a track record to its fixes, [(systime, lat, lon, alt_msl)]
+
+    deltas are zig-zag varints added mod 2^32, the same as the tag
+    took them.  Returns what could be decoded if the record is short.
+    '''
+    xlen  = obj['hdr']['len'].val
+    count = obj['count'].val
+    cur   = [ obj['hdr']['st'].val, obj['lat'].val,
+              obj['lon'].val,       obj['alt_msl'].val ]
+    fixes = [ tuple(cur) ]
+    idx   = obj.__len__()
+    while len(fixes) < count:
+        d = []
+        while len(d) < 4:
+            v = 0
+            shift = 0
+            while True:
+                if idx >= xlen:
+                    return fixes
+                b = buf[idx]
+                idx += 1
+                v |= (b & 0x7f) << shift
+                shift += 7
+                if not (b & 0x80):
+                    break
+            d.append((v >> 1) ^ -(v & 1))
+        cur[0] = cur[0] + s32(d[0])
+        cur[1] = s32(cur[1] + d[1])
+        cur[2] = s32(cur[2] + d[2])
+        cur[3] = s32(cur[3] + d[3])
+        fixes.append(tuple(cur))
+    return fixes
+
+gps_track0 = '  n: {}  {}({})  {}({})  span: {:.1f}s'
+gps_track1 = '    xweek: {:4}  tow: {:10}s'
+gps_track2 = '    {:3d}: {:8d}  {:12d} {:12d}  {:9d}'
+
+def emit_gps_track(level, offset, buf, obj):
+    len      = obj['hdr']['len'].val
+    type     = obj['hdr']['type'].val
+    recnum   = obj['hdr']['recnum'].val
+    st       = obj['hdr']['st'].val
+
+    count    = obj['count'].val
+    lat      = obj['lat'].val
+    lon      = obj['lon'].val
+    fixes    = gps_track_fixes(obj, buf)
+    span     = (fixes[-1][0] - st) / 1024.
+    print(rec0.format(offset, recnum, st, len, type, dt_name(type))),
+    print(gps_track0.format(count,
+                            abs(lat)/float(10000000), 'S' if lat < 0 else 'N',
+                            abs(lon)/float(10000000), 'W' if lon < 0 else 'E',
+                            span))
+    if (fixes.__len__() != count):
+        print('*** track short: {} of {} fixes'.format(fixes.__len__(), count))
+    if (level >= 1):
+        print(gps_track1.format(obj['week_x'].val, obj['tow'].val/float(1000)))
+        for i, f in enumerate(fixes):
+            print(gps_track2.format(i, f[0], f[1], f[2], f[3]))
 
 
 def emit_gps_geo(level, offset, buf, obj):
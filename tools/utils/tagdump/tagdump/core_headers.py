@@ -64,7 +64,8 @@ dt_reboot_obj   = aggie(OrderedDict([
     ('prev',    atom(('<I', '{:08x}'))),
     ('majik',   atom(('<I', '{:08x}'))),
     ('dt_rev',  atom(('<I', '{:08x}'))),
-    ('base',    atom(('<I', '{:08x}')))]))
+    ('base',    atom(('<I', '{:08x}'))),
+    ('prev_hi', atom(('<I', '{:x}')))]))
 
 #
 # reboot is followed by the ow_control_block
@@ -93,6 +94,8 @@ owcb_obj        = aggie(OrderedDict([
     ('strange_loc',     atom(('<I', '0x{:04x}'))),
     ('vec_chk_fail',    atom(('<I', '{}'))),
     ('image_chk_fail',  atom(('<I', '{}'))),
+    ('dblk_nxt_hint',   atom(('<I', '0x{:08x}'))),
+    ('dblk_hint_chk',   atom(('<I', '0x{:08x}'))),
     ('ow_sig_c',        atom(('<I', '0x{:08x}')))
 ]))
 
@@ -131,7 +134,49 @@ dt_sync_obj     = aggie(OrderedDict([
     ('hdr',       dt_hdr_obj),
     ('datetime',  atom(('10s','{}', binascii.hexlify))),
     ('prev_sync', atom(('<I', '{:x}'))),
-    ('majik',     atom(('<I', '{:08x}')))]))
+    ('majik',     atom(('<I', '{:08x}'))),
+    ('drop_norm', atom(('<H', '{}'))),
+    ('drop_bulk', atom(('<H', '{}'))),
+    ('prev_index',atom(('<I', '{:x}'))),
+    ('prev_sync_hi',atom(('<I', '{:x}')))]))
+
+
+# INDEX, entries (dt_index_ent_obj) follow, count of them
+dt_index_obj    = aggie(OrderedDict([
+    ('hdr',       dt_hdr_obj),
+    ('level',     atom(('<B', '{}'))),
+    ('count',     atom(('<B', '{}'))),
+    ('prev_index',atom(('<I', '{:x}')))]))
+
+dt_index_ent_obj = aggie(OrderedDict([
+    ('st',        atom(('<Q', '0x{:x}'))),
+    ('recnum',    atom(('<I', '{}'))),
+    ('offset',    atom(('<I', '{:x}')))]))
+
+
+# GPS_FILTER, entries (dt_gps_filt_ent_obj) follow, count of them
+dt_gps_filter_obj = aggie(OrderedDict([
+    ('hdr',       dt_hdr_obj),
+    ('gen',       atom(('<H', '{}'))),
+    ('count',     atom(('<B', '{}'))),
+    ('fix',       atom(('<B', '{}'))),
+    ('pad',       atom(('<H', '{}')))]))
+
+dt_gps_filt_ent_obj = aggie(OrderedDict([
+    ('mid',       atom(('<B', '{}'))),
+    ('policy',    atom(('<B', '{}'))),
+    ('n',         atom(('<B', '{}'))),
+    ('pad',       atom(('<B', '{}'))),
+    ('passed',    atom(('<H', '{}'))),
+    ('dropped',   atom(('<H', '{}')))]))
+
+gps_filt_names = {
+    0: "ALWAYS",
+    1: "NEVER",
+    2: "NTH",
+    3: "CHANGE",
+    4: "ACQ",
+}
 
 
 # EVENT
@@ -228,7 +273,56 @@ dt_gps_hdr_obj = aggie(OrderedDict([('hdr',     dt_hdr_obj),
 dt_gps_ver_obj = aggie(OrderedDict([('gps_hdr',    dt_gps_hdr_obj),
                                     ('sirf_swver', sirf_swver_obj)]))
 
-dt_gps_time_obj = dt_simple_hdr
+dt_gps_time_obj = aggie(OrderedDict([
+    ('hdr',       dt_hdr_obj),
+    ('tow',       atom(('<I', '{}'))),
+    ('week_x',    atom(('<H', '{}'))),
+    ('utc_year',  atom(('<H', '{}'))),
+    ('utc_ms',    atom(('<H', '{}'))),
+    ('utc_month', atom(('<B', '{}'))),
+    ('utc_day',   atom(('<B', '{}'))),
+    ('utc_hour',  atom(('<B', '{}'))),
+    ('utc_min',   atom(('<B', '{}'))),
+    ('nsats',     atom(('<B', '{}'))),
+    ('pad',       atom(('3s', '{}')))]))
+
+# GPS_FIX, dt_gps_fix_pos_obj follows if len says so (have a fix)
+dt_gps_fix_obj  = aggie(OrderedDict([
+    ('hdr',       dt_hdr_obj),
+    ('nav_valid', atom(('<H', '0x{:04x}'))),
+    ('nav_type',  atom(('<H', '0x{:04x}'))),
+    ('tow',       atom(('<I', '{}'))),
+    ('week_x',    atom(('<H', '{}'))),
+    ('nsats',     atom(('<B', '{}'))),
+    ('mode1',     atom(('<B', '0x{:02x}'))),
+    ('hdop',      atom(('<B', '{}'))),
+    ('additional_mode', atom(('<B', '0x{:02x}'))),
+    ('awake',     atom(('<I', '{}')))]))
+
+dt_gps_fix_pos_obj = aggie(OrderedDict([
+    ('lat',       atom(('<i', '{}'))),
+    ('lon',       atom(('<i', '{}'))),
+    ('alt_ell',   atom(('<i', '{}'))),
+    ('alt_msl',   atom(('<i', '{}'))),
+    ('ehpe',      atom(('<I', '{}'))),
+    ('evpe',      atom(('<I', '{}'))),
+    ('sog',       atom(('<H', '{}'))),
+    ('cog',       atom(('<H', '{}'))),
+    ('sat_mask',  atom(('<I', '0x{:08x}'))),
+    ('x',         atom(('<i', '{}'))),
+    ('y',         atom(('<i', '{}'))),
+    ('z',         atom(('<i', '{}')))]))
+
+# GPS_TRACK, keyframe, varint deltas follow (see gps_track_fixes)
+dt_gps_track_obj = aggie(OrderedDict([
+    ('hdr',       dt_hdr_obj),
+    ('count',     atom(('<H', '{}'))),
+    ('tow',       atom(('<I', '{}'))),
+    ('lat',       atom(('<i', '{}'))),
+    ('lon',       atom(('<i', '{}'))),
+    ('alt_msl',   atom(('<i', '{}'))),
+    ('week_x',    atom(('<H', '{}'))),
+    ('pad',       atom(('<H', '{}')))]))
 dt_gps_geo_obj  = dt_simple_hdr
 dt_gps_xyz_obj  = dt_simple_hdr
 
@@ -36,6 +36,7 @@ __version__ = '0.2.0 (dt)'
 
 __all__ = [
     'DT_H_REVISION',
+    'DT_F_USECS',
 
     # object identifiers in each dt_record tuple
     'DTR_REQ_LEN',
@@ -50,6 +51,7 @@ __all__ = [
     'DT_SYNC',
     'DT_EVENT',
     'DT_DEBUG',
+    'DT_INDEX',
     'DT_GPS_VERSION',
     'DT_GPS_TIME',
     'DT_GPS_GEO',
@@ -59,6 +61,9 @@ __all__ = [
     'DT_TEST',
     'DT_NOTE',
     'DT_CONFIG',
+    'DT_GPS_FILTER',
+    'DT_GPS_FIX',
+    'DT_GPS_TRACK',
     'DT_GPS_RAW_SIRFBIN'
 ]
 
@@ -67,7 +72,7 @@ __all__ = [
 # The value of DT_H_REVISION reflects the version of typed_data.h that
 # we have implemented.  Includes record definitions, headers and decoders.
 
-DT_H_REVISION           = 16
+DT_H_REVISION           = 24
 
 
 # dt_records
@@ -118,6 +123,7 @@ DT_VERSION              = 2
 DT_SYNC                 = 3
 DT_EVENT                = 4
 DT_DEBUG                = 5
+DT_INDEX                = 6
 DT_GPS_VERSION          = 16
 DT_GPS_TIME             = 17
 DT_GPS_GEO              = 18
@@ -127,8 +133,14 @@ DT_SENSOR_SET           = 21
 DT_TEST                 = 22
 DT_NOTE                 = 23
 DT_CONFIG		= 24
+DT_GPS_FILTER           = 25
+DT_GPS_FIX              = 26
+DT_GPS_TRACK            = 27
 DT_GPS_RAW_SIRFBIN      = 32
 
+# dtype flag, record carries a usecs trailer (last 4 bytes, in len)
+DT_F_USECS              = 0x8000
+
 
 # common format used by all records.  (rec0)
 # --- offset recnum  systime  len  type  name
@@ -136,6 +148,11 @@ DT_GPS_RAW_SIRFBIN      = 32
 # ---    512      1      322  116     1  REBOOT  unset -> GOLD (GOLD)
 rec0  = '--- @{:<6d} {:6d} {:8d}  {:3d}    {:2d}  {:s}'
 
+# usecs trailer: us since boot, lag behind systime (relative to the first
+# stamp this boot), delta from the last stamp
+#     usecs: 12.345678  lag: 123  dt: 4567
+usec0 = '    usecs: {:d}.{:06d}  lag: {:d}  dt: {:d}'
+
 
 def dt_name(rtype):
     v = dt_records.get(rtype, (0, None, None, None, 'unk'))
@@ -81,7 +81,7 @@ ver_str = '\ntagdump: ' + VERSION + ':  dt_rev ' + str(DT_REV)
 #                   [--rtypes RTYPES(ints)] [--rnames RNAMES(name[,...])]
 #                   [-s START_TIME] [-e END_TIME]
 #                   [-r START_REC]  [-l LAST_REC]
-#                   input
+#                   input [input ...]
 #
 # Args:
 #
@@ -127,12 +127,23 @@ ver_str = '\ntagdump: ' + VERSION + ':  dt_rev ' + str(DT_REV)
 #                   get new data as it arrives.  (implies --net)
 #                   (args.tail, boolean)
 #
+#   -w [OFFSET], --wrap [OFFSET]
+#                   circular stream, raw image.  dump oldest data first.
+#                   OFFSET is where the oldest data starts, without it
+#                   find where SYNC recnums drop.  (args.wrap, integer)
+#                   --net streams always start with the oldest data.
+#
 #   -v, --verbose   increase output verbosity
 #                   (args.verbose)
 #
 # positional parameters:
 #
-#   input:          file to process.  (args.input)
+#   input:          file to process.  (args.input, list)
+#                   a data stream spread across several DBLK files
+#                   (DBLK0001, DBLK0002, ...) can be given as all of
+#                   them, they are stitched back together in file_idx
+#                   order (see DblkChain in tagfile.py).  one file
+#                   with --net.
 
 
 # This program needs to understand the format of the DBlk data stream.
@@ -159,6 +170,13 @@ RESYNC_HDR_OFFSET       = 36            # how to get back to the start
 MAX_ZERO_SIGS           = 1024          # 1024 quads, 4K bytes of zero
 
 
+# high resolution stamps (usecs trailer, see typed_data.h).  usecs is a
+# free running 32 bit 1us counter, systime (binary ms) says which lap.
+# us_anchor is (systime, usecs) of the first stamped record this boot,
+# stamps are unwrapped relative to it.
+us_anchor               = None
+us_last                 = None          # last stamp seen, us since boot
+
 # global stat counters
 num_resyncs             = 0             # how often we've resync'd
 chksum_errors           = 0             # checksum errors seen
@@ -170,6 +188,7 @@ def init_globals():
     global rec_low, rec_high, rec_last, verbose, debug
     global num_resyncs, chksum_errors, unk_rtypes
     global total_records, total_bytes
+    global us_anchor, us_last
 
     rec_low             = 0
     rec_high            = 0
@@ -182,6 +201,21 @@ def init_globals():
     unk_rtypes          = 0             # unknown record types
     total_records       = 0
     total_bytes         = 0
+    us_anchor           = None
+    us_last             = None
+
+
+def usecs_abs(systime, usecs):
+    '''usecs stamp -> us since boot, full resolution'''
+    global us_anchor
+
+    if (us_anchor is None):
+        us_anchor = (systime, usecs)
+    a_st, a_us = us_anchor
+    coarse = ((systime - a_st) * 1000000) / 1024
+    fine   = (usecs - a_us) & 0xffffffff
+    fine  += ((coarse - fine + (1 << 31)) >> 32) << 32    # nearest lap
+    return (a_st * 1000000) / 1024 + fine
 
 
 #
@@ -281,7 +315,8 @@ def get_record(fd):
     Generate valid typed-data records one at a time until no more bytes
     to read from the input file.
 
-    Yields one record each time (len, type, recnum, systime, recsum, rec_buf).
+    Yields one record each time
+    (len, type, recnum, systime, recsum, rec_buf, usecs).
 
     Input:   fd:         file descriptor we are reading from
     Output:  rec_offset: byte offset of the record from start of file
@@ -291,6 +326,9 @@ def get_record(fd):
              systime     time since last reboot
              recsum      checksum ovr header and data
              rec_buf:    byte buffer with entire record
+             usecs:      usecs trailer if any, else None.  The trailer
+                         and DT_F_USECS are stripped from rlen, rtype,
+                         and rec_buf.
     """
 
     global chksum_errors
@@ -303,6 +341,7 @@ def get_record(fd):
     systime     = 0
     recsum      = 0
     rec_buf     = bytearray()
+    usecs       = None
     align0 = '*** aligning offset {0} (0x{0:x}) -> {1} (0x{1:x}) [{2} bytes]'
 
     last_offset = 0                     # protects against infinite resync
@@ -415,6 +454,16 @@ def get_record(fd):
             if (offset < 0):
                 break
             continue                    # try again
+
+        # usecs trailer, hand the record on as the producer built it
+        usecs = None
+        if (rtype & DT_F_USECS and rlen >= dtd.dt_hdr_size + 4):
+            rlen  -= 4
+            rtype &= ~DT_F_USECS
+            usecs  = dtd.quad_struct.unpack_from(rec_buf, rlen)[0]
+            del rec_buf[rlen:]
+            struct.pack_into('<HH', rec_buf, 0, rlen, rtype)
+
         v = dtd.dt_records.get(rtype, (0, None, None, None, ''))
         required_len = v[DTR_REQ_LEN]
         if (required_len):
@@ -425,15 +474,66 @@ def get_record(fd):
                 continue            # try again
 
         # life is good.  return actual record.
-        return offset, rlen, rtype, recnum, systime, recsum, rec_buf
+        return offset, rlen, rtype, recnum, systime, recsum, rec_buf, usecs
 
     # oops.  things blew up.  just return -1 for the offset
-    return -1, 0, 0, 0, 0, 0, ''
+    return -1, 0, 0, 0, 0, 0, '', None
 
 
 def process_dir(fd):
     fd.seek(DBLK_DIR_SIZE)
 
+    # circular stream over the net, start with the oldest data
+    start = fd.find_start()
+    if (start != DBLK_DIR_SIZE):
+        print('*** stream has wrapped, oldest data @{0} (0x{0:x})'.format(start))
+        fd.seek(start)
+
+
+#
+# find_wrap: circular data streams, raw image of the dblk area.
+#
+# once the tag wraps, the front of the data area is the newest lap and
+# the rest is the oldest.  SYNC/REBOOT recnums always increase along
+# the stream so the boundary is where they drop.  Returns the sector
+# aligned file offset of the first SYNC/REBOOT in the oldest lap, 0 if
+# the stream hasn't wrapped.
+#
+# Any old records between the actual boundary and that SYNC come out
+# at the end of the dump (recnum went backwards).  fd is the raw file.
+#
+
+WRAP_CHUNK              = 1024 * 1024
+WRAP_MAJIK_OFFSET       = RESYNC_HDR_OFFSET - 4
+
+def find_wrap(fd):
+    majik = dtd.quad_struct.pack(dtd.dt_sync_majik)
+    fd.seek(0)
+    base  = 0                           # file offset of buf[0]
+    buf   = ''
+    last  = 0                           # last recnum seen
+    done  = -1                          # last record offset looked at
+    while (True):
+        new = fd.read(WRAP_CHUNK)
+        if (new == ''):
+            return 0
+        keep = buf[-RESYNC_HDR_OFFSET:] if buf else ''
+        base = base + len(buf) - len(keep)
+        buf  = keep + new
+        pos  = buf.find(majik, WRAP_MAJIK_OFFSET)
+        while (pos >= 0):
+            rec = base + pos - WRAP_MAJIK_OFFSET
+            if ((rec & 3) == 0 and rec > done and rec >= DBLK_DIR_SIZE and
+                    pos - WRAP_MAJIK_OFFSET + dtd.dt_hdr_size <= len(buf)):
+                done = rec
+                rlen, rtype, recnum, systime, recsum = \
+                    dtd.dt_hdr_struct.unpack_from(buf, pos - WRAP_MAJIK_OFFSET)
+                if ((rtype == DT_SYNC or rtype == DT_REBOOT) and recnum):
+                    if (recnum < last):
+                        return (rec / 512) * 512
+                    last = recnum
+            pos = buf.find(majik, pos + 1)
+
 
 def dump(args):
     """
@@ -453,6 +553,7 @@ def dump(args):
     global rec_low, rec_high, rec_last, verbose, debug
     global num_resyncs, chksum_errors, unk_rtypes
     global total_records, total_bytes
+    global us_anchor, us_last
 
     init_globals()
 
@@ -498,6 +599,14 @@ def dump(args):
 
     # convert any args.rtypes to upper case
 
+    # circular stream, raw image.  present it oldest first.
+    if (args.wrap is not None and not args.net):
+        wrap = args.wrap if (args.wrap > 0) else find_wrap(infile.fd)
+        if (wrap):
+            print('*** stream has wrapped, oldest data @{0} (0x{0:x}), '
+                  'offsets are logical'.format(wrap))
+        infile.set_wrap(wrap)
+
     # process the directory, this will leave us pointing at the first header
     process_dir(infile)
 
@@ -514,7 +623,7 @@ def dump(args):
     # extract record from input file and output decoded results
     try:
         while(True):
-            rec_offset, rlen, rtype, recnum, systime, recsum, rec_buf = \
+            rec_offset, rlen, rtype, recnum, systime, recsum, rec_buf, usecs = \
                     get_record(infile)
             if (rec_offset < 0):
                 break
@@ -565,6 +674,16 @@ def dump(args):
                 if (verbose >= 5):
                     print('*** no decoder installed for rtype {}, @{}'.format(
                         rtype, rec_offset))
+            if (rtype == DT_REBOOT):        # new boot, new clocks
+                us_anchor = None
+                us_last   = None
+            if (usecs is not None):
+                us_abs = usecs_abs(systime, usecs)
+                if (verbose >= 1):
+                    print(dtd.usec0.format(us_abs / 1000000, us_abs % 1000000,
+                        us_abs - (systime * 1000000) / 1024,
+                        (us_abs - us_last) if (us_last is not None) else 0))
+                us_last = us_abs
             if (verbose >= 3):
                 print
                 print_record(rec_offset, rec_buf)
@@ -572,7 +691,7 @@ def dump(args):
             if (verbose >= 1):
                 print
             total_records += 1
-            total_bytes   += rlen
+            total_bytes   += rlen + (4 if usecs is not None else 0)
             if (args.num and total_records >= args.num):
                 break
     except KeyboardInterrupt:
@@ -41,7 +41,9 @@ def parseargs():
 
     parser.add_argument('input',
                         type=argparse.FileType('rb'),
-                        help='input file')
+                        nargs='+',
+                        help='input file, or DBLK0001 DBLK0002 ... '
+                             '(stitched in file_idx order)')
 
     parser.add_argument('-V', '--version',
                         action='version',
@@ -93,6 +95,13 @@ def parseargs():
                         type=int,
                         help='last record to dump.')
 
+    parser.add_argument('-w', '--wrap',
+                        type=auto_int,
+                        nargs='?',
+                        const=-1,
+                        help='circular stream, raw image.  oldest data first, '
+                             'optional offset of the oldest data')
+
     parser.add_argument('--tail',
                         action='store_true',
                         help='continue reading data at EOF')
@@ -31,29 +31,173 @@ import errno
 # os.SEEK_CUR (1), and os.SEEK_END (2) for the how or whence parameter.
 
 TF_SEEK_END = os.SEEK_END
+TF_DIR_SIZE = 0x200                     # dblk directory, 1st sector
+TF_SECTOR   = 512
+TF_FILE_IDX = 26                        # dblk_dir_t.file_idx, dblk_dir.h
+
+
+class DblkChain(object):
+    '''
+    bigger SDs split the data stream across DBLK0001, DBLK0002, ...
+    (a FAT file tops out at 4GiB).  Each has its own dblk directory
+    sector, file_idx says where it goes.  Stitch raw images of them
+    into one file that looks like a single dblk area: all of the first
+    file, then the data of the rest (their directory sectors dropped).
+    Logical offsets match the tag's 64 bit stream offsets.
+    '''
+    def __init__(self, files):
+        super( DblkChain, self ).__init__()
+
+        def file_idx(f):
+            f.seek(TF_FILE_IDX)
+            idx = f.read(1)
+            return ord(idx) if idx else 0
+        self.files = sorted(files, key=file_idx)
+        self.name  = ','.join([f.name for f in self.files])
+        self.runs  = []                 # (logical start, file, phys start, len)
+        start = 0
+        for i, f in enumerate(self.files):
+            f.seek(0, os.SEEK_END)
+            phys = 0 if (i == 0) else TF_DIR_SIZE
+            size = max(f.tell() - phys, 0)
+            self.runs.append((start, f, phys, size))
+            start += size
+        self.size = start
+        self.pos  = 0
+
+    def read(self, cnt):
+        buf = ''
+        for start, f, phys, size in self.runs:
+            if (len(buf) >= cnt):
+                break
+            if (self.pos >= start + size):
+                continue
+            f.seek(phys + self.pos - start)
+            new = f.read(min(cnt - len(buf), start + size - self.pos))
+            if (new == ''):
+                break
+            buf += new
+            self.pos += len(new)
+        return buf
+
+    def seek(self, pos, how=os.SEEK_SET):
+        if (how == os.SEEK_CUR):
+            pos += self.pos
+        elif (how == os.SEEK_END):
+            pos += self.size
+        self.pos = max(pos, 0)
+
+    def tell(self):
+        return self.pos
+
+    def close(self):
+        for f in self.files:
+            f.close()
+
 
 class TagFile(object):
     def __init__(self, input, net_io = False, tail = False):
         super( TagFile, self ).__init__()
 
-        if not isinstance(input, types.FileType):
+        if isinstance(input, list):
+            if (len(input) > 1 and net_io):
+                raise IOError('net io is one file at a time')
+            input = DblkChain(input) if (len(input) > 1) else input[0]
+        if not isinstance(input, (types.FileType, DblkChain)):
             raise IOError('not expected file type {}'.format(input))
 
         self.net_io = net_io
         self.tail   = tail
         self.fd     = input
         self.name   = input.name
+        self.wrap   = 0                 # raw image, circular boundary
+        self.pos    = 0                 # logical position when wrapped
 
         if (self.net_io):
             self.fd.close()
             self.fileno = os.open(self.name, os.O_DIRECT | os.O_RDONLY)
 
+    def set_wrap(self, wrap):
+        '''
+        circular data stream, raw image of the dblk area.
+
+        once the tag wraps, the front of the data area holds the newest
+        data and the oldest starts at wrap.  present the file in logical
+        order: the directory, wrap to the end, then the front of the data
+        area up to wrap.  offsets seen by the caller are in this order.
+        '''
+        if (self.net_io or wrap <= TF_DIR_SIZE):
+            return
+        self.fd.seek(0, os.SEEK_END)
+        self.size = self.fd.tell()
+        self.wrap = wrap
+        self.pos  = 0
+        self.fd.seek(0)
+
+    def _phys(self, pos):
+        '''logical position -> physical offset and bytes left in that run'''
+        if (pos < TF_DIR_SIZE):
+            return pos, TF_DIR_SIZE - pos
+        old = self.size - self.wrap             # oldest lap, wrap to end
+        if (pos < TF_DIR_SIZE + old):
+            return self.wrap + pos - TF_DIR_SIZE, TF_DIR_SIZE + old - pos
+        phys = pos - old
+        return phys, max(self.wrap - phys, 0)
+
+    def _read_wrapped(self, cnt):
+        buf = ''
+        while (len(buf) < cnt):
+            phys, left = self._phys(self.pos)
+            if (left <= 0):
+                break
+            self.fd.seek(phys)
+            new = self.fd.read(min(cnt - len(buf), left))
+            if (new == ''):
+                break
+            buf += new
+            self.pos += len(new)
+        return buf
+
+    def find_start(self):
+        '''
+        circular data stream over tagnet.  once the tag has wrapped,
+        reading below the oldest data returns ENODATA.  binary search
+        for the first sector that reads, the logical start of the
+        stream.  returns TF_DIR_SIZE if the stream hasn't wrapped.
+        '''
+        if (not self.net_io):
+            return TF_DIR_SIZE
+        def readable(pos):
+            try:
+                os.lseek(self.fileno, pos, os.SEEK_SET)
+                return os.read(self.fileno, 1) != ''
+            except OSError as e:
+                if (e.errno == errno.ENODATA):
+                    return False
+                raise
+        if (readable(TF_DIR_SIZE)):
+            return TF_DIR_SIZE
+        lo = TF_DIR_SIZE / TF_SECTOR            # not readable
+        hi = os.fstat(self.fileno).st_size / TF_SECTOR
+        if (hi <= lo or not readable(hi * TF_SECTOR - 1)):
+            return TF_DIR_SIZE                  # empty or nothing there
+        hi -= 1                                 # readable
+        while (hi - lo > 1):
+            mid = (lo + hi) / 2
+            if (readable(mid * TF_SECTOR)):
+                hi = mid
+            else:
+                lo = mid
+        return hi * TF_SECTOR
+
     def read(self, cnt):
         buf = ''
         while True:
             try:
                 if (self.net_io):
                     new = os.read(self.fileno, cnt - len(buf))
+                elif (self.wrap):
+                    new = self._read_wrapped(cnt - len(buf))
                 else:
                     new = self.fd.read(cnt - len(buf))
 
@@ -86,11 +230,20 @@ class TagFile(object):
     def tell(self):
         if (self.net_io):
             return os.lseek(self.fileno, 0, os.SEEK_CUR)
+        elif (self.wrap):
+            return self.pos
         else:
             return self.fd.tell()
 
     def seek(self, pos, how=os.SEEK_SET):
         if (self.net_io):
             return os.lseek(self.fileno, pos, how)
+        elif (self.wrap):
+            if (how == os.SEEK_CUR):
+                pos += self.pos
+            elif (how == os.SEEK_END):
+                pos += self.size
+            self.pos = max(pos, 0)
+            return None
         else:
             return self.fd.seek(pos, how)
@@ -61,8 +61,8 @@ uint8_t ms_buf[MS_BUF_SIZE];
 extern int verbose;
 extern int debug;
 
-uint32_t
-find_dblk_nxt(uint8_t *dp) {
+static uint32_t
+find_area_nxt(uint8_t *dp, loc_t *lp) {
   uint32_t   blk, lower, upper;
   int        empty;
 
@@ -72,8 +72,8 @@ find_dblk_nxt(uint8_t *dp) {
    *
    * Note: first sector of the DBLK area is reserved for the DBLK directory.
    */
-  lower = loc.locators[FS_LOC_DBLK].start + 1;
-  upper = loc.locators[FS_LOC_DBLK].end;
+  lower = lp->start + 1;
+  upper = lp->end;
   empty = 0;
   blk = lower;
   ms_read_blk_fail(blk, dp);
@@ -102,11 +102,32 @@ find_dblk_nxt(uint8_t *dp) {
   return 0;
 }
 
+
+/*
+ * The DBLK files (DBLK0001, DBLK0002, ...) are filled in order.  The
+ * first one with an empty sector holds dblk_nxt.  0 if all are full.
+ */
+uint32_t
+find_dblk_nxt(uint8_t *dp) {
+  uint32_t   blk;
+  int        n;
+
+  for (n = 0; n < FS_DBLK_FILES_MAX; n++) {
+    if (!loc.locators[FS_LOC_DBLK + n].start)
+      break;
+    blk = find_area_nxt(dp, &loc.locators[FS_LOC_DBLK + n]);
+    if (blk)
+      return blk;
+  }
+  return 0;
+}
+
 ms_rtn
 ms_init(char *device_name) {
     fs_loc_t  *fsl;
+    loc_t     *lp;
     uint32_t   blks;
-    int        empty;
+    int        empty, n;
     uint8_t   *dp;
     ms_rtn     rtn;
 
@@ -163,13 +184,16 @@ ms_init(char *device_name) {
       fprintf(stderr, "         i:   s: %-8x   e: %x\n",
 	      loc.locators[FS_LOC_IMAGE].start,
               loc.locators[FS_LOC_IMAGE].end);
-      blks = 0;
-      if (msc_dblk_nxt)
-        blks = msc_dblk_nxt - loc.locators[FS_LOC_DBLK].start;
-      fprintf(stderr, "         d:   s: %-8x   e: %-8x  nxt: %x (%d blks)\n",
-	      loc.locators[FS_LOC_DBLK].start,
-              loc.locators[FS_LOC_DBLK].end,
-              msc_dblk_nxt, blks);
+      for (n = 0; n < FS_DBLK_FILES_MAX; n++) {
+        lp = &loc.locators[FS_LOC_DBLK + n];
+        if (n && !lp->start)
+          break;
+        blks = 0;
+        if (msc_dblk_nxt >= lp->start && msc_dblk_nxt <= lp->end)
+          blks = msc_dblk_nxt - lp->start;
+        fprintf(stderr, "         d%d:  s: %-8x   e: %-8x  nxt: %x (%d blks)\n",
+                n + 1, lp->start, lp->end, msc_dblk_nxt, blks);
+      }
       if (msc_dblk_nxt == 0)
 	fprintf(stderr, "*** dblk_nxt not set ***\n");
     }
@@ -75,7 +75,10 @@ msu_check_fs_loc(fs_loc_t *fsl) {
 
     if (fsl->loc_sig != FS_LOC_SIG || fsl->loc_sig_a != FS_LOC_SIG)
 	return 1;
-    for (i = 0; i < FS_LOC_MAX; i++) {
+    for (i = 0; i < MAX_FS_LOCATORS; i++) {
+      if (i >= FS_LOC_MAX &&            /* extra DBLK files, optional */
+          !fsl->locators[i].start && !fsl->locators[i].end)
+        continue;
       if (!(fsl->locators[i].start) || !(fsl->locators[i].end))
         return 3;
       if ((fsl->locators[i].start  > fsl->locators[i].end))
@@ -27,6 +27,11 @@
  *
  * vfat format:     mkdosfs -F 32 -I -n"TagTest" -v /dev/sdb
  * create locators: tagfmtsd -w /dev/sdb
+ *
+ * A FAT32 file can't be 4GiB or bigger.  The data area on a bigger card
+ * is split into a chain of files, DBLK0001 through DBLK000n (at most
+ * FS_DBLK_FILES_MAX), each with its own locator (FS_LOC_DBLK + n - 1)
+ * and its own dblk directory sector carrying file_idx n.
  */
 
 #include <mm_types.h>
@@ -48,7 +53,7 @@
 extern fs_loc_t loc;
 
 
-#define VERSION "tagfmtsd: v4.3.1  2018/01/22\n"
+#define VERSION "tagfmtsd: v4.4.0  2018/06/12\n"
 
 int debug	= 0,
     verbose	= 0,
@@ -127,10 +132,12 @@ static void usage(char *name) {
 void
 display_info(uint8_t *buf) {
     fat_dir_entry_t *de;
+    loc_t           *fsl;
     u32_t rds;
     dblk_dir_t *ddp;
     uint32_t    sum, *p32;
-    int err, i;
+    char        name[9];
+    int err, i, n;
 
     fprintf(stderr, "fs_loc:  p:   s: %-8x   e: %x\n",
             loc.locators[FS_LOC_PANIC].start,
@@ -141,13 +148,19 @@ display_info(uint8_t *buf) {
     fprintf(stderr, "         i:   s: %-8x   e: %x\n",
             loc.locators[FS_LOC_IMAGE].start,
             loc.locators[FS_LOC_IMAGE].end);
-    rds = 0;
-    if (msc_dblk_nxt)
-      rds = msc_dblk_nxt - loc.locators[FS_LOC_DBLK].start;
-    fprintf(stderr, "         d:   s: %-8x   e: %-8x  nxt: %x  (%d blks)\n",
-            loc.locators[FS_LOC_DBLK].start,
-            loc.locators[FS_LOC_DBLK].end,
-            msc_dblk_nxt, rds);
+    for (n = 0; n < FS_DBLK_FILES_MAX; n++) {
+      fsl = &loc.locators[FS_LOC_DBLK + n];
+      if (n && !fsl->start)
+        break;
+      if (msc_dblk_nxt < fsl->start || msc_dblk_nxt > fsl->end) {
+        fprintf(stderr, "         d%d:  s: %-8x   e: %x\n",
+                n + 1, fsl->start, fsl->end);
+        continue;
+      }
+      fprintf(stderr, "         d%d:  s: %-8x   e: %-8x  nxt: %x  (%d blks)\n",
+              n + 1, fsl->start, fsl->end,
+              msc_dblk_nxt, msc_dblk_nxt - fsl->start);
+    }
 
     de = f32_get_de("PANIC001", "   ", &rds);
     if (de) {
@@ -170,15 +183,23 @@ display_info(uint8_t *buf) {
 		fx_clu2sec(rds), CF_LE_32(de->size), CF_LE_32(de->size));
     } else
 	fprintf(stderr, "IMAGE001: not found\n");
-    de = f32_get_de("DBLK0001", "   ", &rds);
-    if (de) {
-	rds = (CF_LE_16(de->starthi) << 16) | CF_LE_16(de->start);
-	fprintf(stderr, "DBLK0001:  start  0x%04x  size: %10u (0x%x)\n",
-		fx_clu2sec(rds), CF_LE_32(de->size), CF_LE_32(de->size));
+    for (n = 0; n < FS_DBLK_FILES_MAX; n++) {
+      sprintf(name, "DBLK%04d", n + 1);
+      de = f32_get_de(name, "   ", &rds);
+      if (!de) {
+        if (n == 0)
+          fprintf(stderr, "%s: not found\n", name);
+        break;
+      }
+      rds = (CF_LE_16(de->starthi) << 16) | CF_LE_16(de->start);
+      fprintf(stderr, "%s:  start  0x%04x  size: %10u (0x%x)\n",
+              name, fx_clu2sec(rds), CF_LE_32(de->size), CF_LE_32(de->size));
         /*
          * examine the dblk dir
          */
-        err = ms_read_blk(loc.locators[FS_LOC_DBLK].start, buf);
+        if (!loc.locators[FS_LOC_DBLK + n].start)
+          continue;
+        err = ms_read_blk(loc.locators[FS_LOC_DBLK + n].start, buf);
         if (err)
           fprintf(stderr, "could not read dblk dir: %s (0x%x)\n",
                   fx_dsp_err(err), err);
@@ -203,8 +224,7 @@ display_info(uint8_t *buf) {
               dow2str(ddp->incept_date.dow), ddp->incept_date.hr,
               ddp->incept_date.min, ddp->incept_date.sec);
         }
-    } else
-	fprintf(stderr, "DBLK0001: not found\n");
+    }
 }
 
 
@@ -214,10 +234,12 @@ display_info(uint8_t *buf) {
  * Create the directory.  Includes:
  * o start and end (low/high)
  * o incept date in datetime format.  (creation date)
+ * o file_idx, DBLK000n is n, its locator is FS_LOC_DBLK + n - 1
  *
  * write directory out to first sector of the dblk area.
  */
 int write_dblk_dir(uint8_t *buf, uint8_t file_idx) {
+  loc_t          *fsl;
   dblk_dir_t *ddp;
   struct tm   split_gmtime, *gmp;
   time_t      time_secs;
@@ -245,8 +267,9 @@ int write_dblk_dir(uint8_t *buf, uint8_t file_idx) {
   ddp->dblk_id[2]       = 'L';
   ddp->dblk_id[3]       = 'K';
   ddp->dblk_dir_sig     = DBLK_DIR_SIG;
-  ddp->dblk_low         = loc.locators[FS_LOC_DBLK].start;
-  ddp->dblk_high        = loc.locators[FS_LOC_DBLK].end;
+  fsl = &loc.locators[FS_LOC_DBLK + file_idx - 1];
+  ddp->dblk_low         = fsl->start;
+  ddp->dblk_high        = fsl->end;
   ddp->incept_date.yr   = gmp->tm_year;
   ddp->incept_date.mon  = gmp->tm_mon;
   ddp->incept_date.day  = gmp->tm_mday;
@@ -257,14 +280,15 @@ int write_dblk_dir(uint8_t *buf, uint8_t file_idx) {
   ddp->file_idx         = file_idx;
   ddp->dblk_dir_sig_a   = DBLK_DIR_SIG;
   ddp->chksum           = 0;
+  sum = 0;
   p32 = (void *) buf;
   for (i = 0; i < DBLK_DIR_QUADS; i++)
     sum += *p32++;
   ddp->chksum = (uint32_t) (0 - sum);
-  err = ms_write_blk(loc.locators[FS_LOC_DBLK].start, buf);
+  err = ms_write_blk(fsl->start, buf);
   if (err)
-    fprintf(stderr, "write_dblk_dir: DBLK0001: could not write dblk dir: %s (0x%x)\n",
-            fx_dsp_err(err), err);
+    fprintf(stderr, "write_dblk_dir: DBLK%04d: could not write dblk dir: %s (0x%x)\n",
+            file_idx, fx_dsp_err(err), err);
   return err;
 }
 
@@ -275,7 +299,9 @@ int main(int argc, char **argv) {
     uint8_t buf[MS_BUF_SIZE];
     u32_t   image_size;
     u32_t   panic_size;
-    int     do_fs_loc;
+    loc_t          *fsl;
+    char    name[9];
+    int     do_fs_loc, dblk_files, n;
 
     while ((c = getopt_long(argc,argv,"c:d:i:p:DfhvVw", longopts, NULL)) != EOF)
 	switch (c) {
@@ -400,18 +426,38 @@ int main(int argc, char **argv) {
 	do_fs_loc = 0;
       }
     }
-    err = fx_create_contig("DBLK0001", "   ", dblk_size,
-                           &loc.locators[FS_LOC_DBLK].start,
-                           &loc.locators[FS_LOC_DBLK].end);
-    if (err) {
-	fprintf(stderr, "fx_create_contig: DBLK0001: %s (0x%x)\n", fx_dsp_err(err), err);
-	do_fs_loc = 0;
+
+    /*
+     * DBLK0001 gets dblk_size (0 is the rest of the card).  If that
+     * didn't fit in one file the rest goes into DBLK0002 and on until
+     * we run out of room or locators.
+     */
+    dblk_files = 0;
+    for (n = 0; n < FS_DBLK_FILES_MAX; n++) {
+      fsl = &loc.locators[FS_LOC_DBLK + n];
+      sprintf(name, "DBLK%04d", n + 1);
+      err = fx_create_contig(name, "   ", (n ? 0 : dblk_size),
+                             &fsl->start, &fsl->end);
+      if (n && err == FX_NO_ROOM) {
+        fsl->start = fsl->end = 0;      /* all used up */
+        break;
+      }
+      if (err) {
+        fprintf(stderr, "fx_create_contig: %s: %s (0x%x)\n", name, fx_dsp_err(err), err);
+        do_fs_loc = 0;
+        if (err != FX_EXIST || !fsl->start)
+          break;
+      }
+      dblk_files++;
+      if (dblk_size)                    /* asked for a size, just one */
+        break;
     }
     if (do_fs_loc || force) {
       if (verbose)
-        fprintf(stderr, "*** writing DBLK directory\n");
-      if (write_dblk_dir(buf, 1))
-        do_fs_loc = 0;
+        fprintf(stderr, "*** writing DBLK directories (%d)\n", dblk_files);
+      for (n = 0; n < dblk_files; n++)
+        if (write_dblk_dir(buf, n + 1))
+          do_fs_loc = 0;
     }
     if (do_fs_loc) {
       fprintf(stderr, "*** writing fs locator\n");
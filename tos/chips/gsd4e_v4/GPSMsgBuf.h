@@ -24,10 +24,14 @@
 #define __GPSMSGBUF_H__
 
 
+#ifndef GPS_BUF_SIZE
 #define GPS_BUF_SIZE 1024
+#endif
 
 /* set to a power of 2 */
+#ifndef GPS_MAX_MSGS
 #define GPS_MAX_MSGS 16
+#endif
 
 /* minimum memory slice, same as SIRFBIN_OVERHEAD */
 #define GPS_MIN_MSG  8
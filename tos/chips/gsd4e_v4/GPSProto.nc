@@ -38,6 +38,14 @@ interface GPSProto {
    */
   async command void byteAvail(uint8_t byte);
 
+  /*
+   * blockAvail: a block of bytes is available
+   *
+   * same as byteAvail but len bytes at a time, from block (dma) receive.
+   * ptr is only good for the duration of the call.
+   */
+  async command void blockAvail(uint8_t *ptr, uint16_t len);
+
   /*
    * protoAbort: signal that there has been a problem any where in the
    * packet.
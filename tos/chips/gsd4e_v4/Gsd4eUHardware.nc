@@ -50,9 +50,10 @@
  *   gps_send_block_done(): completion on split phase
  *   gps_send_block_stop(): stop current send_block (abort)
  *
- *   gps_receive_block():   same as send but for receive
- *   gps_receive_block_done():
+ *   gps_receive_block():   circular (dma) receive, see below.
+ *   gps_receive_block_done(): the dma has wrapped
  *   gps_receive_block_stop():
+ *   gps_receive_block_idx():  where the dma is in the buffer
  *
  *   gps_rx_on():
  *   gps_rx_off():
@@ -97,6 +98,16 @@
  * completes with the signal gps_send_block_done(); A block transmission
  * can be aborted using gps_send_block_stop();
  *
+ * Receive can be run the same way.  gps_receive_block() hands the h/w a
+ * buffer that the dma engine fills circularly, rx interrupts are off.
+ * Each time the dma reaches the end of the buffer it is restarted at the
+ * front and gps_receive_block_done() is signalled, once per lap, so the
+ * upper layer can tell if the dma has run over data it hasn't drained.
+ * gps_receive_block_idx() says how far into the buffer the dma has
+ * gotten, the upper layer drains behind it in blocks.  h/w that can't do this returns FAIL and the upper
+ * layer falls back to gps_byte_avail().  rx errors are not reported while
+ * in block mode.
+ *
  * We run at 115200.  Its a good choice.  The downside is potentially
  * we may have to keep the gps up longer while communicating.  The
  * intent though is to run the gps using Micro Power Mode (MPM) where
@@ -143,6 +154,7 @@ interface Gsd4eUHardware {
   async event   void    gps_byte_avail(uint8_t byte);
   async command error_t gps_receive_block(uint8_t *ptr, uint16_t len);
   async command void    gps_receive_block_stop();
+  async command uint16_t gps_receive_block_idx();
   async event   void    gps_receive_block_done(uint8_t *ptr, uint16_t len, error_t err);
   async command void    gps_rx_on();
   async command void    gps_rx_off();
@@ -388,10 +388,13 @@ module Gsd4eUP {
      * GPSTxTimer primarily transmit deadman timing.  Also used
      *            for various state machine functions.
      * GPSRxTimer receive deadman timing.
+     *
+     * GPSRxDrainTimer drains the rx ring when in block receive.
      */
     interface Timer<TMilli> as GPSTxTimer;
     interface Timer<TMilli> as GPSRxTimer;
     interface Timer<TMilli> as GPSRxErrorTimer;
+    interface Timer<TMilli> as GPSRxDrainTimer;
     interface LocalTime<TMilli>;
 
     interface GPSProto as SirfProto;
@@ -426,6 +429,18 @@ implementation {
   norace uint16_t m_first_rx_error;     // first rx_stat we saw
   norace uint32_t m_last_rx_collection; // ms time of last_rx error collection
 
+  /*
+   * block receive.  the dma fills gps_rx_ring, m_rx_rd is where the
+   * drain is.  m_rx_blk says block receive is running.  m_rx_laps counts
+   * dma wraps (gps_receive_block_done) since the last drain, more than
+   * one and the dma has run over data we haven't drained (m_rx_overruns).
+   */
+  norace bool     m_rx_blk;
+  norace uint16_t m_rx_rd;
+  norace uint16_t m_rx_laps;
+  norace uint32_t m_rx_overruns;
+  uint8_t gps_rx_ring[GPS_RX_RING_SIZE];
+
 
   void gps_warn(uint8_t where, parg_t p, parg_t p1) {
     call Panic.warn(PANIC_GPS, where, p, p1, 0, 0);
@@ -439,18 +454,114 @@ implementation {
   /* collect_gps_pak
    *
    * add a gps packet to the data stream.  Debugging etc.
+   *
+   * header is built in place (Collect.reserve), only called from task
+   * level so reserve and commit are in the same task.
    */
   static void collect_gps_pak(uint8_t *pak, uint16_t len, uint8_t dir) {
-    dt_gps_t hdr;
+    dt_gps_t  *hdr;
+    dc_resv_t *rp;
+    uint8_t    i;
 
-    hdr.len      = sizeof(hdr) + len;
-    hdr.dtype    = DT_GPS_RAW_SIRFBIN;
-    hdr.mark_us  = 0;
-    hdr.chip_id  = CHIP_GPS_GSD4E;
-    hdr.dir      = dir;
+    rp = call Collect.reserve(DT_GPS_RAW_SIRFBIN, sizeof(dt_gps_t), len);
+    if (!rp)                            /* shed */
+      return;
+    hdr = (void *) rp->hdr;
+    hdr->len      = sizeof(dt_gps_t) + len;
+    hdr->dtype    = DT_GPS_RAW_SIRFBIN;
+    hdr->mark_us  = 0;
+    hdr->chip_id  = CHIP_GPS_GSD4E;
+    hdr->dir      = dir;
+    for (i = 0; i < rp->nfrags; i++) {
+      memcpy(rp->data[i], pak, rp->dlen[i]);
+      pak += rp->dlen[i];
+    }
 
     /* time stamp added by Collect */
-    call Collect.collect((void *) &hdr, sizeof(hdr), pak, len);
+    call Collect.commit();
+  }
+
+
+  /*
+   * gps_rx_on: turn on the receive side.
+   *
+   * block receive if we can get it, otherwise rx interrupts (byte at a
+   * time).  Only called from task level (the drain timer is started
+   * here).
+   */
+  void gps_rx_on() {
+#ifdef GPS_RX_BLOCK
+    atomic {
+      if (m_rx_blk)
+        return;
+      m_rx_rd = 0;
+      m_rx_laps = 0;
+      if (call HW.gps_receive_block(gps_rx_ring, GPS_RX_RING_SIZE) == SUCCESS) {
+        m_rx_blk = TRUE;
+        call GPSRxDrainTimer.startPeriodic(DT_GPS_RX_DRAIN);
+        return;
+      }
+    }
+#endif
+    call HW.gps_rx_int_enable();
+  }
+
+
+  /*
+   * gps_rx_off: turn off the receive side, either kind.  Anything in the
+   * ring not drained yet is tossed.  Can be called from async, the drain
+   * timer stops itself.
+   */
+  void gps_rx_off() {
+    atomic {
+      call HW.gps_rx_int_disable();
+      if (m_rx_blk) {
+        call HW.gps_receive_block_stop();
+        m_rx_blk = FALSE;
+      }
+    }
+  }
+
+
+  void gps_eavesdrop(uint8_t *ptr, uint16_t len);
+
+  /*
+   * gps_rx_drain: hand what the dma has put in the ring since last time
+   * to the protocol engine.  At most two pieces, before and after the
+   * wrap.  The protocol engine can turn rx off under us (protoAbort).
+   *
+   * If the dma has lapped us (two or more wraps, or one wrap and it is
+   * past where we are) what is in the ring is a mix of laps.  Toss it,
+   * pick up at the dma and restart the protocol engine.
+   */
+  void gps_rx_drain() {
+    uint16_t rd, wr, laps;
+
+    atomic {
+      wr   = call HW.gps_receive_block_idx();
+      laps = m_rx_laps;
+      m_rx_laps = 0;
+    }
+    rd = m_rx_rd;
+    if (laps > 1 || (laps && wr > rd)) {
+      m_rx_overruns++;
+      m_rx_rd = wr;
+      call SirfProto.rx_timeout();
+      return;
+    }
+    if (laps || wr < rd) {              /* wrapped, wr == rd is a full lap */
+      if (rd < GPS_RX_RING_SIZE) {
+        gps_eavesdrop(&gps_rx_ring[rd], GPS_RX_RING_SIZE - rd);
+        call SirfProto.blockAvail(&gps_rx_ring[rd], GPS_RX_RING_SIZE - rd);
+      }
+      rd = 0;
+    }
+    if (m_rx_blk && wr > rd) {
+      gps_eavesdrop(&gps_rx_ring[rd], wr - rd);
+      call SirfProto.blockAvail(&gps_rx_ring[rd], wr - rd);
+    }
+    if (m_rx_blk)
+      m_rx_rd = wr;
   }
 
 
@@ -576,9 +687,8 @@ implementation {
       return FAIL;
     }
     call CollectEvent.logEvent(DT_EVENT_GPS_TURN_OFF, 0, 0, 0, 0);
-    call HW.gps_rx_int_disable();
+    gps_rx_off();
     call HW.gps_send_block_stop();
-    call HW.gps_receive_block_stop();
     call GPSTxTimer.stop();
     call GPSRxTimer.stop();
     m_cur_rx_len = m_req_rx_len = -1;
@@ -593,7 +703,7 @@ implementation {
    */
   command error_t GPSControl.standby() {
     gps_hibernate();
-    call HW.gps_rx_int_disable();
+    gps_rx_off();
     call GPSTxTimer.stop();
     call GPSRxTimer.stop();
     m_cur_rx_len = m_req_rx_len = -1;
@@ -750,7 +860,7 @@ implementation {
           call GPSRxTimer.startOneShot(DT_GPS_PEEK_RSP_TIMEOUT);
           m_cur_rx_len = SIRFBIN_PEEK_RSP_LEN;
           gpsc_change_state(GPSC_CHK_RX_WAIT, GPSW_SEND_BLOCK_TASK);
-          call HW.gps_rx_int_enable();        /* turn on rx system */
+          gps_rx_on();                        /* turn on rx system */
           return;
 
         case GPSC_ON_TX:
@@ -947,7 +1057,7 @@ implementation {
           gps_wakeup();                   /* wake the ARM up */
           nop();
           call GPSRxTimer.startOneShot(DT_GPS_WAKE_UP_DELAY);
-          call HW.gps_rx_int_enable();        /* turn on rx system */
+          gps_rx_on();                        /* turn on rx system */
           return;
 
         case GPSC_CHK_TA_WAIT:
@@ -988,7 +1098,7 @@ implementation {
           return;
 
         case GPSC_PROBE_0:                  /* target speed (from PWR_UP_WAIT) */
-          call HW.gps_rx_int_disable();
+          gps_rx_off();
           gps_probe_index = -1;             /* first peek try */
           gps_chk_trys    = GPS_CHK_MAX_TRYS;
           gpsc_change_state(GPSC_CHK_TX1_WAIT, GPSW_RX_TIMER);
@@ -1000,13 +1110,13 @@ implementation {
 
         case GPSC_CHK_RX_WAIT:
           /* never saw the start of a message, nada, probe cycle */
-          call HW.gps_rx_int_disable();
+          gps_rx_off();
           gpsc_change_state(GPSC_PROBE_CYCLE, GPSW_RX_TIMER);
           post probe_task();
           return;
 
         case GPSC_CHK_MSG_WAIT:
-          call HW.gps_rx_int_disable();
+          gps_rx_off();
           call SirfProto.rx_timeout();          /* tell protocol state machine */
           if (--gps_chk_trys) {
             /*
@@ -1096,7 +1206,7 @@ implementation {
         return;
 
       case GPSC_CHK_MSG_WAIT:
-        call HW.gps_rx_int_disable();
+        gps_rx_off();
         gpsc_change_state(GPSC_PROBE_CYCLE, GPSW_PROTO_ABORT);
         post probe_task();
         return;
@@ -1143,6 +1253,22 @@ implementation {
   }
 
 
+  /* block receive version of the eavesdrop in gps_byte_avail */
+  void gps_eavesdrop(uint8_t *ptr, uint16_t len) {
+#ifdef GPS_EAVESDROP
+    if (!t_gps_first_char) {
+      t_gps_first_char = call LocalTime.get();
+      post collect_task();
+    }
+    while (len--) {
+      gbuf[g_idx++] = *ptr++;
+      if (g_idx >= GPS_EAVES_SIZE)
+        g_idx = 0;
+    }
+#endif
+  }
+
+
   async event void HW.gps_byte_avail(uint8_t byte) {
 #ifdef GPS_EAVESDROP
     if (!t_gps_first_char) {
@@ -1161,7 +1287,29 @@ implementation {
     post send_block_task();
   }
 
-  async event void HW.gps_receive_block_done(uint8_t *ptr, uint16_t len, error_t error) { }
+  task void drain_task() {
+    if (m_rx_blk)
+      gps_rx_drain();
+  }
+
+
+  event void GPSRxDrainTimer.fired() {
+    if (!m_rx_blk) {
+      call GPSRxDrainTimer.stop();
+      return;
+    }
+    gps_rx_drain();
+  }
+
+
+  /*
+   * the dma wrapped, don't wait for the timer.  Signalled from the dma
+   * interrupt, count the lap for the overrun check in gps_rx_drain.
+   */
+  async event void HW.gps_receive_block_done(uint8_t *ptr, uint16_t len, error_t error) {
+    m_rx_laps++;
+    post drain_task();
+  }
 
   async event void Panic.hook() { }
 
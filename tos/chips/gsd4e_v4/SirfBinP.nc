@@ -21,6 +21,13 @@
  * Handle an incoming SIRF binary byte stream assembling it into protocol
  * messages.  Assemble into GPSMsgs.  Processing of the incoming msgs will
  * be handled by upper layer processors.
+ *
+ * Bytes come in one at a time (byteAvail, rx interrupts) or in blocks
+ * (blockAvail, dma receive).  A block is scanned for A0 A2 and a frame
+ * that is entirely in the block is checked (length, checksum, B0 B3) in
+ * place and copied into its GPSMsg in one go.  Frames that straddle
+ * blocks are picked up by the byte engine, with the payload still
+ * copied and summed a run at a time.
  */
 
 #include <panic.h>
@@ -133,6 +140,132 @@ implementation {
   }
 
 
+  /*
+   * sirfbin_sum: sum of n bytes, a word at a time where we can.
+   *
+   * Each word is added in as two 16 bit lanes (bytes 0/2 and 1/3).  A
+   * lane picks up at most 2 * 255 per word so 128 words can't carry
+   * out of a lane.
+   */
+  uint16_t sirfbin_sum(uint8_t *p, uint16_t n) {
+    uint32_t sum, acc, w;
+    uint16_t i;
+
+    sum = 0;
+    while (n && ((uint32_t) p & 3)) {
+      sum += *p++;
+      n--;
+    }
+    while (n >= 4) {
+      acc = 0;
+      for (i = 0; i < 128 && n >= 4; i++, n -= 4, p += 4) {
+        w = *(uint32_t *) p;
+        acc += (w & 0x00ff00ff) + ((w >> 8) & 0x00ff00ff);
+      }
+      sum += (acc & 0xffff) + (acc >> 16);
+    }
+    while (n--)
+      sum += *p++;
+    return sum;
+  }
+
+
+  /*
+   * sirfbin_frame: whole frame at ptr (A0 in hand)?
+   *
+   * returns bytes used up, 0 says hand it to the byte engine.  That is
+   * when the frame isn't all there, or the length is bad (the byte engine
+   * does the too_big accounting).  Otherwise this does what the byte
+   * engine would have, including signalling msgStart/msgEnd/protoAbort,
+   * and uses up the same bytes.
+   */
+  uint16_t sirfbin_frame(uint8_t *ptr, uint16_t avail) {
+    uint16_t len, chksum;
+
+    if (avail < SIRFBIN_OVERHEAD || ptr[1] != SIRFBIN_A2)
+      return 0;
+    len = ptr[2] << 8 | ptr[3];
+    if (len >= SIRFBIN_MAX_MSG || avail < len + SIRFBIN_OVERHEAD)
+      return 0;
+
+    sirfbin_stats.starts++;
+    if (len > sirfbin_stats.max_seen)
+      sirfbin_stats.max_seen = len;
+    sirfbin_ptr_prev = sirfbin_ptr;
+    sirfbin_ptr = call GPSBuffer.msg_start(len + SIRFBIN_OVERHEAD);
+    if (!sirfbin_ptr) {
+      sirfbin_stats.no_buffer++;
+      sirfbin_restart_abort(3);
+      return 4;
+    }
+    signal GPSProto.msgStart(len + SIRFBIN_OVERHEAD);
+    chksum = ptr[len + 4] << 8 | ptr[len + 5];
+    if (chksum != sirfbin_sum(&ptr[4], len)) {
+      sirfbin_stats.chksum_fail++;
+      sirfbin_restart_abort(4);
+      return len + 6;
+    }
+    if (ptr[len + 6] != SIRFBIN_B0) {
+      sirfbin_stats.proto_fail++;
+      sirfbin_restart_abort(5);
+      return len + 7;
+    }
+    if (ptr[len + 7] != SIRFBIN_B3) {
+      sirfbin_stats.proto_fail++;
+      sirfbin_restart_abort(6);
+      return len + 8;
+    }
+    memcpy(sirfbin_ptr, ptr, len + SIRFBIN_OVERHEAD);
+    sirfbin_ptr_prev = sirfbin_ptr;
+    sirfbin_ptr = NULL;
+    sirfbin_stats.complete++;
+    signal GPSProto.msgEnd();
+    call GPSBuffer.msg_complete();
+    return len + SIRFBIN_OVERHEAD;
+  }
+
+
+  async command void GPSProto.blockAvail(uint8_t *ptr, uint16_t len) {
+    uint8_t *end;
+    uint16_t n;
+
+    end = ptr + len;
+    while (ptr < end) {
+      switch(sirfbin_state) {
+        case SBS_START:
+          ptr = memchr(ptr, SIRFBIN_A0, end - ptr);
+          if (!ptr)
+            return;
+          n = sirfbin_frame(ptr, end - ptr);
+          if (n) {
+            ptr += n;
+            continue;
+          }
+          break;
+
+        case SBS_PAYLOAD:
+          n = end - ptr;
+          if (n > sirfbin_left)
+            n = sirfbin_left;
+          memcpy(sirfbin_ptr, ptr, n);
+          sirfbin_chksum += sirfbin_sum(ptr, n);
+          sirfbin_ptr  += n;
+          sirfbin_left -= n;
+          ptr          += n;
+          if (sirfbin_left == 0) {
+            sirfbin_state_prev = sirfbin_state;
+            sirfbin_state = SBS_CHK;
+          }
+          continue;
+
+        default:
+          break;
+      }
+      call GPSProto.byteAvail(*ptr++);
+    }
+  }
+
+
   async command void GPSProto.byteAvail(uint8_t byte) {
     uint16_t chksum;
 
@@ -169,6 +169,24 @@
 #define DT_GPS_PEEK_RSP_TIMEOUT 52
 #define DT_GPS_MAX_RX_TIMEOUT   52
 
+/*
+ * RX_BLOCK
+ *
+ * With GPS_RX_BLOCK the receive side runs off dma into a circular buffer
+ * (GPS_RX_RING_SIZE bytes) rather than taking an interrupt per byte.
+ * The driver drains the ring into the protocol engine every
+ * DT_GPS_RX_DRAIN mis and whenever the dma wraps.  If the h/w can't do
+ * block receive, or GPS_RX_BLOCK isn't defined, we run a byte at a time.
+ *
+ * At 115200 the gps can fill ~11.5 bytes/ms so 512 bytes is ~44ms of
+ * data, well beyond a drain period.  The uDMA limits the ring to 1024.
+ * A drain period of 16mis keeps msgStart within 16mis of the bytes
+ * showing up, well inside PEEK_RSP_TIMEOUT and MAX_RX_TIMEOUT.
+ */
+#define GPS_RX_BLOCK
+#define GPS_RX_RING_SIZE        512
+#define DT_GPS_RX_DRAIN         16
+
 /*
  * All times unless otherwise noted are in decimal time (us and
  * ms).  Baud rates are from ORG447X Series datasheet.
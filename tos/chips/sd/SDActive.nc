@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * SDActive: is the SD up on somebody else's account?
+ *
+ * Lets a background client (SSW) piggyback on a power cycle some other
+ * client is paying for.  Provided per client by SDSchedP, a client gets
+ * its instance from SD0_ArbC.  The client's own activity, including the
+ * power hold that follows its own release, doesn't count.
+ */
+
+interface SDActive {
+  /*
+   * TRUE if the SD is powered (or on its way up) for some other client:
+   * it owns the SD, a grant to it is pending, or the SD is being held
+   * powered after its release.
+   */
+  async command bool is_on();
+
+  /*
+   * signalled (task level) when some other client has powered the SD
+   * up, after its grant.
+   */
+  event void on();
+}
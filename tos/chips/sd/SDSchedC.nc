@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * SDSchedC: SD request scheduler.  Drop in replacement for the
+ * FcfsArbiterC that used to sit in front of the SD.  Also holds
+ * the SD powered between bursts.  See SDSchedP.
+ */
+
+generic configuration SDSchedC(char resourceName[]) {
+  provides {
+    interface Resource[uint8_t id];
+    interface ResourceRequested[uint8_t id];
+    interface ResourceDefaultOwner;
+    interface TagnetAdapter<uint32_t> as SDHold;
+    interface SDActive[uint8_t id];
+  }
+  uses interface SDPriority[uint8_t id];
+}
+implementation {
+  components new SDSchedP(uniqueCount(resourceName)) as SchedP;
+
+  Resource             = SchedP;
+  ResourceRequested    = SchedP;
+  ResourceDefaultOwner = SchedP;
+  SDPriority           = SchedP;
+  SDHold               = SchedP;
+  SDActive             = SchedP;
+
+  components new TimerMilliC() as HoldTimerC;
+  SchedP.HoldTimer -> HoldTimerC;
+
+  components LocalTimeMilliC;
+  SchedP.LocalTime -> LocalTimeMilliC;
+}
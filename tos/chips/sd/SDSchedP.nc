@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * SDSchedP: priority aware SD request scheduler.
+ *
+ * Replaces the FcfsArbiterC that used to sit in front of the SD.  Same
+ * Resource/ResourceDefaultOwner contract (it is modelled on the TinyOS
+ * ArbiterP), so the SD driver's power sequencing and every client are
+ * unchanged.  What differs is who gets the SD next.
+ *
+ * Clients are either foreground or background.  A client is foreground
+ * if its SDPriority.foreground says so (see SD0_FgArbC), background
+ * otherwise.  Foreground is latency sensitive (Tagnet reads of the data
+ * stream and panic area, radio is waiting).  Background is bulk (SSW
+ * flushing its groups, image writes, dblk/panic bookkeeping).
+ *
+ * o two FIFOs, foreground is always served before background.
+ *
+ * o a foreground request signals ResourceRequested.requested to the
+ *   current owner.  An owner that can break up what it is doing (SSW,
+ *   between write runs) releases and re-requests.  The foreground
+ *   client gets the SD next while it is still powered.  The yielding
+ *   owner goes to the back of the background queue.
+ *
+ * o batching: the SD stays powered as long as anyone is queued.  Only
+ *   when both queues drain does the default owner (the driver) get the
+ *   SD back and power it down.  Requests that show up while the card is
+ *   up ride on the same power cycle.
+ *
+ * o background starvation guard: after SD_SCHED_FG_BURST consecutive
+ *   foreground grants with background waiting, one background client
+ *   is let in.
+ *
+ * Per client instrumentation (sd_sched_stats[id]): grants, and queue
+ * wait (request to granted) max and sum in ms.
+ *
+ * Power hold.  When the last client releases, rather than handing the
+ * SD straight back to the default owner (which powers it down) we can
+ * hold it powered for a window.  A request inside the window is granted
+ * immediately, no power up and no SD_RESET_IDLES/SD_GO_OP init.
+ *
+ * The window adapts.  We learn two things:
+ *
+ *   pwr_avg: what a power cycle costs, the time from
+ *            ResourceDefaultOwner.requested to the driver's release
+ *            (power up plus card init).
+ *   gap_avg: how long the SD typically sits idle before the next
+ *            request (last release to next request).
+ *
+ * Both are running averages (1/2^SD_HOLD_SHIFT weight on new samples).
+ * Init draws about SD_HOLD_BE_RATIO times what an idle powered card
+ * does, so holding for longer than pwr_avg * SD_HOLD_BE_RATIO (break
+ * even) costs more than a power cycle.  If the predicted gap is inside
+ * break even we hold for 2 * gap_avg + SD_HOLD_SLACK_MS (capped at
+ * break even), otherwise we don't hold at all.
+ *
+ * The window is further capped by hold_max (SD_HOLD_MAX_MS), settable
+ * via Tagnet (<node>/tag/sd/0/.hold) up to SD_HOLD_LIMIT_MS.  0 turns
+ * holding off.
+ *
+ * SDActive lets a client see whether the SD is up, and tells it when
+ * it comes up, so it can get its work in on someone else's power cycle.
+ * It is per client.  A hold remembers who released into it (holdResId),
+ * the client's own hold isn't somebody else's power cycle.
+ */
+
+#ifndef SD_SCHED_FG_BURST
+#define SD_SCHED_FG_BURST 8
+#endif
+
+#ifndef SD_HOLD_MAX_MS
+#define SD_HOLD_MAX_MS    250
+#endif
+
+/* most .hold will take, the card sitting powered doing nothing */
+#define SD_HOLD_LIMIT_MS  2000
+
+#define SD_HOLD_BE_RATIO  8
+#define SD_HOLD_SLACK_MS  4
+#define SD_HOLD_SHIFT     2
+
+generic module SDSchedP(uint8_t numClients) {
+  provides {
+    interface Resource[uint8_t id];
+    interface ResourceRequested[uint8_t id];
+    interface ResourceDefaultOwner;
+    interface TagnetAdapter<uint32_t> as SDHold;
+    interface SDActive[uint8_t id];
+  }
+  uses {
+    interface SDPriority[uint8_t id];
+    interface Timer<TMilli> as HoldTimer;
+    interface LocalTime<TMilli>;
+  }
+}
+implementation {
+
+  enum {
+    RES_CONTROLLED,                     /* default owner has it, SD off */
+    RES_GRANTING,                       /* grant pending */
+    RES_BUSY,                           /* a client owns it */
+    RES_HELD,                           /* no owner, SD held powered */
+  };
+
+  enum {
+    NO_RES      = 0xff,
+    DEFAULT_RES = 0xfe,
+  };
+
+  typedef struct {
+    uint32_t req_ms;                    /* when last request was queued */
+    uint32_t grants;
+    uint32_t wait_max;                  /* ms */
+    uint32_t wait_sum;                  /* ms */
+  } sd_sched_stat_t;
+
+  typedef struct {
+    uint8_t q[numClients];
+    uint8_t head;
+    uint8_t count;
+  } sd_sched_q_t;
+
+  uint8_t state = RES_CONTROLLED;
+  norace uint8_t resId = DEFAULT_RES;
+  uint8_t reqResId;
+  uint8_t holdResId;                    /* released into the hold */
+  uint8_t fg_burst;                     /* consecutive fg grants, bg waiting */
+  bool    pwr_grant;                    /* next grant follows a power up */
+
+  sd_sched_q_t fg_q, bg_q;
+  bool queued[numClients];
+
+  sd_sched_stat_t sd_sched_stats[numClients];
+
+  typedef struct {
+    uint32_t hold_max;                  /* cap, ms.  0 no holding */
+    uint32_t win;                       /* current window, ms */
+    uint32_t idle_t0;                   /* when last went idle */
+    uint32_t pwr_t0;                    /* power up started */
+    uint32_t gap_avg;                   /* ms */
+    uint32_t pwr_avg;                   /* ms */
+    uint32_t hits;                      /* requests inside a window */
+    uint32_t misses;                    /* windows that ran out */
+    uint32_t pwr_ups;
+    bool     idle_valid;
+  } sd_hold_t;
+
+  norace sd_hold_t sd_hold = { SD_HOLD_MAX_MS };
+
+  task void grantedTask();
+
+
+  uint32_t avg(uint32_t cur, uint32_t sample) {
+    if (sample > 0xffff)                /* keep it from swamping */
+      sample = 0xffff;
+    return cur - (cur >> SD_HOLD_SHIFT) + (sample >> SD_HOLD_SHIFT);
+  }
+
+
+  /* atomic context.  how long to hold the SD powered, 0 don't */
+  uint32_t hold_window() {
+    uint32_t be, win;
+
+    if (!sd_hold.hold_max || !sd_hold.pwr_ups)
+      return 0;
+    be = sd_hold.pwr_avg * SD_HOLD_BE_RATIO;
+    if (sd_hold.gap_avg >= be)
+      return 0;
+    win = 2 * sd_hold.gap_avg + SD_HOLD_SLACK_MS;
+    if (win > be)
+      win = be;
+    if (win > sd_hold.hold_max)
+      win = sd_hold.hold_max;
+    return win;
+  }
+
+
+  task void hold_task() {
+    call HoldTimer.startOneShot(sd_hold.win);
+  }
+
+
+  bool q_add(sd_sched_q_t *qp, uint8_t id) {
+    if (qp->count >= numClients)
+      return FALSE;
+    qp->q[(qp->head + qp->count) % numClients] = id;
+    qp->count++;
+    return TRUE;
+  }
+
+
+  uint8_t q_pop(sd_sched_q_t *qp) {
+    uint8_t id;
+
+    id = qp->q[qp->head];
+    qp->head = (qp->head + 1) % numClients;
+    qp->count--;
+    return id;
+  }
+
+
+  /* atomic context.  NO_RES if both queues are empty. */
+  uint8_t next_client() {
+    uint8_t id;
+
+    if (fg_q.count && (bg_q.count == 0 || fg_burst < SD_SCHED_FG_BURST)) {
+      if (bg_q.count)
+        fg_burst++;
+      id = q_pop(&fg_q);
+    } else if (bg_q.count) {
+      fg_burst = 0;
+      id = q_pop(&bg_q);
+    } else
+      return NO_RES;
+    queued[id] = FALSE;
+    return id;
+  }
+
+
+  async command error_t Resource.request[uint8_t id]() {
+    bool fg;
+    uint8_t owner;
+
+    if (id >= numClients)
+      return EINVAL;
+    fg = call SDPriority.foreground[id]();
+    atomic {
+      if (queued[id] || resId == id ||
+          (state == RES_GRANTING && reqResId == id))
+        return EBUSY;
+      sd_sched_stats[id].req_ms = call LocalTime.get();
+      if (state == RES_CONTROLLED || state == RES_HELD) {
+        if (sd_hold.idle_valid) {
+          sd_hold.gap_avg = avg(sd_hold.gap_avg,
+                sd_sched_stats[id].req_ms - sd_hold.idle_t0);
+          sd_hold.idle_valid = FALSE;
+        }
+        reqResId = id;
+        if (state == RES_HELD) {
+          /* still powered, no need to bother the default owner */
+          sd_hold.hits++;
+          state = RES_GRANTING;
+          post grantedTask();
+          return SUCCESS;
+        }
+        state = RES_GRANTING;
+        sd_hold.pwr_t0 = sd_sched_stats[id].req_ms;
+      } else {
+        queued[id] = TRUE;
+        if (fg)
+          q_add(&fg_q, id);
+        else
+          q_add(&bg_q, id);
+        owner = (state == RES_BUSY) ? resId : NO_RES;
+        if (fg && owner != NO_RES)
+          signal ResourceRequested.requested[owner]();
+        return SUCCESS;
+      }
+    }
+    signal ResourceDefaultOwner.requested();
+    return SUCCESS;
+  }
+
+
+  /* no immediate grants, the SD has to be powered up first */
+  async command error_t Resource.immediateRequest[uint8_t id]() {
+    return FAIL;
+  }
+
+
+  async command error_t Resource.release[uint8_t id]() {
+    uint8_t next;
+
+    atomic {
+      if (state != RES_BUSY || resId != id)
+        return FAIL;
+      next = next_client();
+      if (next != NO_RES) {
+        reqResId = next;
+        resId = NO_RES;
+        state = RES_GRANTING;
+        post grantedTask();
+        return SUCCESS;
+      }
+      sd_hold.idle_t0 = call LocalTime.get();
+      sd_hold.idle_valid = TRUE;
+      sd_hold.win = hold_window();
+      if (sd_hold.win) {
+        resId = NO_RES;
+        holdResId = id;
+        state = RES_HELD;
+        post hold_task();
+        return SUCCESS;
+      }
+      resId = DEFAULT_RES;
+      state = RES_CONTROLLED;
+    }
+    signal ResourceDefaultOwner.granted();
+    return SUCCESS;
+  }
+
+
+  event void HoldTimer.fired() {
+    uint32_t left = 0;
+
+    atomic {
+      if (state != RES_HELD)            /* somebody showed up */
+        return;
+      left = call LocalTime.get() - sd_hold.idle_t0;
+      if (left < sd_hold.win)           /* left over from an earlier hold */
+        left = sd_hold.win - left;
+      else {
+        left = 0;
+        sd_hold.misses++;
+        resId = DEFAULT_RES;
+        state = RES_CONTROLLED;
+      }
+    }
+    if (left) {
+      call HoldTimer.startOneShot(left);
+      return;
+    }
+    signal ResourceDefaultOwner.granted();
+  }
+
+
+  async command error_t ResourceDefaultOwner.release() {
+    atomic {
+      if (resId != DEFAULT_RES || state != RES_GRANTING)
+        return FAIL;
+      sd_hold.pwr_ups++;
+      if (sd_hold.pwr_ups == 1)
+        sd_hold.pwr_avg = call LocalTime.get() - sd_hold.pwr_t0;
+      else
+        sd_hold.pwr_avg = avg(sd_hold.pwr_avg,
+                              call LocalTime.get() - sd_hold.pwr_t0);
+      pwr_grant = TRUE;
+      post grantedTask();
+    }
+    return SUCCESS;
+  }
+
+
+  async command bool Resource.isOwner[uint8_t id]() {
+    atomic return (state == RES_BUSY && resId == id);
+  }
+
+
+  async command bool ResourceDefaultOwner.isOwner() {
+    atomic return (resId == DEFAULT_RES &&
+                   (state == RES_CONTROLLED || state == RES_GRANTING));
+  }
+
+
+  task void grantedTask() {
+    uint8_t id, i;
+    uint32_t wait;
+    bool pwr;
+
+    atomic {
+      pwr = pwr_grant;
+      pwr_grant = FALSE;
+      id = resId = reqResId;
+      state = RES_BUSY;
+      wait = call LocalTime.get() - sd_sched_stats[id].req_ms;
+      sd_sched_stats[id].grants++;
+      sd_sched_stats[id].wait_sum += wait;
+      if (wait > sd_sched_stats[id].wait_max)
+        sd_sched_stats[id].wait_max = wait;
+    }
+    signal Resource.granted[id]();
+    if (pwr)
+      for (i = 0; i < numClients; i++)
+        if (i != id)
+          signal SDActive.on[i]();
+  }
+
+
+  /* up, and not on id's account */
+  async command bool SDActive.is_on[uint8_t id]() {
+    atomic {
+      switch (state) {
+        case RES_GRANTING:      return (reqResId  != id);
+        case RES_BUSY:          return (resId     != id);
+        case RES_HELD:          return (holdResId != id);
+        default:                return FALSE;
+      }
+    }
+  }
+
+
+  command bool SDHold.get_value(uint32_t *t, uint32_t *l) {
+    *t = sd_hold.hold_max;
+    *l = sizeof(uint32_t);
+    return TRUE;
+  }
+
+  command bool SDHold.set_value(uint32_t *t, uint32_t *l) {
+    if (*l != sizeof(uint32_t) || *t > SD_HOLD_LIMIT_MS)
+      return FALSE;
+    sd_hold.hold_max = *t;
+    return TRUE;
+  }
+
+
+  default event void Resource.granted[uint8_t id]() { }
+  default event void SDActive.on[uint8_t id]() { }
+  default async event void ResourceRequested.requested[uint8_t id]() { }
+  default async event void ResourceRequested.immediateRequested[uint8_t id]() { }
+  default async event void ResourceDefaultOwner.granted() { }
+  default async event void ResourceDefaultOwner.requested() {
+    call ResourceDefaultOwner.release();
+  }
+  default async event void ResourceDefaultOwner.immediateRequested() { }
+  default async command bool SDPriority.foreground[uint8_t id]() { return FALSE; }
+}
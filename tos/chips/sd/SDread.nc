@@ -35,5 +35,16 @@ interface SDread {
    * if SUCCESS, it is guaranteed that a future readDone will be signalled.
    */
   command error_t read(uint32_t blk_id, uint8_t *buf);
+
+  /**
+   * SD multi-block read, split phase.
+   *
+   * read n blocks, starting at blk_id, in one SD transaction (CMD18).
+   * block blk_id + i lands in bufs[i].  Each buffer must be SD_BLOCKSIZE.
+   *
+   * completion is signalled with a single readDone(blk_id, bufs[0], err)
+   * for the whole run.
+   */
+  command error_t read_multi(uint32_t blk_id, uint8_t **bufs, uint8_t n);
   event void  readDone(uint32_t blk_id, uint8_t *buf, error_t error);
 }
@@ -40,6 +40,7 @@
 #include "hardware.h"
 #include "sd.h"
 #include "sd_cmd.h"
+#include "sd_crc.h"
 #include <panic.h>
 #include <platform_panic.h>
 
@@ -68,6 +69,7 @@ generic module SDspP() {
   uses {
     interface ResourceDefaultOwner;
     interface Timer<TMilli> as SDtimer;
+    interface Timer<TMilli> as SDbusy;
     interface LocalTime<TMilli> as lt;
     interface SDHardware as HW;
     interface Platform;
@@ -86,6 +88,25 @@ implementation {
  */
 #define GO_OP_POLL_TIME 10
 
+/*
+ * Busy detection.  After a block goes out (or the multi-block stop token,
+ * or an erase) the card holds DO low while it programs.  We used to repost
+ * a task to look at DO until it came back, which keeps the cpu awake for
+ * the whole programming time.
+ *
+ * Now we look from a task SD_BUSY_SPIN times, which catches short busies
+ * (between blocks of a multi-block write the card is typically busy for
+ * only a few us).  After that we look once every SD_BUSY_POLL_MS off the
+ * SDbusy timer and sleep in between.  The SDtimer timeout still protects
+ * against a hung card.  Completion is always handled at task level.
+ *
+ * Busy times are kept in log2 ms histograms, bucket 0 is < 1ms, bucket n
+ * is [2^(n-1), 2^n) ms, the last bucket catches everything longer.
+ */
+#define SD_BUSY_SPIN    8
+#define SD_BUSY_POLL_MS 1
+#define SD_BUSY_HIST    10
+
   typedef enum {
     SDS_OFF = 0,
     SDS_OFF_TO_ON,
@@ -96,6 +117,7 @@ implementation {
     SDS_WRITE,
     SDS_WRITE_DMA,
     SDS_WRITE_BUSY,
+    SDS_WRITE_STOP,
     SDS_ERASE,
     SDS_ERASE_BUSY,
   } sd_state_t;
@@ -126,6 +148,9 @@ implementation {
    *           IDLE if powered on but not busy
    * cur_cid   client id of who has requested the activity.
    * data_ptr  buffer pointer if needed.
+   * bufs      multi-block read/write, list of buffers.
+   * nbufs     multi-block read/write, number of buffers.  0 if single block.
+   * buf_idx   multi-block read/write, which buffer is in flight.
    * erase_state when erased the default state of a sector
    * majik_b   protection tombstone, SD_MAJIK
    *
@@ -152,6 +177,9 @@ implementation {
     uint32_t   blk_start, blk_end;
     uint8_t    cur_cid;			/* current client */
     uint8_t    *data_ptr;
+    uint8_t    **bufs;
+    uint8_t    nbufs, buf_idx;
+    uint16_t   wr_crc;                  /* crc of block going out */
     uint16_t   erase_state;             /* dp, 0x00 or 0xff */
     uint16_t   majik_b;
   } sdc;
@@ -166,6 +194,12 @@ implementation {
          uint32_t     sd_erase_busy_count;
   norace uint32_t     sd_write_busy_count;
 
+  norace uint32_t     sd_busy_t0_us;            /* busy started */
+         uint16_t     sd_busy_spins;            /* task looks, this busy */
+         uint32_t     sd_busy_sleeps;           /* timer looks, total */
+         uint32_t     sd_wr_busy_hist[SD_BUSY_HIST];
+         uint32_t     sd_er_busy_hist[SD_BUSY_HIST];
+
          uint32_t     op_t0_ms;                 /* start time of various operations */
   norace uint32_t     op_t0_us;
 
@@ -224,12 +258,7 @@ implementation {
     uint16_t  i;
     uint8_t   rsp, crc;
 
-    switch (cmd) {
-      case CMD0: crc = 0x95; break;
-      case CMD8: crc = 0x87; break;
-      default:   crc = 0x55; break;
-    }
-
+    crc = sd_cmd_crc7(cmd, arg);
     call HW.spi_check_clean();
 
     call HW.spi_put(cmd);
@@ -617,6 +646,7 @@ implementation {
       default:
       case SDS_ERASE_BUSY:		/* these are various timeout states */
       case SDS_WRITE_BUSY:		/* the timer went off which shouldn't happen */
+      case SDS_WRITE_STOP:
       case SDS_WRITE_DMA:
       case SDS_READ_DMA:
 	w_t = call lt.get();
@@ -673,6 +703,7 @@ implementation {
          */
         if (sdc.blocks == 0)
           sd_get_disk_params();
+        sd_crc_on();
 
         nop();
 	sdc.sd_state = SDS_IDLE;
@@ -742,9 +773,15 @@ implementation {
    *		1 (FAIL) crc didn't check.
    *
    * SD_BLOCKSIZE is the size of the buffer and the sector (512)
+   *
+   * Only checked if CRCs have been turned on (SD_CRC_ENABLE).
    */
 
   int sd_check_crc(uint8_t *data, uint16_t crc) {
+#ifdef SD_CRC_ENABLE
+    if (sd_crc16(data, SD_BLOCKSIZE) != crc)
+      return FAIL;
+#endif
     return SUCCESS;
   }
 
@@ -757,7 +794,21 @@ implementation {
    */
 
   uint16_t sd_compute_crc(uint8_t *data) {
-    return 0x5512;
+    return sd_crc16(data, SD_BLOCKSIZE);
+  }
+
+
+  /*
+   * sd_crc_on: turn on CRC checking in the card, CMD59.  Without it the
+   * card ignores the CRCs we send.  Done after every reset.
+   */
+  void sd_crc_on() {
+#ifdef SD_CRC_ENABLE
+    uint8_t rsp;
+
+    if ((rsp = sd_send_command(SD_SET_CRC, 1)))
+      sd_panic(84, rsp);
+#endif
   }
 
 
@@ -828,6 +879,45 @@ implementation {
   }
 
 
+  /*
+   * sd_stop_read: terminate a multi-block read.
+   *
+   * CMD12 (STOP_TRANSMISSION).  The byte following the command is a
+   * stuff byte and is tossed.  The response is R1b, wait for the
+   * card to go unbusy.  CS is still asserted from the read.
+   */
+  void sd_stop_read() {
+    uint16_t i;
+    uint8_t  rsp;
+
+    call HW.spi_put(SD_STOP_TRANS);
+    call HW.spi_put(0);
+    call HW.spi_put(0);
+    call HW.spi_put(0);
+    call HW.spi_put(0);
+    call HW.spi_put(sd_cmd_crc7(SD_STOP_TRANS, 0));
+    call HW.spi_get();                  /* stuff byte */
+
+    i = 0;
+    do {
+      rsp = call HW.spi_get();
+      i++;
+    } while ((rsp & 0x80) && (i < SD_CMD_TIMEOUT));
+    if (rsp & 0x80) {
+      sd_panic(75, rsp);
+      return;
+    }
+
+    i = 0;
+    while (call HW.spi_get() != 0xff) {
+      if (++i >= SD_READ_TOK_MAX) {
+        sd_panic(76, i);
+        return;
+      }
+    }
+  }
+
+
   void sd_read_dma_handler() {
     uint16_t crc;
     uint8_t  cid, old_byte;
@@ -842,15 +932,32 @@ implementation {
      */
     crc = (call HW.spi_get() << 8) | call HW.spi_get();
 
-    /* Send some extra clocks so the card can finish */
-    call HW.spi_get();                  /* sandisk */
-    call HW.sd_clr_cs();
-
     if (sd_check_crc(sdc.data_ptr, crc)) {
       sd_panic_idle(45, crc);           /* no return */
       return;
     }
 
+    if (sdc.nbufs) {
+      /*
+       * multi-block read.  the card just keeps streaming blocks, each
+       * with its own start token.  Go get the next one or tell the card
+       * to stop.
+       */
+      if (++sdc.buf_idx < sdc.nbufs) {
+        sdc.data_ptr = sdc.bufs[sdc.buf_idx];
+        sdc.sd_state = SDS_READ;
+        sd_read_tok_count = 0;
+        post sd_read_task();
+        return;
+      }
+      sd_stop_read();
+      sdc.data_ptr = sdc.bufs[0];
+    }
+
+    /* Send some extra clocks so the card can finish */
+    call HW.spi_get();                  /* sandisk */
+    call HW.sd_clr_cs();
+
     /*
      * sometimes.  not sure of the conditions.  When using dma
      * the first byte will show up as 0xfe (something having
@@ -861,7 +968,7 @@ implementation {
      * Haven't seen this in a while pretty sure it got cleaned up when
      * we got a better handle on the transaction sequence of the SD.
      */
-    if (sdc.data_ptr[0] == 0xfe) {
+    if (!sdc.nbufs && sdc.data_ptr[0] == 0xfe) {
       old_byte = sdc.data_ptr[0];
       call SDsa.read(sdc.blk_start, sdc.data_ptr);
       if (sdc.data_ptr[0] != 0xfe)
@@ -876,6 +983,8 @@ implementation {
     if (last_read_delta_ms > max_read_time_ms)
       max_read_time_ms = last_read_delta_ms;
 
+    sdc.nbufs = 0;
+    sdc.bufs  = NULL;
     sdc.sd_state = SDS_IDLE;
     sdc.cur_cid = CID_NONE;
     signal SDread.readDone[cid](sdc.blk_start, sdc.data_ptr, SUCCESS);
@@ -908,6 +1017,7 @@ implementation {
     sdc.cur_cid = cid;
     sdc.blk_start = blk_id;
     sdc.data_ptr = data;
+    sdc.nbufs = 0;
 
     if (!sdc.sdhc)
       blk_id = blk_id << SD_BLOCKSIZE_NBITS;
@@ -928,26 +1038,154 @@ implementation {
   }
 
 
+  /*
+   * SDread.read_multi: read a run of blocks in one transaction
+   *
+   * CMD18 then the card streams blocks, each preceeded by a start token
+   * (SD_TOK_READ_STARTBLOCK_M), until told to stop with CMD12.  Saves
+   * the command overhead and per sector access latency.
+   *
+   * A run of 1 is just a single block read.
+   */
+  command error_t SDread.read_multi[uint8_t cid](uint32_t blk_id,
+                                                 uint8_t **bufs, uint8_t n) {
+    uint8_t   rsp;
+
+    if (n == 1)
+      return call SDread.read[cid](blk_id, bufs[0]);
+
+    if (sdc.sd_state != SDS_IDLE) {
+      sd_panic_idle(77, sdc.sd_state);
+      return EBUSY;
+    }
+    if (!bufs || !n) {
+      sd_panic_idle(78, n);
+      return EINVAL;
+    }
+
+    op_t0_us = call Platform.usecsRaw();
+    op_t0_ms = call lt.get();
+
+    sdc.sd_state = SDS_READ;
+    sdc.cur_cid = cid;
+    sdc.blk_start = blk_id;
+    sdc.bufs = bufs;
+    sdc.nbufs = n;
+    sdc.buf_idx = 0;
+    sdc.data_ptr = bufs[0];
+
+    if (!sdc.sdhc)
+      blk_id = blk_id << SD_BLOCKSIZE_NBITS;
+    if ((rsp = sd_send_command(SD_READ_MULTI, blk_id))) {
+      sd_panic_idle(79, rsp);
+      return FAIL;
+    }
+
+    call HW.sd_set_cs();		/* reassert to continue xfer */
+    sd_read_tok_count = 0;
+    post sd_read_task();
+    return SUCCESS;
+  }
+
+
   /************************************************************************
    *
    * Write
    *
    */
 
-  task void sd_write_task() {
+  /*
+   * send the start token and fire up the dma for the block in data_ptr.
+   * crc bytes (2) will be sent after the data is sent.
+   *
+   * start the dma, enable a time out to monitor the h/w
+   * and enable the dma h/w interrupt to generate the h/w event.
+   *
+   * The crc is computed while the dma is clocking the block out, it
+   * reads the same buffer, so it is ready by the time the dma completes.
+   */
+  void sd_start_write_dma(uint8_t tok) {
+    call HW.spi_put(tok);
+    sdc.sd_state = SDS_WRITE_DMA;
+    call HW.spi_check_clean();
+    call HW.sd_dma_enable_int();
+    call HW.sd_start_dma(sdc.data_ptr, NULL, SD_BLOCKSIZE);
+    call SDtimer.startOneShot(SD_SECTOR_XFER_TIMEOUT);
+    sdc.wr_crc = sd_compute_crc(sdc.data_ptr);
+  }
+
+
+  task void sd_busy_task();
+
+  /* card just went busy, start looking */
+  void sd_busy_start() {
+    sd_busy_t0_us = call Platform.usecsRaw();
+    sd_busy_spins = 0;
+    post sd_busy_task();
+  }
+
+
+  /* still busy, look again.  From a task for a bit, then off the timer */
+  void sd_busy_again() {
+    if (++sd_busy_spins < SD_BUSY_SPIN) {
+      post sd_busy_task();
+      return;
+    }
+    sd_busy_sleeps++;
+    call SDbusy.startOneShot(SD_BUSY_POLL_MS);
+  }
+
+
+  /* busy is done, log how long it took */
+  void sd_busy_done(uint32_t *hist) {
+    uint32_t ms;
+    uint8_t  b;
+
+    ms = (call Platform.usecsRaw() - sd_busy_t0_us) >> 10;
+    for (b = 0; ms && b < SD_BUSY_HIST - 1; b++)
+      ms >>= 1;
+    hist[b]++;
+  }
+
+
+  void sd_write_busy() {
     uint16_t i;
     uint8_t  tmp;
     uint8_t  cid;
+    uint8_t  nblks;
 
     /* card is busy writing the block.  ask if still busy. */
 
     tmp = call HW.spi_get();
     sd_write_busy_count++;
     if (tmp != 0xff) {			/* protected by timeout timer */
-      post sd_write_task();
+      sd_busy_again();
       return;
     }
     call SDtimer.stop();		/* write busy done, kill timeout timer */
+    sd_busy_done(sd_wr_busy_hist);
+
+    if (sdc.sd_state == SDS_WRITE_BUSY && sdc.nbufs) {
+      /*
+       * multi-block write.  CS stays asserted across the whole
+       * transaction.  Either send the next block or finish up with the
+       * stop token, which causes one more busy while the card programs
+       * what it has buffered.
+       */
+      if (++sdc.buf_idx < sdc.nbufs) {
+        sdc.data_ptr = sdc.bufs[sdc.buf_idx];
+        sd_start_write_dma(SD_TOK_WRITE_STARTBLOCK_M);
+        return;
+      }
+      call HW.spi_put(SD_TOK_STOP_MULTI);
+      call HW.spi_get();                /* Nbr, busy shows after this */
+      sd_write_busy_count = 0;
+      sdc.sd_state = SDS_WRITE_STOP;
+      call SDtimer.startOneShot(SD_WRITE_BUSY_TIMEOUT);
+      sd_busy_start();
+      return;
+    }
+
     call HW.spi_get();                  /* extra clocking */
     call HW.sd_clr_cs();
 
@@ -963,10 +1201,15 @@ implementation {
     if (last_write_delta_ms > max_write_time_ms)
       max_write_time_ms = last_write_delta_ms;
 
-    if (last_write_delta_ms > SD_WRITE_WARN_THRESHOLD) {
+    nblks = (sdc.nbufs ? sdc.nbufs : 1);
+    if (last_write_delta_ms > SD_WRITE_WARN_THRESHOLD * nblks) {
       call Panic.warn(PANIC_SD, 50, sdc.blk_start, last_write_delta_ms, 0, 0);
       /* no return */
     }
+    if (sdc.nbufs)
+      sdc.data_ptr = sdc.bufs[0];
+    sdc.nbufs = 0;
+    sdc.bufs  = NULL;
     cid = sdc.cur_cid;
     sdc.sd_state = SDS_IDLE;
     sdc.cur_cid = CID_NONE;
@@ -982,8 +1225,8 @@ implementation {
       sd_panic(99, sdc.sd_state);
     call HW.sd_stop_dma();
 
-    /* crc is the next two bytes out, big endian */
-    crc = sd_compute_crc(sdc.data_ptr);
+    /* crc is the next two bytes out, big endian, done while dma ran */
+    crc = sdc.wr_crc;
     call HW.spi_put((crc >> 8) & 0xff);
     call HW.spi_put(crc & 0xff);
 
@@ -1007,7 +1250,7 @@ implementation {
     sd_write_busy_count = 0;
     sdc.sd_state = SDS_WRITE_BUSY;
     call SDtimer.startOneShot(SD_WRITE_BUSY_TIMEOUT);
-    post sd_write_task();
+    sd_busy_start();
   }
 
 
@@ -1026,6 +1269,7 @@ implementation {
     sdc.cur_cid = cid;
     sdc.blk_start = blk_id;
     sdc.data_ptr = data;
+    sdc.nbufs = 0;
 
     if (!sdc.sdhc)
       blk_id = blk_id << SD_BLOCKSIZE_NBITS;
@@ -1040,20 +1284,67 @@ implementation {
      * The SD needs a write token, send it first then fire
      * up the dma.
      */
-    call HW.spi_put(SD_START_TOK);
+    sd_start_write_dma(SD_START_TOK);
+    return SUCCESS;
+  }
 
-    /*
-     * send the sector data, crc bytes (2) will be sent after the
-     * data is sent.
-     *
-     * start the dma, enable a time out to monitor the h/w
-     * and enable the dma h/w interrupt to generate the h/w event.
-     */
-    sdc.sd_state = SDS_WRITE_DMA;
-    call HW.spi_check_clean();
-    call HW.sd_dma_enable_int();
-    call HW.sd_start_dma(data, NULL, SD_BLOCKSIZE);
-    call SDtimer.startOneShot(SD_SECTOR_XFER_TIMEOUT);
+
+  /*
+   * SDwrite.write_multi: write a run of blocks in one transaction
+   *
+   * CMD25 followed by a data block (SD_TOK_WRITE_STARTBLOCK_M) per buffer,
+   * each with its own data response and busy.  The transaction is closed
+   * with SD_TOK_STOP_MULTI.  Saves the command overhead and lets the card
+   * program the run as a unit.
+   *
+   * Unless SD_NO_PRE_ERASE, we first tell the card how many blocks are
+   * coming (ACMD23, SET_WR_BLK_ERASE_COUNT) so it can pre-erase.
+   *
+   * A run of 1 is just a single block write.
+   */
+  command error_t SDwrite.write_multi[uint8_t cid](uint32_t blk_id,
+                                                   uint8_t **bufs, uint8_t n) {
+    uint8_t   rsp;
+
+    if (n == 1)
+      return call SDwrite.write[cid](blk_id, bufs[0]);
+
+    if (sdc.sd_state != SDS_IDLE) {
+      sd_panic_idle(71, sdc.sd_state);
+      return EBUSY;
+    }
+    if (!bufs || !n) {
+      sd_panic_idle(72, n);
+      return EINVAL;
+    }
+
+    op_t0_us = call Platform.usecsRaw();
+    op_t0_ms = call lt.get();
+
+    sdc.sd_state = SDS_WRITE;
+    sdc.cur_cid = cid;
+    sdc.blk_start = blk_id;
+    sdc.bufs = bufs;
+    sdc.nbufs = n;
+    sdc.buf_idx = 0;
+    sdc.data_ptr = bufs[0];
+
+#ifndef SD_NO_PRE_ERASE
+    if ((rsp = sd_send_acmd(SD_SET_PRE_ERASE, n))) {
+      sd_panic_idle(73, rsp);
+      return FAIL;
+    }
+#endif
+
+    if (!sdc.sdhc)
+      blk_id = blk_id << SD_BLOCKSIZE_NBITS;
+    if ((rsp = sd_send_command(SD_WRITE_MULTI, blk_id))) {
+      sd_panic_idle(74, rsp);
+      return FAIL;
+    }
+
+    call HW.sd_set_cs();		/* reassert to continue xfer */
+    sd_start_write_dma(SD_TOK_WRITE_STARTBLOCK_M);
     return SUCCESS;
   }
 
@@ -1065,7 +1356,7 @@ implementation {
    *
    */
 
-  task void sd_erase_task() {
+  void sd_erase_busy() {
     uint8_t  tmp;
     uint8_t  cid;
 
@@ -1075,10 +1366,11 @@ implementation {
     tmp = call HW.spi_get();
     sd_erase_busy_count++;
     if (tmp != 0xff) {			/* protected by timeout timer */
-      post sd_erase_task();
+      sd_busy_again();
       return;
     }
     call SDtimer.stop();		/* busy done, kill timeout */
+    sd_busy_done(sd_er_busy_hist);
     call HW.spi_get();                  /* extra clocks */
     call HW.sd_clr_cs();		/* deassert CS */
 
@@ -1140,11 +1432,39 @@ implementation {
     sd_erase_busy_count = 0;
     sdc.sd_state = SDS_ERASE_BUSY;
     call SDtimer.startOneShot(SD_ERASE_BUSY_TIMEOUT);
-    post sd_erase_task();
+    sd_busy_start();
     return SUCCESS;
   }
 
 
+  /* look at busy, whoever is waiting on it */
+  void sd_busy_check() {
+    switch (sdc.sd_state) {
+      case SDS_WRITE_BUSY:
+      case SDS_WRITE_STOP:
+        sd_write_busy();
+        return;
+
+      case SDS_ERASE_BUSY:
+        sd_erase_busy();
+        return;
+
+      default:                          /* timed out, nothing to do */
+        return;
+    }
+  }
+
+
+  task void sd_busy_task() {
+    sd_busy_check();
+  }
+
+
+  event void SDbusy.fired() {
+    sd_busy_check();
+  }
+
+
   /*************************************************************************
    *
    * SDsa: standalone SD implementation, no split phase, no clients
@@ -1241,6 +1561,7 @@ implementation {
       sd_panic(59, sa_op_cnt);
     if (sdc.blocks == 0)
       sd_get_disk_params();
+    sd_crc_on();
     return SUCCESS;
   }
 
@@ -1315,7 +1636,6 @@ implementation {
     uint16_t  t, last_time, time_wraps;
     uint16_t  crc;
 
-    crc = sd_compute_crc(buf);
     if (!sdc.sdhc)
       blk_id = blk_id << SD_BLOCKSIZE_NBITS;
     if ((rsp = sd_send_command(SD_WRITE_BLOCK, blk_id)))
@@ -1325,6 +1645,7 @@ implementation {
     call HW.spi_put(SD_START_TOK);
     call HW.spi_check_clean();
     call HW.sd_start_dma(buf, NULL, SD_BLOCKSIZE);
+    crc = sd_compute_crc(buf);          /* while the dma runs */
     call HW.sd_wait_dma(SD_BLOCKSIZE);
 
     /* next two bytes is the CRC */
@@ -35,5 +35,18 @@ interface SDwrite {
    * if SUCCESS, it is guaranteed that a future writeDone will be signalled.
    */
   command error_t write(uint32_t blk, uint8_t *buf);
+
+  /**
+   * SD multi-block write, split phase.
+   *
+   * write n blocks, starting at blk, in one SD transaction (CMD25).
+   * bufs[i] is written to blk + i.  Each buffer must be SD_BLOCKSIZE.
+   * bufs must stay put until writeDone.
+   *
+   * completion is signalled with a single writeDone(blk, bufs[0], err)
+   * for the whole run.
+   */
+  command error_t write_multi(uint32_t blk, uint8_t **bufs, uint8_t n);
+
   event   void    writeDone(uint32_t blk, uint8_t *buf, error_t error);
 }
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * SD0C, emulated.
+ *
+ * Drop in replacement for <platform>/hardware/sd0/SD0C.  Instead of
+ * SDspP talking SPI to a real card, SDemuP keeps the sectors in an
+ * image (a file mmap'd on a host build, see SDemuP) and models the
+ * card's command latency and busy times with a timer.
+ *
+ * Everything above SD0C (SD0_ArbC/SD0_ArbP, the arbiter and
+ * ResourceDefaultOwner power sequencing, SSWrite, Collect, DblkManager,
+ * ImageManager, Panic) is the real code.
+ *
+ * Selected by the sdemu make extra, which puts this directory ahead of
+ * the platform's sd0 directory on the search path.  ie. make mm6a sdemu
+ */
+
+configuration SD0C {
+  provides {
+    interface SDread[uint8_t cid];
+    interface SDwrite[uint8_t cid];
+    interface SDerase[uint8_t cid];
+    interface SDsa;
+    interface SDraw;
+  }
+  uses interface ResourceDefaultOwner;          /* power control */
+}
+
+implementation {
+  components new SDemuP() as SDdvrP;
+
+  SDread   = SDdvrP;
+  SDwrite  = SDdvrP;
+  SDerase  = SDdvrP;
+  SDsa     = SDdvrP;
+  SDraw    = SDdvrP;
+
+  ResourceDefaultOwner = SDdvrP;
+
+  components MainC;
+  MainC.SoftwareInit -> SDdvrP;
+
+  components PanicC;
+  SDdvrP.Panic -> PanicC;
+
+  components new TimerMilliC() as SDTimer;
+  SDdvrP.SDtimer -> SDTimer;
+
+  components LocalTimeMilliC;
+  SDdvrP.lt -> LocalTimeMilliC;
+}
@@ -0,0 +1,604 @@
+/*
+ * SDemu - Secure Digital storage emulator
+ * Split phase, event driven.
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * SDemuP provides the same interfaces as SDspP (SDread, SDwrite,
+ * SDerase, SDsa, SDraw, and ResourceDefaultOwner for power sequencing)
+ * but the sectors live in an image rather than on a card.  It is used
+ * to run the storage stack (SSWrite, Collect, DblkManager, ImageManager,
+ * Panic) without a tag on the bench, replay workloads, and measure what
+ * the real nesC modules do with throughput and latency.
+ *
+ * Image:
+ *
+ * SD_EMU_FILE      (string) host builds.  The image file is mmap'd
+ *                  shared, so the result can be looked at afterwards
+ *                  with tagdump and friends.  Number of blocks is the
+ *                  size of the file.  Create it with something like
+ *                  dd if=/dev/zero of=sd.img bs=512 count=<n>
+ *                  and lay down a filesystem with mkdblk.
+ *
+ * otherwise        a RAM image of SD_EMU_BLOCKS sectors, erased.  Only
+ *                  useful for small experiments.
+ *
+ * Timing model (all ms, driven off SDtimer):
+ *
+ * SD_EMU_PWR_UP_MS     power up and reset, RDO.requested to release.
+ * SD_EMU_CMD_MS        per command overhead.
+ * SD_EMU_READ_MS       per block, read.
+ * SD_EMU_WRITE_MS      per block, write busy.  Expected 3-5 ms.
+ * SD_EMU_SLOW_EVERY    every nth write goes slow (0, never).
+ * SD_EMU_SLOW_MS       how long a slow write stays busy.  Defaults to
+ *                      the observed 190 ms, which is over
+ *                      SD_WRITE_WARN_THRESHOLD.  Setting it over
+ *                      SD_WRITE_BUSY_TIMEOUT exercises the timeout panic.
+ * SD_EMU_ERASE_MS      erase busy.
+ *
+ * Write busy is checked against SD_WRITE_WARN_THRESHOLD and
+ * SD_WRITE_BUSY_TIMEOUT the same way SDspP does, so the warnings and
+ * panics show up as they would on the tag.
+ *
+ * sd_emu_stats is global so it can be pulled from gdb or a host harness.
+ * tools/utils/hosttest/sdemu_test builds this module natively (nc2c) and
+ * checks it against an image file.
+ */
+
+#include "sd.h"
+#include "sd_cmd.h"
+#include <panic.h>
+#include <platform_panic.h>
+
+#ifdef SD_EMU_FILE
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifndef PANIC_SD
+enum {
+  __pcode_sd = unique(UQ_PANIC_SUBSYS)
+};
+
+#define PANIC_SD __pcode_sd
+#endif
+
+#ifndef SD_EMU_BLOCKS
+#define SD_EMU_BLOCKS           128
+#endif
+
+#ifndef SD_EMU_ERASE_STATE
+#define SD_EMU_ERASE_STATE      0x00
+#endif
+
+#ifndef SD_EMU_PWR_UP_MS
+#define SD_EMU_PWR_UP_MS        10
+#endif
+
+#ifndef SD_EMU_CMD_MS
+#define SD_EMU_CMD_MS           1
+#endif
+
+#ifndef SD_EMU_READ_MS
+#define SD_EMU_READ_MS          1
+#endif
+
+#ifndef SD_EMU_WRITE_MS
+#define SD_EMU_WRITE_MS         4
+#endif
+
+#ifndef SD_EMU_SLOW_EVERY
+#define SD_EMU_SLOW_EVERY       0
+#endif
+
+#ifndef SD_EMU_SLOW_MS
+#define SD_EMU_SLOW_MS          190
+#endif
+
+#ifndef SD_EMU_ERASE_MS
+#define SD_EMU_ERASE_MS         50
+#endif
+
+typedef struct {
+  uint32_t reads;                       /* read commands  */
+  uint32_t writes;                      /* write commands */
+  uint32_t erases;
+  uint32_t blks_read;
+  uint32_t blks_written;
+  uint32_t slow_writes;                 /* over SD_WRITE_WARN_THRESHOLD */
+  uint32_t pwr_ups;
+  uint32_t busy_ms;                     /* total time busy */
+  uint32_t max_read_ms;
+  uint32_t max_write_ms;
+} sd_emu_stats_t;
+
+norace sd_emu_stats_t sd_emu_stats;
+
+generic module SDemuP() {
+  provides {
+    interface SDread[uint8_t cid];
+    interface SDwrite[uint8_t cid];
+    interface SDerase[uint8_t cid];
+    interface SDsa;			/* standalone */
+    interface SDraw;			/* raw */
+    interface Init as SoftwareInit @exactlyonce();
+  }
+  uses {
+    interface ResourceDefaultOwner;
+    interface Timer<TMilli> as SDtimer;
+    interface LocalTime<TMilli> as lt;
+    interface Panic;
+  }
+}
+
+implementation {
+
+  typedef enum {
+    SDE_OFF = 0,
+    SDE_OFF_TO_ON,
+    SDE_IDLE,
+    SDE_READ,
+    SDE_WRITE,
+    SDE_ERASE,
+  } sde_state_t;
+
+#define SDSA_MAJIK 0xAAAA5555
+#define CID_NONE   0xff
+
+  typedef struct {
+    sde_state_t  sd_state;
+    uint8_t      cur_cid;
+    uint32_t     blk_start;
+    uint32_t     blk_end;               /* erase only */
+    uint8_t     *data_ptr;
+    uint8_t    **bufs;                  /* multi-block, NULL single */
+    uint8_t      nbufs;
+    uint32_t     busy_ms;               /* modeled busy for this op */
+    uint32_t     op_t0_ms;
+    uint32_t     blocks;                /* size of the image */
+    uint32_t     sdsa_majik;
+  } sde_ctl_t;
+
+  norace sde_ctl_t sdc;
+  uint32_t         write_count;
+
+#ifdef SD_EMU_FILE
+  uint8_t *sd_img;
+#else
+  uint8_t  sd_img[SD_EMU_BLOCKS * SD_BLOCKSIZE] __attribute__ ((aligned (4)));
+#endif
+
+#define sd_panic(where, arg) do { call Panic.panic(PANIC_SD, where, arg, 0, 0, 0); } while (0)
+#define  sd_warn(where, arg) do { call  Panic.warn(PANIC_SD, where, arg, 0, 0, 0); } while (0)
+
+
+  uint8_t *blk_ptr(uint32_t blk_id) {
+    if (blk_id >= sdc.blocks)
+      sd_panic(82, blk_id);
+    return &sd_img[blk_id << SD_BLOCKSIZE_NBITS];
+  }
+
+
+  void blk_copy(uint8_t *dst, uint8_t *src) {
+    uint32_t *d, *s, count;
+
+    d = (void *) dst;
+    s = (void *) src;
+    for (count = SD_BLOCKSIZE; count; count -= 4)
+      *d++ = *s++;
+  }
+
+
+  command error_t SoftwareInit.init() {
+#ifdef SD_EMU_FILE
+    int         fd;
+    struct stat st;
+#endif
+
+    sdc.sd_state  = SDE_OFF;
+    sdc.cur_cid   = CID_NONE;
+
+#ifdef SD_EMU_FILE
+    fd = open(SD_EMU_FILE, O_RDWR);
+    if (fd < 0 || fstat(fd, &st))
+      sd_panic(80, fd);
+    sdc.blocks = st.st_size >> SD_BLOCKSIZE_NBITS;
+    if (!sdc.blocks)
+      sd_panic(81, 0);
+    sd_img = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (sd_img == MAP_FAILED)
+      sd_panic(81, 1);
+    close(fd);
+#else
+    sdc.blocks = SD_EMU_BLOCKS;
+    memset(sd_img, SD_EMU_ERASE_STATE, sizeof(sd_img));
+#endif
+    return SUCCESS;
+  }
+
+
+  /*
+   * start_op: common front end for read, write, and erase.
+   *
+   * kick the timer with the modeled busy time.  Completion (and
+   * for reads the actual data move) happens when it fires.
+   */
+  error_t start_op(sde_state_t state, uint8_t cid, uint32_t busy) {
+    if (sdc.sd_state != SDE_IDLE)
+      return EBUSY;
+    sdc.sd_state = state;
+    sdc.cur_cid  = cid;
+    sdc.busy_ms  = busy;
+    sdc.op_t0_ms = call lt.get();
+    call SDtimer.startOneShot(busy);
+    return SUCCESS;
+  }
+
+
+  void finish_op() {
+    uint32_t delta;
+
+    delta = call lt.get() - sdc.op_t0_ms;
+    sd_emu_stats.busy_ms += delta;
+    sdc.sd_state = SDE_IDLE;
+    sdc.cur_cid  = CID_NONE;
+  }
+
+
+  void read_done() {
+    uint32_t delta;
+    uint8_t  cid, i, n;
+
+    n = sdc.bufs ? sdc.nbufs : 1;
+    for (i = 0; i < n; i++)
+      blk_copy(sdc.bufs ? sdc.bufs[i] : sdc.data_ptr,
+               blk_ptr(sdc.blk_start + i));
+    sd_emu_stats.blks_read += n;
+    delta = call lt.get() - sdc.op_t0_ms;
+    if (delta > sd_emu_stats.max_read_ms)
+      sd_emu_stats.max_read_ms = delta;
+    if (sdc.bufs)
+      sdc.data_ptr = sdc.bufs[0];
+    sdc.bufs  = NULL;
+    sdc.nbufs = 0;
+    cid = sdc.cur_cid;
+    finish_op();
+    signal SDread.readDone[cid](sdc.blk_start, sdc.data_ptr, SUCCESS);
+  }
+
+
+  void write_done() {
+    uint32_t delta, nblks;
+    uint8_t  cid;
+
+    delta = call lt.get() - sdc.op_t0_ms;
+    if (delta > sd_emu_stats.max_write_ms)
+      sd_emu_stats.max_write_ms = delta;
+    nblks = (sdc.nbufs ? sdc.nbufs : 1);
+    if (delta > SD_WRITE_BUSY_TIMEOUT * nblks)
+      call Panic.panic(PANIC_SD, 38, sdc.sd_state, delta, 0, 0);
+    if (delta > SD_WRITE_WARN_THRESHOLD * nblks) {
+      sd_emu_stats.slow_writes++;
+      call Panic.warn(PANIC_SD, 50, sdc.blk_start, delta, 0, 0);
+    }
+    if (sdc.bufs)
+      sdc.data_ptr = sdc.bufs[0];
+    sdc.bufs  = NULL;
+    sdc.nbufs = 0;
+    cid = sdc.cur_cid;
+    finish_op();
+    signal SDwrite.writeDone[cid](sdc.blk_start, sdc.data_ptr, SUCCESS);
+  }
+
+
+  event void SDtimer.fired() {
+    uint8_t  cid;
+
+    switch (sdc.sd_state) {
+      default:
+        sd_panic(83, sdc.sd_state);
+        return;
+
+      case SDE_OFF_TO_ON:
+        sd_emu_stats.pwr_ups++;
+        sdc.sd_state = SDE_IDLE;
+        sdc.cur_cid  = CID_NONE;
+        call ResourceDefaultOwner.release();
+        return;
+
+      case SDE_READ:
+        read_done();
+        return;
+
+      case SDE_WRITE:
+        write_done();
+        return;
+
+      case SDE_ERASE:
+        cid = sdc.cur_cid;
+        finish_op();
+        signal SDerase.eraseDone[cid](sdc.blk_start, sdc.blk_end, SUCCESS);
+        return;
+    }
+  }
+
+
+  task void sd_pwr_up_task() {
+    call SDtimer.startOneShot(SD_EMU_PWR_UP_MS);
+  }
+
+
+  async event void ResourceDefaultOwner.granted() {
+    sdc.sd_state = SDE_OFF;
+  }
+
+
+  async event void ResourceDefaultOwner.requested() {
+    if (sdc.sd_state != SDE_OFF) {
+      sd_panic(41, 0);
+    }
+    sdc.sd_state = SDE_OFF_TO_ON;
+    post sd_pwr_up_task();
+  }
+
+
+  async event void ResourceDefaultOwner.immediateRequested() {
+    sd_panic(42, 0);
+  }
+
+
+  command error_t SDread.read[uint8_t cid](uint32_t blk_id, uint8_t *data) {
+    if (blk_id >= sdc.blocks || !data)
+      return EINVAL;
+    if (sdc.sd_state != SDE_IDLE)
+      return EBUSY;
+    sdc.blk_start = blk_id;
+    sdc.data_ptr  = data;
+    sdc.bufs      = NULL;
+    sdc.nbufs     = 0;
+    sd_emu_stats.reads++;
+    return start_op(SDE_READ, cid, SD_EMU_CMD_MS + SD_EMU_READ_MS);
+  }
+
+
+  command error_t SDread.read_multi[uint8_t cid](uint32_t blk_id,
+                                        uint8_t **bufs, uint8_t n) {
+    if (!bufs || !n || (blk_id + n) > sdc.blocks)
+      return EINVAL;
+    if (sdc.sd_state != SDE_IDLE)
+      return EBUSY;
+    sdc.blk_start = blk_id;
+    sdc.data_ptr  = NULL;
+    sdc.bufs      = bufs;
+    sdc.nbufs     = n;
+    sd_emu_stats.reads++;
+    return start_op(SDE_READ, cid, SD_EMU_CMD_MS + SD_EMU_READ_MS * n);
+  }
+
+
+  /*
+   * writes: the data moves into the image when the command is accepted
+   * (it would be on its way out the DMA on the real thing).  The
+   * caller still owns the buffer until writeDone.
+   */
+  uint32_t write_busy(uint8_t n) {
+    uint32_t busy;
+
+    busy = SD_EMU_CMD_MS + SD_EMU_WRITE_MS * n;
+    write_count++;
+    if (SD_EMU_SLOW_EVERY && (write_count % SD_EMU_SLOW_EVERY) == 0)
+      busy = SD_EMU_SLOW_MS;
+    return busy;
+  }
+
+
+  command error_t SDwrite.write[uint8_t cid](uint32_t blk_id, uint8_t *data) {
+    error_t err;
+
+    if (blk_id >= sdc.blocks || !data)
+      return EINVAL;
+    if (sdc.sd_state != SDE_IDLE)
+      return EBUSY;
+    sdc.blk_start = blk_id;
+    sdc.data_ptr  = data;
+    sdc.bufs      = NULL;
+    sdc.nbufs     = 0;
+    err = start_op(SDE_WRITE, cid, write_busy(1));
+    if (err)
+      return err;
+    blk_copy(blk_ptr(blk_id), data);
+    sd_emu_stats.writes++;
+    sd_emu_stats.blks_written++;
+    return SUCCESS;
+  }
+
+
+  command error_t SDwrite.write_multi[uint8_t cid](uint32_t blk_id,
+                                        uint8_t **bufs, uint8_t n) {
+    error_t err;
+    uint8_t i;
+
+    if (!bufs || !n || (blk_id + n) > sdc.blocks)
+      return EINVAL;
+    if (sdc.sd_state != SDE_IDLE)
+      return EBUSY;
+    sdc.blk_start = blk_id;
+    sdc.data_ptr  = NULL;
+    sdc.bufs      = bufs;
+    sdc.nbufs     = n;
+    err = start_op(SDE_WRITE, cid, write_busy(n));
+    if (err)
+      return err;
+    for (i = 0; i < n; i++)
+      blk_copy(blk_ptr(blk_id + i), bufs[i]);
+    sd_emu_stats.writes++;
+    sd_emu_stats.blks_written += n;
+    return SUCCESS;
+  }
+
+
+  command error_t SDerase.erase[uint8_t cid](uint32_t blk_s, uint32_t blk_e) {
+    error_t err;
+
+    if (blk_s > blk_e || blk_e >= sdc.blocks)
+      return EINVAL;
+    if (sdc.sd_state != SDE_IDLE)
+      return EBUSY;
+    sdc.blk_start = blk_s;
+    sdc.blk_end   = blk_e;
+    err = start_op(SDE_ERASE, cid, SD_EMU_CMD_MS + SD_EMU_ERASE_MS);
+    if (err)
+      return err;
+    memset(blk_ptr(blk_s), SD_EMU_ERASE_STATE,
+           (blk_e - blk_s + 1) << SD_BLOCKSIZE_NBITS);
+    sd_emu_stats.erases++;
+    return SUCCESS;
+  }
+
+
+  /*
+   * standalone.  Used by Panic, everything is synchronous and there
+   * is no timing model.
+   */
+  async command bool SDsa.inSA() {
+    if (sdc.sdsa_majik == SDSA_MAJIK)
+      return TRUE;
+    return FALSE;
+  }
+
+
+  async command error_t SDsa.reset() {
+    sdc.sdsa_majik = SDSA_MAJIK;
+    return SUCCESS;
+  }
+
+
+  async command void SDsa.off() {
+    sdc.sdsa_majik = 0;
+  }
+
+
+  async command void SDsa.read(uint32_t blk_id, uint8_t *buf) {
+    blk_copy(buf, blk_ptr(blk_id));
+  }
+
+
+  async command void SDsa.write(uint32_t blk_id, uint8_t *buf) {
+    blk_copy(blk_ptr(blk_id), buf);
+  }
+
+
+  /*
+   * raw.  There is no SPI bus.  Commands always say R1 ok, the bus
+   * always reads idle (0xff).
+   */
+  command void    SDraw.start_op()                          { }
+  command void    SDraw.end_op()                            { }
+  command uint8_t SDraw.get()                               { return 0xff; }
+  command void    SDraw.put(uint8_t byte)                   { }
+  command uint8_t SDraw.send_cmd(uint8_t cmd, uint32_t arg) { return 0; }
+  command uint8_t SDraw.raw_acmd(uint8_t cmd, uint32_t arg) { return 0; }
+  command uint8_t SDraw.raw_cmd(uint8_t cmd, uint32_t arg)  { return 0; }
+
+  command void SDraw.send_recv(uint8_t *tx, uint8_t *rx, uint16_t len) {
+    if (rx)
+      memset(rx, 0xff, len);
+  }
+
+
+  async command uint32_t SDraw.blocks() {
+    return sdc.blocks;
+  }
+
+
+  async command bool SDraw.erase_state() {
+    return SD_EMU_ERASE_STATE;
+  }
+
+
+  bool chk_buffer(uint8_t *sd_buf, uint8_t val) {
+    uint16_t i;
+
+    for (i = 0; i < SD_BLOCKSIZE; i++)
+      if (sd_buf[i] != val)
+        return FALSE;
+    return TRUE;
+  }
+
+
+  async command bool SDraw.chk_zero(uint8_t *sd_buf) {
+    return chk_buffer(sd_buf, 0);
+  }
+
+
+  async command bool SDraw.chk_erased(uint8_t *sd_buf) {
+    return chk_buffer(sd_buf, SD_EMU_ERASE_STATE);
+  }
+
+
+  async command bool SDraw.zero_fill(uint8_t *sd_buf, uint32_t offset) {
+    if (offset >= SD_BLOCKSIZE)
+      return FALSE;
+    memset(sd_buf + offset, 0, SD_BLOCKSIZE - offset);
+    return TRUE;
+  }
+
+
+  /* powered, SDHC, 3.2-3.4V */
+  command uint32_t SDraw.ocr() {
+    return 0xC0300000;
+  }
+
+
+  command error_t SDraw.cid(uint8_t *buf) {
+    memset(buf, 0, 16);
+    return SUCCESS;
+  }
+
+
+  command error_t SDraw.csd(uint8_t *buf) {
+    memset(buf, 0, 16);
+    return SUCCESS;
+  }
+
+
+  command error_t SDraw.scr(uint8_t *buf) {
+    memset(buf, 0, 8);
+    return SUCCESS;
+  }
+
+
+  default event void   SDread.readDone[uint8_t cid](uint32_t blk_id, uint8_t *buf, error_t error) {
+    sd_panic(68, cid);
+  }
+
+  default event void SDwrite.writeDone[uint8_t cid](uint32_t blk, uint8_t *buf, error_t error) {
+    sd_panic(69, cid);
+  }
+
+  default event void SDerase.eraseDone[uint8_t cid](uint32_t blk_start, uint32_t blk_end, error_t error) {
+    sd_panic(70, cid);
+  }
+
+  async event void Panic.hook() { }
+}
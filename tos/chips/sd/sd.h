@@ -36,10 +36,8 @@
  * all data transfers to/from the SD include a 2 byte crc.
  * This CRC is handled outside of the buffer traffic itself.
  *
- * We currently do not know what byte order the CRC is transmitted in
- * didn't find it in the spec.  We currently don't check it and when
- * writing we fake it.  This will have to be sorted out (obviously) if we
- * turn CRCs on.
+ * The CRC is CRC-ITU16 and is transmitted big endian.  See sd_crc.h.
+ * Checking (and CMD59) only happens with SD_CRC_ENABLE.
  */
 
 /*
@@ -15,21 +15,40 @@ configuration TagnetC {
   }
   uses {
     interface      TagnetSysExecAdapter                     as SysActive;
+    interface             TagnetAdapter<uint32_t>           as DblkCacheMisses;
+    interface             TagnetAdapter<uint32_t>           as DblkCacheFillMax;
+    interface             TagnetAdapter<uint32_t>           as DblkOldestOffset;
+    interface             TagnetAdapter<uint32_t>           as DblkOldestRecnum;
+    interface             TagnetAdapter<uint32_t>           as DblkCommittedOffset;
+    interface             TagnetAdapter<uint32_t>           as DblkDropNorm;
+    interface             TagnetAdapter<uint32_t>           as DblkDropBulk;
+    interface             TagnetAdapter<uint32_t>           as DblkCacheHits;
+    interface      TagnetSysExecAdapter                     as SysNIB;
+    interface      TagnetSysExecAdapter                     as SysRunning;
     interface      TagnetSysExecAdapter                     as SysBackup;
-    interface             TagnetAdapter<tagnet_file_bytes_t>  as PanicBytes;
     interface      TagnetSysExecAdapter                     as SysGolden;
-    interface      TagnetSysExecAdapter                     as SysNIB;
+    interface             TagnetAdapter<uint32_t>           as DblkEraseWin;
+    interface             TagnetAdapter<uint32_t>           as SswGroup;
+    interface             TagnetAdapter<tagnet_file_bytes_t>  as PanicBytes;
+    interface             TagnetAdapter<int32_t>            as PollCount;
+    interface             TagnetAdapter<message_t>          as PollEvent;
+    interface             TagnetAdapter<tagnet_gps_xyz_t>   as InfoSensGpsXyz;
+    interface             TagnetAdapter<uint32_t>           as SDHold;
+    interface             TagnetAdapter<uint32_t>           as GpsFilter;
     interface             TagnetAdapter<tagnet_gps_cmd_t>   as InfoSensGpsCmd;
-    interface             TagnetAdapter<tagnet_dblk_note_t>  as DblkNote;
     interface             TagnetAdapter<tagnet_file_bytes_t>  as DblkBytes;
-    interface             TagnetAdapter<uint32_t>           as DblkLastRecOffset;
     interface             TagnetAdapter<uint32_t>           as DblkLastRecNum;
-    interface             TagnetAdapter<uint32_t>           as DblkCommittedOffset;
+    interface             TagnetAdapter<tagnet_dblk_note_t>  as DblkNote;
     interface             TagnetAdapter<uint32_t>           as DblkLastSyncOffset;
-    interface      TagnetSysExecAdapter                     as SysRunning;
-    interface             TagnetAdapter<int32_t>            as PollCount;
-    interface             TagnetAdapter<message_t>          as PollEvent;
-    interface             TagnetAdapter<tagnet_gps_xyz_t>   as InfoSensGpsXyz;
+    interface             TagnetAdapter<uint32_t>           as DblkLastRecOffset;
+    interface             TagnetAdapter<uint32_t>           as SswMaxFull;
+    interface             TagnetAdapter<uint32_t>           as SswBufs;
+    interface             TagnetAdapter<uint32_t>           as DblkDropDtype;
+    interface             TagnetAdapter<uint32_t>           as DblkUsecs;
+    interface             TagnetAdapter<uint32_t>           as DblkFindAgo;
+    interface             TagnetAdapter<uint32_t>           as DblkFindRec;
+    interface             TagnetAdapter<uint32_t>           as SswLatP95;
+    interface             TagnetAdapter<uint32_t>           as SswLatP50;
   }
 }
 implementation {
@@ -50,24 +69,43 @@ implementation {
     components new      TagnetNameElementP (TN_8_ID,TN_8_UQ)   as    tn_8_Vx;
     components new    TagnetGpsXyzAdapterP ( TN_9_ID  )        as    tn_9_Vx;
     components new  TagnetFileByteAdapterP ( TN_10_ID )        as   tn_10_Vx;
-    components new      TagnetNameElementP (TN_11_ID,TN_11_UQ) as   tn_11_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_11_ID )        as   tn_11_Vx;
     components new      TagnetNameElementP (TN_12_ID,TN_12_UQ) as   tn_12_Vx;
     components new      TagnetNameElementP (TN_13_ID,TN_13_UQ) as   tn_13_Vx;
-    components new  TagnetFileByteAdapterP ( TN_14_ID )        as   tn_14_Vx;
+    components new      TagnetNameElementP (TN_14_ID,TN_14_UQ) as   tn_14_Vx;
     components new  TagnetFileByteAdapterP ( TN_15_ID )        as   tn_15_Vx;
-    components new  TagnetUnsignedAdapterP ( TN_16_ID )        as   tn_16_Vx;
+    components new  TagnetFileByteAdapterP ( TN_16_ID )        as   tn_16_Vx;
     components new  TagnetUnsignedAdapterP ( TN_17_ID )        as   tn_17_Vx;
     components new  TagnetUnsignedAdapterP ( TN_18_ID )        as   tn_18_Vx;
     components new  TagnetUnsignedAdapterP ( TN_19_ID )        as   tn_19_Vx;
-    components new     TagnetImageAdapterP ( TN_20_ID )        as   tn_20_Vx;
-    components new      TagnetNameElementP (TN_21_ID,TN_21_UQ) as   tn_21_Vx;
-    components new  TagnetFileByteAdapterP ( TN_22_ID )        as   tn_22_Vx;
-    components new      TagnetNameElementP (TN_23_ID,TN_23_UQ) as   tn_23_Vx;
-    components new   TagnetSysExecAdapterP ( TN_24_ID )        as   tn_24_Vx;
-    components new   TagnetSysExecAdapterP ( TN_25_ID )        as   tn_25_Vx;
-    components new   TagnetSysExecAdapterP ( TN_26_ID )        as   tn_26_Vx;
-    components new   TagnetSysExecAdapterP ( TN_27_ID )        as   tn_27_Vx;
-    components new   TagnetSysExecAdapterP ( TN_28_ID )        as   tn_28_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_20_ID )        as   tn_20_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_21_ID )        as   tn_21_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_22_ID )        as   tn_22_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_23_ID )        as   tn_23_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_24_ID )        as   tn_24_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_25_ID )        as   tn_25_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_26_ID )        as   tn_26_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_27_ID )        as   tn_27_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_28_ID )        as   tn_28_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_29_ID )        as   tn_29_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_30_ID )        as   tn_30_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_31_ID )        as   tn_31_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_32_ID )        as   tn_32_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_33_ID )        as   tn_33_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_34_ID )        as   tn_34_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_35_ID )        as   tn_35_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_36_ID )        as   tn_36_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_37_ID )        as   tn_37_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_38_ID )        as   tn_38_Vx;
+    components new     TagnetImageAdapterP ( TN_39_ID )        as   tn_39_Vx;
+    components new      TagnetNameElementP (TN_40_ID,TN_40_UQ) as   tn_40_Vx;
+    components new  TagnetFileByteAdapterP ( TN_41_ID )        as   tn_41_Vx;
+    components new      TagnetNameElementP (TN_42_ID,TN_42_UQ) as   tn_42_Vx;
+    components new   TagnetSysExecAdapterP ( TN_43_ID )        as   tn_43_Vx;
+    components new   TagnetSysExecAdapterP ( TN_44_ID )        as   tn_44_Vx;
+    components new   TagnetSysExecAdapterP ( TN_45_ID )        as   tn_45_Vx;
+    components new   TagnetSysExecAdapterP ( TN_46_ID )        as   tn_46_Vx;
+    components new   TagnetSysExecAdapterP ( TN_47_ID )        as   tn_47_Vx;
 
     Tagnet           =     tn_0_Vx;
        tn_1_Vx.Super ->     tn_0_Vx.Sub[unique(TN_0_UQ)];
@@ -84,34 +122,72 @@ implementation {
     InfoSensGpsXyz   =      tn_9_Vx.Adapter;
       tn_10_Vx.Super ->     tn_8_Vx.Sub[unique(TN_8_UQ)];
     InfoSensGpsCmd   =     tn_10_Vx.Adapter;
-      tn_11_Vx.Super ->     tn_2_Vx.Sub[unique(TN_2_UQ)];
-      tn_12_Vx.Super ->    tn_11_Vx.Sub[unique(TN_11_UQ)];
+      tn_11_Vx.Super ->     tn_8_Vx.Sub[unique(TN_8_UQ)];
+    GpsFilter        =     tn_11_Vx.Adapter;
+      tn_12_Vx.Super ->     tn_2_Vx.Sub[unique(TN_2_UQ)];
       tn_13_Vx.Super ->    tn_12_Vx.Sub[unique(TN_12_UQ)];
       tn_14_Vx.Super ->    tn_13_Vx.Sub[unique(TN_13_UQ)];
-    DblkBytes        =     tn_14_Vx.Adapter;
-      tn_15_Vx.Super ->    tn_13_Vx.Sub[unique(TN_13_UQ)];
-    DblkNote         =     tn_15_Vx.Adapter;
-      tn_16_Vx.Super ->    tn_13_Vx.Sub[unique(TN_13_UQ)];
-    DblkLastRecNum   =     tn_16_Vx.Adapter;
-      tn_17_Vx.Super ->    tn_13_Vx.Sub[unique(TN_13_UQ)];
-    DblkLastRecOffset  =     tn_17_Vx.Adapter;
-      tn_18_Vx.Super ->    tn_13_Vx.Sub[unique(TN_13_UQ)];
-    DblkLastSyncOffset  =     tn_18_Vx.Adapter;
-      tn_19_Vx.Super ->    tn_13_Vx.Sub[unique(TN_13_UQ)];
-    DblkCommittedOffset  =     tn_19_Vx.Adapter;
-      tn_20_Vx.Super ->    tn_12_Vx.Sub[unique(TN_12_UQ)];
-      tn_21_Vx.Super ->    tn_12_Vx.Sub[unique(TN_12_UQ)];
-      tn_22_Vx.Super ->    tn_21_Vx.Sub[unique(TN_21_UQ)];
-    PanicBytes       =     tn_22_Vx.Adapter;
-      tn_23_Vx.Super ->     tn_2_Vx.Sub[unique(TN_2_UQ)];
-      tn_24_Vx.Super ->    tn_23_Vx.Sub[unique(TN_23_UQ)];
-    SysActive        =     tn_24_Vx.Adapter;
-      tn_25_Vx.Super ->    tn_23_Vx.Sub[unique(TN_23_UQ)];
-    SysBackup        =     tn_25_Vx.Adapter;
-      tn_26_Vx.Super ->    tn_23_Vx.Sub[unique(TN_23_UQ)];
-    SysGolden        =     tn_26_Vx.Adapter;
-      tn_27_Vx.Super ->    tn_23_Vx.Sub[unique(TN_23_UQ)];
-    SysNIB           =     tn_27_Vx.Adapter;
-      tn_28_Vx.Super ->    tn_23_Vx.Sub[unique(TN_23_UQ)];
-    SysRunning       =     tn_28_Vx.Adapter;
+      tn_15_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkBytes        =     tn_15_Vx.Adapter;
+      tn_16_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkNote         =     tn_16_Vx.Adapter;
+      tn_17_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkLastRecNum   =     tn_17_Vx.Adapter;
+      tn_18_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkLastRecOffset  =     tn_18_Vx.Adapter;
+      tn_19_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkLastSyncOffset  =     tn_19_Vx.Adapter;
+      tn_20_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkCommittedOffset  =     tn_20_Vx.Adapter;
+      tn_21_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkDropNorm     =     tn_21_Vx.Adapter;
+      tn_22_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkDropBulk     =     tn_22_Vx.Adapter;
+      tn_23_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkCacheHits    =     tn_23_Vx.Adapter;
+      tn_24_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkCacheMisses  =     tn_24_Vx.Adapter;
+      tn_25_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkCacheFillMax  =     tn_25_Vx.Adapter;
+      tn_26_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkOldestOffset  =     tn_26_Vx.Adapter;
+      tn_27_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkOldestRecnum  =     tn_27_Vx.Adapter;
+      tn_28_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkEraseWin     =     tn_28_Vx.Adapter;
+      tn_29_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    SswGroup         =     tn_29_Vx.Adapter;
+      tn_30_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    SswBufs          =     tn_30_Vx.Adapter;
+      tn_31_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    SswMaxFull       =     tn_31_Vx.Adapter;
+      tn_32_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    SswLatP50        =     tn_32_Vx.Adapter;
+      tn_33_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    SswLatP95        =     tn_33_Vx.Adapter;
+      tn_34_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkFindRec      =     tn_34_Vx.Adapter;
+      tn_35_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkFindAgo      =     tn_35_Vx.Adapter;
+      tn_36_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkUsecs        =     tn_36_Vx.Adapter;
+      tn_37_Vx.Super ->    tn_14_Vx.Sub[unique(TN_14_UQ)];
+    DblkDropDtype    =     tn_37_Vx.Adapter;
+      tn_38_Vx.Super ->    tn_13_Vx.Sub[unique(TN_13_UQ)];
+    SDHold           =     tn_38_Vx.Adapter;
+      tn_39_Vx.Super ->    tn_13_Vx.Sub[unique(TN_13_UQ)];
+      tn_40_Vx.Super ->    tn_13_Vx.Sub[unique(TN_13_UQ)];
+      tn_41_Vx.Super ->    tn_40_Vx.Sub[unique(TN_40_UQ)];
+    PanicBytes       =     tn_41_Vx.Adapter;
+      tn_42_Vx.Super ->     tn_2_Vx.Sub[unique(TN_2_UQ)];
+      tn_43_Vx.Super ->    tn_42_Vx.Sub[unique(TN_42_UQ)];
+    SysActive        =     tn_43_Vx.Adapter;
+      tn_44_Vx.Super ->    tn_42_Vx.Sub[unique(TN_42_UQ)];
+    SysBackup        =     tn_44_Vx.Adapter;
+      tn_45_Vx.Super ->    tn_42_Vx.Sub[unique(TN_42_UQ)];
+    SysGolden        =     tn_45_Vx.Adapter;
+      tn_46_Vx.Super ->    tn_42_Vx.Sub[unique(TN_42_UQ)];
+    SysNIB           =     tn_46_Vx.Adapter;
+      tn_47_Vx.Super ->    tn_42_Vx.Sub[unique(TN_42_UQ)];
+    SysRunning       =     tn_47_Vx.Adapter;
 }
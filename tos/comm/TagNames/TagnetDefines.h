@@ -12,25 +12,44 @@ typedef enum {                   //      (parent) name
   TN_8_ID               =     8, //  (   sens   ) gps
   TN_9_ID               =     9, //  (   gps    ) xyz
   TN_10_ID              =    10, //  (   gps    ) cmd
-  TN_11_ID              =    11, //  (   tag    ) sd
-  TN_12_ID              =    12, //  (    sd    ) 0
-  TN_13_ID              =    13, //  (    0     ) dblk
-  TN_14_ID              =    14, //  (   dblk   ) byte
-  TN_15_ID              =    15, //  (   dblk   ) note
-  TN_16_ID              =    16, //  (   dblk   ) .recnum
-  TN_17_ID              =    17, //  (   dblk   ) .last_rec
-  TN_18_ID              =    18, //  (   dblk   ) .last_sync
-  TN_19_ID              =    19, //  (   dblk   ) .committed
-  TN_20_ID              =    20, //  (    0     ) img
-  TN_21_ID              =    21, //  (    0     ) panic
-  TN_22_ID              =    22, //  (  panic   ) byte
-  TN_23_ID              =    23, //  (   tag    ) sys
-  TN_24_ID              =    24, //  (   sys    ) active
-  TN_25_ID              =    25, //  (   sys    ) backup
-  TN_26_ID              =    26, //  (   sys    ) golden
-  TN_27_ID              =    27, //  (   sys    ) nib
-  TN_28_ID              =    28, //  (   sys    ) running
-  TN_LAST_ID            =    29,
+  TN_11_ID              =    11, //  (   gps    ) .filter
+  TN_12_ID              =    12, //  (   tag    ) sd
+  TN_13_ID              =    13, //  (    sd    ) 0
+  TN_14_ID              =    14, //  (    0     ) dblk
+  TN_15_ID              =    15, //  (   dblk   ) byte
+  TN_16_ID              =    16, //  (   dblk   ) note
+  TN_17_ID              =    17, //  (   dblk   ) .recnum
+  TN_18_ID              =    18, //  (   dblk   ) .last_rec
+  TN_19_ID              =    19, //  (   dblk   ) .last_sync
+  TN_20_ID              =    20, //  (   dblk   ) .committed
+  TN_21_ID              =    21, //  (   dblk   ) .drop_norm
+  TN_22_ID              =    22, //  (   dblk   ) .drop_bulk
+  TN_23_ID              =    23, //  (   dblk   ) .cache_hits
+  TN_24_ID              =    24, //  (   dblk   ) .cache_misses
+  TN_25_ID              =    25, //  (   dblk   ) .fill_max
+  TN_26_ID              =    26, //  (   dblk   ) .oldest
+  TN_27_ID              =    27, //  (   dblk   ) .oldest_rec
+  TN_28_ID              =    28, //  (   dblk   ) .erase_win
+  TN_29_ID              =    29, //  (   dblk   ) .ssw_group
+  TN_30_ID              =    30, //  (   dblk   ) .ssw_bufs
+  TN_31_ID              =    31, //  (   dblk   ) .ssw_max_full
+  TN_32_ID              =    32, //  (   dblk   ) .ssw_p50
+  TN_33_ID              =    33, //  (   dblk   ) .ssw_p95
+  TN_34_ID              =    34, //  (   dblk   ) .find_rec
+  TN_35_ID              =    35, //  (   dblk   ) .find_ago
+  TN_36_ID              =    36, //  (   dblk   ) .usecs
+  TN_37_ID              =    37, //  (   dblk   ) .drop_dtype
+  TN_38_ID              =    38, //  (    0     ) .hold
+  TN_39_ID              =    39, //  (    0     ) img
+  TN_40_ID              =    40, //  (    0     ) panic
+  TN_41_ID              =    41, //  (  panic   ) byte
+  TN_42_ID              =    42, //  (   tag    ) sys
+  TN_43_ID              =    43, //  (   sys    ) active
+  TN_44_ID              =    44, //  (   sys    ) backup
+  TN_45_ID              =    45, //  (   sys    ) golden
+  TN_46_ID              =    46, //  (   sys    ) nib
+  TN_47_ID              =    47, //  (   sys    ) running
+  TN_LAST_ID            =    48,
   TN_ROOT_ID            =     0,
   TN_MAX_ID             =  65000,
 } tn_ids_t;
@@ -64,6 +83,25 @@ typedef enum {                   //      (parent) name
 #define  TN_26_UQ                "TN_26_UQ"
 #define  TN_27_UQ                "TN_27_UQ"
 #define  TN_28_UQ                "TN_28_UQ"
+#define  TN_29_UQ                "TN_29_UQ"
+#define  TN_30_UQ                "TN_30_UQ"
+#define  TN_31_UQ                "TN_31_UQ"
+#define  TN_32_UQ                "TN_32_UQ"
+#define  TN_33_UQ                "TN_33_UQ"
+#define  TN_34_UQ                "TN_34_UQ"
+#define  TN_35_UQ                "TN_35_UQ"
+#define  TN_36_UQ                "TN_36_UQ"
+#define  TN_37_UQ                "TN_37_UQ"
+#define  TN_38_UQ                "TN_38_UQ"
+#define  TN_39_UQ                "TN_39_UQ"
+#define  TN_40_UQ                "TN_40_UQ"
+#define  TN_41_UQ                "TN_41_UQ"
+#define  TN_42_UQ                "TN_42_UQ"
+#define  TN_43_UQ                "TN_43_UQ"
+#define  TN_44_UQ                "TN_44_UQ"
+#define  TN_45_UQ                "TN_45_UQ"
+#define  TN_46_UQ                "TN_46_UQ"
+#define  TN_47_UQ                "TN_47_UQ"
 #define UQ_TAGNET_ADAPTER_LIST  "UQ_TAGNET_ADAPTER_LIST"
 #define UQ_TN_ROOT               TN_0_UQ
 /* structure used to hold configuration values for each of the elements
@@ -88,23 +126,42 @@ const TN_data_t tn_name_data_descriptors[TN_LAST_ID]={
   { TN_8_ID, "\01\03gps", "\01\04help", TN_8_UQ },
   { TN_9_ID, "\01\03xyz", "\01\04help", TN_9_UQ },
   { TN_10_ID, "\01\03cmd", "\01\04help", TN_10_UQ },
-  { TN_11_ID, "\01\02sd", "\01\04help", TN_11_UQ },
-  { TN_12_ID, "\02\01\00", "\01\04help", TN_12_UQ },
-  { TN_13_ID, "\01\04dblk", "\01\04help", TN_13_UQ },
-  { TN_14_ID, "\01\04byte", "\01\04help", TN_14_UQ },
-  { TN_15_ID, "\01\04note", "\01\04help", TN_15_UQ },
-  { TN_16_ID, "\01\07.recnum", "\01\04help", TN_16_UQ },
-  { TN_17_ID, "\01\011.last_rec", "\01\04help", TN_17_UQ },
-  { TN_18_ID, "\01\012.last_sync", "\01\04help", TN_18_UQ },
-  { TN_19_ID, "\01\012.committed", "\01\04help", TN_19_UQ },
-  { TN_20_ID, "\01\03img", "\01\04help", TN_20_UQ },
-  { TN_21_ID, "\01\05panic", "\01\04help", TN_21_UQ },
-  { TN_22_ID, "\01\04byte", "\01\04help", TN_22_UQ },
-  { TN_23_ID, "\01\03sys", "\01\04help", TN_23_UQ },
-  { TN_24_ID, "\01\06active", "\01\04help", TN_24_UQ },
-  { TN_25_ID, "\01\06backup", "\01\04help", TN_25_UQ },
-  { TN_26_ID, "\01\06golden", "\01\04help", TN_26_UQ },
-  { TN_27_ID, "\01\03nib", "\01\04help", TN_27_UQ },
-  { TN_28_ID, "\01\07running", "\01\04help", TN_28_UQ },
+  { TN_11_ID, "\01\07.filter", "\01\04help", TN_11_UQ },
+  { TN_12_ID, "\01\02sd", "\01\04help", TN_12_UQ },
+  { TN_13_ID, "\02\01\00", "\01\04help", TN_13_UQ },
+  { TN_14_ID, "\01\04dblk", "\01\04help", TN_14_UQ },
+  { TN_15_ID, "\01\04byte", "\01\04help", TN_15_UQ },
+  { TN_16_ID, "\01\04note", "\01\04help", TN_16_UQ },
+  { TN_17_ID, "\01\07.recnum", "\01\04help", TN_17_UQ },
+  { TN_18_ID, "\01\011.last_rec", "\01\04help", TN_18_UQ },
+  { TN_19_ID, "\01\012.last_sync", "\01\04help", TN_19_UQ },
+  { TN_20_ID, "\01\012.committed", "\01\04help", TN_20_UQ },
+  { TN_21_ID, "\01\012.drop_norm", "\01\04help", TN_21_UQ },
+  { TN_22_ID, "\01\012.drop_bulk", "\01\04help", TN_22_UQ },
+  { TN_23_ID, "\01\013.cache_hits", "\01\04help", TN_23_UQ },
+  { TN_24_ID, "\01\015.cache_misses", "\01\04help", TN_24_UQ },
+  { TN_25_ID, "\01\011.fill_max", "\01\04help", TN_25_UQ },
+  { TN_26_ID, "\01\07.oldest", "\01\04help", TN_26_UQ },
+  { TN_27_ID, "\01\013.oldest_rec", "\01\04help", TN_27_UQ },
+  { TN_28_ID, "\01\012.erase_win", "\01\04help", TN_28_UQ },
+  { TN_29_ID, "\01\012.ssw_group", "\01\04help", TN_29_UQ },
+  { TN_30_ID, "\01\011.ssw_bufs", "\01\04help", TN_30_UQ },
+  { TN_31_ID, "\01\015.ssw_max_full", "\01\04help", TN_31_UQ },
+  { TN_32_ID, "\01\010.ssw_p50", "\01\04help", TN_32_UQ },
+  { TN_33_ID, "\01\010.ssw_p95", "\01\04help", TN_33_UQ },
+  { TN_34_ID, "\01\011.find_rec", "\01\04help", TN_34_UQ },
+  { TN_35_ID, "\01\011.find_ago", "\01\04help", TN_35_UQ },
+  { TN_36_ID, "\01\06.usecs", "\01\04help", TN_36_UQ },
+  { TN_37_ID, "\01\013.drop_dtype", "\01\04help", TN_37_UQ },
+  { TN_38_ID, "\01\05.hold", "\01\04help", TN_38_UQ },
+  { TN_39_ID, "\01\03img", "\01\04help", TN_39_UQ },
+  { TN_40_ID, "\01\05panic", "\01\04help", TN_40_UQ },
+  { TN_41_ID, "\01\04byte", "\01\04help", TN_41_UQ },
+  { TN_42_ID, "\01\03sys", "\01\04help", TN_42_UQ },
+  { TN_43_ID, "\01\06active", "\01\04help", TN_43_UQ },
+  { TN_44_ID, "\01\06backup", "\01\04help", TN_44_UQ },
+  { TN_45_ID, "\01\06golden", "\01\04help", TN_45_UQ },
+  { TN_46_ID, "\01\03nib", "\01\04help", TN_46_UQ },
+  { TN_47_ID, "\01\07running", "\01\04help", TN_47_UQ },
 };
 
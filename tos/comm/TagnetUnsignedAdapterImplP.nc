@@ -54,6 +54,19 @@ implementation {
           }
           return TRUE;
           break;
+        case TN_PUT:
+          tn_trace_rec(my_id, 4);
+          this_tlv = call TPload.first_element(msg);
+          if (this_tlv && call TTLV.get_tlv_type(this_tlv) == TN_TLV_INTEGER) {
+            v = call TTLV.tlv_to_integer(this_tlv);
+            l = sizeof(v);
+            if (call Adapter.set_value(&v, &l)) {
+              call TPload.reset_payload(msg);
+              call TPload.add_integer(msg, v);
+              return TRUE;
+            }
+          }
+          break;                        /* not settable, no match */
         case TN_HEAD:
           tn_trace_rec(my_id, 3);
           call TPload.reset_payload(msg);                // no params
@@ -20,6 +20,7 @@
  */
 
 #include <typed_data.h>
+#include <collect.h>
 
 interface Collect {
   command void collect(dt_header_t *header, uint16_t hlen,
@@ -30,4 +31,22 @@ interface Collect {
                             uint8_t     *data,   uint16_t dlen);
 
   async command uint32_t buf_offset();
+
+  /*
+   * zero copy record reservation, see collect.h
+   *
+   * reserve space for a record of hlen + dlen bytes directly in the SSW
+   * buffers.  Only one reservation can be outstanding and it must be
+   * committed before anything else is collected.  reserve and commit
+   * must be called from the same task (no intervening task boundary).
+   *
+   * commit fills in recnum, systime, and recsum.
+   * commit_nots fills in recnum and recsum.  systime is filled by caller.
+   *
+   * reserve returns NULL if the record has been shed (no buffer space,
+   * see collect.h).  Nothing is outstanding and commit must not be called.
+   */
+  command dc_resv_t *reserve(dtype_t dtype, uint16_t hlen, uint16_t dlen);
+  command void       commit();
+  command void       commit_nots();
 }
@@ -24,10 +24,16 @@ configuration CollectC {
     interface Boot as Booted;           /* out boot */
     interface Collect;
     interface CollectEvent;
+    interface CollectIndex;
+    interface CollectFlush;
     interface TagnetAdapter<uint32_t> as DblkLastRecNum;
     interface TagnetAdapter<uint32_t> as DblkLastRecOffset;
     interface TagnetAdapter<uint32_t> as DblkLastSyncOffset;
     interface TagnetAdapter<uint32_t> as DblkCommittedOffset;
+    interface TagnetAdapter<uint32_t> as DblkDropNorm;
+    interface TagnetAdapter<uint32_t> as DblkDropBulk;
+    interface TagnetAdapter<uint32_t> as DblkDropDtype;
+    interface TagnetAdapter<uint32_t> as DblkUsecs;
   }
   uses     interface Boot;              /* in  boot */
 }
@@ -41,12 +47,18 @@ implementation {
   Booted       = CollectP;
   Collect      = CollectP;
   CollectEvent = CollectP;
+  CollectIndex = CollectP;
+  CollectFlush = CollectP;
   Boot         = CollectP.Boot;
 
   DblkLastRecNum      = CollectP.DblkLastRecNum;
   DblkLastRecOffset   = CollectP.DblkLastRecOffset;
   DblkLastSyncOffset  = CollectP.DblkLastSyncOffset;
   DblkCommittedOffset = CollectP.DblkCommittedOffset;
+  DblkDropNorm        = CollectP.DblkDropNorm;
+  DblkDropBulk        = CollectP.DblkDropBulk;
+  DblkDropDtype       = CollectP.DblkDropDtype;
+  DblkUsecs           = CollectP.DblkUsecs;
 
   components new TimerMilliC() as SyncTimerC;
   CollectP.SyncTimer -> SyncTimerC;
@@ -69,4 +81,5 @@ implementation {
 
   components PlatformC;
   CollectP.SysReboot -> PlatformC;
+  CollectP.Platform  -> PlatformC;
 }
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+#include <typed_data.h>
+
+/*
+ * For producers that hold a record back while they build it (ie. the
+ * GPS track).  Collect tells them when to let go of it so it lands in
+ * front of the next SYNC and isn't lost across a reboot.
+ */
+
+interface CollectFlush {
+  /*
+   * flush: a SYNC is about to go down (task level).  Hand anything
+   * pending to Collect.collect/collect_nots now.
+   */
+  event void flush();
+
+  /*
+   * shutdown: the system is going down (SysReboot.shutdown_flush).  No
+   * more buffers, no more tasks.  The only way out is shutdown_collect
+   * which lays the record into what is left of the current buffer,
+   * leaving room for the last SYNC.  Caller fills in systime.
+   *
+   * returns FALSE if the record didn't fit, it is counted as a drop.
+   */
+  async event void shutdown();
+  async command bool shutdown_collect(dt_header_t *header, uint16_t hlen,
+                                      uint8_t     *data,   uint16_t dlen);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * CollectIndex: the part of the DT_INDEX tree (see typed_data.h) that
+ * Collect is still holding in RAM.
+ *
+ * pending: entries at level that haven't been laid down in a DT_INDEX
+ *          record yet, oldest first.  returns how many, *entp is set
+ *          to the first.
+ * last:    file offset of the last DT_INDEX laid down at level this
+ *          boot, 0 if none.
+ *
+ * Entry offsets are the low word (typed_data.h, DT_OFF64), last() is
+ * all 64 bits.
+ *
+ * Pending entries at a level are newer than anything covered by the
+ * level above.  Searching the top level first and working down visits
+ * the pending entries oldest to newest.
+ */
+
+#include <typed_data.h>
+
+interface CollectIndex {
+  command uint8_t  pending(uint8_t level, dt_index_ent_t **entp);
+  command uint64_t last(uint8_t level);
+}
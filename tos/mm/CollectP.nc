@@ -54,15 +54,33 @@
  * a fail safe, we also start a timer after any SYNC as been written.  If
  * the timer expires, we lay down a SYNC.
  *
+ * Producers that hold a record back while building it (GPS track) are
+ * told via CollectFlush.flush before each SYNC, and CollectFlush.shutdown
+ * on the way down, so what they have lands before the SYNC.
+ *
  * Collect is responsible for managing prev_sync file offsets.  This a
  * combination of blk_id and byte offset within the buffer of the SYNC or
- * REBOOT being lay'd down.
+ * REBOOT being lay'd down.  File offsets are 64 bits, records get the
+ * low word (and prev_sync_hi, see typed_data.h).
+ *
+ * Collect also builds the sparse index (DT_INDEX, see typed_data.h).
+ * Every SYNC/REBOOT becomes a level 0 entry.  When a level has
+ * DT_INDEX_FAN entries they are laid down as a DT_INDEX record, which in
+ * turn becomes an entry one level up.  The top level is laid down and
+ * chained via prev_index.  What hasn't been laid down yet is handed out
+ * via CollectIndex (DblkIndexP does the lookups).
+ *
+ * usecs: with dcc.usecs on (Tagnet .usecs, default DC_USECS) ordinary
+ * records get a dt_usecs_t trailer holding Platform.usecsRaw and
+ * DT_F_USECS in dtype (see typed_data.h).  Collect adds it, producers
+ * don't know about it.  The CRIT records never get one.
  */
 
 #include <typed_data.h>
 #include <image_info.h>
 #include <overwatch.h>
 #include <stream_storage.h>
+#include <collect.h>
 #include <sd.h>
 
 /*
@@ -80,7 +98,23 @@
  * last_rec_offset:     file offset of last record laid down
  * last_sync_offset:    file offset of last REBOOT/SYNC laid down
  * bufs_to_next_sync:   number of buffers/sectors before we do next sync
-
+ *
+ * resv:                current zero copy reservation (see collect.h)
+ * resv_pending:        TRUE if reserve has been called, waiting on commit
+ * resv_offset:         file offset of the reserved record
+ * resv_hlen/dlen:      header and data size of the reserved record
+ * hfrag/hflen:         if the header was staged, where it gets scattered
+ *                      to on commit.  hfrag[1] NULL if not split.
+ * resv_tlen:           size of the usecs trailer reserved, 0 if none.
+ * tfrag/tflen:         where the trailer goes, can be split too.
+ *
+ * usecs:               lay usecs trailers on ordinary records.
+ *
+ * chksum:              running recsum of the record being copied out.
+ *
+ * sync_drops:          records shed, by priority, since the last SYNC.
+ * drops:               records shed, by priority, since boot.
+ *
  * DblkManager is responsible for keeping track of where in the Data Stream
  * we are.
  */
@@ -93,10 +127,27 @@ typedef struct {
   uint8_t     *cur_ptr;
 
   uint32_t     cur_recnum;              /* last record used */
-  uint32_t     last_rec_offset;         /* file offset */
-  uint32_t     last_sync_offset;        /* file offset */
+  uint64_t     last_rec_offset;         /* file offset */
+  uint64_t     last_sync_offset;        /* file offset */
   uint16_t     bufs_to_next_sync;
 
+  dc_resv_t    resv;
+  bool         resv_pending;
+  uint64_t     resv_offset;
+  uint16_t     resv_hlen;
+  uint16_t     resv_dlen;
+  uint8_t     *hfrag[2];
+  uint16_t     hflen[2];
+  uint16_t     resv_tlen;
+  uint8_t     *tfrag[2];
+  uint16_t     tflen[2];
+
+  uint16_t     chksum;
+  bool         usecs;
+
+  uint16_t     sync_drops[DC_PRI_MAX];
+  uint32_t     drops[DC_PRI_MAX];
+
   uint16_t     majik_b;
 } dc_control_t;
 
@@ -113,11 +164,17 @@ module CollectP {
     interface Collect;
     interface Init;
     interface CollectEvent;
+    interface CollectIndex;
+    interface CollectFlush;
 
     interface TagnetAdapter<uint32_t> as DblkLastRecNum;
     interface TagnetAdapter<uint32_t> as DblkLastRecOffset;
     interface TagnetAdapter<uint32_t> as DblkLastSyncOffset;
     interface TagnetAdapter<uint32_t> as DblkCommittedOffset;
+    interface TagnetAdapter<uint32_t> as DblkDropNorm;
+    interface TagnetAdapter<uint32_t> as DblkDropBulk;
+    interface TagnetAdapter<uint32_t> as DblkDropDtype;
+    interface TagnetAdapter<uint32_t> as DblkUsecs;
   }
   uses {
     interface Boot;                     /* in boot in sequence */
@@ -131,6 +188,7 @@ module CollectP {
     interface DblkManager;
     interface SysReboot @atleastonce();
     interface LocalTime<TMilli>;
+    interface Platform;
   }
 }
 
@@ -138,6 +196,30 @@ implementation {
 
   norace dc_control_t dcc;
 
+  /*
+   * records shed, per dtype, since boot.  Tagnet .drop_dtype, a PUT
+   * selects the dtype (dc_drop_sel), a GET reads its count.
+   */
+  norace uint32_t dc_drops[DT_MAX + 1];
+  norace uint8_t  dc_drop_sel;
+
+  /* staging area for reserved headers that cross a sector boundary */
+  uint8_t dc_hdr_stage[DT_MAX_HEADER] __attribute__ ((aligned (4)));
+
+  /*
+   * sparse index.  entries waiting to be laid down, per level.
+   * dc_idx_last: file offset of the last DT_INDEX per level (chain heads).
+   * dc_idx_prev: file offset of the last DT_INDEX of any level.
+   */
+  dt_index_ent_t dc_idx[DT_INDEX_LEVELS][DT_INDEX_FAN];
+  uint8_t        dc_idx_n[DT_INDEX_LEVELS];
+  uint64_t       dc_idx_last[DT_INDEX_LEVELS];
+  uint64_t       dc_idx_prev;
+
+
+  bool dc_collect_now(dt_header_t *header, uint16_t hlen,
+                      uint8_t     *data,   uint16_t dlen);
+
 
   /*
    * get_rec_offset
@@ -147,11 +229,58 @@ implementation {
    * record offsets.
    */
 
-  uint32_t get_rec_offset() {
+  uint64_t get_rec_offset() {
     return call SS.eof_offset();
   }
 
 
+  /*
+   * index_add: add a SYNC/REBOOT to the sparse index.
+   *
+   * A level that fills is laid down as a DT_INDEX and its first entry,
+   * pointing at the new DT_INDEX, is carried up to the next level.  The
+   * top level is laid down and starts over, its records are chained via
+   * prev_index.
+   */
+  void index_add(uint32_t recnum, uint64_t systime, uint64_t offset) {
+    dt_index_t      i;
+    dt_index_t     *ip;
+    dt_index_ent_t *ep;
+    uint8_t         level;
+
+    ip = &i;
+    for (level = 0; level < DT_INDEX_LEVELS; level++) {
+      ep = &dc_idx[level][dc_idx_n[level]++];
+      ep->systime = systime;
+      ep->recnum  = recnum;
+      ep->offset  = offset;             /* low word */
+      if (dc_idx_n[level] < DT_INDEX_FAN)
+        return;
+
+      ip->len        = sizeof(i) + sizeof(dc_idx[level]);
+      ip->dtype      = DT_INDEX;
+      ip->level      = level;
+      ip->count      = DT_INDEX_FAN;
+      ip->prev_index = dc_idx_last[level];
+      offset = get_rec_offset();
+      if (!dc_collect_now((void *) ip, sizeof(i),
+                          (void *) dc_idx[level], sizeof(dc_idx[level]))) {
+        /*
+         * dropped, out of buffers.  Lose this level's entries rather
+         * than carry them up, lookups fall back to the prev_sync chain.
+         */
+        dc_idx_n[level] = 0;
+        return;
+      }
+      dc_idx_last[level] = offset;
+      dc_idx_prev        = offset;
+      dc_idx_n[level]    = 0;
+      recnum  = dc_idx[level][0].recnum;
+      systime = dc_idx[level][0].systime;
+    }
+  }
+
+
   void write_version_record() {
     dt_version_t  v;
     dt_version_t *vp;
@@ -169,32 +298,49 @@ implementation {
   void write_sync_record() {
     dt_sync_t  s;
     dt_sync_t *sp;
+    uint64_t   offset;
 
     sp = &s;
     sp->len = sizeof(s);
     sp->dtype = DT_SYNC;
     sp->sync_majik = SYNC_MAJIK;
     sp->prev_sync  = dcc.last_sync_offset;
-    dcc.last_sync_offset = get_rec_offset();
-    call Collect.collect((void *) sp, sizeof(dt_sync_t), NULL, 0);
+    sp->prev_sync_hi = dcc.last_sync_offset >> 32;
+    sp->drop_norm  = dcc.sync_drops[DC_PRI_NORM];
+    sp->drop_bulk  = dcc.sync_drops[DC_PRI_BULK];
+    sp->prev_index = dc_idx_prev;
+    offset = get_rec_offset();
+    if (!dc_collect_now((void *) sp, sizeof(dt_sync_t), NULL, 0))
+      return;                           /* dropped, chain stays as is */
+    dcc.sync_drops[DC_PRI_NORM] = 0;
+    dcc.sync_drops[DC_PRI_BULK] = 0;
+    dcc.last_sync_offset = offset;
+    call DblkManager.note_sync(offset, sp->recnum);
+    index_add(sp->recnum, sp->systime, offset);
   }
 
 
   void write_reboot_record() {
     dt_reboot_t  r;
     dt_reboot_t *rp;
+    uint64_t     offset;
 
     rp = &r;
     rp->len = sizeof(r) + sizeof(ow_control_block_t);
     rp->dtype = DT_REBOOT;
     rp->sync_majik = SYNC_MAJIK;
     rp->prev_sync  = dcc.last_sync_offset;
+    rp->prev_sync_hi = dcc.last_sync_offset >> 32;
     rp->dt_h_revision = DT_H_REVISION;  /* which version of typed_data */
     rp->base = call OverWatch.getImageBase();
-    dcc.last_sync_offset = get_rec_offset();
-    call Collect.collect((void *) rp, sizeof(r),
-                         (void *) &ow_control_block,
-                         sizeof(ow_control_block_t));
+    offset = get_rec_offset();
+    if (!dc_collect_now((void *) rp, sizeof(r),
+                        (void *) &ow_control_block,
+                        sizeof(ow_control_block_t)))
+      return;                           /* dropped, keep the owcb copies */
+    dcc.last_sync_offset = offset;
+    call DblkManager.note_sync(offset, rp->recnum);
+    index_add(rp->recnum, rp->systime, offset);
     call OverWatch.clearReset();        /* clears owcb copies */
 
     /* clear resetable faults */
@@ -209,8 +355,14 @@ implementation {
    * This will ALWAYS be the first record written to the very
    * first sector that DblkManager has found for where the Data
    * Stream will restart.
+   *
+   * DblkManager's restart scan tells us where the previous incarnation
+   * left off.  Pick up recnum and the prev_sync chain from there.
    */
   event void Boot.booted() {
+    dcc.cur_recnum       = call DblkManager.get_cur_recnum();
+    dcc.last_rec_offset  = call DblkManager.get_last_rec_offset();
+    dcc.last_sync_offset = call DblkManager.get_last_sync_offset();
     write_reboot_record();
     write_version_record();
     nop();                              /* BRK */
@@ -225,6 +377,7 @@ implementation {
      */
     dcc.bufs_to_next_sync = SYNC_MAX_SECTORS;
     call SyncTimer.stop();
+    signal CollectFlush.flush();        /* held records go first */
     write_sync_record();
     call SyncTimer.startOneShot(SYNC_PERIOD);
   }
@@ -244,6 +397,7 @@ implementation {
     dcc.majik_a = DC_MAJIK;
     dcc.majik_b = DC_MAJIK;
     dcc.bufs_to_next_sync = SYNC_MAX_SECTORS;
+    dcc.usecs = DC_USECS;
     return SUCCESS;
   }
 
@@ -255,6 +409,7 @@ implementation {
   }
 
 
+  /* Tagnet offsets are the low word, see DblkMapFileP */
   command bool DblkLastRecOffset.get_value(uint32_t *t, uint32_t *l) {
     *t = dcc.last_rec_offset;
     *l = 4;
@@ -276,10 +431,55 @@ implementation {
   }
 
 
+  command bool DblkDropNorm.get_value(uint32_t *t, uint32_t *l) {
+    *t = dcc.drops[DC_PRI_NORM];
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool DblkDropBulk.get_value(uint32_t *t, uint32_t *l) {
+    *t = dcc.drops[DC_PRI_BULK];
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool DblkDropDtype.get_value(uint32_t *t, uint32_t *l) {
+    *t = dc_drops[dc_drop_sel];
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool DblkDropDtype.set_value(uint32_t *t, uint32_t *l) {
+    if (*l != 4 || *t > DT_MAX)
+      return FALSE;
+    dc_drop_sel = *t;
+    return TRUE;
+  }
+
+
+  command bool DblkUsecs.get_value(uint32_t *t, uint32_t *l) {
+    *t = dcc.usecs;
+    *l = 4;
+    return 1;
+  }
+
+
+  /* takes effect with the next record, a reservation keeps what it got */
+  command bool DblkUsecs.set_value(uint32_t *t, uint32_t *l) {
+    dcc.usecs = (*t != 0);
+    return TRUE;
+  }
+
+
   command bool DblkLastRecNum.set_value(uint32_t *t, uint32_t *l)      { return FALSE; }
   command bool DblkLastRecOffset.set_value(uint32_t *t, uint32_t *l)   { return FALSE; }
   command bool DblkLastSyncOffset.set_value(uint32_t *t, uint32_t *l)  { return FALSE; }
   command bool DblkCommittedOffset.set_value(uint32_t *t, uint32_t *l) { return FALSE; }
+  command bool DblkDropNorm.set_value(uint32_t *t, uint32_t *l)        { return FALSE; }
+  command bool DblkDropBulk.set_value(uint32_t *t, uint32_t *l)        { return FALSE; }
 
 
   /*
@@ -336,38 +536,172 @@ implementation {
 
 
   /*
+   * fused copy and checksum.
+   *
+   * recsum is a 16 bit sum of all the bytes in the record.  Rather than
+   * making one pass to sum and a second to copy, we sum as we copy, 32
+   * bits at a time.
+   *
+   * Each word is folded into two 16 bit lanes, bytes 0/2 and bytes 1/3,
+   * ((w & 0x00ff00ff) + ((w >> 8) & 0x00ff00ff)).  Each word adds at most
+   * 2 * 255 to a lane.  The copy routines are only ever handed one sector
+   * worth (128 words) at a time, which maxes out at 65280 per lane.  So
+   * the lanes can't carry into each other and we fold them once at the
+   * end.  The byte sum is order independent so the result is bit for bit
+   * identical to summing byte by byte.
+   *
+   * We are little endian (the tag and the host side).
+   */
+  static inline uint32_t sum_fold(uint32_t acc) {
+    return (acc & 0xffff) + (acc >> 16);
+  }
+
+
+  /* dst and src both 32 bit aligned */
+  static uint32_t copy_sum_aligned(uint32_t *dst, uint32_t *src,
+                                   uint16_t nwords) {
+    uint32_t acc, w;
+
+    acc = 0;
+    while (nwords--) {
+      w = *src++;
+      *dst++ = w;
+      acc += (w & 0x00ff00ff) + ((w >> 8) & 0x00ff00ff);
+    }
+    return sum_fold(acc);
+  }
+
+
+  /*
+   * dst 32 bit aligned, src not.
+   *
+   * GPS messages come out of the gps_buf with no particular alignment.
+   * Rather than going byte by byte, do aligned word fetches from the
+   * source and shift/merge into the aligned destination.
+   *
+   * The last fetch can read up to 3 bytes past the end of src.  Those
+   * bytes live in the same aligned word as the last source byte so can
+   * never fault.
+   */
+  static uint32_t copy_sum_unaligned(uint32_t *dst, uint8_t *src,
+                                     uint16_t nwords) {
+    uint32_t *sp;
+    uint32_t  acc, w, cur, nxt;
+    unsigned int rs, ls;
+
+    acc = 0;
+    rs = ((uint32_t) src & 0x03) * 8;
+    ls = 32 - rs;
+    sp = (void *) ((uintptr_t) src & ~0x03);
+    cur = *sp++;
+    while (nwords--) {
+      nxt = *sp++;
+      w = (cur >> rs) | (nxt << ls);
+      *dst++ = w;
+      acc += (w & 0x00ff00ff) + ((w >> 8) & 0x00ff00ff);
+      cur = nxt;
+    }
+    return sum_fold(acc);
+  }
+
+
+  /*
+   * sum only, for bytes already in place (reserve/commit).  Same lanes
+   * as the copy routines, bytes before the first aligned word and after
+   * the last are summed separately so they can't overflow the lanes.
+   * len is at most a sector (a header or one data fragment).
+   */
+  static uint16_t sum_block(uint8_t *ptr, uint16_t len) {
+    uint32_t *wp;
+    uint32_t  acc, w;
+    uint16_t  bsum, nw;
+
+    bsum = 0;
+    while (len && ((uint32_t) ptr & 0x03)) {
+      bsum += *ptr++;
+      len--;
+    }
+    acc = 0;
+    wp  = (void *) ptr;
+    for (nw = len >> 2; nw; nw--) {
+      w = *wp++;
+      acc += (w & 0x00ff00ff) + ((w >> 8) & 0x00ff00ff);
+    }
+    ptr = (void *) wp;
+    len &= 0x03;
+    while (len--)
+      bsum += *ptr++;
+    return bsum + sum_fold(acc);
+  }
+
+
+  /*
+   * copy what fits into the current sector and add into the running
+   * record checksum (dcc.chksum).
+   *
    * returns amount actually copied
    */
   static uint16_t copy_block_out(uint8_t *data, uint16_t dlen) {
     uint8_t  *ptr;
-    uint16_t num_to_copy;
-    unsigned int i;
+    uint16_t num_to_copy, n, nw;
+    uint32_t acc;
 
     num_to_copy = ((dlen < dcc.remaining) ? dlen : dcc.remaining);
     ptr = dcc.cur_ptr;
-    for (i = 0; i < num_to_copy; i++)
-      *ptr++  = *data++;
+    n   = num_to_copy;
+    acc = 0;
+
+    /* cur_ptr is normally aligned, but the data after an odd header isn't */
+    while (n && ((uint32_t) ptr & 0x03)) {
+      acc += *data;
+      *ptr++ = *data++;
+      n--;
+    }
+    nw = n >> 2;
+    if (nw) {
+      if ((uint32_t) data & 0x03)
+        acc += copy_sum_unaligned((void *) ptr, data, nw);
+      else
+        acc += copy_sum_aligned((void *) ptr, (void *) data, nw);
+      ptr  += nw * 4;
+      data += nw * 4;
+      n    &= 0x03;
+    }
+    while (n--) {
+      acc += *data;
+      *ptr++ = *data++;
+    }
+    dcc.chksum += acc;
     dcc.cur_ptr = ptr;
     dcc.remaining -= num_to_copy;
     return num_to_copy;
   }
 
 
+  /*
+   * no space left, get another buffer
+   *
+   * dc_shed has already made sure SSW has enough free buffers for the
+   * whole record.  SSW coming up empty here means Collect and SSW
+   * disagree about the ring, that's corruption.
+   */
+  void get_buf() {
+    dcc.handle = call SSW.get_free_buf_handle();
+    if (!dcc.handle)
+      call Panic.panic(PANIC_SS, 9, call SSW.free_bufs(), 0, 0, 0);
+    dcc.cur_ptr = dcc.cur_buf = call SSW.buf_handle_to_buf(dcc.handle);
+    dcc.remaining = SD_BLOCKSIZE;
+  }
+
+
   void copy_out(uint8_t *data, uint16_t dlen) {
     uint16_t num_copied;
 
     if (!data || !dlen)            /* nothing to do? */
       return;
     while (dlen > 0) {
-      if (dcc.cur_buf == NULL) {
-        /*
-         * no space left, get another buffer
-         * get_free_buf_handle either works or panics.
-         */
-        dcc.handle = call SSW.get_free_buf_handle();
-        dcc.cur_ptr = dcc.cur_buf = call SSW.buf_handle_to_buf(dcc.handle);
-        dcc.remaining = SD_BLOCKSIZE;
-      }
+      if (dcc.cur_buf == NULL)
+        get_buf();
       num_copied = copy_block_out(data, dlen);
       data += num_copied;
       dlen -= num_copied;
@@ -377,41 +711,117 @@ implementation {
   }
 
 
-  void finish_record(dt_header_t *header, uint16_t hlen,
-                     uint8_t     *data,   uint16_t dlen) {
-    uint16_t    chksum;
-    uint32_t    i;
-
+  /*
+   * start_record: assign the recnum and get ready to checksum
+   *
+   * upper layers are responsible for filling in any pad fields,
+   * typically 0.  Pad fields are don't care but are part of the record
+   * and are significant in the checksum.  We set to zero by convention.
+   *
+   * we need to compute the record chksum over all bytes of the header and
+   * all bytes of the data area.  Additions to the chksum are done byte by
+   * byte (see copy_block_out for how this is done a word at a time).
+   *
+   * Set recsum to 0.  Sum byte by byte all header and data bytes.  Then lay
+   * in the computed 16 bit result as recsum.  The sum is accumulated while
+   * the record is copied out, so recsum gets laid into the copy of the
+   * header that lives in the SSW buffer after the fact (see lay_recsum).
+   *
+   * To verify, sum all bytes.  This result will include both recsum
+   * bytes.  Remove the recsum bytes from result (as individual bytes)
+   * and compare the result to recsum itself.  See checksum verify in
+   * get_record in tagdump.py.  (tools/utils/tagdump/tagdump)
+   */
+  void start_record(dt_header_t *header) {
     dcc.cur_recnum++;
     dcc.last_rec_offset = get_rec_offset();
     header->recnum = dcc.cur_recnum;
-
-    /*
-     * upper layers are responsible for filling in any pad fields,
-     * typically 0.  Pad fields are don't care but are part of the record
-     * and are significant in the checksum.  We set to zero by convention.
-     *
-     * we need to compute the record chksum over all bytes of the header and
-     * all bytes of the data area.  Additions to the chksum are done byte by
-     * byte.  This has to be done before copying any of the data out and added
-     * to the header (recsum).  Duh.  In other words, we have to finish updating
-     * critical fields in the record header before coping it else where.
-     *
-     * Set recsum to 0.  Sum byte by byte all header and data bytes.  Then lay
-     * in the computed 16 bit result as recsum.
-     *
-     * To verify, sum all bytes.  This result will include both recsum
-     * bytes.  Remove the recsum bytes from result (as individual bytes)
-     * and compare the result to recsum itself.  See checksum verify in
-     * get_record in tagdump.py.  (tools/utils/tagdump/tagdump)
-     */
-    chksum = 0;
     header->recsum = 0;
-    for (i = 0; i < hlen; i++)
-      chksum += ((uint8_t *) header)[i];
-    for (i = 0; data && i < dlen; i++)
-      chksum += data[i];
-    header->recsum = (uint16_t) chksum;
+    dcc.chksum = 0;
+  }
+
+
+  /*
+   * lay_recsum: lay the final checksum into the buffered copy of the header.
+   *
+   * Records start quad aligned and sectors are quad sized so recsum (an
+   * even offset) never straddles a sector.  The sector holding it may
+   * already have been handed to SSW via finish_sector, but SSW only
+   * touches buffers from task level and we are still running.
+   */
+  void lay_recsum(dt_header_t *header, uint16_t *sump) {
+    header->recsum = dcc.chksum;
+    *sump = dcc.chksum;
+  }
+
+
+  /*
+   * dc_pri: what priority a dtype sheds at.
+   */
+  dc_pri_t dc_pri(dtype_t dtype) {
+    switch (dtype) {
+      case DT_REBOOT:
+      case DT_VERSION:
+      case DT_SYNC:
+      case DT_INDEX:
+        return DC_PRI_CRIT;
+
+      case DT_GPS_RAW_SIRFBIN:
+        return DC_PRI_BULK;
+
+      default:
+        return DC_PRI_NORM;
+    }
+  }
+
+
+  /*
+   * dc_shed: see if a record needs to be shed.
+   *
+   * A record that fits in what is left of the current sector never
+   * sheds, it doesn't need any more buffers.  Otherwise figure how many
+   * buffers the record needs and shed it if that would eat into the
+   * reserve kept back for higher priority records.  CRIT has no
+   * reserve below it, it only sheds when SSW doesn't have the buffers
+   * at all.
+   *
+   * returns TRUE if the record was dropped (and counted).
+   */
+  bool dc_shed(dtype_t dtype, uint16_t rlen) {
+    dc_pri_t pri;
+    uint16_t need;
+    uint8_t  reserve;
+
+    pri = dc_pri(dtype);
+    if (rlen <= dcc.remaining)
+      return FALSE;
+    need = (rlen - dcc.remaining + SD_BLOCKSIZE - 1) / SD_BLOCKSIZE;
+    switch (pri) {
+      case DC_PRI_CRIT: reserve = 0;               break;
+      case DC_PRI_BULK: reserve = DC_RESERVE_BULK; break;
+      default:          reserve = DC_RESERVE_NORM; break;
+    }
+    if (call SSW.free_bufs() >= need + reserve)
+      return FALSE;
+
+    dc_drops[dtype]++;
+    dcc.drops[pri]++;
+    if (dcc.sync_drops[pri] < 0xffff)
+      dcc.sync_drops[pri]++;
+    return TRUE;
+  }
+
+
+  /*
+   * dc_tlen: size of the usecs trailer a record of rlen bytes gets.
+   * CRIT records never get one (SYNC/REBOOT framing, fixed sizes), nor
+   * does a record that would end up too big.
+   */
+  uint16_t dc_tlen(dtype_t dtype, uint16_t rlen) {
+    if (!dcc.usecs || dc_pri(dtype) == DC_PRI_CRIT ||
+        rlen + sizeof(dt_usecs_t) > DT_MAX_RLEN)
+      return 0;
+    return sizeof(dt_usecs_t);
   }
 
 
@@ -437,11 +847,18 @@ implementation {
    * dblk headers are constrained to fit completely into a data sector.  Data
    * immediately follows the dblk header as long as there is space.  Data
    * can flow into as many sectors as needed following the dblk header.
+   *
+   * returns TRUE if the record was laid down, FALSE if it was shed.
    */
-  command void Collect.collect_nots(dt_header_t *header, uint16_t hlen,
-                                    uint8_t     *data,   uint16_t dlen) {
+  bool dc_collect(dt_header_t *header, uint16_t hlen,
+                  uint8_t     *data,   uint16_t dlen, uint32_t usecs) {
+    uint16_t *sump;
+    uint16_t  rem, tlen;
+
     if (dcc.majik_a != DC_MAJIK || dcc.majik_b != DC_MAJIK)
       call Panic.panic(PANIC_SS, 1, dcc.majik_a, dcc.majik_b, 0, 0);
+    if (dcc.resv_pending)
+      call Panic.panic(PANIC_SS, 5, (parg_t) header, header->dtype, 0, 0);
     if ((uint32_t) header & 0x3 || (uint32_t) dcc.cur_ptr & 0x03 ||
         dcc.remaining > SD_BLOCKSIZE)
       call Panic.panic(PANIC_SS, 2, (parg_t) header, (parg_t) dcc.cur_ptr, dcc.remaining, 0);
@@ -454,19 +871,267 @@ implementation {
     if (hlen + dlen > DT_MAX_RLEN)
       call Panic.panic(PANIC_SS, 4, (parg_t) data, dlen, 0, 0);
 
-    /* update recnum and calc the checksum */
-    finish_record(header, hlen, data, dlen);
+    tlen = dc_tlen(header->dtype, hlen + dlen);
+    if (dc_shed(header->dtype, hlen + dlen + tlen))
+      return FALSE;
+
+    if (dcc.cur_buf == NULL)
+      get_buf();
+    sump = (void *) (dcc.cur_ptr + offsetof(dt_header_t, recsum));
+    rem  = dcc.remaining;
+
+    if (tlen) {
+      header->len   += tlen;
+      header->dtype |= DT_F_USECS;
+    }
+
+    /*
+     * update recnum, then copy and checksum in one pass.
+     *
+     * If the header crosses into the next sector, recsum lands in that
+     * sector.  Grab where while that sector is still cur_buf, the data
+     * can run on into more sectors (or finish this one off, NULL).
+     */
+    start_record(header);
     nop();                              /* BRK */
     copy_out((void *)header, hlen);
+    if (rem <= offsetof(dt_header_t, recsum))
+      sump = (void *) (dcc.cur_buf + offsetof(dt_header_t, recsum) - rem);
     copy_out((void *)data,   dlen);
+    copy_out((void *)&usecs, tlen);
+    lay_recsum(header, sump);
     align_next();
+
+    if (tlen) {                         /* hand the header back as it was */
+      header->len   -= tlen;
+      header->dtype &= ~DT_F_USECS;
+    }
+    return TRUE;
+  }
+
+
+  command void Collect.collect_nots(dt_header_t *header, uint16_t hlen,
+                                    uint8_t     *data,   uint16_t dlen) {
+    dc_collect(header, hlen, data, dlen, call Platform.usecsRaw());
+  }
+
+
+  /*
+   * dc_collect_now: stamp systime and usecs, as close together as we
+   * can get them, and lay the record down.  The SYNC/REBOOT/INDEX
+   * writers need to know if their record made it.
+   */
+  bool dc_collect_now(dt_header_t *header, uint16_t hlen,
+                      uint8_t     *data,   uint16_t dlen) {
+    uint32_t usecs;
+
+    atomic {
+      header->systime = call LocalTime.get();
+      usecs = call Platform.usecsRaw();
+    }
+    return dc_collect(header, hlen, data, dlen, usecs);
   }
 
 
   command void Collect.collect(dt_header_t *header, uint16_t hlen,
                                uint8_t     *data,   uint16_t dlen) {
-    header->systime = call LocalTime.get();
-    call Collect.collect_nots(header, hlen, data, dlen);
+    dc_collect_now(header, hlen, data, dlen);
+  }
+
+
+  /*
+   * claim_space: claim up to len bytes from the current sector.
+   *
+   * returns how many bytes were claimed and where they live (*ptrp).
+   * If we exhaust the current sector and still need more, the sector
+   * is handed off to SSW.  The last sector touched by a reservation is
+   * left in place and is finished by the commit.
+   *
+   * SSW only writes buffers from task level, reserve/commit are required
+   * to be in the same task so any sector handed off here can not go out
+   * to the SD before the commit finishes filling it in.
+   */
+  uint16_t claim_space(uint16_t len, uint16_t more, uint8_t **ptrp) {
+    uint16_t num;
+
+    if (dcc.cur_buf == NULL)
+      get_buf();
+    num = ((len < dcc.remaining) ? len : dcc.remaining);
+    *ptrp = dcc.cur_ptr;
+    dcc.cur_ptr   += num;
+    dcc.remaining -= num;
+    if (dcc.remaining == 0 && (len - num + more))
+      finish_sector();
+    return num;
+  }
+
+
+  /*
+   * Collect.reserve: zero copy record reservation.
+   *
+   * Fast path: the whole record fits in what is left of the current
+   * sector.  The header and data are handed out as one contiguous piece
+   * of the SSW buffer.
+   *
+   * Otherwise the record crosses one or more sectors.  If the header
+   * still fits in the current sector it is built in place, else it is
+   * built in dc_hdr_stage and scattered on commit.  The data area is
+   * described by up to DC_MAX_FRAGS fragments.
+   *
+   * The same constraints as collect apply.  The record starts quad
+   * aligned and the next record is quad aligned after the commit.
+   */
+  command dc_resv_t *Collect.reserve(dtype_t dtype, uint16_t hlen,
+                                     uint16_t dlen) {
+    dc_resv_t *rp;
+    uint8_t   *ptr;
+    uint16_t   num, left, tlen;
+
+    if (dcc.majik_a != DC_MAJIK || dcc.majik_b != DC_MAJIK)
+      call Panic.panic(PANIC_SS, 1, dcc.majik_a, dcc.majik_b, 0, 0);
+    if (dcc.resv_pending || (uint32_t) dcc.cur_ptr & 0x03 ||
+        dcc.remaining > SD_BLOCKSIZE)
+      call Panic.panic(PANIC_SS, 6, dcc.resv_pending, (parg_t) dcc.cur_ptr,
+                       dcc.remaining, 0);
+    if (hlen > DT_MAX_HEADER || hlen < sizeof(dt_header_t) ||
+        hlen + dlen > DT_MAX_RLEN || dtype > DT_MAX)
+      call Panic.panic(PANIC_SS, 7, hlen, dlen, dtype, 0);
+
+    tlen = dc_tlen(dtype, hlen + dlen);
+    if (dc_shed(dtype, hlen + dlen + tlen))
+      return NULL;
+
+    rp = &dcc.resv;
+    rp->nfrags = 0;
+    dcc.resv_pending = TRUE;
+    dcc.resv_offset  = get_rec_offset();
+    dcc.resv_hlen    = hlen;
+    dcc.resv_dlen    = dlen;
+    dcc.resv_tlen    = tlen;
+    dcc.hfrag[0] = dcc.hfrag[1] = NULL;
+    dcc.hflen[0] = dcc.hflen[1] = 0;
+    dcc.tfrag[0] = dcc.tfrag[1] = NULL;
+    dcc.tflen[0] = dcc.tflen[1] = 0;
+
+    if (dcc.cur_buf == NULL)
+      get_buf();
+
+    /* fast path, everything fits in this sector */
+    if (hlen + dlen + tlen <= dcc.remaining) {
+      rp->hdr     = (void *) dcc.cur_ptr;
+      rp->data[0] = dcc.cur_ptr + hlen;
+      rp->dlen[0] = dlen;
+      rp->nfrags  = 1;
+      dcc.tfrag[0] = dcc.cur_ptr + hlen + dlen;
+      dcc.tflen[0] = tlen;
+      dcc.cur_ptr   += hlen + dlen + tlen;
+      dcc.remaining -= hlen + dlen + tlen;
+      return rp;
+    }
+
+    if (hlen <= dcc.remaining)
+      claim_space(hlen, dlen + tlen, (void *) &rp->hdr);
+    else {
+      /* header gets split, build it in staging */
+      rp->hdr = (void *) dc_hdr_stage;
+      dcc.hflen[0] = claim_space(hlen, dlen + tlen, &dcc.hfrag[0]);
+      dcc.hflen[1] = claim_space(hlen - dcc.hflen[0], dlen + tlen,
+                                 &dcc.hfrag[1]);
+    }
+
+    left = dlen;
+    while (left) {
+      if (rp->nfrags >= DC_MAX_FRAGS)
+        call Panic.panic(PANIC_SS, 7, hlen, dlen, rp->nfrags, 0);
+      num = claim_space(left, tlen, &ptr);
+      rp->data[rp->nfrags] = ptr;
+      rp->dlen[rp->nfrags] = num;
+      rp->nfrags++;
+      left -= num;
+    }
+    if (tlen) {
+      dcc.tflen[0] = claim_space(tlen, 0, &dcc.tfrag[0]);
+      if (dcc.tflen[0] < tlen)
+        dcc.tflen[1] = claim_space(tlen - dcc.tflen[0], 0, &dcc.tfrag[1]);
+    }
+    return rp;
+  }
+
+
+  /*
+   * dc_commit: finish off an outstanding reservation
+   *
+   * lay in the recnum, fill in the usecs trailer if one was reserved,
+   * compute recsum over the header, all the data fragments and the
+   * trailer, scatter the header if it was staged, then align for the
+   * next record.
+   */
+  void dc_commit(uint32_t usecs) {
+    dt_header_t *hp;
+    dc_resv_t   *rp;
+    uint16_t     chksum, i, j;
+    uint8_t     *ptr;
+
+    rp = &dcc.resv;
+    hp = rp->hdr;
+    if (!dcc.resv_pending || !hp ||
+        hp->len != (dcc.resv_hlen + dcc.resv_dlen) ||
+        hp->dtype > DT_MAX)
+      call Panic.panic(PANIC_SS, 8, dcc.resv_pending, (parg_t) hp,
+                       dcc.resv_hlen, dcc.resv_dlen);
+
+    dcc.cur_recnum++;
+    dcc.last_rec_offset = dcc.resv_offset;
+    hp->recnum = dcc.cur_recnum;
+    hp->recsum = 0;
+    if (dcc.resv_tlen) {
+      hp->len   += dcc.resv_tlen;
+      hp->dtype |= DT_F_USECS;
+    }
+
+    /* see start_record for the rules on recsum */
+    chksum = sum_block((void *) hp, dcc.resv_hlen);
+    for (j = 0; j < rp->nfrags; j++)
+      chksum += sum_block(rp->data[j], rp->dlen[j]);
+    ptr = (void *) &usecs;
+    for (j = 0; j < 2; j++)
+      for (i = 0; i < dcc.tflen[j]; i++) {
+        dcc.tfrag[j][i] = *ptr;
+        chksum += *ptr++;
+      }
+    hp->recsum = chksum;
+
+    if (dcc.hfrag[0]) {
+      ptr = (void *) hp;
+      for (i = 0; i < dcc.hflen[0]; i++)
+        dcc.hfrag[0][i] = *ptr++;
+      for (i = 0; i < dcc.hflen[1]; i++)
+        dcc.hfrag[1][i] = *ptr++;
+    }
+
+    dcc.resv_pending = FALSE;
+    rp->hdr = NULL;
+    rp->nfrags = 0;
+    if (dcc.cur_buf && dcc.remaining == 0)
+      finish_sector();
+    align_next();
+  }
+
+
+  command void Collect.commit_nots() {
+    dc_commit(call Platform.usecsRaw());
+  }
+
+
+  command void Collect.commit() {
+    uint32_t usecs;
+
+    atomic {
+      if (dcc.resv.hdr)
+        dcc.resv.hdr->systime = call LocalTime.get();
+      usecs = call Platform.usecsRaw();
+    }
+    dc_commit(usecs);
   }
 
 
@@ -488,6 +1153,21 @@ implementation {
   }
 
 
+  command uint8_t CollectIndex.pending(uint8_t level, dt_index_ent_t **entp) {
+    if (level >= DT_INDEX_LEVELS)
+      return 0;
+    *entp = dc_idx[level];
+    return dc_idx_n[level];
+  }
+
+
+  command uint64_t CollectIndex.last(uint8_t level) {
+    if (level >= DT_INDEX_LEVELS)
+      return 0;
+    return dc_idx_last[level];
+  }
+
+
   command void CollectEvent.logEvent(uint16_t ev, uint32_t arg0, uint32_t arg1,
                                                   uint32_t arg2, uint32_t arg3) {
     dt_event_t  e;
@@ -511,6 +1191,7 @@ implementation {
   async event void SysReboot.shutdown_flush() {
     dt_sync_t  s;
     dt_sync_t *sp;
+    uint16_t  *sump;
 
     nop();                              /* BRK */
 
@@ -522,7 +1203,11 @@ implementation {
      * ready to go as is.  But if we have room put one last sync record
      * down that records what we currently think current datetime is.
      * Yeah!
+     *
+     * Anyone holding a record back gets to lay it down first (via
+     * CollectFlush.shutdown_collect), space for the SYNC is kept.
      */
+    signal CollectFlush.shutdown();
     sp = &s;
     if (dcc.cur_buf) {
       /*
@@ -535,19 +1220,59 @@ implementation {
         sp->systime    = call LocalTime.get();
         sp->sync_majik = SYNC_MAJIK;
         sp->prev_sync  = dcc.last_sync_offset;
+        sp->prev_sync_hi = dcc.last_sync_offset >> 32;
+        sp->drop_norm  = dcc.sync_drops[DC_PRI_NORM];
+        sp->drop_bulk  = dcc.sync_drops[DC_PRI_BULK];
+        sp->prev_index = dc_idx_prev;
         dcc.last_sync_offset = get_rec_offset();
+        call DblkManager.note_sync(dcc.last_sync_offset, dcc.cur_recnum + 1);
 
         /* fill in datetime */
 
-        /* add recnum and checksum the record */
-        finish_record( (void *) sp, sizeof(dt_sync_t), NULL, 0);
+        /* add recnum, copy and checksum the record */
+        start_record((void *) sp);
+        sump = (void *) (dcc.cur_ptr + offsetof(dt_header_t, recsum));
         copy_block_out((void *) sp, sizeof(dt_sync_t));
+        lay_recsum((void *) sp, sump);
       }
       dcc.remaining = 0;
     }
     call SSW.flush_all();
   }
 
+  /*
+   * shutdown_collect: on the way down, see CollectFlush.  Only what is
+   * left of the current buffer is used, no new buffers and no calls
+   * into SSW, room for the last SYNC is left.  Records start and stay
+   * quad aligned so the header (recsum) is all in this buffer.
+   */
+  async command bool CollectFlush.shutdown_collect(dt_header_t *header,
+        uint16_t hlen, uint8_t *data, uint16_t dlen) {
+    uint16_t *sump;
+
+    if (!dcc.cur_buf || dcc.resv_pending || header->len != hlen + dlen ||
+        hlen + dlen + 3 + sizeof(dt_sync_t) > dcc.remaining) {
+      if (header->dtype <= DT_MAX)
+        dc_drops[header->dtype]++;
+      return FALSE;
+    }
+    sump = (void *) (dcc.cur_ptr + offsetof(dt_header_t, recsum));
+    start_record(header);
+    copy_block_out((void *) header, hlen);
+    if (data && dlen)
+      copy_block_out(data, dlen);
+    lay_recsum(header, sump);
+    while ((uint32_t) dcc.cur_ptr & 0x03) {     /* align_next w/o finish */
+      *dcc.cur_ptr++ = 0;
+      dcc.remaining--;
+    }
+    return TRUE;
+  }
+
+
+  default event void CollectFlush.flush()           { }
+  default async event void CollectFlush.shutdown()  { }
+
         event void SS.dblk_stream_full()           { }
         event void SS.dblk_advanced(uint32_t last) { }
   async event void Panic.hook()                    { }
@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * DblkIndexP: resolve a recnum or a time to a file offset using the
+ * sparse index (DT_INDEX, see typed_data.h).
+ *
+ * The answer is the file offset of the last SYNC/REBOOT at or before
+ * the key.  The record wanted is within a SYNC interval (at most
+ * SYNC_MAX_SECTORS) after that.
+ *
+ * Tagnet:
+ *
+ *   <node>/tag/sd/0/dblk/.find_rec   PUT recnum
+ *   <node>/tag/sd/0/dblk/.find_ago   PUT seconds back from now
+ *
+ * A PUT starts the lookup.  A GET then returns the offset (the low
+ * word, see DblkMapFileP).  GET fails while the lookup is still running,
+ * if it failed, or if the last lookup was of the other kind.
+ *
+ * The search starts with the entries Collect hasn't laid down yet
+ * (CollectIndex.pending), top level first.  The last entry at or
+ * before the key is either a SYNC (level 0, done) or a DT_INDEX one
+ * level down, which gets read in and searched the same way.  One
+ * DT_INDEX read per level.  If the key is older than anything pending,
+ * the top level DT_INDEX records are walked back via prev_index.
+ *
+ * DT_INDEX records are read through DblkMapFile, so it doesn't matter
+ * if they are still sitting in SSW buffers, and repeat lookups tend to
+ * hit in its cache.  Offsets in entries and prev_index are the low word,
+ * the rest comes from the record (or for pending entries the eof) they
+ * were found in.
+ *
+ * The index only covers the current boot (systime restarts on reboot).
+ * A recnum before this boot fails.  A time before this boot resolves to
+ * the first SYNC/REBOOT of this boot.
+ */
+
+#include <typed_data.h>
+
+/* most top level DT_INDEX records walked back before giving up */
+#ifndef DI_WALK_MAX
+#define DI_WALK_MAX 32
+#endif
+
+typedef enum {
+  DIS_IDLE = 0,
+  DIS_BUSY,                             /* lookup in progress */
+  DIS_DONE,                             /* di_result is good */
+  DIS_FAIL,
+} di_state_t;
+
+
+module DblkIndexP {
+  provides {
+    interface TagnetAdapter<uint32_t> as DblkFindRec;
+    interface TagnetAdapter<uint32_t> as DblkFindAgo;
+  }
+  uses {
+    interface CollectIndex;
+    interface ByteMapFile as DMF;
+    interface StreamStorage as SS;
+    interface LocalTime<TMilli>;
+  }
+}
+
+implementation {
+  di_state_t  di_state;
+  bool        di_by_time;               /* key is systime, else recnum */
+  uint64_t    di_key;
+  uint64_t    di_result;                /* file offset */
+
+  /* DT_INDEX being read in */
+  uint64_t    di_off;                   /* file offset */
+  uint8_t     di_level;                 /* level expected */
+  bool        di_chain;                 /* top level, walking back */
+  uint16_t    di_have;                  /* bytes in di_rec */
+  uint8_t     di_walk;
+  bool        di_waiting;               /* for DMF.data_avail */
+
+  uint8_t     di_rec[sizeof(dt_index_t) +
+                     DT_INDEX_FAN * sizeof(dt_index_ent_t)]
+                                        __attribute__ ((aligned (4)));
+
+  uint32_t    di_reads;                 /* DT_INDEX reads, last lookup */
+
+  task void di_task();
+
+
+  uint64_t di_ent_key(dt_index_ent_t *ep) {
+    return di_by_time ? ep->systime : ep->recnum;
+  }
+
+
+  /* last of n entries at or before the key, -1 if none */
+  int16_t di_find(dt_index_ent_t *ep, uint8_t n) {
+    int16_t i;
+
+    for (i = n - 1; i >= 0; i--)
+      if (di_ent_key(&ep[i]) <= di_key)
+        return i;
+    return -1;
+  }
+
+
+  void di_done(uint64_t offset) {
+    di_result = offset;
+    di_state  = DIS_DONE;
+  }
+
+
+  /* go get the DT_INDEX at offset, level */
+  void di_read(uint8_t level, uint64_t offset, bool chain) {
+    if (!offset) {
+      di_state = DIS_FAIL;
+      return;
+    }
+    di_level = level;
+    di_off   = offset;
+    di_chain = chain;
+    di_have  = 0;
+    di_reads++;
+    post di_task();
+  }
+
+
+  /*
+   * ep at level is the last entry at or before the key.  ref is the
+   * offset of the record it came from (eof if pending).
+   */
+  void di_found(dt_index_ent_t *ep, uint8_t level, uint64_t ref) {
+    if (level == 0) {
+      di_done(DT_OFF64(ref, ep->offset));
+      return;
+    }
+    di_read(level - 1, DT_OFF64(ref, ep->offset), FALSE);
+  }
+
+
+  /*
+   * key is before anything in the index.  a time resolves to the
+   * oldest entry.  Searching for it takes the first entry at each level
+   * on the way down.
+   */
+  void di_before(dt_index_ent_t *first, uint8_t level, uint64_t ref) {
+    if (!di_by_time) {
+      di_state = DIS_FAIL;
+      return;
+    }
+    di_key = first->systime;
+    di_found(first, level, ref);
+  }
+
+
+  void di_start() {
+    dt_index_ent_t *ep, *best, *first;
+    uint8_t level, best_level, first_level, n;
+    uint64_t eof;
+    int16_t i;
+
+    eof = call SS.eof_offset();
+    di_reads = 0;
+    di_walk  = 0;
+    best  = first = NULL;
+    best_level = first_level = 0;
+    for (level = DT_INDEX_LEVELS; level--; ) {
+      n = call CollectIndex.pending(level, &ep);
+      if (!n)
+        continue;
+      if (!first) {
+        first = ep;
+        first_level = level;
+      }
+      i = di_find(ep, n);
+      if (i >= 0) {
+        best = &ep[i];
+        best_level = level;
+      }
+    }
+
+    if (best) {
+      di_found(best, best_level, eof);
+      return;
+    }
+
+    /* older than anything pending */
+    if (call CollectIndex.last(DT_INDEX_LEVELS - 1)) {
+      di_read(DT_INDEX_LEVELS - 1,
+              call CollectIndex.last(DT_INDEX_LEVELS - 1), TRUE);
+      return;
+    }
+    if (first) {
+      di_before(first, first_level, eof);
+      return;
+    }
+    di_state = DIS_FAIL;                /* nothing indexed yet */
+  }
+
+
+  /* DT_INDEX is all in, sane? */
+  bool di_check() {
+    dt_index_t *ip;
+    uint16_t    sum, i;
+
+    ip = (void *) di_rec;
+    if (ip->len != sizeof(dt_index_t) + ip->count * sizeof(dt_index_ent_t) ||
+        ip->count == 0 || ip->count > DT_INDEX_FAN ||
+        ip->level != di_level)
+      return FALSE;
+
+    /* see Collect start_record for the rules on recsum */
+    sum = 0;
+    for (i = 0; i < ip->len; i++)
+      sum += di_rec[i];
+    sum -= (ip->recsum & 0xff) + (ip->recsum >> 8);
+    return sum == ip->recsum;
+  }
+
+
+  /*
+   * pull the DT_INDEX at di_off into di_rec.  The header first, its len
+   * says how much more.  It can cross a sector so it can take more than
+   * one map.
+   */
+  task void di_task() {
+    dt_index_t     *ip;
+    dt_index_ent_t *ep;
+    uint8_t        *buf;
+    uint64_t        fo;
+    uint32_t        need, len;
+    error_t         err;
+    int16_t         i;
+
+    if (di_state != DIS_BUSY)
+      return;
+    ip = (void *) di_rec;
+    di_waiting = FALSE;
+    while (1) {
+      need = sizeof(dt_index_t);
+      if (di_have >= need) {
+        if (ip->dtype != DT_INDEX || ip->len > sizeof(di_rec) ||
+            ip->len < need) {
+          di_state = DIS_FAIL;
+          return;
+        }
+        need = ip->len;
+      }
+      if (di_have >= need)
+        break;
+      len = need - di_have;
+      fo  = di_off + di_have;
+      err = call DMF.map(fo >> 32, &buf, fo, &len);
+      if (err == EBUSY) {
+        di_waiting = TRUE;
+        return;
+      }
+      if (err || !len) {                /* gone (overwritten) or bad */
+        di_state = DIS_FAIL;
+        return;
+      }
+      memcpy(&di_rec[di_have], buf, len);
+      di_have += len;
+    }
+
+    if (!di_check()) {
+      di_state = DIS_FAIL;
+      return;
+    }
+    ep = (void *) &di_rec[sizeof(dt_index_t)];
+    i  = di_find(ep, ip->count);
+    if (i >= 0) {
+      di_found(&ep[i], di_level, di_off);
+      return;
+    }
+
+    /* only a top level record walking back can be entirely after the key */
+    if (!di_chain) {
+      di_state = DIS_FAIL;
+      return;
+    }
+    if (ip->prev_index && ++di_walk < DI_WALK_MAX) {
+      di_read(di_level, DT_OFF64(di_off, ip->prev_index), TRUE);
+      return;
+    }
+    if (ip->prev_index)
+      di_state = DIS_FAIL;
+    else
+      di_before(&ep[0], di_level, di_off); /* first top level this boot */
+  }
+
+
+  event void DMF.data_avail(error_t err) {
+    if (di_state == DIS_BUSY && di_waiting)
+      post di_task();
+  }
+
+
+  bool di_get(bool by_time, uint32_t *t, uint32_t *l) {
+    if (di_state != DIS_DONE || di_by_time != by_time)
+      return FALSE;
+    *t = di_result;
+    *l = 4;
+    return TRUE;
+  }
+
+
+  command bool DblkFindRec.get_value(uint32_t *t, uint32_t *l) {
+    return di_get(FALSE, t, l);
+  }
+
+
+  command bool DblkFindAgo.get_value(uint32_t *t, uint32_t *l) {
+    return di_get(TRUE, t, l);
+  }
+
+
+  command bool DblkFindRec.set_value(uint32_t *t, uint32_t *l) {
+    if (di_state == DIS_BUSY)
+      return FALSE;
+    di_state   = DIS_BUSY;
+    di_by_time = FALSE;
+    di_key     = *t;
+    di_start();
+    return TRUE;
+  }
+
+
+  /* Tmilli is binary, 1024 ticks/sec */
+  command bool DblkFindAgo.set_value(uint32_t *t, uint32_t *l) {
+    uint64_t now, ago;
+
+    if (di_state == DIS_BUSY)
+      return FALSE;
+    now = call LocalTime.get();
+    ago = (uint64_t) *t * 1024;
+    di_state   = DIS_BUSY;
+    di_by_time = TRUE;
+    di_key     = (ago < now) ? now - ago : 0;
+    di_start();
+    return TRUE;
+  }
+
+
+  event void DMF.extended(uint32_t context, uint32_t offset)  { }
+  event void DMF.committed(uint32_t context, uint32_t offset) { }
+  event void SS.dblk_stream_full()                            { }
+  event void SS.dblk_advanced(uint32_t last)                  { }
+}
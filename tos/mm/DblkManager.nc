@@ -21,20 +21,57 @@
  */
 
 interface DblkManager {
-  /* return start of the DBLK file, abs sector blk_id */
+  /* return start of the first DBLK file, abs sector blk_id (directory) */
   async command uint32_t get_dblk_low();
 
-  /* return end (inclusive) of the DBLK file, abs sector blk_id */
+  /*
+   * return end (inclusive) of the DBLK file being written (the one
+   * dblk_nxt is in), abs sector blk_id.  A run of sectors written
+   * starting at dblk_nxt must not go past this.
+   */
   async command uint32_t get_dblk_high();
 
+  /* return end (inclusive) of the DBLK file holding abs blk_id */
+  async command uint32_t blk_file_high(uint32_t blk_id);
+
   /* return the next abs blk_id that will be written next */
   async command uint32_t get_dblk_nxt();
 
   /*
    * return current file relative offset of dblk_nxt (from dblk_low)
    * this is the file offset of the next block to be written.
+   *
+   * file offsets are logical offsets into the data stream, which runs
+   * through all the DBLK files, and are 64 bits.
+   */
+  async command uint64_t dblk_nxt_offset();
+
+  /*
+   * results of the restart scan done on boot.
+   *
+   * last recnum used, file offset of the last good record, and file
+   * offset of the last SYNC/REBOOT.  All 0 if the Dblk Area was empty
+   * or nothing could be found.
+   */
+  async command uint32_t get_cur_recnum();
+  async command uint64_t get_last_rec_offset();
+  async command uint64_t get_last_sync_offset();
+
+  /*
+   * circular stream (DBLK_CIRCULAR).  file offsets are logical and keep
+   * increasing across wraps.
+   *
+   * offset_blk:          abs blk_id holding logical file offset offset.
+   * dblk_oldest_offset:  file offset of the oldest data still on disk,
+   *                      0 if the stream hasn't wrapped.
+   * dblk_oldest_recnum:  recnum of the first SYNC/REBOOT at or after
+   *                      the oldest data, 0 if not known.
+   * note_sync:           Collect tells us where each SYNC/REBOOT went.
    */
-  async command uint32_t dblk_nxt_offset();
+  async command uint32_t offset_blk(uint64_t offset);
+  async command uint64_t dblk_oldest_offset();
+  async command uint32_t dblk_oldest_recnum();
+  async command void     note_sync(uint64_t offset, uint32_t recnum);
 
   /* advance dblk_nxt and return the new value */
   async command uint32_t adv_dblk_nxt();
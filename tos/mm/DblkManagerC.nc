@@ -31,6 +31,9 @@ configuration DblkManagerC {
   provides {
     interface Boot        as Booted;    /* out Booted signal */
     interface DblkManager as DM;
+    interface TagnetAdapter<uint32_t> as DblkOldestOffset;
+    interface TagnetAdapter<uint32_t> as DblkOldestRecnum;
+    interface TagnetAdapter<uint32_t> as DblkEraseWin;
   }
   uses interface Boot;			/* incoming signal */
 }
@@ -42,12 +45,18 @@ implementation {
   Booted = DMP;
   Boot   = DMP;
 
+  DblkOldestOffset = DMP;
+  DblkOldestRecnum = DMP;
+  DblkEraseWin     = DMP;
+
   components new SD0_ArbC() as SD, SSWriteC;
   components FileSystemC, SD0C;
 
   DMP.SSW        -> SSWriteC;
   DMP.SDResource -> SD;
   DMP.SDread     -> SD;
+  DMP.SDerase    -> SD;
+  DMP.SDActive   -> SD;
   DMP.SDraw      -> SD0C;
   DMP.FileSystem -> FileSystemC;
 
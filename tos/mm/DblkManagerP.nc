@@ -29,17 +29,128 @@
  * On boot the DblkManager will keep track of its limits (start/end) and
  * which data block to use next.  On Boot it will use a binary search to
  * find the first empty data block within the Dblk Area.
+ *
+ * Warm boot.  Every time dblk_nxt advances (the previous sector has been
+ * committed) we leave it as a hint in the OverWatch control block, which
+ * survives reboots but not power fails.  If the hint is good (its check
+ * matches this Dblk Area) we look there first: the hinted sector should
+ * be erased and the one before it written, 2 reads.  If the hint is off
+ * (an erase, a crash before the hint caught up) we gallop outward from
+ * it, doubling the step, until we bracket the boundary and then binary
+ * search the bracket.  No hint, the full binary search as before.
+ *
+ * Restart.  If the Dblk Area already has data in it, we need to pick up
+ * where the previous incarnation left off, the last recnum used and the
+ * last SYNC/REBOOT written (so prev_sync links stay intact).  Collect
+ * pulls these from us when it lays down the new REBOOT.
+ *
+ * o Reverse scan.  A SYNC is written at least every SYNC_MAX_SECTORS, so
+ *   starting with the sector just below dblk_nxt we walk backwards at most
+ *   DM_SYNC_SCAN_MAX sectors looking for SYNC_MAJIK.  Records are quad
+ *   aligned and the majik lives at the same offset in SYNC and REBOOT so
+ *   we only look at quad boundaries.  The last one in a sector wins.  A
+ *   SYNC whose header starts in the previous sector is passed over, the
+ *   forward walk picks it up.
+ *
+ * o Forward walk.  From that SYNC walk the record headers forward to the
+ *   end of the data.  Each record must have a sane len and dtype and the
+ *   next recnum.  The last good record gives us the recnum.  Any SYNC or
+ *   REBOOT seen along the way becomes last_sync.
+ *
+ * The reverse scan and the forward walk each read at most
+ * DM_SYNC_SCAN_MAX sectors, so boot time does not depend on how big the
+ * SD is or how much data is on it.  Nothing is scanned if the Dblk Area
+ * is empty.
+ *
+ * Circular (DBLK_CIRCULAR).  Rather than stopping when dblk_nxt runs off
+ * the end of the Dblk Area, the stream wraps back to dblk_lower+1 and
+ * starts overwriting the oldest data.  File offsets stay logical, they
+ * keep increasing across wraps (laps is how many times we have gone
+ * around), so prev_sync links and anything else holding a file offset
+ * stay good.  Logical offset fo lives in data sector (stream blk)
+ * lower + 1 + ((fo/512 - 1) % N) where N is the number of data sectors.
+ * Once wrapped, the oldest data is the sector at dblk_nxt (one lap back).
+ *
+ * The recnum of the oldest data is tracked with a small ring of
+ * checkpoints, SYNC offset/recnum pairs handed to us by Collect spaced
+ * about N/DM_CKPTS sectors apart.  Checkpoints that get overwritten are
+ * dropped, the first one left is the oldest place a reader can sync to.
+ *
+ * Cold boot after a wrap finds no erased sector.  The boundary between
+ * the newest lap and the oldest is found with a binary search on SYNC
+ * recnums instead, newer laps have larger recnums.  The forward walk
+ * then finds the end of the data (and dblk_nxt) from the last SYNC of
+ * the newest lap.  laps is recovered from that SYNC's prev_sync.
+ *
+ * Pre-erase.  Writing a sector the card hasn't erased costs it extra
+ * programming time, and it shows up as long and ragged writeDone
+ * latency.  In the background we keep a window of erase_win chunks
+ * (DM_ERASE_CHUNK sectors each) erased just past dblk_nxt.  We only
+ * go after the SD when it is already up (SSW writing, someone reading,
+ * or held powered), never just for this.  An erase is one chunk, then
+ * we give the SD back so SSW isn't held off for long.
+ *
+ * An erase never touches dblk_nxt itself, it starts at dblk_nxt + 1 (or
+ * where the last one stopped).  dblk_nxt is the sector SSW is filling,
+ * with SSW_FLUSH_ALLOC it may already hold a partial copy of it.  Once
+ * dblk_nxt advances into the run the erased sectors are [dblk_nxt,
+ * erase_end).  The run never goes past dblk_upper (it starts over at the
+ * front when dblk_nxt wraps).  That keeps the boot scans honest: the
+ * first erased sector found by the binary search is dblk_nxt, and a
+ * wrapped probe landing in the run sees no SYNC and moves down, which is
+ * right since the run sits at the boundary.  The exception is the short
+ * stretch between a fresh run being erased and the next advance, when
+ * dblk_nxt still holds the previous lap (or the partial copy) and a cold
+ * boot sees the boundary one sector high.  A wrapped stream whose front
+ * is erased (dblk_nxt == lower+1) means empty only if dblk_upper is also
+ * erased.
+ *
+ * Once wrapped, the erased run is data that is gone, the oldest data
+ * starts at erase_end.  On boot erase_end is recovered by looking at the
+ * last sector of each chunk ahead of dblk_nxt.
+ *
+ * DBLK files.  A FAT file can't be bigger than 4 GiB so on larger SDs the
+ * Dblk Area is a chain of DBLK files (fs_loc.h), each its own contiguous
+ * run of sectors with its own directory sector.  We work in stream
+ * blocks: the data sectors of all the files numbered one after the
+ * other, starting with DBLK0001.  Stream block n of DBLK0001 is abs
+ * sector n, so with one file nothing changes.  dblk_upper, dblk_nxt,
+ * erase_end, the boot searches and the hint are all stream blocks, they
+ * get turned into abs sectors (sblk_abs) only when we go to the SD.
+ * Erase chunks and SSW write runs stop at the end of a file.  File
+ * offsets are logical across the chain (64 bits, the chain can be
+ * bigger than 4 GiB), the directory sectors of the later files aren't
+ * part of the stream.
+ *
+ * DateTime isn't recovered.  There is no RTC or other DateTime source
+ * on the tag yet, and Collect doesn't fill in datetime.
  */
 
 #include <panic.h>
 #include <platform_panic.h>
 #include <sd.h>
+#include <typed_data.h>
+#include <overwatch.h>
+#include <fs_loc.h>
 
 typedef enum {
   DMS_IDLE = 0,                         /* doing nothing */
   DMS_REQUEST,                          /* resource requested */
   DMS_START,                            /* read first block, chk empty */
   DMS_SCAN,                             /* scanning for 1st blank */
+  DMS_HINT,                             /* checking hinted dblk_nxt */
+  DMS_HINT_PREV,                        /* checking the one before  */
+  DMS_GALLOP_UP,                        /* hint too low, gallop up  */
+  DMS_GALLOP_DN,                        /* hint too high, gallop dn */
+  DMS_SYNC,                             /* reverse scan, last SYNC  */
+  DMS_WALK,                             /* forward walk, last rec   */
+  DMS_WRAP_R0,                          /* wrapped, 1st SYNC recnum */
+  DMS_WRAP_PROBE,                       /* wrapped, binary search   */
+  DMS_OLDEST,                           /* 1st SYNC in oldest data  */
+  DMS_START_END,                        /* 1st erased, check last   */
+  DMS_ERASED,                           /* boot, find erase_end     */
+  DMS_ERASE_REQ,                        /* pre-erase, SD requested  */
+  DMS_ERASE,                            /* pre-erase, erasing       */
 } dm_state_t;
 
 
@@ -51,16 +162,57 @@ enum {
 #define PANIC_DM __pcode_dm
 #endif
 
+#define DM_SYNC_SCAN_MAX (SYNC_MAX_SECTORS + 2)
+
+#define DM_HINT_CHK(hint, low) (~(hint) ^ (low))
+
+/* hint check when the stream has wrapped, dblk_nxt can't be checked */
+#define DM_HINT_WRAPPED 0x57524150
+
+/* oldest recnum checkpoints */
+#define DM_CKPTS 16
+
+/*
+ * pre-erase.  sectors per erase, default window (chunks) and how many
+ * chunks the boot probe will look at.  Refill once less than half the
+ * window is left.
+ */
+#define DM_ERASE_CHUNK     256
+#define DM_ERASE_WIN       4
+#define DM_ERASE_PROBE_MAX 64
+
+/* biggest window .erase_win takes, well inside what the probe finds */
+#define DM_ERASE_WIN_MAX   32
+
+typedef struct {
+  uint64_t offset;                      /* logical file offset of SYNC */
+  uint32_t recnum;
+} dm_ckpt_t;
+
+/* one DBLK file, FS_LOC_DBLK + n */
+typedef struct {
+  uint32_t lower;                       /* abs, directory */
+  uint32_t upper;                       /* abs, inclusive */
+  uint32_t first;                       /* stream blk of 1st data sector */
+} dm_file_t;
+
+extern ow_control_block_t ow_control_block;
+
 
 module DblkManagerP {
   provides {
     interface Boot        as Booted;    /* signals OutBoot */
     interface DblkManager;
+    interface TagnetAdapter<uint32_t> as DblkOldestOffset;
+    interface TagnetAdapter<uint32_t> as DblkOldestRecnum;
+    interface TagnetAdapter<uint32_t> as DblkEraseWin;
   }
   uses {
     interface Boot;                     /* incoming boot signal */
     interface FileSystem;
     interface SDread;
+    interface SDerase;
+    interface SDActive;
     interface SDraw;
     interface SSWrite as SSW;
     interface Resource as SDResource;
@@ -81,33 +233,519 @@ implementation {
      *
      * file offsets are file relative so the first record in the
      *   first data sector is at file offset 0x200 which lives in
-     *   absolute sector (fo / 512) + lower.
+     *   stream blk (fo / 512) + lower.
+     *
+     * dblk_nxt, dblk_upper are stream blks.
      */
     uint32_t dblk_lower;                /* inclusive  */
                                         /* lower is where dir is */
     /* next blk_id to write */
     uint32_t dblk_nxt;                  /* 0 means full          */
     uint32_t dblk_upper;                /* inclusive  */
+    uint32_t laps;                      /* times around, circular */
+    uint8_t  dblk_files;                /* DBLK files in the chain */
 
     /* last record number used */
     uint32_t cur_recnum;                /* current record number */
+
+    /* found by the restart scan, file offsets, 0 if none */
+    uint64_t last_rec_offset;
+    uint64_t last_sync_offset;
+    uint16_t scan_reads;                /* sectors read by restart scan */
+    uint16_t search_reads;              /* sectors read finding dblk_nxt */
+    bool     hint_used;                 /* boot started from the hint */
+    uint32_t erase_end;                 /* [dblk_nxt, erase_end) erased */
+    uint32_t erase_chunks;              /* pre-erases done */
     uint32_t dm_sig_b;
   } dmc;
 
   dm_state_t   dm_state;
   uint8_t     *dm_buf;
+  dm_file_t    dm_files[FS_DBLK_FILES_MAX];
+  uint32_t     dm_blk;                  /* stream blk being read */
   uint32_t     lower, cur_blk, upper;
+  uint32_t     gal_blk, gal_step;       /* galloping from the hint */
   bool         do_erase = 0;
 
+  /* restart scan */
+  uint32_t     scan_low;                /* reverse scan lower limit */
+  uint64_t     walk_fo;                 /* file offset, record looked at */
+  uint64_t     walk_cur;                /* file offset, sector in dm_buf */
+  uint64_t     walk_end;                /* file offset, end of data */
+  bool         walk_split;              /* header split across sectors */
+  bool         walk_wrap;               /* end of data unknown, wrapped */
+  uint16_t     walk_len;
+  dtype_t      walk_dtype;
+
+  /* wrapped cold boot, binary search on SYNC recnums */
+  uint32_t     wrap_r0;                 /* recnum of 1st SYNC in area */
+  uint32_t     wrap_m;                  /* probe start */
+  uint16_t     wrap_n;                  /* sectors looked at, this probe */
+  uint64_t     old_fo;                  /* oldest data, SYNC search */
+
+  /* oldest recnum checkpoints, ring */
+  dm_ckpt_t    dm_ckpt[DM_CKPTS];
+  uint8_t      ck_out, ck_num;
+  uint64_t     ck_next;                 /* next checkpoint at or after */
+
+  /* pre-erase window, chunks.  0 off */
+  uint32_t     erase_win = DM_ERASE_WIN;
+  uint32_t     erase_to;                /* end of the erase running */
+
 
   void dm_panic(uint8_t where, parg_t p0, parg_t p1) {
     call Panic.panic(PANIC_DM, where, p0, p1, 0, 0);
   }
 
 
-  event void Boot.booted() {
+  /* DBLK file holding stream blk sblk */
+  dm_file_t *sblk_file(uint32_t sblk) {
+    uint8_t i;
+
+    for (i = dmc.dblk_files; i > 1; i--)
+      if (sblk >= dm_files[i - 1].first)
+        return &dm_files[i - 1];
+    return &dm_files[0];
+  }
+
+
+  /* abs blk_id of stream blk sblk */
+  uint32_t sblk_abs(uint32_t sblk) {
+    dm_file_t *fp;
+
+    if (sblk <= dmc.dblk_lower)
+      return sblk;                      /* directory (or 0, full) */
+    fp = sblk_file(sblk);
+    return fp->lower + 1 + (sblk - fp->first);
+  }
+
+
+  /* last stream blk of the DBLK file holding sblk */
+  uint32_t sblk_file_end(uint32_t sblk) {
+    dm_file_t *fp;
+
+    fp = sblk_file(sblk);
+    return fp->first + (fp->upper - fp->lower) - 1;
+  }
+
+
+  void search_read(uint32_t blk_id) {
     error_t err;
 
+    cur_blk = blk_id;
+    dm_blk  = blk_id;
+    dmc.search_reads++;
+    if ((err = call SDread.read(sblk_abs(blk_id), dm_buf)))
+      dm_panic(8, err, blk_id);
+  }
+
+
+  /*
+   * scan_range: binary search for the first erased sector.
+   * lo is known written, hi is the upper limit.
+   */
+  void scan_range(uint32_t lo, uint32_t hi) {
+    lower = lo;
+    upper = hi;
+    cur_blk = (upper - lower)/2 + lower;
+    if (cur_blk == lower)
+      cur_blk = lower = upper;
+    dm_state = DMS_SCAN;
+    search_read(cur_blk);
+  }
+
+
+  /* gal_blk is written, look further up */
+  void gallop_up() {
+    uint32_t blk;
+
+    blk = gal_blk + gal_step;
+    if (blk >= dmc.dblk_upper || blk < gal_blk) {
+      scan_range(gal_blk, dmc.dblk_upper);
+      return;
+    }
+    dm_state = DMS_GALLOP_UP;
+    search_read(blk);
+  }
+
+
+  /* gal_blk is erased, look further down */
+  void gallop_dn() {
+    uint32_t first;
+
+    first = dmc.dblk_lower + 1;
+    dm_state = DMS_GALLOP_DN;
+    if (gal_blk - first > gal_step)
+      search_read(gal_blk - gal_step);
+    else
+      search_read(first);
+  }
+
+
+  /*
+   * is the persisted hint believable for this Dblk Area
+   * returns 0 no, 1 yes, 2 yes and the stream had wrapped.
+   */
+  uint8_t hint_valid(uint32_t hint) {
+    uint32_t chk;
+
+    if (hint <= dmc.dblk_lower || hint > dmc.dblk_upper)
+      return 0;
+    chk = DM_HINT_CHK(hint, dmc.dblk_lower);
+    if (ow_control_block.dblk_hint_chk == chk)
+      return (hint > dmc.dblk_lower + 1) ? 1 : 0;
+#ifdef DBLK_CIRCULAR
+    if (ow_control_block.dblk_hint_chk == (chk ^ DM_HINT_WRAPPED))
+      return 2;
+#endif
+    return 0;
+  }
+
+
+  /* physical file offset of stream blk_id, ignores laps */
+  uint64_t blk_fo(uint32_t blk_id) {
+    return (uint64_t) (blk_id - dmc.dblk_lower) << SD_BLOCKSIZE_NBITS;
+  }
+
+
+  /* number of data sectors, one lap */
+  uint32_t area_secs() {
+    return dmc.dblk_upper - dmc.dblk_lower;
+  }
+
+
+  /* logical file offset of the start of the current lap */
+  uint64_t lap_base() {
+    return (uint64_t) dmc.laps * area_secs() << SD_BLOCKSIZE_NBITS;
+  }
+
+
+  /* stream blk_id holding logical file offset fo */
+  uint32_t fo_blk(uint64_t fo) {
+    uint64_t rel;
+
+    rel = fo >> SD_BLOCKSIZE_NBITS;
+    if (rel == 0)
+      return dmc.dblk_lower;            /* directory */
+    return dmc.dblk_lower + 1 + (rel - 1) % area_secs();
+  }
+
+
+  /* set dblk_nxt and laps from the logical offset of the next sector */
+  void set_nxt(uint64_t fo) {
+    uint64_t rel;
+
+    rel = fo >> SD_BLOCKSIZE_NBITS;
+    dmc.dblk_nxt = dmc.dblk_lower + 1 + (rel - 1) % area_secs();
+    dmc.laps     = (rel - 1) / area_secs();
+  }
+
+
+  /*
+   * stream blk just past the erase chunk holding blk, clipped to the
+   * DBLK file (an erase is one contiguous run on the SD).
+   */
+  uint32_t chunk_end(uint32_t blk) {
+    uint32_t e, end;
+
+    e = (blk - (dmc.dblk_lower + 1)) / DM_ERASE_CHUNK + 1;
+    e = dmc.dblk_lower + 1 + e * DM_ERASE_CHUNK;
+    end = sblk_file_end(blk) + 1;
+    if (e > end)
+      e = end;
+    return e;
+  }
+
+
+  /*
+   * sectors from dblk_nxt up to erase_end.  All erased, except dblk_nxt
+   * itself right after a fresh run (erase_start).  Either way the
+   * oldest data starts at erase_end.
+   */
+  uint32_t erase_ahead() {
+    if (!dmc.dblk_nxt || dmc.erase_end <= dmc.dblk_nxt)
+      return 0;
+    return dmc.erase_end - dmc.dblk_nxt;
+  }
+
+
+  /* low on pre-erased sectors?  not while booting or already at it */
+  bool erase_wanted() {
+    if (dm_state != DMS_IDLE || !erase_win || !dmc.dblk_nxt)
+      return FALSE;
+    if (dmc.erase_end > dmc.dblk_upper)
+      return FALSE;                     /* up against the end, wait for wrap */
+    return erase_ahead() < erase_win * DM_ERASE_CHUNK / 2;
+  }
+
+
+  /* drop any checkpoints we have written (or erased) over */
+  void ck_drop() {
+    uint64_t oldest;
+
+    atomic {
+      oldest = call DblkManager.dblk_oldest_offset();
+      while (ck_num && dm_ckpt[ck_out].offset < oldest) {
+        if (++ck_out >= DM_CKPTS)
+          ck_out = 0;
+        ck_num--;
+      }
+    }
+  }
+
+
+  /*
+   * sync_laps: which lap the SYNC at physical file offset p is in.
+   *
+   * prev_sync is logical and was laid down less than a lap before the
+   * SYNC itself, that pins it down.  prev is all 64 bits (prev_sync_hi).
+   */
+  uint32_t sync_laps(uint64_t p, uint64_t prev) {
+#ifdef DBLK_CIRCULAR
+    uint64_t lap;
+
+    if (prev == 0)
+      return 0;
+    lap = (uint64_t) area_secs() << SD_BLOCKSIZE_NBITS;
+    if (prev >= p)
+      return (prev - p) / lap + 1;
+    return (prev + lap - p) / lap;
+#else
+    return 0;
+#endif
+  }
+
+
+  void dm_read(uint32_t blk_id) {
+    error_t err;
+
+    dm_blk = blk_id;
+    dmc.scan_reads++;
+    if ((err = call SDread.read(sblk_abs(blk_id), dm_buf)))
+      dm_panic(11, err, blk_id);
+  }
+
+
+  /*
+   * find_sync: find the last SYNC/REBOOT in a sector.
+   *
+   * returns offset in the sector of the start of the record, -1 if none.
+   */
+  int16_t find_sync(uint8_t *dp) {
+    dt_sync_t *sp;
+    int16_t    off;
+
+    for (off = SD_BLOCKSIZE - sizeof(uint32_t);
+         off >= (int16_t) offsetof(dt_sync_t, sync_majik);
+         off -= sizeof(uint32_t)) {
+      if (*(uint32_t *) (dp + off) != SYNC_MAJIK)
+        continue;
+      sp = (void *) (dp + off - offsetof(dt_sync_t, sync_majik));
+      if (sp->recnum == 0 || sp->len > DT_MAX_RLEN)
+        continue;
+      if (sp->dtype == DT_SYNC &&
+          sp->len >= offsetof(dt_sync_t, sync_majik) + sizeof(uint32_t))
+        return off - offsetof(dt_sync_t, sync_majik);
+      if (sp->dtype == DT_REBOOT && sp->len >= sizeof(dt_reboot_t))
+        return off - offsetof(dt_sync_t, sync_majik);
+    }
+    return -1;
+  }
+
+
+  bool walk_rec_ok(uint16_t len, dtype_t dtype, uint32_t recnum) {
+    if (len < sizeof(dt_header_t) || len > DT_MAX_RLEN)
+      return FALSE;
+    dtype = DT_TYPE(dtype);             /* usecs trailer flag */
+    if (dtype == DT_NONE || dtype > DT_MAX)
+      return FALSE;
+    if (dtype == DT_REBOOT && !walk_wrap) /* older streams restart recnum */
+      return (recnum != 0);
+    return (recnum == dmc.cur_recnum + 1);
+  }
+
+
+  /*
+   * walk_records: walk record headers forward starting at walk_fo.
+   *
+   * returns TRUE if a read has been started to get the next sector,
+   * FALSE when the walk is done.
+   */
+  bool walk_records(uint8_t *dp) {
+    dt_header_t *hp;
+    uint32_t     off, recnum;
+    uint16_t     len;
+    dtype_t      dtype;
+
+    while (walk_fo < walk_end) {
+      if (walk_split) {
+        /* len/dtype came from the previous sector, recnum is up front */
+        walk_split = FALSE;
+        len    = walk_len;
+        dtype  = walk_dtype;
+        recnum = *(uint32_t *) dp;
+      } else {
+        off = walk_fo - walk_cur;
+        if (off >= SD_BLOCKSIZE) {
+          /* record starts in a later sector, skip any it spans */
+          walk_cur = walk_fo & ~(SD_BLOCKSIZE - 1);
+          dm_read(fo_blk(walk_cur));
+          return TRUE;
+        }
+        hp    = (void *) (dp + off);
+        len   = hp->len;
+        dtype = hp->dtype;
+        if (off > SD_BLOCKSIZE - offsetof(dt_header_t, systime)) {
+          walk_len   = len;
+          walk_dtype = dtype;
+          walk_split = TRUE;
+          walk_cur  += SD_BLOCKSIZE;
+          if (walk_cur >= walk_end)
+            return FALSE;
+          dm_read(fo_blk(walk_cur));
+          return TRUE;
+        }
+        recnum = hp->recnum;
+      }
+      if (!walk_rec_ok(len, dtype, recnum))
+        return FALSE;
+      dmc.cur_recnum      = recnum;
+      dmc.last_rec_offset = walk_fo;
+      if (dtype == DT_SYNC || dtype == DT_REBOOT)
+        dmc.last_sync_offset = walk_fo;
+      walk_fo += (len + 3) & ~3;        /* records are quad aligned */
+    }
+    return FALSE;
+  }
+
+
+  /*
+   * restart_scan: kick off the reverse scan if there is anything
+   * in the Dblk Area.  returns TRUE if the scan is running.
+   */
+  bool restart_scan() {
+    uint32_t blk;
+
+    blk = dmc.dblk_nxt - 1;
+    if (dmc.dblk_nxt <= dmc.dblk_lower + 1) {
+      if (!walk_wrap)
+        return FALSE;                   /* empty, nothing to find */
+      blk = dmc.dblk_upper;             /* wrapped, newest at the end */
+    }
+    scan_low = dmc.dblk_lower + 1;
+    if (blk - scan_low >= DM_SYNC_SCAN_MAX)
+      scan_low = blk - DM_SYNC_SCAN_MAX + 1;
+    dm_state = DMS_SYNC;
+    dm_read(blk);
+    return TRUE;
+  }
+
+
+  /*
+   * oldest_scan: find the first SYNC in the oldest data, that gives
+   * us the first checkpoint.  returns TRUE if the read is running.
+   */
+  bool oldest_scan() {
+    if (!dmc.laps && dmc.dblk_nxt <= dmc.dblk_lower + 1)
+      return FALSE;                     /* nothing there */
+    old_fo = call DblkManager.dblk_oldest_offset();
+    if (!old_fo)
+      old_fo = SD_BLOCKSIZE;            /* not wrapped, 1st data sector */
+    wrap_n = 0;
+    dm_state = DMS_OLDEST;
+    dm_read(fo_blk(old_fo));
+    return TRUE;
+  }
+
+
+  /*
+   * erase_probe: recover erase_end.  Only matters once wrapped (it moves
+   * the oldest data up).  Erases always run to the end of a chunk, so
+   * the last sector of each chunk tells us.  The run starts past
+   * dblk_nxt (erase_start), so does the probe.  returns TRUE if reading.
+   */
+  bool erase_probe() {
+    dmc.erase_end = dmc.dblk_nxt;
+    if (!dmc.laps || !dmc.dblk_nxt || dmc.dblk_nxt >= dmc.dblk_upper)
+      return oldest_scan();
+    wrap_n = 0;
+    dm_state = DMS_ERASED;
+    dm_read(chunk_end(dmc.dblk_nxt + 1) - 1);
+    return TRUE;
+  }
+
+
+  /*
+   * scan_done: restart scan/walk finished.  If wrapped the end of the
+   * data is where the walk stopped.  returns TRUE if still reading.
+   */
+  bool scan_done() {
+    if (walk_wrap) {
+      walk_wrap = FALSE;
+      set_nxt((walk_fo + SD_BLOCKSIZE - 1) & ~(SD_BLOCKSIZE - 1));
+    }
+    return erase_probe();
+  }
+
+
+  /*
+   * erase_start: we have the SD, erase from just past dblk_nxt (or where
+   * the last one left off) to the end of that chunk.  Never dblk_nxt
+   * itself, SSW may have already written some of it (SSW_FLUSH_ALLOC).
+   */
+  void erase_start() {
+    uint32_t start;
+    error_t  err;
+
+    start = dmc.erase_end;
+    if (start <= dmc.dblk_nxt)
+      start = dmc.dblk_nxt + 1;
+    if (!dmc.dblk_nxt || start > dmc.dblk_upper) {
+      dm_state = DMS_IDLE;
+      call SDResource.release();
+      return;
+    }
+    dm_state = DMS_ERASE;
+    erase_to = chunk_end(start);
+    if ((err = call SDerase.erase(sblk_abs(start), sblk_abs(erase_to - 1))))
+      dm_panic(14, err, start);
+  }
+
+
+  /* only bother the SD for a pre-erase if someone else has it up */
+  task void erase_task() {
+    if (!erase_wanted() || !call SDActive.is_on())
+      return;
+    dm_state = DMS_ERASE_REQ;
+    if (call SDResource.request())
+      dm_state = DMS_IDLE;
+  }
+
+
+  /*
+   * wrap_probe: wrapped cold boot.  lower holds a SYNC from the newest
+   * lap, upper is past the boundary.  Look for a SYNC starting halfway.
+   */
+  void wrap_probe() {
+    if (upper - lower <= 1) {
+      /* lower has the last SYNC of the newest lap, walk from there */
+      dmc.dblk_nxt = lower + 1;
+      walk_wrap = TRUE;
+      restart_scan();
+      return;
+    }
+    wrap_m = (upper - lower)/2 + lower;
+    wrap_n = 0;
+    dm_state = DMS_WRAP_PROBE;
+    search_read(wrap_m);
+  }
+
+
+  event void Boot.booted() {
+    uint32_t l, u;
+    uint8_t  n;
+    error_t  err;
+
 #ifdef DBLK_ERASE_ENABLE
     /*
      * FS.erase is split phase and will grab the SD,  We will wait on the
@@ -129,11 +767,42 @@ implementation {
     }
     dmc.dm_sig_a = dmc.dm_sig_b = DM_SIG;
 
-    /* first sector is dblk directory, reserved */
+    /*
+     * first sector is dblk directory, reserved.  Any more DBLK files
+     * carry on the stream blks from the end of the last one.
+     */
+    dm_files[0].lower = lower;
+    dm_files[0].upper = upper;
+    dm_files[0].first = lower + 1;
+    for (n = 1; n < FS_DBLK_FILES_MAX; n++) {
+      l = call FileSystem.area_start(FS_LOC_DBLK + n);
+      u = call FileSystem.area_end(FS_LOC_DBLK + n);
+      if (!l)
+        break;
+      if (u <= l) {
+        dm_panic(16, l, u);
+        return;
+      }
+      dm_files[n].lower = l;
+      dm_files[n].upper = u;
+      dm_files[n].first = upper + 1;
+      upper += u - l;
+    }
+    dmc.dblk_files = n;
     dmc.dblk_lower = lower;
     dmc.dblk_nxt   = lower + 1;
     dmc.dblk_upper = upper;
+    dmc.laps       = 0;
     dmc.cur_recnum = 0;
+    dmc.last_rec_offset  = 0;
+    dmc.last_sync_offset = 0;
+    dmc.scan_reads = 0;
+    dmc.search_reads = 0;
+    dmc.hint_used = FALSE;
+    dmc.erase_end = lower + 1;
+    walk_wrap = FALSE;
+    ck_out = ck_num = 0;
+    ck_next = 0;
     dm_state = DMS_REQUEST;
     if ((err = call SDResource.request()))
       dm_panic(2, err, 0);
@@ -146,6 +815,10 @@ implementation {
 
     nop();
     nop();                              /* BRK */
+    if (dm_state == DMS_ERASE_REQ) {
+      erase_start();
+      return;
+    }
     if (dm_state != DMS_REQUEST) {
       dm_panic(3, dm_state, 0);
       return;
@@ -157,7 +830,30 @@ implementation {
       dm_panic(4, (parg_t) dm_buf, 0);
       return;
     }
-    if ((err = call SDread.read(dmc.dblk_nxt, dm_buf))) {
+    switch (hint_valid(ow_control_block.dblk_nxt_hint)) {
+      default:
+        break;
+
+      case 1:
+        dmc.hint_used = TRUE;
+        dm_state = DMS_HINT;
+        search_read(ow_control_block.dblk_nxt_hint);
+        return;
+
+      case 2:
+        /*
+         * wrapped, erased tells us nothing (pre-erase).  Trust the hint
+         * and let the walk find the actual end of the newest data.
+         */
+        dmc.hint_used = TRUE;
+        dmc.dblk_nxt  = ow_control_block.dblk_nxt_hint;
+        walk_wrap     = TRUE;
+        restart_scan();
+        return;
+    }
+    dm_blk = dmc.dblk_nxt;
+    dmc.search_reads++;
+    if ((err = call SDread.read(sblk_abs(dmc.dblk_nxt), dm_buf))) {
       dm_panic(5, err, 0);
       return;
     }
@@ -167,6 +863,7 @@ implementation {
   event void SDread.readDone(uint32_t blk_id, uint8_t *read_buf, error_t err) {
     uint8_t    *dp;
     bool        empty;
+    int16_t     off;
 
     nop();
     nop();                              /* BRK */
@@ -183,19 +880,74 @@ implementation {
 
       case DMS_START:
         /* if blk is erased, dmc.dblk_nxt is already correct. */
-        if (call SDraw.chk_erased(dp))
+        if (call SDraw.chk_erased(dp)) {
+#ifdef DBLK_CIRCULAR
+          /* unless wrapped and the front has been pre-erased */
+          dm_state = DMS_START_END;
+          search_read(dmc.dblk_upper);
+          return;
+#endif
           break;
+        }
 
-        lower = dmc.dblk_nxt;
-        upper = dmc.dblk_upper;
+        scan_range(dmc.dblk_nxt, dmc.dblk_upper);
+        return;
 
-        cur_blk = (upper - lower)/2 + lower;
-        if (cur_blk == lower)
-          cur_blk = lower = upper;
+      case DMS_START_END:
+        if (call SDraw.chk_erased(dp))
+          break;                        /* empty */
+        walk_wrap = TRUE;               /* wrapped, newest at the end */
+        if (restart_scan())
+          return;
+        break;
 
-        dm_state = DMS_SCAN;
-        if ((err = call SDread.read(cur_blk, dp)))
-          dm_panic(8, err, 0);
+      case DMS_HINT:
+        /* hinted dblk_nxt must be erased, else it is too low */
+        if (!call SDraw.chk_erased(dp)) {
+          gal_blk  = cur_blk;
+          gal_step = 1;
+          gallop_up();
+          return;
+        }
+        dm_state = DMS_HINT_PREV;
+        search_read(cur_blk - 1);
+        return;
+
+      case DMS_HINT_PREV:
+        /* and the one before it written, else the hint is too high */
+        if (!call SDraw.chk_erased(dp)) {
+          dmc.dblk_nxt = cur_blk + 1;
+          if (restart_scan())
+            return;
+          break;
+        }
+        gal_blk  = cur_blk;
+        gal_step = 1;
+        gallop_dn();
+        return;
+
+      case DMS_GALLOP_UP:
+        if (call SDraw.chk_erased(dp)) {
+          scan_range(gal_blk, cur_blk);
+          return;
+        }
+        gal_blk   = cur_blk;
+        gal_step <<= 1;
+        gallop_up();
+        return;
+
+      case DMS_GALLOP_DN:
+        if (!call SDraw.chk_erased(dp)) {
+          scan_range(cur_blk, gal_blk);
+          return;
+        }
+        gal_blk = cur_blk;
+        if (cur_blk <= dmc.dblk_lower + 1) {
+          dmc.dblk_nxt = cur_blk;       /* nothing written */
+          break;
+        }
+        gal_step <<= 1;
+        gallop_dn();
         return;
 
       case DMS_SCAN:
@@ -211,8 +963,17 @@ implementation {
            */
           if (empty) {
             dmc.dblk_nxt = cur_blk;
+            if (restart_scan())
+              return;
             break;              /* break out of switch, we be done */
           }
+#ifdef DBLK_CIRCULAR
+          /* nothing erased, we have wrapped.  go find the boundary */
+          wrap_n = 0;
+          dm_state = DMS_WRAP_R0;
+          search_read(dmc.dblk_lower + 1);
+          return;
+#endif
           dm_panic(9, (parg_t) cur_blk, 0);
           return;
         }
@@ -223,9 +984,129 @@ implementation {
         cur_blk = (upper - lower)/2 + lower;
         if (cur_blk == lower)
           cur_blk = lower = upper;
-        if ((err = call SDread.read(cur_blk, dp)))
-          dm_panic(10, err, 0);
+        search_read(cur_blk);
         return;
+
+      case DMS_SYNC:
+        off = find_sync(dp);
+        if (off < 0) {
+          if (dm_blk > scan_low) {
+            dm_read(dm_blk - 1);
+            return;
+          }
+          /* no SYNC within range, recnums start over */
+          call Panic.warn(PANIC_DM, 12, dmc.dblk_nxt, scan_low, 0, 0);
+          if (walk_wrap && !dmc.laps)
+            dmc.laps = 1;               /* lost the lap, still wrapped */
+          walk_wrap = FALSE;
+          if (oldest_scan())
+            return;
+          break;
+        }
+
+        /*
+         * walk from the SYNC itself.  Back cur_recnum off by one so
+         * the SYNC passes the next recnum check.
+         *
+         * The walk is in logical file offsets, the SYNC's prev_sync
+         * tells us which lap it is in.  If wrapped we don't know where
+         * the data ends, walk until the records stop making sense.
+         */
+        dmc.laps   = sync_laps(blk_fo(dm_blk) + off,
+                               ((dt_sync_t *) (dp + off))->prev_sync |
+                               (uint64_t) ((dt_sync_t *) (dp + off))->prev_sync_hi << 32);
+        walk_fo    = blk_fo(dm_blk) + off + lap_base();
+        walk_cur   = blk_fo(dm_blk) + lap_base();
+        if (walk_wrap)
+          walk_end = walk_cur + (DM_SYNC_SCAN_MAX << SD_BLOCKSIZE_NBITS);
+        else
+          walk_end = call DblkManager.dblk_nxt_offset();
+        walk_split = FALSE;
+        dmc.cur_recnum = ((dt_header_t *) (dp + off))->recnum - 1;
+        dm_state = DMS_WALK;
+        if (walk_records(dp))
+          return;
+        if (scan_done())
+          return;
+        break;
+
+      case DMS_WALK:
+        if (walk_records(dp))
+          return;
+        if (scan_done())
+          return;
+        break;
+
+      case DMS_WRAP_R0:
+        /* recnum of the 1st SYNC at the front, newest lap */
+        off = find_sync(dp);
+        if (off < 0) {
+          if (++wrap_n < DM_SYNC_SCAN_MAX) {
+            search_read(cur_blk + 1);
+            return;
+          }
+          /* can't tell where we are, start over at the front */
+          call Panic.warn(PANIC_DM, 13, cur_blk, 0, 0, 0);
+          dmc.dblk_nxt = dmc.dblk_lower + 1;
+          dmc.laps     = 1;
+          break;
+        }
+        wrap_r0 = ((dt_header_t *) (dp + off))->recnum;
+        lower   = cur_blk;
+        upper   = dmc.dblk_upper + 1;
+        wrap_probe();
+        return;
+
+      case DMS_WRAP_PROBE:
+        /*
+         * first SYNC at or after wrap_m.  Sectors are all from one lap
+         * or the other.  A newer recnum moves lower up, an older one
+         * (or none before upper) says the boundary is below wrap_m.
+         */
+        off = find_sync(dp);
+        if (off < 0) {
+          if (++wrap_n < DM_SYNC_SCAN_MAX && cur_blk + 1 < upper) {
+            search_read(cur_blk + 1);
+            return;
+          }
+          upper = wrap_m;
+          wrap_probe();
+          return;
+        }
+        if (((dt_header_t *) (dp + off))->recnum >= wrap_r0)
+          lower = cur_blk;
+        else
+          upper = wrap_m;
+        wrap_probe();
+        return;
+
+      case DMS_ERASED:
+        if (call SDraw.chk_erased(dp)) {
+          dmc.erase_end = dm_blk + 1;
+          if (dmc.erase_end <= dmc.dblk_upper &&
+              ++wrap_n < DM_ERASE_PROBE_MAX) {
+            dm_read(chunk_end(dmc.erase_end) - 1);
+            return;
+          }
+        }
+        if (oldest_scan())
+          return;
+        break;
+
+      case DMS_OLDEST:
+        off = find_sync(dp);
+        if (off >= 0) {
+          call DblkManager.note_sync(old_fo + off,
+                                     ((dt_header_t *) (dp + off))->recnum);
+          break;
+        }
+        old_fo += SD_BLOCKSIZE;
+        if (++wrap_n < DM_SYNC_SCAN_MAX &&
+            old_fo < call DblkManager.dblk_nxt_offset()) {
+          dm_read(fo_blk(old_fo));
+          return;
+        }
+        break;                          /* no checkpoint, oh well */
     }
 
     dm_state = DMS_IDLE;
@@ -250,31 +1131,181 @@ implementation {
 
 
   async command uint32_t DblkManager.get_dblk_high() {
-    return dmc.dblk_upper;
+    return sblk_file(dmc.dblk_nxt)->upper;
+  }
+
+
+  async command uint32_t DblkManager.blk_file_high(uint32_t blk_id) {
+    uint8_t i;
+
+    for (i = 0; i < dmc.dblk_files; i++)
+      if (blk_id >= dm_files[i].lower && blk_id <= dm_files[i].upper)
+        return dm_files[i].upper;
+    return 0;
   }
 
 
   async command uint32_t DblkManager.get_dblk_nxt() {
-    return dmc.dblk_nxt;
+    return sblk_abs(dmc.dblk_nxt);
   }
 
 
-  async command uint32_t DblkManager.dblk_nxt_offset() {
+  async command uint64_t DblkManager.dblk_nxt_offset() {
     if (dmc.dblk_nxt)
-      return (dmc.dblk_nxt - dmc.dblk_lower) << SD_BLOCKSIZE_NBITS;
+      return blk_fo(dmc.dblk_nxt) + lap_base();
     return 0;
   }
 
 
+  async command uint32_t DblkManager.offset_blk(uint64_t offset) {
+    return sblk_abs(fo_blk(offset));
+  }
+
+
+  async command uint64_t DblkManager.dblk_oldest_offset() {
+    if (!dmc.laps || !dmc.dblk_nxt)
+      return 0;
+    return call DblkManager.dblk_nxt_offset() +
+      ((uint64_t) erase_ahead() << SD_BLOCKSIZE_NBITS) -
+      ((uint64_t) area_secs() << SD_BLOCKSIZE_NBITS);
+  }
+
+
+  async command uint32_t DblkManager.dblk_oldest_recnum() {
+    atomic {
+      if (ck_num)
+        return dm_ckpt[ck_out].recnum;
+    }
+    return 0;
+  }
+
+
+  /*
+   * Collect tells us about every SYNC/REBOOT it lays down.  Only keep
+   * one every N/(DM_CKPTS - 2) sectors so a lap fits in the ring.
+   */
+  async command void DblkManager.note_sync(uint64_t offset, uint32_t recnum) {
+    uint32_t space;
+    uint8_t  idx;
+
+    atomic {
+      if (offset < ck_next || ck_num >= DM_CKPTS)
+        return;
+      idx = ck_out + ck_num;
+      if (idx >= DM_CKPTS)
+        idx -= DM_CKPTS;
+      dm_ckpt[idx].offset = offset;
+      dm_ckpt[idx].recnum = recnum;
+      ck_num++;
+      space = area_secs() / (DM_CKPTS - 2);
+      if (!space)
+        space = 1;
+      ck_next = offset + ((uint64_t) space << SD_BLOCKSIZE_NBITS);
+    }
+  }
+
+
+  async command uint32_t DblkManager.get_cur_recnum() {
+    return dmc.cur_recnum;
+  }
+
+
+  async command uint64_t DblkManager.get_last_rec_offset() {
+    return dmc.last_rec_offset;
+  }
+
+
+  async command uint64_t DblkManager.get_last_sync_offset() {
+    return dmc.last_sync_offset;
+  }
+
+
   async command uint32_t DblkManager.adv_dblk_nxt() {
     atomic {
       if (dmc.dblk_nxt) {
         dmc.dblk_nxt++;
-        if (dmc.dblk_nxt > dmc.dblk_upper)
+        if (dmc.dblk_nxt > dmc.dblk_upper) {
+#ifdef DBLK_CIRCULAR
+          dmc.dblk_nxt = dmc.dblk_lower + 1;
+          dmc.laps++;
+          dmc.erase_end = dmc.dblk_nxt; /* erased run starts over */
+#else
           dmc.dblk_nxt = 0;
+#endif
+        }
       }
+
+      ck_drop();
+      if (erase_wanted())
+        post erase_task();
+
+      ow_control_block.dblk_nxt_hint = dmc.dblk_nxt;
+      ow_control_block.dblk_hint_chk =
+        DM_HINT_CHK(dmc.dblk_nxt, dmc.dblk_lower) ^
+        (dmc.laps ? DM_HINT_WRAPPED : 0);
     }
-    return dmc.dblk_nxt;
+    return sblk_abs(dmc.dblk_nxt);
+  }
+
+
+  /* Tagnet offsets are the low word, see DblkMapFileP */
+  command bool DblkOldestOffset.get_value(uint32_t *t, uint32_t *l) {
+    uint64_t oldest;
+
+    oldest = call DblkManager.dblk_oldest_offset();
+    if (!oldest && call DblkManager.dblk_nxt_offset() > SD_BLOCKSIZE)
+      oldest = SD_BLOCKSIZE;            /* not wrapped, 1st data sector */
+    *t = oldest;
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool DblkOldestRecnum.get_value(uint32_t *t, uint32_t *l) {
+    *t = call DblkManager.dblk_oldest_recnum();
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool DblkEraseWin.get_value(uint32_t *t, uint32_t *l) {
+    *t = erase_win;
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool DblkOldestOffset.set_value(uint32_t *t, uint32_t *l) { return FALSE; }
+  command bool DblkOldestRecnum.set_value(uint32_t *t, uint32_t *l) { return FALSE; }
+
+  /* pre-erase window, chunks of DM_ERASE_CHUNK sectors, 0 turns it off */
+  command bool DblkEraseWin.set_value(uint32_t *t, uint32_t *l) {
+    if (*l != sizeof(uint32_t) || *t > DM_ERASE_WIN_MAX)
+      return FALSE;
+    erase_win = *t;
+    return TRUE;
+  }
+
+
+  event void SDerase.eraseDone(uint32_t blk_start, uint32_t blk_end, error_t err) {
+    if (err || dm_state != DMS_ERASE) {
+      call Panic.panic(PANIC_DM, 15, err, dm_state, blk_start, blk_end);
+      return;
+    }
+    dmc.erase_end = erase_to;
+    dmc.erase_chunks++;
+    ck_drop();
+    dm_state = DMS_IDLE;
+    call SDResource.release();
+    if (erase_wanted())
+      post erase_task();
+  }
+
+
+  /* somebody powered the SD up, get some erasing in */
+  event void SDActive.on() {
+    if (erase_wanted())
+      post erase_task();
   }
 
 
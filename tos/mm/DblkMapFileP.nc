@@ -32,38 +32,70 @@
 #include <sd.h>
 
 /*
- * dblk_map_cache_t   defines the information context representing
- *                    the dblk file cache.
+ * DblkMapFile cache
  *
- * the dblk cache always stores sectors or partial sectors (if the
- * last sector being written by the data stream).  The cache contents
- * is identified by the starting offset of the block and its length.
- * In addition we also store the absolute blk_id of the sector but
- * this can also be derived from the block offset (but would be needed
- * to be added to dblk_low to get the absolute block).
+ * The cache is DMF_CACHE_SECTORS sector slots managed LRU.  Each slot
+ * holds a sector or partial sector (if the last sector being written by
+ * the data stream).  Slot contents are identified by the starting offset
+ * of the block and its length.  In addition we also store the absolute
+ * blk_id of the sector (0 says the slot is empty).
  *
- * Three flags are maintained to track the progress of block reads
- * and the last err is remembered.  These datums are for informational
- * purposes only and do not effect the algorithm.
+ * Only one fill (miss) can be pending at a time.  While it is, map()
+ * calls that hit still get satisfied immediately, other misses are
+ * aborted with EBUSY.  DBLK byte and note contexts share the cache.
  *
- * Only one map() call can be pending at a time.  Either the map call
- * can be satisfied immediately (cache hit) or the underlying data store
- * will be accessed using split phase.  While this underlying read
- * is pending any other map() calls will be aborted with EBUSY.
+ * Read-ahead.  A miss on a sector whose predecessor is in the cache
+ * means someone is reading through the file (a bulk download).  Rather
+ * than arbitrating for and powering up the SD for each sector, we pull
+ * in up to DMF_READ_AHEAD committed sectors with one multi-block read
+ * (SDread.read_multi), scattered into the LRU slots.  Random access
+ * only brings in the one sector.
+ *
+ * hits/misses and fill latency (ms, request to readDone) are kept for
+ * sizing the cache and are available via Tagnet.
+ *
+ * Offsets.  The data stream can span more than one DBLK file and be
+ * bigger than 4 GiB, its file offsets are 64 bits.  ByteMapFile offsets
+ * are 32 bits, the context is the high word (which 4 GiB window of the
+ * stream), so Tagnet dblk/byte reads pass the high word as the context.
+ * filesize/commitsize are what is in that window.  Tagnet names that
+ * return a file offset return the low word.
  */
 
+#ifndef DMF_CACHE_SECTORS
+#define DMF_CACHE_SECTORS 8
+#endif
+
+#ifndef DMF_READ_AHEAD
+#define DMF_READ_AHEAD 4
+#endif
+
+#if DMF_READ_AHEAD >= DMF_CACHE_SECTORS
+#error "DMF_READ_AHEAD must be less than DMF_CACHE_SECTORS"
+#endif
+
 typedef struct {
-  struct {
-    uint32_t             id;         // storage block id - 0 if cache invalid
-    uint32_t             offset;     // file offset of cached block
-    uint32_t             len;        // how much is in the cache.
-  } cache;
+  uint32_t             id;           // storage block id - 0 if slot invalid
+  uint64_t             offset;       // file offset of cached block
+  uint32_t             len;          // how much is in the slot.
+  uint32_t             last_use;     // lru stamp
+  bool                 filling;      // being brought in
+} dmf_slot_t;
 
+typedef struct {
   uint32_t             fill_blk_id;  // blk_id being brought into the cache
+  uint8_t              fill_count;   // sectors being brought in
+  uint8_t              fill_slot[DMF_READ_AHEAD];
+  uint32_t             fill_t0;      // when the fill was started
+  uint32_t             lru_clock;
   error_t              err;          // last error encountered
-  bool                 ready;        // true if cache has valid data
   bool                 requested;    // true if sd.request in progress
   bool                 reading;      // true if sd.read in progress
+
+  uint32_t             hits;
+  uint32_t             misses;
+  uint32_t             fill_last_ms;
+  uint32_t             fill_max_ms;
 } dblk_map_cache_t;
 
 #ifndef PANIC_DM
@@ -76,36 +108,129 @@ enum {
 
 
 module DblkMapFileP {
-  provides  interface ByteMapFile as DMF;
+  provides {
+    interface ByteMapFile as DMF;
+    interface TagnetAdapter<uint32_t> as DblkCacheHits;
+    interface TagnetAdapter<uint32_t> as DblkCacheMisses;
+    interface TagnetAdapter<uint32_t> as DblkCacheFillMax;
+  }
   uses {
     interface StreamStorage as SS;
     interface SDread        as SDread;
     interface Resource      as SDResource;
+    interface LocalTime<TMilli>;
     interface Panic;
   }
 }
 implementation {
   dblk_map_cache_t dmf_cb;
-  uint8_t          dmf_cache[SD_BLOCKSIZE] __attribute__ ((aligned (4)));
+  dmf_slot_t       dmf_slots[DMF_CACHE_SECTORS];
+  uint8_t          dmf_cache[DMF_CACHE_SECTORS][SD_BLOCKSIZE]
+                                        __attribute__ ((aligned (4)));
+  uint8_t         *dmf_bufs[DMF_READ_AHEAD];
 
   void dmap_panic(uint8_t where, parg_t p0, parg_t p1) {
-    call Panic.panic(PANIC_DM, where, p0, p1, dmf_cb.cache.id,
-                     dmf_cb.cache.len);
+    call Panic.panic(PANIC_DM, where, p0, p1, dmf_cb.fill_blk_id,
+                     dmf_cb.fill_count);
+  }
+
+
+  /* find the slot holding offset, NULL if not cached */
+  dmf_slot_t *dmf_lookup(uint64_t offset) {
+    dmf_slot_t *sp;
+    uint8_t     i;
+
+    for (i = 0; i < DMF_CACHE_SECTORS; i++) {
+      sp = &dmf_slots[i];
+      if (sp->id && (sp->offset <= offset) &&
+          (offset < (sp->offset + sp->len)))
+        return sp;
+    }
+    return NULL;
+  }
+
+
+  /* find the slot holding blk_id, NULL if not cached */
+  dmf_slot_t *dmf_find_blk(uint32_t blk_id) {
+    uint8_t i;
+
+    for (i = 0; i < DMF_CACHE_SECTORS; i++)
+      if (dmf_slots[i].id == blk_id)
+        return &dmf_slots[i];
+    return NULL;
+  }
+
+
+  /*
+   * dmf_victim: pick a slot to replace.  empty first, otherwise
+   * the least recently used.  Slots being filled are off limits.
+   */
+  uint8_t dmf_victim() {
+    dmf_slot_t *sp;
+    uint8_t     i, victim;
+    uint32_t    oldest;
+
+    victim = DMF_CACHE_SECTORS;
+    oldest = 0xffffffff;
+    for (i = 0; i < DMF_CACHE_SECTORS; i++) {
+      sp = &dmf_slots[i];
+      if (sp->filling)
+        continue;
+      if (sp->id == 0)
+        return i;
+      if (sp->last_use < oldest) {
+        oldest = sp->last_use;
+        victim = i;
+      }
+    }
+    if (victim >= DMF_CACHE_SECTORS)
+      dmap_panic(36, victim, 0);
+    return victim;
+  }
+
+
+  /*
+   * hand out a piece of a cached slot.  minimum one byte, or *lenp,
+   * or len_avail in the slot.
+   */
+  error_t dmf_hit(dmf_slot_t *sp, uint64_t offset,
+                  uint8_t **bufp, uint32_t *lenp) {
+    uint32_t len_avail;
+
+    sp->last_use = ++dmf_cb.lru_clock;
+    *bufp = &dmf_cache[sp - dmf_slots][(offset - sp->offset)];
+
+    /* check and possibly modify how much data we can make available */
+    len_avail = sp->offset + sp->len - offset;
+    if (len_avail < *lenp)
+      *lenp = len_avail;
+    return SUCCESS;
+  }
+
+
+  /* how much of size is in the 4 GiB window context */
+  uint32_t dmf_window(uint32_t context, uint64_t size) {
+    uint64_t base;
+
+    base = (uint64_t) context << 32;
+    if (size <= base)
+      return 0;
+    size -= base;
+    return (size > 0xffffffff) ? 0xffffffff : size;
   }
 
 
   command error_t DMF.map(uint32_t context, uint8_t **bufp,
                           uint32_t offset, uint32_t *lenp) {
+    dmf_slot_t *sp;
+    uint64_t    fo;                     /* full file offset */
     uint32_t    blk_id;
     uint32_t    len;
-    uint32_t    blk_offset;
+    uint64_t    blk_offset;
     uint8_t    *blk_buf;
-    uint32_t    len_avail;
+    uint32_t    avail;
     uint32_t   *src, *dst, count;
-
-    /* if we are in the middle of bringing a new block in, no new requests */
-    if (dmf_cb.fill_blk_id)
-      return EBUSY;
+    uint8_t     i, n;
 
     if (!lenp || !bufp)                 /* nulls are very bad */
       dmap_panic(32, 0, 0);
@@ -115,37 +240,30 @@ implementation {
       return EINVAL;                    /* should we return SUCCESS? */
     }
 
-    /*
-     * see if we have a cache hit.
-     * we will have a cache hit iff:
-     *
-     *    cache.offset <= offset < cache.offset + cache.len
-     *
-     * minimum one byte, or *lenp, or len_avail in cache.
-     */
-
-    if (dmf_cb.cache.id &&              /* cache valid? */
-        (dmf_cb.cache.offset <= offset) &&
-        (offset < (dmf_cb.cache.offset + dmf_cb.cache.len))) {
-      *bufp = &dmf_cache[(offset - dmf_cb.cache.offset)];
-
-      /* check and possibly modify how much data we can make available */
-      len_avail = dmf_cb.cache.offset + dmf_cb.cache.len - offset;
-      if (len_avail < *lenp)
-        *lenp = len_avail;
-      return SUCCESS;
+    /* cache hit?  hits are fine even while a fill is in progress */
+    fo = ((uint64_t) context << 32) | offset;
+    sp = dmf_lookup(fo);
+    if (sp) {
+      dmf_cb.hits++;
+      return dmf_hit(sp, fo, bufp, lenp);
     }
 
+    /* if we are in the middle of bringing a new block in, no new requests */
+    if (dmf_cb.fill_blk_id)
+      return EBUSY;
+
     /* cache miss, ask the low level where things live */
-    blk_id = call SS.where(context, offset, &len, &blk_offset, &blk_buf);
-    if (!blk_id) {                      /* past eof   */
+    dmf_cb.misses++;
+    blk_id = call SS.where(context, fo, &len, &blk_offset, &blk_buf);
+    if (!blk_id) {                      /* past eof, or overwritten */
       *bufp = NULL;                     /* no result  */
       *lenp = 0;                        /* no result  */
       return EODATA;
     }
 
-    /* invalidate current cache */
-    dmf_cb.cache.id = 0;
+    /* toss any stale (partial) copy of this block */
+    if ((sp = dmf_find_blk(blk_id)))
+      sp->id = 0;
 
     /*
      * we got something...
@@ -163,8 +281,10 @@ implementation {
        * data is in SSW (low level) memory waiting to go out.
        * we need to copy it into the cache and update our control cells.
        */
+      n     = dmf_victim();
+      sp    = &dmf_slots[n];
       src   = (uint32_t *) blk_buf;
-      dst   = (uint32_t *) dmf_cache;
+      dst   = (uint32_t *) dmf_cache[n];
       count = len;
       while (count > 3) {
         *dst++ = *src++;
@@ -174,31 +294,53 @@ implementation {
         *dst++ = *src++;
 
       /* update control datums */
-      dmf_cb.cache.id     = blk_id;
-      dmf_cb.cache.offset = blk_offset;
-      dmf_cb.cache.len    = len;
-
-      *bufp = &dmf_cache[(offset - dmf_cb.cache.offset)];
-
-      /* check and possibly modify how much data we can make available */
-      len_avail = dmf_cb.cache.offset + dmf_cb.cache.len - offset;
-      if (len_avail < *lenp)
-        *lenp = len_avail;
-      return SUCCESS;
+      sp->id     = blk_id;
+      sp->offset = blk_offset;
+      sp->len    = len;
+      return dmf_hit(sp, fo, bufp, lenp);
     }
 
     /*
      * data is out on disk.  we need to read it into the cache.
+     *
+     * sequential if the previous sector is cached, read ahead.  Only
+     * sectors that have been committed are on disk, where() only tells
+     * us about this sector.  Stop at anything we already have.
      */
+    count = 1;
+    if (dmf_find_blk(blk_id - 1)) {
+      avail = (call SS.committed_offset() - blk_offset) >> SD_BLOCKSIZE_NBITS;
+      count = (avail < DMF_READ_AHEAD) ? avail : DMF_READ_AHEAD;
+      avail = call SS.get_dblk_high(blk_id) - blk_id + 1; /* end of file */
+      count = (avail < count) ? avail : count;
+      for (n = 1; n < count; n++)
+        if (dmf_find_blk(blk_id + n))
+          break;
+      count = (n < count) ? n : count;
+      if (count == 0)
+        count = 1;
+    }
+
+    for (i = 0; i < count; i++) {
+      n  = dmf_victim();
+      sp = &dmf_slots[n];
+      sp->id      = 0;
+      sp->filling = TRUE;
+      sp->offset  = blk_offset + (i << SD_BLOCKSIZE_NBITS);
+      sp->len     = SD_BLOCKSIZE;
+      dmf_cb.fill_slot[i] = n;
+      dmf_bufs[i] = dmf_cache[n];
+    }
     dmf_cb.fill_blk_id  = blk_id;
-    dmf_cb.ready        = FALSE;
+    dmf_cb.fill_count   = count;
+    dmf_cb.fill_t0      = call LocalTime.get();
     dmf_cb.requested    = FALSE;
     dmf_cb.reading      = FALSE;
-    dmf_cb.cache.offset = blk_offset;
-    dmf_cb.cache.len    = len;
     dmf_cb.err = call SDResource.request();
     if (dmf_cb.err != SUCCESS) {
       dmap_panic(33, dmf_cb.err, 0);
+      for (i = 0; i < count; i++)
+        dmf_slots[dmf_cb.fill_slot[i]].filling = FALSE;
       dmf_cb.fill_blk_id  = 0;
       return FAIL;
     }
@@ -208,10 +350,15 @@ implementation {
 
 
   event void SDResource.granted() {
+    uint8_t i;
+
     dmf_cb.requested = FALSE;
-    dmf_cb.err = call SDread.read(dmf_cb.fill_blk_id, dmf_cache);
+    dmf_cb.err = call SDread.read_multi(dmf_cb.fill_blk_id, dmf_bufs,
+                                        dmf_cb.fill_count);
     if (dmf_cb.err) {
       dmap_panic(34, dmf_cb.err, 0);
+      for (i = 0; i < dmf_cb.fill_count; i++)
+        dmf_slots[dmf_cb.fill_slot[i]].filling = FALSE;
       dmf_cb.fill_blk_id = 0;
       call SDResource.release();
       signal DMF.data_avail(dmf_cb.err);
@@ -223,34 +370,72 @@ implementation {
 
 
   event void SDread.readDone(uint32_t blk_id, uint8_t *read_buf, error_t err) {
+    dmf_slot_t *sp;
+    uint8_t     i;
+
     if (blk_id != dmf_cb.fill_blk_id ||
-        read_buf != dmf_cache || err)
+        read_buf != dmf_bufs[0] || err)
       dmap_panic(35, err, blk_id);
-    dmf_cb.fill_blk_id = 0;             /* err or success, open lock */
     call SDResource.release();
+    for (i = 0; i < dmf_cb.fill_count; i++) {
+      sp = &dmf_slots[dmf_cb.fill_slot[i]];
+      sp->filling = FALSE;
+      if (!err) {
+        sp->id       = blk_id + i;      /* validate */
+        sp->last_use = ++dmf_cb.lru_clock;
+      }
+    }
+    dmf_cb.fill_blk_id = 0;             /* err or success, open lock */
+    dmf_cb.requested   = FALSE;
+    dmf_cb.reading     = FALSE;
     if (err) {
       dmf_cb.err         = err;
       signal DMF.data_avail(err);
       return;
     }
-    dmf_cb.ready      = TRUE;
-    dmf_cb.requested  = FALSE;
-    dmf_cb.reading    = FALSE;
-    dmf_cb.cache.id = blk_id;           /* validate */
+    dmf_cb.fill_last_ms = call LocalTime.get() - dmf_cb.fill_t0;
+    if (dmf_cb.fill_last_ms > dmf_cb.fill_max_ms)
+      dmf_cb.fill_max_ms = dmf_cb.fill_last_ms;
     signal DMF.data_avail(SUCCESS);
   }
 
 
   command uint32_t DMF.filesize(uint32_t context) {
-    return call SS.eof_offset();
+    return dmf_window(context, call SS.eof_offset());
   }
 
 
   command uint32_t DMF.commitsize(uint32_t context) {
-    return call SS.committed_offset();
+    return dmf_window(context, call SS.committed_offset());
+  }
+
+
+  command bool DblkCacheHits.get_value(uint32_t *t, uint32_t *l) {
+    *t = dmf_cb.hits;
+    *l = 4;
+    return 1;
   }
 
 
+  command bool DblkCacheMisses.get_value(uint32_t *t, uint32_t *l) {
+    *t = dmf_cb.misses;
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool DblkCacheFillMax.get_value(uint32_t *t, uint32_t *l) {
+    *t = dmf_cb.fill_max_ms;
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool DblkCacheHits.set_value(uint32_t *t, uint32_t *l)    { return FALSE; }
+  command bool DblkCacheMisses.set_value(uint32_t *t, uint32_t *l)  { return FALSE; }
+  command bool DblkCacheFillMax.set_value(uint32_t *t, uint32_t *l) { return FALSE; }
+
+
           event void SS.dblk_stream_full() { }
           event void SS.dblk_advanced(uint32_t last) { }
   async   event void Panic.hook()          { }
@@ -26,6 +26,9 @@
 interface FileSystem {
   /*
    * return area start and end
+   *
+   * which may be any locator up to MAX_FS_LOCATORS.  Extra DBLK files
+   * (FS_LOC_DBLK + 1 on) that aren't on the card return 0.
    */
   async command uint32_t area_start(uint8_t which);
   async command uint32_t area_end(uint8_t which);
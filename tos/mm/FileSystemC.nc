@@ -34,6 +34,9 @@ configuration FileSystemC {
     interface FileSystem  as FS;
     interface ByteMapFile as DblkFileMap;
     interface ByteMapFile as PanicFileMap;
+    interface TagnetAdapter<uint32_t> as DblkCacheHits;
+    interface TagnetAdapter<uint32_t> as DblkCacheMisses;
+    interface TagnetAdapter<uint32_t> as DblkCacheFillMax;
   }
   uses interface Boot;			/* incoming signal */
 }
@@ -50,10 +53,14 @@ implementation {
   DblkFileMap  = DMF.DMF;
   PanicFileMap = PMF.PMF;
 
+  DblkCacheHits    = DMF.DblkCacheHits;
+  DblkCacheMisses  = DMF.DblkCacheMisses;
+  DblkCacheFillMax = DMF.DblkCacheFillMax;
+
   components     SSWriteC;
   components new SD0_ArbC() as SD_FS;   /* filesystem   SD   */
-  components new SD0_ArbC() as SD_DMF;  /* DblkMapFile  SD   */
-  components new SD0_ArbC() as SD_PMF;  /* PanicMapFile SD   */
+  components new SD0_FgArbC() as SD_DMF; /* DblkMapFile  SD, foreground */
+  components new SD0_FgArbC() as SD_PMF; /* PanicMapFile SD, foreground */
   components     SD0C       as SDsa;    /* StandAlone for FS */
 
   FS_P.SSW        -> SSWriteC;
@@ -70,6 +77,9 @@ implementation {
 
   DMF.SS            -> SSWriteC;
 
+  components LocalTimeMilliC;
+  DMF.LocalTime     -> LocalTimeMilliC;
+
   components PanicC;
   FS_P.Panic -> PanicC;
   DMF.Panic         -> PanicC;
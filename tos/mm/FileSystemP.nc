@@ -123,7 +123,10 @@ implementation {
 
     if (fsl->loc_sig != FS_LOC_SIG || fsl->loc_sig_a != FS_LOC_SIG)
       return 1;
-    for (i = 0; i < FS_LOC_MAX; i++) {
+    for (i = 0; i < MAX_FS_LOCATORS; i++) {
+      if (i >= FS_LOC_MAX &&            /* extra DBLK files, optional */
+          !fsl->locators[i].start && !fsl->locators[i].end)
+        continue;
       if (!(fsl->locators[i].start) || !(fsl->locators[i].end))
         return 3;
       if ((fsl->locators[i].start  > fsl->locators[i].end))
@@ -148,16 +151,8 @@ implementation {
 
     fs_state = FSS_ERASE;
     start = fs_loc.locators[fs_which].start;
-    switch (fs_which) {
-      default:
-      case FS_LOC_PANIC:
-      case FS_LOC_CONFIG:
-      case FS_LOC_IMAGE:
-        break;
-      case FS_LOC_DBLK:
-        start++;                        /* don't do directory */
-        break;
-    }
+    if (fs_which >= FS_LOC_DBLK)        /* any DBLK file */
+      start++;                          /* don't do directory */
     err = call SDerase.erase(start, fs_loc.locators[fs_which].end);
     if (err)
       fs_panic(4, err);
@@ -179,7 +174,8 @@ implementation {
 #ifdef FS_ENABLE_ERASE
     error_t err;
 
-    if (fs_state != FSS_IDLE || which >= FS_LOC_MAX)
+    if (fs_state != FSS_IDLE || which >= MAX_FS_LOCATORS ||
+        !fs_loc.locators[which].start)
       call Panic.panic(PANIC_FS, 8, fs_state, which, 0, 0);
 
     fs_which = which;
@@ -198,8 +194,9 @@ implementation {
   }
 
 
+  /* extra DBLK files not there are 0 */
   async command uint32_t FS.area_start(uint8_t which) {
-    if (which < FS_LOC_MAX)
+    if (which < MAX_FS_LOCATORS)
       return fs_loc.locators[which].start;
     fs_panic(7, which);
     return 0;
@@ -207,7 +204,7 @@ implementation {
 
 
   async command uint32_t FS.area_end(uint8_t which) {
-    if (which < FS_LOC_MAX)
+    if (which < MAX_FS_LOCATORS)
       return fs_loc.locators[which].end;
     fs_panic(8, which);
     return 0;
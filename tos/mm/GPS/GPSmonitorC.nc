@@ -25,6 +25,7 @@ configuration GPSmonitorC {
   provides {
     interface TagnetAdapter<tagnet_gps_xyz_t> as InfoSensGpsXyz;
     interface TagnetAdapter<tagnet_gps_cmd_t> as InfoSensGpsCmd;
+    interface TagnetAdapter<uint32_t>         as GpsFilter;
   }
   uses {
     interface GPSControl;
@@ -37,6 +38,7 @@ implementation {
   components GPSmonitorP;
   InfoSensGpsXyz = GPSmonitorP;
   InfoSensGpsCmd = GPSmonitorP;
+  GpsFilter      = GPSmonitorP;
 
   GPSControl     = GPSmonitorP;
   GPSTransmit    = GPSmonitorP;
@@ -57,4 +59,5 @@ implementation {
   components CollectC;
   GPSmonitorP.CollectEvent -> CollectC;
   GPSmonitorP.Collect -> CollectC;
+  GPSmonitorP.CollectFlush -> CollectC;
 }
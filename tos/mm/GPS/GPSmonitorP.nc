@@ -28,6 +28,23 @@
  * multibyte datums in the GPS packets are big endian.  We are little
  * endian so must compensate.
  *
+ * Received packets are logged raw (DT_GPS_RAW_SIRFBIN) subject to the
+ * filter table, a policy per MID (see DT_GPS_FILTER in typed_data.h).
+ * The table is set via <node>/tag/info/sens/gps/.filter, a PUT of
+ *
+ *   (mid << 16) | (policy << 8) | n
+ *
+ * sets the entry for mid (mid 0 is the default entry).  Policy
+ * GPS_FILT_CLEAR drops the entry for mid, or with mid 0 puts the whole
+ * table back to the boot default (log everything).  A GET returns the
+ * policy generation, which is also in each DT_GPS_FILTER record.
+ *
+ * Each geodetic message (MID 41) is logged as one DT_GPS_FIX record,
+ * position included when we have a fix.  DT_GPS_TIME is logged when a
+ * fix is acquired.  While the fix holds, positions go into a delta
+ * encoded DT_GPS_TRACK record instead, only the first fix of each
+ * track record is also logged as a DT_GPS_FIX.
+ *
  * *** State Machine Description (GMS_)
  *
  * FAIL         we gave up
@@ -157,6 +174,17 @@ typedef struct {
 } gps_time_t;
 
 
+/*
+ * track record buffer, the deltas.  A fix takes at most 4 varints of 5
+ * bytes (GT_FIX_MAX).
+ */
+#ifndef GPS_TRACK_BYTES
+#define GPS_TRACK_BYTES 256
+#endif
+
+#define GT_FIX_MAX 20
+
+
 typedef enum mpm_state {
   MPM_START_UP = 0,
   MPM_OS_WAIT,
@@ -173,6 +201,7 @@ module GPSmonitorP {
   provides {
     interface TagnetAdapter<tagnet_gps_xyz_t> as InfoSensGpsXyz;
     interface TagnetAdapter<tagnet_gps_cmd_t> as InfoSensGpsCmd;
+    interface TagnetAdapter<uint32_t>         as GpsFilter;
   } uses {
     interface Boot;                           /* in boot */
     interface GPSControl;
@@ -181,6 +210,7 @@ module GPSmonitorP {
 
     interface Collect;
     interface CollectEvent;
+    interface CollectFlush;
 
     interface Timer<TMilli> as MonTimer;
     interface Panic;
@@ -202,6 +232,34 @@ implementation {
   bool        mpm_pending;
 #endif
 
+  /*
+   * raw filter.  gf_ents[0] is the default.  gf_cnt (NTH count, CHANGE
+   * have a last) and gf_last (CHANGE) are per entry state.  m_fix is
+   * whether the last nav message (MID 2 or 41) said we have a fix.
+   */
+  dt_gps_filt_ent_t gf_ents[GPS_FILT_ENTRIES];
+  uint8_t           gf_cnt[GPS_FILT_ENTRIES];
+  uint16_t          gf_last[GPS_FILT_ENTRIES];
+  uint8_t           gf_count;
+  uint16_t          gf_gen;
+  bool              m_fix;
+
+  uint8_t           m_mode1;            /* last MID 2, for DT_GPS_FIX */
+  bool              m_time_logged;      /* DT_GPS_TIME for this fix */
+
+  /*
+   * track being built.  gt_hdr.count 0 says none.  gt_ms/lat/lon/alt is
+   * the last fix added, deltas are from it.  CollectFlush.shutdown
+   * touches the record on the way down, nothing else is running then.
+   */
+  norace dt_gps_track_t gt_hdr __attribute__ ((aligned (4)));
+  norace uint8_t    gt_buf[GPS_TRACK_BYTES];
+  norace uint16_t   gt_len;
+  uint32_t          gt_ms;
+  int32_t           gt_lat, gt_lon, gt_alt;
+
+  void gt_flush();
+
   void gps_warn(uint8_t where, parg_t p, parg_t p1) {
     call Panic.warn(PANIC_GPS, where, p, p1, 0, 0);
   }
@@ -211,12 +269,145 @@ implementation {
   }
 
 
+  /*
+   * write the filter table to the data stream and start new counts.
+   */
+  void gf_collect() {
+    dt_gps_filter_t hdr;
+    uint8_t i;
+
+    hdr.len   = sizeof(hdr) + gf_count * sizeof(dt_gps_filt_ent_t);
+    hdr.dtype = DT_GPS_FILTER;
+    hdr.gen   = gf_gen;
+    hdr.count = gf_count;
+    hdr.fix   = m_fix;
+    hdr.pad   = 0;
+    call Collect.collect((void *) &hdr, sizeof(hdr), (void *) gf_ents,
+                         gf_count * sizeof(dt_gps_filt_ent_t));
+    for (i = 0; i < gf_count; i++) {
+      gf_ents[i].passed  = 0;
+      gf_ents[i].dropped = 0;
+    }
+  }
+
+
+  void gf_reset() {
+    memset(gf_ents, 0, sizeof(gf_ents));
+    gf_ents[0].policy = GPS_FILT_ALWAYS;
+    gf_ents[0].n      = 1;
+    gf_count = 1;
+  }
+
+
+  int8_t gf_find(uint8_t mid) {
+    int8_t i;
+
+    for (i = 1; i < gf_count; i++)
+      if (gf_ents[i].mid == mid)
+        return i;
+    return -1;
+  }
+
+
+  /*
+   * gf_pass: log this one?
+   *
+   * chksum is the packet's SiRF checksum, stands in for the payload for
+   * CHANGE.
+   */
+  bool gf_pass(uint8_t mid, uint16_t chksum) {
+    dt_gps_filt_ent_t *ep;
+    int8_t i;
+    bool   pass;
+
+    i = gf_find(mid);
+    if (i < 0)
+      i = 0;
+    ep = &gf_ents[i];
+    switch (ep->policy) {
+      default:
+      case GPS_FILT_ALWAYS:     pass = TRUE;            break;
+      case GPS_FILT_NEVER:      pass = FALSE;           break;
+      case GPS_FILT_ACQ:        pass = !m_fix;          break;
+
+      case GPS_FILT_NTH:
+        pass = (gf_cnt[i] == 0);
+        if (++gf_cnt[i] >= ep->n)
+          gf_cnt[i] = 0;
+        break;
+
+      case GPS_FILT_CHANGE:
+        pass = !gf_cnt[i] || gf_last[i] != chksum;
+        gf_cnt[i]  = 1;                 /* have a last */
+        gf_last[i] = chksum;
+        break;
+    }
+    if (pass)
+      ep->passed++;
+    else
+      ep->dropped++;
+    return pass;
+  }
+
+
+  command bool GpsFilter.get_value(uint32_t *t, uint32_t *l) {
+    *t = gf_gen;
+    *l = 4;
+    return TRUE;
+  }
+
+
+  command bool GpsFilter.set_value(uint32_t *t, uint32_t *l) {
+    uint8_t mid, policy, n;
+    int8_t  i;
+
+    mid    = (*t >> 16) & 0xff;
+    policy = (*t >> 8)  & 0xff;
+    n      = *t & 0xff;
+    if (policy == GPS_FILT_CLEAR) {
+      if (mid == 0)
+        gf_reset();
+      else {
+        i = gf_find(mid);
+        if (i < 0)
+          return FALSE;
+        gf_count--;
+        gf_ents[i] = gf_ents[gf_count];
+        gf_cnt[i]  = gf_cnt[gf_count];
+        gf_last[i] = gf_last[gf_count];
+      }
+    } else {
+      if (policy >= GPS_FILT_MAX)
+        return FALSE;
+      if (policy == GPS_FILT_NTH && n == 0)
+        return FALSE;
+      i = mid ? gf_find(mid) : 0;
+      if (i < 0) {
+        if (gf_count >= GPS_FILT_ENTRIES)
+          return FALSE;
+        i = gf_count++;
+        memset(&gf_ents[i], 0, sizeof(gf_ents[i]));
+        gf_ents[i].mid = mid;
+      }
+      gf_ents[i].policy = policy;
+      gf_ents[i].n      = n ? n : 1;
+      gf_cnt[i]  = 0;
+      gf_last[i] = 0;
+    }
+    gf_gen++;
+    gf_collect();
+    return TRUE;
+  }
+
+
   /*
    * We are being told the system has come up.
    * make sure we can communicate with the GPS and that it is
    * the proper state.
    */
   event void Boot.booted() {
+    gf_reset();
+    gf_collect();
     gps_boot_try = 1;
     gps_mon_state = GMS_BOOTING;
     call CollectEvent.logEvent(DT_EVENT_GPS_BOOT, gps_mon_state, gps_boot_try, 0, 0);
@@ -365,11 +556,13 @@ implementation {
                                    call GPSControl.awake(), err, 1);
         break;
       case GDC_TURNOFF:
+        gt_flush();
         err = call GPSControl.turnOff();
         call CollectEvent.logEvent(DT_EVENT_GPS_CMD, gp->cmd,
                                    call GPSControl.awake(), err, 1);
         break;
       case GDC_STANDBY:
+        gt_flush();
         err = call GPSControl.standby();
         call CollectEvent.logEvent(DT_EVENT_GPS_CMD, gp->cmd,
                                    call GPSControl.awake(), err, 1);
@@ -437,6 +630,121 @@ implementation {
   }
 
 
+  /*
+   * finish off the header of the track being built, ready to go out.
+   */
+  void gt_close() {
+    gt_hdr.len   = sizeof(gt_hdr) + gt_len;
+    gt_hdr.dtype = DT_GPS_TRACK;
+    gt_hdr.pad   = 0;
+  }
+
+
+  /*
+   * write out the track being built, if any.
+   */
+  void gt_flush() {
+    if (!gt_hdr.count)
+      return;
+    gt_close();
+    call Collect.collect_nots((void *) &gt_hdr, sizeof(gt_hdr),
+                              gt_buf, gt_len);
+    gt_hdr.count = 0;
+    gt_len = 0;
+  }
+
+
+  /*
+   * Collect is about to lay down a SYNC, get the track in ahead of it.
+   * Otherwise a track (up to GPS_TRACK_BYTES worth of fixes) could sit
+   * here across a reboot and be lost.
+   */
+  event void CollectFlush.flush() {
+    gt_flush();
+  }
+
+
+  async event void CollectFlush.shutdown() {
+    if (!gt_hdr.count)
+      return;
+    gt_close();
+    call CollectFlush.shutdown_collect((void *) &gt_hdr, sizeof(gt_hdr),
+                                       gt_buf, gt_len);
+    gt_hdr.count = 0;
+    gt_len = 0;
+  }
+
+
+  /*
+   * zig-zag, small magnitudes of either sign become small unsigneds.
+   * d is a difference mod 2^32 (lon can swing more than an int32 across
+   * the date line), the decoder adds it back the same way.
+   */
+  uint32_t gt_zz(uint32_t d) {
+    return (d << 1) ^ (uint32_t) ((int32_t) d >> 31);
+  }
+
+
+  void gt_varint(uint32_t v) {
+    while (v >= 0x80) {
+      gt_buf[gt_len++] = v | 0x80;
+      v >>= 7;
+    }
+    gt_buf[gt_len++] = v;
+  }
+
+
+  /*
+   * add a fix to the track.  Returns TRUE if it is the keyframe of a new
+   * track record, the caller logs those in full.
+   */
+  bool gt_add(uint32_t arrival_ms, gps_geo_t *mgp) {
+    if (gt_hdr.count && gt_len + GT_FIX_MAX > GPS_TRACK_BYTES)
+      gt_flush();
+    if (gt_hdr.count == 0) {
+      gt_hdr.systime = arrival_ms;
+      gt_hdr.tow     = mgp->tow;
+      gt_hdr.week_x  = mgp->week_x;
+      gt_hdr.lat     = mgp->lat;
+      gt_hdr.lon     = mgp->lon;
+      gt_hdr.alt_msl = mgp->alt_msl;
+    } else {
+      gt_varint(gt_zz(arrival_ms   - gt_ms));
+      gt_varint(gt_zz((uint32_t) mgp->lat     - gt_lat));
+      gt_varint(gt_zz((uint32_t) mgp->lon     - gt_lon));
+      gt_varint(gt_zz((uint32_t) mgp->alt_msl - gt_alt));
+    }
+    gt_ms  = arrival_ms;
+    gt_lat = mgp->lat;
+    gt_lon = mgp->lon;
+    gt_alt = mgp->alt_msl;
+    return (gt_hdr.count++ == 0);
+  }
+
+
+  /*
+   * DT_GPS_TIME, ties systime to UTC.  Written when we get a fix.
+   */
+  void log_time(gps_time_t *mtp) {
+    dt_gps_time_t t;
+
+    t.len       = sizeof(t);
+    t.dtype     = DT_GPS_TIME;
+    t.systime   = mtp->ts;
+    t.tow       = mtp->tow;
+    t.week_x    = mtp->week_x;
+    t.utc_year  = mtp->utc_year;
+    t.utc_ms    = mtp->utc_ms;
+    t.utc_month = mtp->utc_month;
+    t.utc_day   = mtp->utc_day;
+    t.utc_hour  = mtp->utc_hour;
+    t.utc_min   = mtp->utc_min;
+    t.nsats     = mtp->nsats;
+    t.pad[0] = t.pad[1] = t.pad[2] = 0;
+    call Collect.collect_nots((void *) &t, sizeof(t), NULL, 0);
+  }
+
+
   /*
    * MID 2: NAV_DATA
    */
@@ -449,9 +757,10 @@ implementation {
     if (!np || CF_BE_16(np->len) != NAVDATA_LEN)
       return;
 
-    call CollectEvent.logEvent(DT_EVENT_GPS_SATS_2, np->nsats, np->mode1, 0, 0);
+    m_mode1 = np->mode1;
     pmode = np->mode1 & SB_NAV_M1_PMODE_MASK;
-    if (pmode >= SB_NAV_M1_PMODE_SV2KF && pmode <= SB_NAV_M1_PMODE_SVODKF) {
+    m_fix = (pmode >= SB_NAV_M1_PMODE_SV2KF && pmode <= SB_NAV_M1_PMODE_SVODKF);
+    if (m_fix) {
       /*
        * we consider a valid fix anywhere from a 2D (2SV KF fix) to an over
        * determined >= 5 sat fix.
@@ -467,11 +776,7 @@ implementation {
       mxp->mode1 = np->mode1;
       mxp->hdop  = np->hdop;
       mxp->nsats = np->nsats;
-      call CollectEvent.logEvent(DT_EVENT_GPS_XYZ, mxp->nsats,
-                                 mxp->x, mxp->y, mxp->z);
     }
-    call CollectEvent.logEvent(DT_EVENT_GPS_AWAKE_S, 2,
-                               call GPSControl.awake(), 0, 0);
 #ifdef GPS_SIMPLE_MPM
     if (mpm_pending) {
       /*
@@ -526,15 +831,31 @@ implementation {
   void process_geodetic(sb_geodetic_t *gp, uint32_t arrival_ms) {
     gps_time_t    *mtp;
     gps_geo_t     *mgp;
+    dt_gps_fix_t   fix;
     uint16_t       nav_valid, nav_type;
+    bool           log_fix;
 
     if (!gp || CF_BE_16(gp->len) != GEODETIC_LEN)
       return;
 
     nav_valid = CF_BE_16(gp->nav_valid);
     nav_type  = CF_BE_16(gp->nav_type);
-    call CollectEvent.logEvent(DT_EVENT_GPS_SATS_41, gp->nsats, nav_valid, nav_type, 0);
 
+    fix.len             = DT_GPS_FIX_STATUS_SIZE;
+    fix.dtype           = DT_GPS_FIX;
+    fix.systime         = arrival_ms;
+    fix.nav_valid       = nav_valid;
+    fix.nav_type        = nav_type;
+    fix.tow             = CF_BE_32(gp->tow);
+    fix.week_x          = CF_BE_16(gp->week_x);
+    fix.nsats           = gp->nsats;
+    fix.mode1           = m_mode1;
+    fix.hdop            = gp->hdop;
+    fix.additional_mode = gp->additional_mode;
+    fix.awake           = call GPSControl.awake();
+    log_fix             = TRUE;
+
+    m_fix = (nav_valid == 0);
     if (nav_valid == 0) {
 
 #ifdef GPS_SIMPLE_MPM
@@ -548,8 +869,8 @@ implementation {
       mtp = &m_time;
 
       mtp->ts        = arrival_ms;
-      mtp->tow       = CF_BE_32(gp->tow);
-      mtp->week_x    = CF_BE_16(gp->week_x);
+      mtp->tow       = fix.tow;
+      mtp->week_x    = fix.week_x;
       mtp->nsats     = gp->nsats;
 
       mtp->utc_year  = CF_BE_16(gp->utc_year);
@@ -558,32 +879,51 @@ implementation {
       mtp->utc_hour  = gp->utc_hour;
       mtp->utc_min   = gp->utc_min;
       mtp->utc_ms    = CF_BE_16(gp->utc_ms);
-      call CollectEvent.logEvent(DT_EVENT_GPS_TIME,
-        (mtp->utc_year << 16) | (mtp->utc_month << 8) | (mtp->utc_day),
-        (mtp->utc_hour << 8) | (mtp->utc_min),
-        mtp->utc_ms, 0);
 
       mgp = &m_geo;
       mgp->ts        = arrival_ms;
-      mgp->tow       = CF_BE_32(gp->tow);
-      mgp->week_x    = CF_BE_16(gp->week_x);
+      mgp->tow       = fix.tow;
+      mgp->week_x    = fix.week_x;
       mgp->nsats     = gp->nsats;
       mgp->lat       = CF_BE_32(gp->lat);
       mgp->lon       = CF_BE_32(gp->lon);
       mgp->ehpe      = CF_BE_32(gp->ehpe);
+      mgp->evpe      = CF_BE_32(gp->evpe);
       mgp->hdop      = gp->hdop;
       mgp->sat_mask  = CF_BE_32(gp->sat_mask);
-      mgp->nav_valid = CF_BE_16(gp->nav_valid);
-      mgp->nav_type  = CF_BE_16(gp->nav_type);
+      mgp->nav_valid = nav_valid;
+      mgp->nav_type  = nav_type;
       mgp->alt_ell   = CF_BE_32(gp->alt_elipsoid);
       mgp->alt_msl   = CF_BE_32(gp->alt_msl);
       mgp->sog       = CF_BE_16(gp->sog);
       mgp->cog       = CF_BE_16(gp->cog);
       mgp->additional_mode = gp->additional_mode;
-      call CollectEvent.logEvent(DT_EVENT_GPS_GEO, mgp->lat, mgp->lon, mgp->week_x, mgp->tow);
+
+      fix.len      = sizeof(fix);
+      fix.lat      = mgp->lat;
+      fix.lon      = mgp->lon;
+      fix.alt_ell  = mgp->alt_ell;
+      fix.alt_msl  = mgp->alt_msl;
+      fix.ehpe     = mgp->ehpe;
+      fix.evpe     = mgp->evpe;
+      fix.sog      = mgp->sog;
+      fix.cog      = mgp->cog;
+      fix.sat_mask = mgp->sat_mask;
+      fix.x        = m_xyz.x;
+      fix.y        = m_xyz.y;
+      fix.z        = m_xyz.z;
+
+      if (!m_time_logged) {
+        log_time(mtp);
+        m_time_logged = TRUE;
+      }
+      log_fix = gt_add(arrival_ms, mgp);
+    } else {
+      m_time_logged = FALSE;
+      gt_flush();
     }
-    call CollectEvent.logEvent(DT_EVENT_GPS_AWAKE_S, 41,
-                               call GPSControl.awake(), 0, 0);
+    if (log_fix)
+      call Collect.collect_nots((void *) &fix, fix.len, NULL, 0);
 #ifdef GPS_SIMPLE_MPM
     if (mpm_pending) {
       /*
@@ -638,6 +978,7 @@ implementation {
           call CollectEvent.logEvent(DT_EVENT_GPS_MPM, 55, 0, 0, call GPSControl.awake());
           call MonTimer.startOneShot(2*60*60*1024);       /* 2hrs */
           mpm_state = MPM_SLEEPING;
+          gt_flush();                   /* no more fixes for a while */
         }
         return;
     }
@@ -673,7 +1014,10 @@ implementation {
   event void GPSReceive.msg_available(uint8_t *msg, uint16_t len,
         uint32_t arrival_ms, uint32_t mark_j) {
     sb_header_t *sbp;
-    dt_gps_t hdr;
+    dt_gps_t    *hdr;
+    dc_resv_t   *rp;
+    uint8_t     *src;
+    uint8_t      i;
 
     sbp = (void *) msg;
     if (sbp->start1 != SIRFBIN_A0 || sbp->start2 != SIRFBIN_A2) {
@@ -681,13 +1025,31 @@ implementation {
       return;
     }
 
-    hdr.len      = sizeof(hdr) + len;
-    hdr.dtype    = DT_GPS_RAW_SIRFBIN;
-    hdr.systime  = arrival_ms;
-    hdr.mark_us  = (mark_j * MULT_JIFFIES_TO_US) / DIV_JIFFIES_TO_US;
-    hdr.chip_id  = CHIP_GPS_GSD4E;
-    hdr.dir      = GPS_DIR_RX;
-    call Collect.collect_nots((void *) &hdr, sizeof(hdr), msg, len);
+    /*
+     * build the record directly in the data stream buffers.  Saves
+     * staging the header and a second pass over the message.
+     *
+     * The SiRF checksum is the 2 bytes in front of B0 B3.
+     */
+    rp = NULL;
+    if (len >= SIRFBIN_OVERHEAD &&
+        gf_pass(sbp->mid, msg[len - 4] << 8 | msg[len - 3]))
+      rp = call Collect.reserve(DT_GPS_RAW_SIRFBIN, sizeof(dt_gps_t), len);
+    if (rp) {
+      hdr = (void *) rp->hdr;
+      hdr->len      = sizeof(dt_gps_t) + len;
+      hdr->dtype    = DT_GPS_RAW_SIRFBIN;
+      hdr->systime  = arrival_ms;
+      hdr->mark_us  = (mark_j * MULT_JIFFIES_TO_US) / DIV_JIFFIES_TO_US;
+      hdr->chip_id  = CHIP_GPS_GSD4E;
+      hdr->dir      = GPS_DIR_RX;
+      src = msg;
+      for (i = 0; i < rp->nfrags; i++) {
+        memcpy(rp->data[i], src, rp->dlen[i]);
+        src += rp->dlen[i];
+      }
+      call Collect.commit_nots();
+    }
 
     switch (sbp->mid) {
       case MID_NAVDATA:
@@ -822,6 +1184,7 @@ implementation {
         call CollectEvent.logEvent(DT_EVENT_GPS_MPM, 499, 0, 0, awake);
         call MonTimer.startOneShot(2*60*60*1024);       /* 2hrs */
         mpm_state = MPM_SLEEPING;
+        gt_flush();
         return;
 
       case MPM_SLEEPING:
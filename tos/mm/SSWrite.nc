@@ -65,6 +65,14 @@ interface SSWrite {
    */
   command ss_wr_buf_t* get_free_buf_handle();
 
+  /**
+   * how many buffers can be handed out by get_free_buf_handle before
+   * it runs dry.  Lets clients shed load before we run out of buffers.
+   *
+   * @return number of FREE buffers.
+   */
+  command uint8_t free_bufs();
+
   /**
    * call when the buffer objectified by buf_handle has been filled and
    * should be flushed.  The handle is then returned to the free pool.  Do
@@ -33,6 +33,11 @@ configuration SSWriteC {
   provides {
     interface SSWrite       as SSW;
     interface StreamStorage as SS;
+    interface TagnetAdapter<uint32_t> as SswGroup;
+    interface TagnetAdapter<uint32_t> as SswBufs;
+    interface TagnetAdapter<uint32_t> as SswMaxFull;
+    interface TagnetAdapter<uint32_t> as SswLatP50;
+    interface TagnetAdapter<uint32_t> as SswLatP95;
   }
 }
 
@@ -40,13 +45,20 @@ implementation {
   components SSWriteP as SSW_P, MainC;
   SSW = SSW_P;
   SS  = SSW_P;
+  SswGroup   = SSW_P;
+  SswBufs    = SSW_P;
+  SswMaxFull = SSW_P;
+  SswLatP50  = SSW_P;
+  SswLatP95  = SSW_P;
   MainC.SoftwareInit -> SSW_P;
 
   components new SD0_ArbC() as SD;
   components SD0C;
   SSW_P.SDResource -> SD;
+  SSW_P.SDResourceRequested -> SD;
   SSW_P.SDwrite    -> SD;
   SSW_P.SDsa       -> SD0C;
+  SSW_P.SDActive   -> SD;
 
   components PanicC, LocalTimeMilliC;
   SSW_P.Panic      -> PanicC;
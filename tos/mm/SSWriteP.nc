@@ -71,12 +71,19 @@ module SSWriteP {
     interface Init;
     interface SSWrite       as SSW;
     interface StreamStorage as SS;
+    interface TagnetAdapter<uint32_t> as SswGroup;
+    interface TagnetAdapter<uint32_t> as SswBufs;
+    interface TagnetAdapter<uint32_t> as SswMaxFull;
+    interface TagnetAdapter<uint32_t> as SswLatP50;
+    interface TagnetAdapter<uint32_t> as SswLatP95;
   }
   uses {
     interface SDwrite;
     interface SDsa;
     interface DblkManager;
     interface Resource as SDResource;
+    interface ResourceRequested as SDResourceRequested;
+    interface SDActive;
     interface Panic;
     interface LocalTime<TMilli>;
     interface Trace;
@@ -107,6 +114,39 @@ implementation {
 
   norace ss_control_t ssc;              /* all global control cells */
 
+  /*
+   * set when a foreground SD client (see SDSchedP) wants the SD while we
+   * are writing.  A run in flight can't be split, so we yield between
+   * runs: release and re-request.  We pick up where we left off on the
+   * next grant.  The SD stays powered across the hand off.
+   */
+  norace bool ssw_yield;
+  uint32_t    ssw_yields;
+
+  /*
+   * opportunistic writes.  If somebody else has the SD up we don't wait
+   * for a full group, whatever is FULL goes out on their power cycle.
+   * ssw_opps counts the groups started that way.
+   *
+   * SSW_FLUSH_ALLOC: also write out the part of the ALLOC buffer Collect
+   * has filled so far, any time we have the SD and nothing FULL is left.
+   * The sector gets written again for real when the buffer fills.  The
+   * data is copied first (ssw_alloc_copy), Collect keeps filling the
+   * buffer while the write is in flight.
+   */
+  uint32_t    ssw_opps;
+
+#ifdef SSW_FLUSH_ALLOC
+  uint8_t     ssw_alloc_copy[SD_BLOCKSIZE] __attribute__ ((aligned (4)));
+  bool        ssw_alloc_wr;             /* alloc flush in flight */
+  uint32_t    ssw_alloc_blk;            /* last alloc flush, where and */
+  uint32_t    ssw_alloc_len;            /* how much */
+  uint32_t    ssw_alloc_flushes;
+#endif
+
+  /* buffer list handed to SDwrite.write_multi, run starts at ssw_out */
+  uint8_t *ssw_run_bufs[SSW_NUM_BUFS];
+
 
   /*
    * instrumentation for measuring how long things take.
@@ -114,15 +154,151 @@ implementation {
   uint32_t ssw_delay_start;             // how long are we held off?
   uint32_t ssw_write_grp_start;         // when we start the write of the group.
 
+  /*
+   * run time tuning of the group size (ssc.ssw_group) and of how many
+   * buffers are in play (ssc.ssw_nbufs).  See ssw_tune.
+   *
+   * fill_avg:  ms per buffer coming back from Collect.
+   * delay_avg: ms from request to grant (power up + init, or waiting
+   *            behind other SD clients).
+   * wr_avg:    ms per sector written (multi-block runs).
+   * fixed_group: non-zero, group size forced (via Tagnet).
+   * req_nbufs: non-zero, pending change to ssw_nbufs.
+   * grp_secs:  sectors written so far by this group.
+   * lat_hist:  group latency, request to done, log2 ms buckets.
+   */
+  typedef struct {
+    uint32_t last_full;
+    uint32_t fill_avg;
+    uint32_t delay_avg;
+    uint32_t wr_avg;
+    uint32_t lat_max;
+    uint32_t groups;
+    uint16_t grp_secs;
+    uint8_t  fixed_group;
+    uint8_t  req_nbufs;
+    uint32_t lat_hist[SSW_LAT_HIST];
+  } ssw_tune_t;
+
+  ssw_tune_t ssw_tune_s;
+
 #define ss_panic(where, arg) do { call Panic.panic(PANIC_SS, where, arg, 0, 0, 0); } while (0)
 
+  /* running average, 1/4 weight on the new sample.  0 seeds */
+  uint32_t ssw_avg(uint32_t cur, uint32_t sample) {
+    if (!cur)
+      return sample ? sample : 1;
+    return cur - (cur >> 2) + (sample >> 2);
+  }
+
+
+  /*
+   * ssw_tune: pick the group size for the next group.
+   *
+   * o amortize: power up should be at most 1/SSW_AMORT of the group's
+   *   time on the SD, delay <= g * wr * (SSW_AMORT - 1).
+   * o exposure: a group shouldn't sit in RAM longer than SSW_EXPOSE_MS,
+   *   g * fill <= SSW_EXPOSE_MS.
+   * o room: while a group is being written ((delay + g * wr) ms) Collect
+   *   keeps filling.  Those plus the group plus the one Collect is
+   *   working on have to fit in ssw_nbufs.
+   *
+   * exposure and room win over amortize.  Called when a group is done.
+   */
+  void ssw_tune() {
+    ssw_tune_t *tp = &ssw_tune_s;
+    uint32_t g, lim, wr, fill;
+
+    if (tp->fixed_group) {
+      g = tp->fixed_group;
+    } else {
+      wr   = tp->wr_avg   ? tp->wr_avg   : 1;
+      fill = tp->fill_avg ? tp->fill_avg : 1;
+      g = (tp->delay_avg + wr * (SSW_AMORT - 1) - 1) / (wr * (SSW_AMORT - 1));
+      lim = SSW_EXPOSE_MS / fill;
+      if (g > lim)
+        g = lim;
+      lim = 0;
+      if ((ssc.ssw_nbufs - 1) * fill > tp->delay_avg)
+        lim = ((ssc.ssw_nbufs - 1) * fill - tp->delay_avg) / (fill + wr);
+      if (g > lim)
+        g = lim;
+    }
+    if (g < 1)
+      g = 1;
+    if (g > ssc.ssw_nbufs - 1U)
+      g = ssc.ssw_nbufs - 1;
+    ssc.ssw_group = g;
+  }
+
+
+  /*
+   * ssw_resize: change how many buffers are in play.
+   *
+   * The ring can only be resized when what is in use doesn't wrap.
+   * ie.  [ssw_out, ssw_alloc) is contiguous and below the new size.
+   * If nothing is in use at all we start the ring over at 0.
+   */
+  void ssw_resize() {
+    uint8_t n = ssw_tune_s.req_nbufs;
+
+    if (!n)
+      return;
+    if (ssc.ssw_out == ssc.ssw_alloc) {
+      if (ssw_p[ssc.ssw_out]->buf_state != SS_BUF_STATE_FREE ||
+          ssc.state != SSW_IDLE)
+        return;                         /* all in use */
+      ssc.ssw_out = ssc.ssw_in = ssc.ssw_alloc = 0;
+    } else if (ssc.ssw_out > ssc.ssw_alloc || ssc.ssw_alloc >= n)
+      return;                           /* wraps, try later */
+    ssc.ssw_nbufs = n;
+    ssw_tune_s.req_nbufs = 0;
+    if (ssc.ssw_group > n - 1)
+      ssc.ssw_group = n - 1;
+  }
+
+
+  /* group done, SD released.  ms since the group was requested */
+  void ssw_group_done() {
+    ssw_tune_t *tp = &ssw_tune_s;
+    uint32_t lat, b;
+
+    lat = call LocalTime.get() - ssw_delay_start;
+    if (lat > tp->lat_max)
+      tp->lat_max = lat;
+    for (b = 0; b < SSW_LAT_HIST - 1 && lat; b++)
+      lat >>= 1;
+    tp->lat_hist[b]++;
+    tp->groups++;
+    tp->grp_secs = 0;
+    ssw_tune();
+    ssw_resize();
+  }
+
+
+  /* pct percentile of group latency, upper edge of its bucket, ms */
+  uint32_t ssw_lat_pct(uint32_t pct) {
+    ssw_tune_t *tp = &ssw_tune_s;
+    uint32_t b, cum;
+
+    if (!tp->groups)
+      return 0;
+    cum = 0;
+    for (b = 0; b < SSW_LAT_HIST - 1; b++) {
+      cum += tp->lat_hist[b];
+      if (cum * 100 >= pct * tp->groups)
+        break;
+    }
+    return 1UL << b;
+  }
+
   void flush_buffers(void) {
     while (ssc.cur_handle->buf_state == SS_BUF_STATE_FULL) {
       ssc.cur_handle->stamp = call LocalTime.get();
       ssc.cur_handle->buf_state = SS_BUF_STATE_FREE;
       memset(ssc.cur_handle->buf, 0, SD_BLOCKSIZE);
       ssc.ssw_out++;
-      if (ssc.ssw_out >= SSW_NUM_BUFS)
+      if (ssc.ssw_out >= ssc.ssw_nbufs)
         ssc.ssw_out = 0;
       ssc.ssw_num_full--;
       ssc.cur_handle = ssw_p[ssc.ssw_out];
@@ -136,6 +312,8 @@ implementation {
 
     ssc.majik_a     = SSC_MAJIK;
     ssc.majik_b     = SSC_MAJIK;
+    ssc.ssw_nbufs   = SSW_NUM_BUFS;
+    ssc.ssw_group   = SSW_GROUP;
 
     /* ssw_p[x]->buf_state starts in FREE (0) */
     for (i = 0; i < SSW_NUM_BUFS; i++)
@@ -153,7 +331,7 @@ implementation {
    * filled the buffer.
    *
    * The main SSWriter task will be kicked if current state is IDLE and
-   * we have at least SSW_GROUP buffers.
+   * we have at least ssw_group buffers.
    */
 
   task void SSWriter_task();
@@ -168,7 +346,7 @@ implementation {
      */
     in_index = ssc.ssw_in;
     sswp = ssw_p[in_index];
-    if (in_index >= SSW_NUM_BUFS)
+    if (in_index >= ssc.ssw_nbufs)
       ss_panic(10, in_index);
 
     /* the next check also catches the null pointer */
@@ -184,14 +362,20 @@ implementation {
 
     handle->stamp = call LocalTime.get();
     handle->buf_state = SS_BUF_STATE_FULL;
+    if (ssw_tune_s.last_full)
+      ssw_tune_s.fill_avg = ssw_avg(ssw_tune_s.fill_avg,
+                                    handle->stamp - ssw_tune_s.last_full);
+    ssw_tune_s.last_full = handle->stamp;
     ssc.ssw_num_full++;
     if (ssc.ssw_num_full > ssc.ssw_max_full)
       ssc.ssw_max_full = ssc.ssw_num_full;
-    if (ssc.state == SSW_IDLE && ssc.ssw_num_full >= SSW_GROUP)
+    if (ssc.state == SSW_IDLE && (ssc.ssw_num_full >= ssc.ssw_group ||
+                                  call SDActive.is_on()))
       post SSWriter_task();
     ssc.ssw_in++;
-    if (ssc.ssw_in >= SSW_NUM_BUFS)
+    if (ssc.ssw_in >= ssc.ssw_nbufs)
       ssc.ssw_in = 0;
+    ssw_resize();
   }
 
 
@@ -199,7 +383,7 @@ implementation {
     ss_wr_buf_t *sswp;
 
     sswp = ssw_p[ssc.ssw_alloc];
-    if (ssc.ssw_alloc >= SSW_NUM_BUFS ||
+    if (ssc.ssw_alloc >= ssc.ssw_nbufs ||
         ssc.majik_a != SSC_MAJIK ||
         ssc.majik_b != SSC_MAJIK ||
         sswp->buf_state < SS_BUF_STATE_FREE ||
@@ -213,12 +397,29 @@ implementation {
       sswp->stamp = call LocalTime.get();
       sswp->buf_state = SS_BUF_STATE_ALLOC;
       ssc.ssw_alloc++;
-      if (ssc.ssw_alloc >= SSW_NUM_BUFS)
+      if (ssc.ssw_alloc >= ssc.ssw_nbufs)
         ssc.ssw_alloc = 0;
       return sswp;
     }
-    ss_panic(15, -1);
-    return NULL;
+    return NULL;                        /* ring is empty, caller drops */
+  }
+
+
+  /*
+   * buffers are allocated in ring order starting at ssw_alloc, so the
+   * free buffers are the run of FREE buffers starting there.
+   */
+  command uint8_t SSW.free_bufs() {
+    uint8_t idx, count;
+
+    idx = ssc.ssw_alloc;
+    for (count = 0; count < ssc.ssw_nbufs; count++) {
+      if (ssw_p[idx]->buf_state != SS_BUF_STATE_FREE)
+        break;
+      if (++idx >= ssc.ssw_nbufs)
+        idx = 0;
+    }
+    return count;
   }
 
 
@@ -246,8 +447,8 @@ implementation {
    * on a buffer.  Collect will tell us where the next record
    * will get layed down (buf_offset).
    */
-  async command uint32_t SS.eof_offset() {
-    uint32_t offset;
+  async command uint64_t SS.eof_offset() {
+    uint64_t offset;
 
     offset = call DblkManager.dblk_nxt_offset();
     if (!offset)
@@ -258,7 +459,7 @@ implementation {
   }
 
 
-  async command uint32_t SS.committed_offset() {
+  async command uint64_t SS.committed_offset() {
     return call DblkManager.dblk_nxt_offset();
   }
 
@@ -286,30 +487,72 @@ implementation {
    * The SSWriter_task is what performs the main function of the Stream writer.
    *
    * The task gets posted anytime a buffer becomes available.  The writer stays
-   * idle until SSW_GROUP buffers are available.  This amortizes any start up
-   * cost of powering the SD up across that many buffers.  We assume that the
-   * SD is off.  This could be changed easily by allowing a peek at the SD state
-   * and starting the write up if the SD is already on.  This would reduce the
-   * amount of pending data.  ie.  if we crash, right now we lose any data that
-   * hasn't been written out yet.
+   * idle until ssw_group buffers are available.  This amortizes any start up
+   * cost of powering the SD up across that many buffers.  Unless the SD is
+   * already on for some other client (SDActive, the hold after our own
+   * release doesn't count), in which case anything FULL goes out right away.
+   * That costs no extra power up and reduces the amount of pending data.
+   * ie.  if we crash, we lose any data that hasn't been written out yet.
    *
    * IDLE: not doing anything yet, possibly collecting buffers.
-   *       when SSW_GROUP buffers have been collected start writing.  request
+   *       when ssw_group buffers have been collected start writing.  request
    *       the h/w.
    *
    * REQUESTED: h/w has been requested.  waiting for the grant.
    *
    * WRITING: buffers are being sent to the h/w.  waiting for writeDone event.
+   *
+   * Once we have the h/w, the whole contiguous run of FULL buffers is
+   * handed to the SD as one multi-block write (CMD25).  When that
+   * completes any buffers that filled in the meantime go out as
+   * another run before giving the SD up.
    */
 
+  /*
+   * ssw_start_run: write the run of FULL buffers starting at ssw_out.
+   *
+   * The run is limited by the end of the DBLK file being written.  The
+   * next run picks up in the next DBLK file.  Anything past the end of
+   * the last one gets flushed when we run off the end (see writeDone).
+   */
+  void ssw_start_run() {
+    ss_wr_buf_t *sswp;
+    uint32_t     room;
+    uint8_t      idx, n;
+    error_t      err;
+
+    room = call DblkManager.get_dblk_high() - ssc.dblk + 1;
+    w_t0 = call LocalTime.get();
+    idx  = ssc.ssw_out;
+    for (n = 0; n < ssc.ssw_num_full && n < room; n++) {
+      sswp = ssw_p[idx];
+      if (sswp->buf_state != SS_BUF_STATE_FULL)
+        break;
+      sswp->stamp = w_t0;
+      sswp->buf_state = SS_BUF_STATE_WRITING;
+      ssw_run_bufs[n] = sswp->buf;
+      if (++idx >= ssc.ssw_nbufs)
+        idx = 0;
+    }
+    if (n == 0)
+      ss_panic(29, ssc.ssw_num_full);
+    ssc.ssw_run = n;
+    err = call SDwrite.write_multi(ssc.dblk, ssw_run_bufs, n);
+    if (err)
+      ss_panic(23, err);
+  }
+
+
   task void SSWriter_task() {
     error_t err;
 
     /*
      * This task should only get kicked if not doing anything
      */
-    if (ssc.state != SSW_IDLE || ssc.ssw_num_full < SSW_GROUP)
+    if (ssc.state != SSW_IDLE || ssc.ssw_num_full == 0)
       call Panic.panic(PANIC_SS, 18, ssc.state, ssc.ssw_num_full, 0, 0);
+    if (ssc.ssw_num_full < ssc.ssw_group)
+      ssw_opps++;                       /* riding someone else's power */
 
     ssc.cur_handle = ssw_p[ssc.ssw_out];
     if (ssc.cur_handle->buf_state != SS_BUF_STATE_FULL)
@@ -351,8 +594,6 @@ implementation {
 
 
   event void SDResource.granted() {
-    error_t  err;
-
     if (ssc.cur_handle->buf_state != SS_BUF_STATE_FULL)
       call Panic.panic(PANIC_SS, 21, (parg_t) ssc.cur_handle,
                        (parg_t) ssc.cur_handle->buf_state, 0, 0);
@@ -360,32 +601,126 @@ implementation {
     if (ssc.dblk == 0)                  /* shouldn't have asked if no where to write */
       ss_panic(22, ssc.state);
 
-    w_t0 = call LocalTime.get();
-    ssw_write_grp_start = w_t0;
-    ssc.cur_handle->stamp = w_t0;
-    ssc.cur_handle->buf_state = SS_BUF_STATE_WRITING;
+    ssw_write_grp_start = call LocalTime.get();
+    if (ssw_tune_s.grp_secs == 0)       /* first grant of the group */
+      ssw_tune_s.delay_avg = ssw_avg(ssw_tune_s.delay_avg,
+                                     ssw_write_grp_start - ssw_delay_start);
     ssc.state = SSW_WRITING;
-    err = call SDwrite.write(ssc.dblk, ssc.cur_handle->buf);
-    if (err)
-      ss_panic(23, err);
+    ssw_start_run();
+  }
+
+
+#ifdef SSW_FLUSH_ALLOC
+  /*
+   * ssw_flush_alloc: write what Collect has put in the ALLOC buffer so
+   * far to where it will eventually go (ssc.dblk, not advanced).
+   *
+   * return TRUE if a write was started.
+   */
+  bool ssw_flush_alloc() {
+    ss_wr_buf_t *sswp;
+    uint32_t len;
+
+    sswp = ssw_p[ssc.ssw_out];
+    if (ssc.ssw_out != ssc.ssw_in || ssc.dblk == 0 ||
+        sswp->buf_state != SS_BUF_STATE_ALLOC)
+      return FALSE;
+    len = call Collect.buf_offset();
+    if (len == 0 || len > SD_BLOCKSIZE ||
+        (ssc.dblk == ssw_alloc_blk && len == ssw_alloc_len))
+      return FALSE;                     /* nothing new */
+    memcpy(ssw_alloc_copy, sswp->buf, len);
+    memset(&ssw_alloc_copy[len], 0, SD_BLOCKSIZE - len);
+    if (call SDwrite.write(ssc.dblk, ssw_alloc_copy))
+      return FALSE;
+    ssw_alloc_blk = ssc.dblk;
+    ssw_alloc_len = len;
+    ssw_alloc_wr  = TRUE;
+    ssw_alloc_flushes++;
+    return TRUE;
+  }
+#endif
+
+
+  /*
+   * ssw_continue: a write has finished and we still own the SD.  Write
+   * any more FULL buffers (or yield to a foreground client first), then
+   * the ALLOC buffer if flushing it, else we are done with this group.
+   */
+  void ssw_continue() {
+    error_t err;
+
+    if (ssc.cur_handle->buf_state == SS_BUF_STATE_FULL) {
+      if (ssw_yield) {
+        /*
+         * foreground reader waiting.  let it in and get back in line.
+         */
+        ssw_yield = FALSE;
+        ssw_yields++;
+        ssc.state = SSW_REQUESTED;
+        if (call SDResource.release())
+          ss_panic(31, 0);
+        if ((err = call SDResource.request()))
+          ss_panic(32, err);
+        return;
+      }
+      /*
+       * more filled while we were writing, stay in SSW_WRITING.
+       */
+      ssw_start_run();
+      return;
+    }
+#ifdef SSW_FLUSH_ALLOC
+    if (ssw_flush_alloc())
+      return;
+#endif
+    w_t0 = call LocalTime.get();
+    w_diff = w_t0 - ssw_write_grp_start;
+
+    ssc.state = SSW_IDLE;
+    ssw_yield = FALSE;
+    if (call SDResource.release())
+      ss_panic(27, 0);
+    ssw_group_done();
   }
 
 
   event void SDwrite.writeDone(uint32_t blk, uint8_t *buf, error_t err) {
+    uint8_t i, run;
+
+#ifdef SSW_FLUSH_ALLOC
+    if (ssw_alloc_wr) {
+      ssw_alloc_wr = FALSE;
+      if (err || blk != ssc.dblk)
+        call Panic.panic(PANIC_SS, 33, err, blk, ssc.dblk, 0);
+      ssw_continue();
+      return;
+    }
+#endif
 
     if (err || blk != ssc.dblk || ssc.cur_handle->buf_state != SS_BUF_STATE_WRITING)
       call Panic.panic(PANIC_SS, 24, err, blk, ssc.dblk, ssc.cur_handle->buf_state);
 
-    ssc.cur_handle->stamp = call LocalTime.get();
-    ssc.cur_handle->buf_state = SS_BUF_STATE_FREE;
-    memset(ssc.cur_handle->buf, 0, SD_BLOCKSIZE);
-    ssc.ssw_out++;
-    if (ssc.ssw_out >= SSW_NUM_BUFS)
-      ssc.ssw_out = 0;
-    ssc.cur_handle = ssw_p[ssc.ssw_out];                /* point to nxt buf */
-    ssc.ssw_num_full--;
-    signal SS.dblk_advanced(blk);                       /* tell what we last did */
-    if ((ssc.dblk = call DblkManager.adv_dblk_nxt()) == 0) {
+    run = ssc.ssw_run;
+    ssw_tune_s.wr_avg = ssw_avg(ssw_tune_s.wr_avg,
+                                (call LocalTime.get() - w_t0) / run);
+    ssw_tune_s.grp_secs += run;
+    for (i = 0; i < run; i++) {
+      if (ssc.cur_handle->buf_state != SS_BUF_STATE_WRITING)
+        call Panic.panic(PANIC_SS, 30, i, run, ssc.cur_handle->buf_state, 0);
+      ssc.cur_handle->stamp = call LocalTime.get();
+      ssc.cur_handle->buf_state = SS_BUF_STATE_FREE;
+      memset(ssc.cur_handle->buf, 0, SD_BLOCKSIZE);
+      ssc.ssw_out++;
+      if (ssc.ssw_out >= ssc.ssw_nbufs)
+        ssc.ssw_out = 0;
+      ssc.cur_handle = ssw_p[ssc.ssw_out];              /* point to nxt buf */
+      ssc.ssw_num_full--;
+      ssc.dblk = call DblkManager.adv_dblk_nxt();
+    }
+    ssc.ssw_run = 0;
+    signal SS.dblk_advanced(blk + run - 1);             /* tell what we last did */
+    if (ssc.dblk == 0) {
       /*
        * adv_nxt_blk returning 0 says we ran off the end of
        * the file system area.
@@ -393,29 +728,31 @@ implementation {
       signal SS.dblk_stream_full();
       flush_buffers();
       ssc.state = SSW_IDLE;
+      ssw_yield = FALSE;
+      ssw_tune_s.grp_secs = 0;
       if (call SDResource.release())
         ss_panic(25, 0);
       return;
     }
 
-    if (ssc.cur_handle->buf_state == SS_BUF_STATE_FULL) {
-      /*
-       * more work to do, stay in SSW_WRITING.
-       */
-      w_t0 = call LocalTime.get();
-      ssc.cur_handle->stamp = call LocalTime.get();
-      ssc.cur_handle->buf_state = SS_BUF_STATE_WRITING;
-      err = call SDwrite.write(ssc.dblk, ssc.cur_handle->buf);
-      if (err)
-        ss_panic(26, err);
-      return;
-    }
-    w_t0 = call LocalTime.get();
-    w_diff = w_t0 - ssw_write_grp_start;
+    ssw_continue();
+  }
 
-    ssc.state = SSW_IDLE;
-    if (call SDResource.release())
-      ss_panic(27, 0);
+
+  async event void SDResourceRequested.requested() {
+    ssw_yield = TRUE;
+  }
+
+  async event void SDResourceRequested.immediateRequested() { }
+
+
+  /*
+   * someone else powered the SD up.  If we are sitting on FULL buffers
+   * get them out now.
+   */
+  event void SDActive.on() {
+    if (ssc.state == SSW_IDLE && ssc.ssw_num_full)
+      post SSWriter_task();
   }
 
 
@@ -450,7 +787,7 @@ implementation {
     num_full = ssc.ssw_num_full;
 
     /* too many, we be gone */
-    if (num_full > SSW_NUM_BUFS)
+    if (ssc.ssw_nbufs > SSW_NUM_BUFS || num_full > ssc.ssw_nbufs)
       return;
     dblk = call DblkManager.get_dblk_nxt();
     while (num_full) {
@@ -462,7 +799,7 @@ implementation {
         return;                         /* that's weird, somethings wrong */
       call SDsa.write(dblk, handle->buf);
       idx++;
-      if (idx >= SSW_NUM_BUFS)
+      if (idx >= ssc.ssw_nbufs)
         idx = 0;
       dblk = call DblkManager.adv_dblk_nxt();
 
@@ -502,8 +839,8 @@ implementation {
   }
 
 
-  command uint32_t SS.get_dblk_high() {
-    return call DblkManager.get_dblk_high();
+  command uint32_t SS.get_dblk_high(uint32_t blk_id) {
+    return call DblkManager.blk_file_high(blk_id);
   }
 
 
@@ -521,16 +858,22 @@ implementation {
    *            *blk_offsetp    offset pointer (output)
    *            **bufp          if in memory, where offset lives (output)
    *
-   * return:    0               offset past eof.
+   * return:    0               offset past eof, or (circular) the data
+   *                            at offset has been or is about to be
+   *                            written over.
    *            blk_id          blk_id corresponding to offset requested
    *                            if >= dblk_nxt then offset is cached.  *bufp
    *                            set to non-null.
+   *
+   * offsets are logical, DblkManager maps them to the sector they live in.
+   * Once a circular stream has wrapped, anything within SSW_NUM_BUFS
+   * sectors of the oldest data is treated as gone, those sectors are
+   * next in line to be written.
    */
 
-  command uint32_t SS.where(uint32_t context, uint32_t offset, uint32_t *lenp,
-                            uint32_t *blk_offsetp, uint8_t **bufp) {
-    uint32_t dblk_low, dblk_nxt;
-    uint32_t rel_blk;                   /* relative block id    */
+  command uint32_t SS.where(uint32_t context, uint64_t offset, uint32_t *lenp,
+                            uint64_t *blk_offsetp, uint8_t **bufp) {
+    uint64_t nxt_offset, oldest;
     uint32_t blk_id;                    /* absolute block id    */
     uint32_t idx;                       /* buffer index, cached */
 
@@ -545,15 +888,19 @@ implementation {
     if (offset >= call SS.eof_offset())
       return 0;
 
-    dblk_low = call DblkManager.get_dblk_low();
-    dblk_nxt = call DblkManager.get_dblk_nxt();
-    rel_blk  = offset >> SD_BLOCKSIZE_NBITS;
-    blk_id   = rel_blk + dblk_low;
+    /* wrapped, overwritten (or about to be) */
+    oldest = call DblkManager.dblk_oldest_offset();
+    if (oldest && offset >= SD_BLOCKSIZE &&
+        offset < oldest + (SSW_NUM_BUFS << SD_BLOCKSIZE_NBITS))
+      return 0;
+
+    nxt_offset = call DblkManager.dblk_nxt_offset();
+    blk_id     = call DblkManager.offset_blk(offset);
 
     *lenp = SD_BLOCKSIZE;
-    *blk_offsetp = rel_blk << SD_BLOCKSIZE_NBITS;
+    *blk_offsetp = offset & ~(SD_BLOCKSIZE - 1);
 
-    if (offset < call DblkManager.dblk_nxt_offset())
+    if (offset < nxt_offset)
       return blk_id;
 
     /*
@@ -569,10 +916,10 @@ implementation {
      * we want to find the SSW index that corresponds to the offset we are
      * looking for.
      */
-    idx = blk_id - dblk_nxt;            /* how many past the last commit */
+    idx = (offset - nxt_offset) >> SD_BLOCKSIZE_NBITS; /* past last commit */
     idx += ssc.ssw_out;                 /* and figure out where in SSW   */
-    if (idx >= SSW_NUM_BUFS)            /* adjust for wrap               */
-      idx -= SSW_NUM_BUFS;
+    if (idx >= ssc.ssw_nbufs)           /* adjust for wrap               */
+      idx -= ssc.ssw_nbufs;
     *bufp = ssw_handles[idx].buf;
 
     /* full buffers (lenp set above), unless ALLOC buffer */
@@ -582,6 +929,69 @@ implementation {
   }
 
 
+  /*
+   * Tagnet.  group and bufs can be set.  Setting group to 0 goes back
+   * to adapting.  A bufs change takes effect once the ring allows.
+   */
+  command bool SswGroup.get_value(uint32_t *t, uint32_t *l) {
+    *t = ssc.ssw_group;
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool SswBufs.get_value(uint32_t *t, uint32_t *l) {
+    *t = ssc.ssw_nbufs;
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool SswMaxFull.get_value(uint32_t *t, uint32_t *l) {
+    *t = ssc.ssw_max_full;
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool SswLatP50.get_value(uint32_t *t, uint32_t *l) {
+    *t = ssw_lat_pct(50);
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool SswLatP95.get_value(uint32_t *t, uint32_t *l) {
+    *t = ssw_lat_pct(95);
+    *l = 4;
+    return 1;
+  }
+
+
+  command bool SswGroup.set_value(uint32_t *t, uint32_t *l) {
+    if (*t >= ssc.ssw_nbufs)
+      return FALSE;
+    ssw_tune_s.fixed_group = *t;
+    if (*t)
+      ssc.ssw_group = *t;
+    return TRUE;
+  }
+
+
+  command bool SswBufs.set_value(uint32_t *t, uint32_t *l) {
+    if (*t < SSW_MIN_BUFS || *t > SSW_NUM_BUFS)
+      return FALSE;
+    ssw_tune_s.req_nbufs = *t;
+    ssw_resize();
+    return TRUE;
+  }
+
+
+  command bool SswMaxFull.set_value(uint32_t *t, uint32_t *l) { return FALSE; }
+  command bool SswLatP50.set_value(uint32_t *t, uint32_t *l)  { return FALSE; }
+  command bool SswLatP95.set_value(uint32_t *t, uint32_t *l)  { return FALSE; }
+
+
   default event void SS.dblk_stream_full()          { }
   default event void SS.dblk_advanced(uint32_t last) { }
 
@@ -29,11 +29,12 @@ interface StreamStorage {
 
 
   /**
-   * get_dblk_high(): get the upper inclusive limit of the Dblk Area.
+   * get_dblk_high(): get the upper inclusive limit of the DBLK file
+   * holding blk_id.  The Dblk Area can be more than one DBLK file.
    *
-   * return absolute blk_id of the end (inclusive) of the DBLK file
+   * return absolute blk_id of the end (inclusive) of that DBLK file
    */
-  command uint32_t get_dblk_high();
+  command uint32_t get_dblk_high(uint32_t blk_id);
 
 
   /**
@@ -47,25 +48,29 @@ interface StreamStorage {
    * committed_offset() will return the offset of all data that has been
    * physically written to disk.
    *
+   * offsets are logical offsets into the data stream (all the DBLK
+   * files), 64 bits.
+   *
    * can be called from anywhere.
    */
-  async command uint32_t eof_offset();
-  async command uint32_t committed_offset();
+  async command uint64_t eof_offset();
+  async command uint64_t committed_offset();
 
 
   /**
    * where(): determine where a given offset in the Dblk stream lives.
    *
    * @param   'uint32_t context'
-   * @param   'uint32_t offset'       offset to find
+   * @param   'uint64_t offset'       offset to find
    * @param   'uint32_t *lenp'        pointer to returned length
-   * @param   'uint32_t *blk_offsetp' pointer to returned blk offset
+   * @param   'uint64_t *blk_offsetp' pointer to returned blk offset
    * @param   'uint8_t **bufp'        pointer to returned buffer
    *
    * @return: 'uint32_t blk_id'       absolute blk_id of found offset.
+   *                                  0 if past eof or overwritten.
    */
-  command uint32_t where(uint32_t context, uint32_t offset, uint32_t *lenp,
-                         uint32_t *blk_offsetp, uint8_t **bufp);
+  command uint32_t where(uint32_t context, uint64_t offset, uint32_t *lenp,
+                         uint64_t *blk_offsetp, uint8_t **bufp);
 
 
   /**
@@ -73,6 +78,8 @@ interface StreamStorage {
    * for data block storage is full.  Typically this will cause the
    * sensing system to shut down and put the tag into a low power
    * try to connect to the world mode.
+   *
+   * A circular stream (DBLK_CIRCULAR) wraps instead and never signals.
    */
   event void dblk_stream_full();
 
@@ -0,0 +1,102 @@
+/*
+ * collect.h - Collect (record marshaller) definitions
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+#ifndef __COLLECT_H__
+#define __COLLECT_H__
+
+#include <typed_data.h>
+
+/*
+ * Record reservation (zero copy).
+ *
+ * Collect.reserve hands out space for a record directly in the SSW
+ * buffers.  The producer builds the header in place and moves its data
+ * directly into the data fragments.  Collect.commit then fills in
+ * recnum, systime (if requested), and recsum.
+ *
+ * A usecs trailer (if on) is reserved behind the data and filled in by
+ * the commit.  The producer never sees it, it sets len to hlen + dlen
+ * as always.
+ *
+ * Records are a maximum of DT_MAX_RLEN (1024) bytes.  Worst case, a
+ * record starts near the end of a sector and covers the remainder of
+ * that sector, one full sector, and part of a third.  So at most
+ * DC_MAX_FRAGS data fragments.
+ *
+ * hdr:       where the producer builds the header.  If the header fits
+ *            in the current sector, this points directly into the SSW
+ *            buffer.  Otherwise it points at a staging area inside of
+ *            Collect and the header gets scattered out on commit.
+ * data[]:    data fragments, each pointing directly into an SSW buffer.
+ * dlen[]:    length of each data fragment.
+ * nfrags:    number of data fragments in play.  1 is the fast path,
+ *            the entire data area is contiguous.
+ */
+
+#define DC_MAX_FRAGS 3
+
+typedef struct {
+  dt_header_t *hdr;
+  uint8_t     *data[DC_MAX_FRAGS];
+  uint16_t     dlen[DC_MAX_FRAGS];
+  uint8_t      nfrags;
+} dc_resv_t;
+
+
+/*
+ * Load shedding.
+ *
+ * If the SD can't keep up (slow write bursts) SSW runs out of buffers.
+ * Rather than panicking, Collect sheds records based on the priority of
+ * their dtype.  Each priority leaves some number of SSW buffers in
+ * reserve for higher priority records.  CRIT records have no reserve
+ * of their own, they only shed when SSW is completely out of buffers.
+ * A shed SYNC/REBOOT leaves the prev_sync chain where it was, a shed
+ * INDEX loses that level's entries.
+ *
+ * Drops are counted per dtype and per priority.  NORM and BULK counts
+ * since the last SYNC are laid down in the next SYNC record, CRIT drops
+ * show up via .drop_dtype.
+ *
+ * DC_RESERVE_<pri>: number of free SSW buffers that must remain after
+ * a record of priority <pri> has been laid down.
+ */
+typedef enum {
+  DC_PRI_CRIT = 0,                      /* REBOOT, VERSION, SYNC, INDEX */
+  DC_PRI_NORM,                          /* EVENT, decoded gps, sensors */
+  DC_PRI_BULK,                          /* GPS_RAW, shed first */
+  DC_PRI_MAX,
+} dc_pri_t;
+
+#define DC_RESERVE_NORM 1
+#define DC_RESERVE_BULK 3
+
+
+/*
+ * usecs trailers (dt_usecs_t, see typed_data.h) on ordinary records.
+ * Boot default, can be changed on the fly via Tagnet (.usecs).
+ */
+#ifndef DC_USECS
+#define DC_USECS FALSE
+#endif
+
+#endif  /* __COLLECT_H__ */
@@ -28,16 +28,35 @@
 
 #include "sd.h"
 
-/* number of buffers that StreamStorage is using */
+/*
+ * number of buffers reserved for StreamStorage (the pool).  How many of
+ * them are in play (ssw_nbufs) can be changed at run time, between
+ * SSW_MIN_BUFS and SSW_NUM_BUFS.
+ */
 #define SSW_NUM_BUFS   10
+#define SSW_MIN_BUFS   3
 
 /*
  * SSW_GROUP defines how many buffers to group together before trying to fire up the SD
  * to write them out.   Amortizes the turn on cost over this many buffers.  Note that there
  * need to be more than this number of buffers so the collection system has something to
  * write into while the writes are happening.
+ *
+ * SSW_GROUP is where we start.  The group size in use (ssw_group) is
+ * retuned after each group is written, see SSWriteP (ssw_tune).
+ *
+ * SSW_EXPOSE_MS: longest we want data sitting in RAM waiting for a
+ *     group to fill.  Sparse data shrinks the group.
+ * SSW_AMORT:     power up (request to grant) should be no more than
+ *     1/SSW_AMORT of a group's time on the SD.  A slow to start card
+ *     grows the group.
+ * SSW_LAT_HIST:  number of log2 ms buckets for group latency (request
+ *     to done).  bucket 0 < 1ms, bucket n [2^(n-1), 2^n) ms.
  */
-#define SSW_GROUP  4
+#define SSW_GROUP      4
+#define SSW_EXPOSE_MS  (60 * 1024)
+#define SSW_AMORT      2
+#define SSW_LAT_HIST   12
 
 /*
  * Stream Storage Buffer States
@@ -108,6 +127,9 @@ typedef struct {
  * ssw_alloc:    Next buffer to be given out.
  * ssw_num_full: number of full buffers including the one being written.
  * ssw_max_full: maximum number of full buffers ever
+ * ssw_run:      number of buffers in the multi-block write in flight.
+ * ssw_nbufs:    buffers in play, ring indices wrap here.
+ * ssw_group:    full buffers needed before we fire up the SD.
  */
 
 typedef enum {
@@ -129,7 +151,9 @@ typedef struct {
   uint8_t     ssw_alloc;	/* next buffer to be allocated. */
   uint8_t     ssw_num_full;	/* number of full buffers including active */
   uint8_t     ssw_max_full;	/* maximum that ever went, max */
-  uint8_t     pad;
+  uint8_t     ssw_run;		/* buffers in current multi-block write */
+  uint8_t     ssw_nbufs;	/* active buffers, <= SSW_NUM_BUFS */
+  uint8_t     ssw_group;	/* current group size */
 
   uint16_t    majik_b;		/* tombstone */
 } ss_control_t;
@@ -48,6 +48,7 @@ implementation {
   components new TimerMilliC() as GPSTxTimer;
   components new TimerMilliC() as GPSRxTimer;
   components new TimerMilliC() as GPSRxErrorTimer;
+  components new TimerMilliC() as GPSRxDrainTimer;
   components     LocalTimeMilliC;
   components     CollectC;
 
@@ -58,6 +59,7 @@ implementation {
   Gsd4eUP.GPSTxTimer -> GPSTxTimer;
   Gsd4eUP.GPSRxTimer -> GPSRxTimer;
   Gsd4eUP.GPSRxErrorTimer -> GPSRxErrorTimer;
+  Gsd4eUP.GPSRxDrainTimer -> GPSRxDrainTimer;
   Gsd4eUP.LocalTime  -> LocalTimeMilliC;
   Gsd4eUP.Collect      -> CollectC;
   Gsd4eUP.CollectEvent -> CollectC;
@@ -27,14 +27,17 @@ configuration HplGPS0C {
 implementation {
   components Msp432UsciA2P as UsciP;
   components GPS0HardwareP as GpsHwP;
+  components Msp432DmaC    as DMAC;
 
   Gsd4eUHardware = GpsHwP;
   GpsHwP.Usci      -> UsciP;
   GpsHwP.Interrupt -> UsciP;
+  GpsHwP.DmaRX     -> DMAC.Dma[5];
 
   components PanicC, PlatformC;
   GpsHwP.Panic    -> PanicC;
   GpsHwP.Platform -> PlatformC;
 
+  PlatformC.PeripheralInit -> DMAC;
   PlatformC.PeripheralInit -> GpsHwP;
 }
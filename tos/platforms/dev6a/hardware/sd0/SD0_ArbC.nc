@@ -30,7 +30,7 @@
  * power down when no further requests are pending.
  *
  * SD0_ArbC pulls in SD0_ArbP which has the arbiter.  We can't pull ArbP
- * into ArbC because FcfsArbiterC is generic and needs to be a singleton.
+ * into ArbC because the scheduler (SDSchedC) is generic and needs to be a singleton.
  *
  * SD0C is the exported SD port wired to a particular SPI port and
  * connected to the actual driver.
@@ -52,6 +52,7 @@ generic configuration SD0_ArbC() {
 
     interface Resource;
     interface ResourceRequested;
+    interface SDActive;
   }
 }
 
@@ -65,6 +66,7 @@ implementation {
 
   Resource                 = ArbP.Resource[CLIENT_ID];
   ResourceRequested        = ArbP.ResourceRequested[CLIENT_ID];
+  SDActive                 = ArbP.SDActive[CLIENT_ID];
 
   SDread  = SD.SDread[CLIENT_ID];
   SDwrite = SD.SDwrite[CLIENT_ID];
@@ -27,12 +27,18 @@ configuration SD0_ArbP {
   provides {
     interface Resource[uint8_t id];
     interface ResourceRequested[uint8_t id];
+    interface TagnetAdapter<uint32_t> as SDHold;    /* power hold cap */
+    interface SDActive[uint8_t id];                 /* SD up? */
   }
+  uses interface SDPriority[uint8_t id];
 }
 implementation {
-  components new FcfsArbiterC(SD0_RESOURCE) as ArbiterC;
+  components new SDSchedC(SD0_RESOURCE) as ArbiterC;
   Resource             = ArbiterC;
   ResourceRequested    = ArbiterC;
+  SDPriority           = ArbiterC;
+  SDHold               = ArbiterC;
+  SDActive             = ArbiterC;
 
   components SD0C as SD;
   SD.ResourceDefaultOwner -> ArbiterC;
@@ -68,6 +68,12 @@
 #define GSD4E_PINS_MODULE   do { P3->SEL0 |=  0x0c; } while (0)
 #define GSD4E_PINS_PORT     do { P3->SEL0 &= ~0x0c; } while (0)
 
+/*
+ * block (dma) receive off the gps UART, eUSCI_A2.  see GPS0HardwareP.
+ */
+#define GSD4E_DMA_RX_TRIGGER MSP432_DMA_CH5_A2_RX
+#define GSD4E_DMA_RX_ADDR    EUSCI_A2->RXBUF
+
 /* radio - si446x - (B2) */
 #define SI446X_CTS_PORT     P2
 #define SI446X_CTS_PIN      3
@@ -23,6 +23,7 @@
 #include <panic.h>
 #include <platform_panic.h>
 #include <msp432.h>
+#include <msp432dma.h>
 
 /*
  * The eUSCI for the UART is always clocked by SMCLK which is DCOCLK/2.  So
@@ -49,6 +50,7 @@ module GPS0HardwareP {
   uses {
     interface HplMsp432Usci    as Usci;
     interface HplMsp432UsciInt as Interrupt;
+    interface Msp432Dma        as DmaRX;
     interface Panic;
     interface Platform;
   }
@@ -57,6 +59,7 @@ implementation {
 
   enum {
     UART_MAX_BUSY_WAIT = 10000,                 /* 10ms max busy wait time */
+    GPS_DMA_MAX_LEN    = 1024,                  /* uDMA max per cycle */
   };
 
 
@@ -149,7 +152,7 @@ implementation {
 
   norace uint8_t *m_rx_buf;
   norace uint16_t m_rx_len;
-  norace uint32_t m_tx_idx, m_rx_idx;
+  norace uint32_t m_tx_idx;
 
   command error_t Init.init() {
     call Usci.enableModuleInterrupt();
@@ -274,22 +277,69 @@ implementation {
     call Usci.getRxbuf();
   }
 
+  /*
+   * Block receive.
+   *
+   * The dma engine pulls bytes off the UART into m_rx_buf, rx interrupts
+   * are off.  When it reaches the end, DmaRX.dma_interrupted restarts it
+   * at the front and signals gps_receive_block_done.  The uDMA writes the
+   * remaining count back into the channel's control block as it goes,
+   * which is where gps_receive_block_idx gets its answer.
+   */
+  void gps_rx_dma_start() {
+    uint32_t control;
+
+    control = UDMA_CHCTL_DSTINC_8 | UDMA_CHCTL_SRCINC_NONE |
+      MSP432_DMA_SIZE_8 | UDMA_CHCTL_ARBSIZE_1 | MSP432_DMA_MODE_BASIC;
+    call DmaRX.dma_start_channel(GSD4E_DMA_RX_TRIGGER, m_rx_len,
+        m_rx_buf, (void *) &(GSD4E_DMA_RX_ADDR), control);
+  }
+
+
   async command error_t HW.gps_receive_block(uint8_t *ptr, uint16_t len) {
-    if (!len || !ptr)
+    if (!len || !ptr || len > GPS_DMA_MAX_LEN)
       return FAIL;
 
-    if (m_rx_buf)
-      return EBUSY;
+    atomic {
+      if (m_rx_buf)
+        return EBUSY;
 
-    m_rx_len = len;
-    m_rx_idx = 0;
-    m_rx_buf = ptr;
-    call HW.gps_rx_int_enable();
+      call Usci.disableRxIntr();        /* RXIFG belongs to the dma now */
+      call HW.gps_clear_rx_errs();
+      m_rx_len = len;
+      m_rx_buf = ptr;
+      gps_rx_dma_start();
+      call DmaRX.dma_enable_int();
+    }
     return SUCCESS;
   }
 
   async command void    HW.gps_receive_block_stop() {
-    m_rx_buf = NULL;
+    atomic {
+      call DmaRX.dma_disable_int();
+      call DmaRX.dma_stop_channel();
+      m_rx_buf = NULL;
+    }
+  }
+
+  /*
+   * how far into the buffer the dma has gotten, 0..len.  len says the
+   * dma has finished the lap and hasn't been restarted yet.
+   */
+  async command uint16_t HW.gps_receive_block_idx() {
+    dma_cb_t *cb;
+    uint32_t  control;
+
+    atomic {
+      if (!m_rx_buf)
+        return 0;
+      cb = call DmaRX.dma_cb();
+      control = cb->control;
+      if ((control & UDMA_CHCTL_XFERMODE_M) == UDMA_CHCTL_XFERMODE_STOP)
+        return m_rx_len;
+      return m_rx_len - (((control & UDMA_CHCTL_XFERSIZE_M) >>
+                          UDMA_CHCTL_XFERSIZE_S) + 1);
+    }
   }
 
   async command void    HW.gps_rx_off() { }
@@ -356,17 +406,13 @@ implementation {
         if (stat_word & EUSCI_A_STATW_RXERR)
           signal HW.gps_rx_err(stat_word);
 
-        /* if there was an rx_err, the read of RxBuf will clear it */
+        /*
+         * if there was an rx_err, the read of RxBuf will clear it.
+         * rx interrupts are off while in block receive, so this is
+         * always the byte at a time path.
+         */
         data = call Usci.getRxbuf();
-        if (m_rx_buf) {
-          m_rx_buf[m_rx_idx++] = data;
-          if (m_rx_idx >= m_rx_len) {
-            buf = m_rx_buf;
-            m_rx_buf = NULL;
-            signal HW.gps_receive_block_done(buf, m_rx_len, SUCCESS);
-          }
-        } else
-          signal HW.gps_byte_avail(data);
+        signal HW.gps_byte_avail(data);
         return;
 
       case MSP432U_IV_TXIFG:
@@ -399,5 +445,13 @@ implementation {
     }
   }
 
+  async event void DmaRX.dma_interrupted() {
+    call DmaRX.dma_clear_int();
+    if (!m_rx_buf)
+      return;
+    gps_rx_dma_start();                 /* next lap */
+    signal HW.gps_receive_block_done(m_rx_buf, m_rx_len, SUCCESS);
+  }
+
   async event void Panic.hook() { }
 }
@@ -66,6 +66,9 @@ implementation {
   components new TimerMilliC() as SDTimer;
   SDdvrP.SDtimer -> SDTimer;
 
+  components new TimerMilliC() as SDBusyTimer;
+  SDdvrP.SDbusy  -> SDBusyTimer;
+
   components HplSD0C as HW;
   SDdvrP.HW -> HW;
 
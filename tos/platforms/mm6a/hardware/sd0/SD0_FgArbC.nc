@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2018 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * SD0_FgArbC: same as SD0_ArbC but the client is foreground to the SD
+ * scheduler (SDSchedP).  Foreground requests are served ahead of
+ * background ones and ask the current owner to yield.  Use for latency
+ * sensitive readers (Tagnet access to the data stream and panic area).
+ */
+
+#ifndef SD0_RESOURCE
+#define SD0_RESOURCE     "SD0.Resource"
+#endif
+
+generic configuration SD0_FgArbC() {
+  provides {
+    interface SDread;
+    interface SDwrite;
+    interface SDerase;
+
+    interface Resource;
+    interface ResourceRequested;
+  }
+}
+
+implementation {
+  enum {
+    CLIENT_ID = unique(SD0_RESOURCE),
+  };
+
+  components SD0_ArbP as ArbP;
+  components SD0C as SD;
+  components new SDForegroundP() as FgP;
+
+  Resource                 = ArbP.Resource[CLIENT_ID];
+  ResourceRequested        = ArbP.ResourceRequested[CLIENT_ID];
+  ArbP.SDPriority[CLIENT_ID] -> FgP;
+
+  SDread  = SD.SDread[CLIENT_ID];
+  SDwrite = SD.SDwrite[CLIENT_ID];
+  SDerase = SD.SDerase[CLIENT_ID];
+}
@@ -96,6 +96,12 @@
 #define GSD4E_PINS_MODULE   do { P7->SEL0 |=  0x0c; } while (0)
 #define GSD4E_PINS_PORT     do { P7->SEL0 &= ~0x0c; } while (0)
 
+/*
+ * block (dma) receive off the gps UART, eUSCI_A0.  see GPS0HardwareP.
+ */
+#define GSD4E_DMA_RX_TRIGGER MSP432_DMA_CH1_A0_RX
+#define GSD4E_DMA_RX_ADDR    EUSCI_A0->RXBUF
+
 /* radio - si446x - (B2) */
 #define SI446X_CTS_PORT     P4
 #define SI446X_CTS_PIN      1